@@ -0,0 +1,276 @@
+#include "Benchmark.h"
+#include <Core/Engine.h>
+#include <Core/ResourceManager.h>
+#include <Core/Logger.h>
+#include <Utils/Helpers.h>
+
+#include <assimp/postprocess.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+  constexpr uint32_t MAX_MODEL_LOAD_FRAMES = 10000;  // (give up on a scene whose model never finishes streaming in)
+
+  // Quote a CSV field, doubling any quotes inside it, so commas and newlines in it don't split it into columns:
+  std::string quoteCSV(const std::string& str)
+  {
+    std::string quoted = "\"";
+    for (const char c : str)
+    {
+      if (c == '"')
+        quoted.push_back('"');
+      quoted.push_back(c);
+    }
+    quoted.push_back('"');
+    return quoted;
+  }
+
+  void writeStatsJSON(std::ofstream& file, const char* name, float mean, float min, float max, float p50, float p95, float p99)
+  {
+    file << "      \"" << name << "\": { \"mean\": " << mean << ", \"min\": " << min << ", \"max\": " << max
+      << ", \"p50\": " << p50 << ", \"p95\": " << p95 << ", \"p99\": " << p99 << " }";
+  }
+}
+
+bool cassidy::Benchmark::run(cassidy::Engine& engine, const Settings& settings)
+{
+  if (!loadSceneList(settings.sceneListPath))
+    return false;
+
+  m_results.clear();
+  for (const BenchScene& scene : m_scenes)
+  {
+    if (!setUpScene(engine, scene))
+      continue;
+
+    m_results.push_back(runScene(engine, scene, settings));
+
+    const SceneResults& results = m_results.back();
+    CS_LOG_INFO("{0} x{1}: CPU p50 {2:.3f}ms, p99 {3:.3f}ms | GPU p50 {4:.3f}ms, p99 {5:.3f}ms", scene.modelPath,
+      results.numInstances, results.cpuStats.p50, results.cpuStats.p99, results.gpuStats.p50, results.gpuStats.p99);
+  }
+
+  m_deviceName = engine.getRenderer().getPhysDeviceProperties().deviceName;
+
+  const bool wroteJSON = writeJSON(settings.outputPath + ".json", settings);
+  const bool wroteCSV = writeCSV(settings.outputPath + ".csv");
+  return wroteJSON && wroteCSV && m_results.size() == m_scenes.size();
+}
+
+bool cassidy::Benchmark::loadSceneList(const std::string& filepath)
+{
+  std::ifstream file(filepath);
+  if (!file.is_open())
+  {
+    CS_LOG_ERROR("Failed to open benchmark scene list {0}!", filepath);
+    return false;
+  }
+
+  m_scenes.clear();
+
+  std::string line;
+  while (std::getline(file, line))
+  {
+    if (line.empty() || line[0] == '#') continue;
+
+    std::istringstream lineStream(line);
+    BenchScene scene;
+    if (!(lineStream >> scene.modelPath)) continue;
+
+    lineStream >> scene.gridSize >> scene.spacing;
+    scene.gridSize = std::max(scene.gridSize, 1U);
+    m_scenes.push_back(scene);
+  }
+
+  CS_LOG_INFO("Loaded {0} benchmark scenes from {1}", m_scenes.size(), filepath);
+  return !m_scenes.empty();
+}
+
+bool cassidy::Benchmark::setUpScene(cassidy::Engine& engine, const BenchScene& scene)
+{
+  constexpr cassidy::ModelManager& modelManager = cassidy::globals::g_resourceManager.modelManager;
+  const std::string modelPath = MESH_ABS_FILEPATH + scene.modelPath;
+
+  // Clearing the scene unloads the previous scene's model once it's no longer in flight:
+  engine.getScene().clear();
+  const cassidy::ModelHandle modelHandle = modelManager.loadModelAsync(modelPath, &engine.getRenderer(), aiProcess_FlipUVs);
+
+  // Keep drawing (untimed) while the model streams in, since finished uploads are picked up by the renderer:
+  for (uint32_t i = 0; i < MAX_MODEL_LOAD_FRAMES; ++i)
+  {
+    const cassidy::Model* model = modelManager.getModel(modelHandle);
+    const LoadResult loadResult = model ? model->getLoadResult() : LoadResult::NOT_FOUND;
+    if (loadResult != LoadResult::READY_TO_LOAD && loadResult != LoadResult::UPLOADING)
+      break;
+
+    engine.renderFrame();
+  }
+
+  const cassidy::Model* model = modelManager.getModel(modelHandle);
+  const bool isLoaded = model && model->getLoadResult() == LoadResult::SUCCESS;
+  if (!isLoaded)
+    CS_LOG_ERROR("Failed to load benchmark model {0}, skipping scene!", scene.modelPath);
+  else
+    engine.getScene().addInstanceGrid(modelHandle, scene.gridSize, scene.spacing);
+
+  // The scene's instances keep the model loaded from here on:
+  modelManager.releaseModel(modelHandle);
+  return isLoaded;
+}
+
+cassidy::Benchmark::SceneResults cassidy::Benchmark::runScene(cassidy::Engine& engine, const BenchScene& scene,
+  const Settings& settings)
+{
+  SceneResults results;
+  results.scene = scene;
+  results.numInstances = engine.getScene().getNumInstances();
+
+  CameraPath cameraPath;
+  if (settings.cameraPathPath.empty() || !cameraPath.load(settings.cameraPathPath))
+  {
+    const float radius = std::max(3.0f, scene.gridSize * scene.spacing * 0.75f);
+    cameraPath.buildOrbit(radius, radius * 0.35f, 9);
+  }
+
+  cassidy::Camera& camera = engine.getCamera();
+  for (uint32_t i = 0; i < settings.numWarmupFrames; ++i)
+  {
+    cameraPath.apply(camera, static_cast<float>(i) / std::max(settings.numWarmupFrames, 1U));
+    engine.renderFrame();
+  }
+
+  // GPU times are read back FRAMES_IN_FLIGHT frames after they're drawn, so keep drawing (holding the camera at
+  // the end of the path) until the last measured frame's time is available:
+  const uint32_t numFramesToDraw = settings.numMeasuredFrames + FRAMES_IN_FLIGHT;
+  std::vector<float> cpuTimes(numFramesToDraw);
+  std::vector<float> gpuReadings(numFramesToDraw);
+
+  for (uint32_t i = 0; i < numFramesToDraw; ++i)
+  {
+    const float t = static_cast<float>(i) / std::max(settings.numMeasuredFrames - 1, 1U);
+    cameraPath.apply(camera, std::min(t, 1.0f));
+
+    const auto frameStart = std::chrono::steady_clock::now();
+    engine.renderFrame();
+    const auto frameEnd = std::chrono::steady_clock::now();
+
+    cpuTimes[i] = std::chrono::duration<float, std::milli>(frameEnd - frameStart).count();
+    gpuReadings[i] = engine.getRenderer().getGpuFrameTimeMs();
+  }
+
+  std::vector<float> cpuSamples(settings.numMeasuredFrames);
+  std::vector<float> gpuSamples(settings.numMeasuredFrames);
+  results.frames.resize(settings.numMeasuredFrames);
+  for (uint32_t i = 0; i < settings.numMeasuredFrames; ++i)
+  {
+    results.frames[i] = { cpuTimes[i], gpuReadings[i + FRAMES_IN_FLIGHT] };
+    cpuSamples[i] = results.frames[i].cpuMs;
+    gpuSamples[i] = results.frames[i].gpuMs;
+  }
+
+  results.cpuStats = computeStats(std::move(cpuSamples));
+  results.gpuStats = computeStats(std::move(gpuSamples));
+  return results;
+}
+
+cassidy::Benchmark::TimingStats cassidy::Benchmark::computeStats(std::vector<float> samples)
+{
+  TimingStats stats;
+  if (samples.empty()) return stats;
+
+  std::sort(samples.begin(), samples.end());
+
+  // Nearest-rank percentiles, so every statistic is a frame time that was actually measured:
+  auto percentile = [&](float p) {
+    const size_t rank = static_cast<size_t>(std::ceil(p * 0.01f * samples.size()));
+    return samples[std::clamp(rank, size_t(1), samples.size()) - 1];
+  };
+
+  double sum = 0.0;
+  for (const float sample : samples)
+    sum += sample;
+
+  stats.mean = static_cast<float>(sum / samples.size());
+  stats.min = samples.front();
+  stats.max = samples.back();
+  stats.p50 = percentile(50.0f);
+  stats.p95 = percentile(95.0f);
+  stats.p99 = percentile(99.0f);
+  return stats;
+}
+
+bool cassidy::Benchmark::writeJSON(const std::string& filepath, const Settings& settings) const
+{
+  std::ofstream file(filepath);
+  if (!file.is_open())
+  {
+    CS_LOG_ERROR("Failed to open {0} for writing benchmark results!", filepath);
+    return false;
+  }
+
+  file << "{\n";
+  file << "  \"device\": \"" << cassidy::helper::escapeJSON(m_deviceName) << "\",\n";
+  file << "  \"warmupFrames\": " << settings.numWarmupFrames << ",\n";
+  file << "  \"measuredFrames\": " << settings.numMeasuredFrames << ",\n";
+  file << "  \"scenes\": [\n";
+
+  for (size_t i = 0; i < m_results.size(); ++i)
+  {
+    const SceneResults& results = m_results[i];
+    const TimingStats& cpu = results.cpuStats;
+    const TimingStats& gpu = results.gpuStats;
+
+    file << "    {\n";
+    file << "      \"model\": \"" << cassidy::helper::escapeJSON(results.scene.modelPath) << "\",\n";
+    file << "      \"gridSize\": " << results.scene.gridSize << ",\n";
+    file << "      \"spacing\": " << results.scene.spacing << ",\n";
+    file << "      \"instances\": " << results.numInstances << ",\n";
+    writeStatsJSON(file, "cpuMs", cpu.mean, cpu.min, cpu.max, cpu.p50, cpu.p95, cpu.p99);
+    file << ",\n";
+    writeStatsJSON(file, "gpuMs", gpu.mean, gpu.min, gpu.max, gpu.p50, gpu.p95, gpu.p99);
+    file << ",\n";
+
+    file << "      \"frames\": [";
+    for (size_t f = 0; f < results.frames.size(); ++f)
+    {
+      file << (f == 0 ? "" : ", ") << "[" << results.frames[f].cpuMs << ", " << results.frames[f].gpuMs << "]";
+    }
+    file << "]\n";
+    file << "    }" << (i + 1 < m_results.size() ? "," : "") << "\n";
+  }
+
+  file << "  ]\n";
+  file << "}\n";
+
+  CS_LOG_INFO("Wrote benchmark results to {0}", filepath);
+  return file.good();
+}
+
+bool cassidy::Benchmark::writeCSV(const std::string& filepath) const
+{
+  std::ofstream file(filepath);
+  if (!file.is_open())
+  {
+    CS_LOG_ERROR("Failed to open {0} for writing benchmark results!", filepath);
+    return false;
+  }
+
+  file << "model,instances,frame,cpu_ms,gpu_ms\n";
+  for (const SceneResults& results : m_results)
+  {
+    const std::string modelField = quoteCSV(results.scene.modelPath);
+    for (size_t f = 0; f < results.frames.size(); ++f)
+    {
+      file << modelField << ", << results.numInstances << "," << f << ","
+        << results.frames[f].cpuMs << "," << results.frames[f].gpuMs << "\n";
+    }
+  }
+
+  CS_LOG_INFO("Wrote benchmark frame times to {0}", filepath);
+  return file.good();
+}
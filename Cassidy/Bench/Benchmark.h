@@ -0,0 +1,73 @@
+#pragma once
+#include <Bench/CameraPath.h>
+
+#include <string>
+#include <vector>
+
+namespace cassidy
+{
+  class Engine;
+
+  // Runs a list of scenes through a headless engine along a deterministic camera path, recording the CPU and GPU time
+  // of every measured frame and writing them (with percentile statistics per scene) to JSON and CSV:
+  class Benchmark
+  {
+  public:
+    struct Settings
+    {
+      std::string sceneListPath;
+      std::string cameraPathPath;     // (orbit around each scene if empty)
+      std::string outputPath = "CassidyBench";  // (results are written to <outputPath>.json and <outputPath>.csv)
+      uint32_t numWarmupFrames = 60;
+      uint32_t numMeasuredFrames = 600;
+    };
+
+    bool run(cassidy::Engine& engine, const Settings& settings);
+
+  private:
+    // One line of the scene list, as "<model path relative to Meshes/> [grid size] [spacing]":
+    struct BenchScene
+    {
+      std::string modelPath;
+      uint32_t gridSize = 1;
+      float spacing = 5.0f;
+    };
+
+    struct FrameTiming
+    {
+      float cpuMs;
+      float gpuMs;
+    };
+
+    struct TimingStats
+    {
+      float mean = 0.0f;
+      float min = 0.0f;
+      float max = 0.0f;
+      float p50 = 0.0f;
+      float p95 = 0.0f;
+      float p99 = 0.0f;
+    };
+
+    struct SceneResults
+    {
+      BenchScene scene;
+      uint32_t numInstances = 0;
+      std::vector<FrameTiming> frames;
+      TimingStats cpuStats;
+      TimingStats gpuStats;
+    };
+
+    bool loadSceneList(const std::string& filepath);
+    bool setUpScene(cassidy::Engine& engine, const BenchScene& scene);
+    SceneResults runScene(cassidy::Engine& engine, const BenchScene& scene, const Settings& settings);
+
+    static TimingStats computeStats(std::vector<float> samples);
+    bool writeJSON(const std::string& filepath, const Settings& settings) const;
+    bool writeCSV(const std::string& filepath) const;
+
+    std::vector<BenchScene> m_scenes;
+    std::vector<SceneResults> m_results;
+    std::string m_deviceName;
+  };
+}
@@ -0,0 +1,81 @@
+#include "CameraPath.h"
+#include <Core/Camera.h>
+#include <Core/Logger.h>
+
+#include <Vendor/glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+bool cassidy::CameraPath::load(const std::string& filepath)
+{
+  std::ifstream file(filepath);
+  if (!file.is_open())
+  {
+    CS_LOG_ERROR("Failed to open camera path {0}!", filepath);
+    return false;
+  }
+
+  m_keyframes.clear();
+
+  std::string line;
+  while (std::getline(file, line))
+  {
+    if (line.empty() || line[0] == '#') continue;
+
+    std::istringstream lineStream(line);
+    CameraKeyframe keyframe;
+    if (!(lineStream >> keyframe.position.x >> keyframe.position.y >> keyframe.position.z
+      >> keyframe.eulerAngles.x >> keyframe.eulerAngles.y))
+    {
+      CS_LOG_WARN("Skipping malformed camera path keyframe: {0}", line);
+      continue;
+    }
+    m_keyframes.push_back(keyframe);
+  }
+
+  CS_LOG_INFO("Loaded camera path with {0} keyframes ({1})", m_keyframes.size(), filepath);
+  return !m_keyframes.empty();
+}
+
+void cassidy::CameraPath::buildOrbit(float radius, float height, uint32_t numKeyframes)
+{
+  m_keyframes.clear();
+  numKeyframes = std::max(numKeyframes, 2U);
+
+  const float pitch = -glm::degrees(std::atan2(height, radius));
+  for (uint32_t i = 0; i < numKeyframes; ++i)
+  {
+    // Last keyframe returns to the start of the circle, with yaw kept increasing so interpolation never wraps:
+    const float angle = glm::two_pi<float>() * static_cast<float>(i) / static_cast<float>(numKeyframes - 1);
+
+    CameraKeyframe keyframe;
+    keyframe.position = glm::vec3(std::cos(angle) * radius, height, std::sin(angle) * radius);
+    keyframe.eulerAngles = glm::vec3(pitch, glm::degrees(angle) + 180.0f, 0.0f);
+    m_keyframes.push_back(keyframe);
+  }
+}
+
+cassidy::CameraKeyframe cassidy::CameraPath::sample(float t) const
+{
+  if (m_keyframes.empty()) return {};
+  if (m_keyframes.size() == 1) return m_keyframes[0];
+
+  const float scaledT = std::clamp(t, 0.0f, 1.0f) * static_cast<float>(m_keyframes.size() - 1);
+  const size_t first = std::min(static_cast<size_t>(scaledT), m_keyframes.size() - 2);
+  const float blend = scaledT - static_cast<float>(first);
+
+  CameraKeyframe result;
+  result.position = glm::mix(m_keyframes[first].position, m_keyframes[first + 1].position, blend);
+  result.eulerAngles = glm::mix(m_keyframes[first].eulerAngles, m_keyframes[first + 1].eulerAngles, blend);
+  return result;
+}
+
+void cassidy::CameraPath::apply(cassidy::Camera& camera, float t) const
+{
+  const CameraKeyframe keyframe = sample(t);
+  camera.setPosition(keyframe.position);
+  camera.setEulerAngles(keyframe.eulerAngles);
+}
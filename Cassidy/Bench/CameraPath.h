@@ -0,0 +1,40 @@
+#pragma once
+#include <Utils/Types.h>
+
+#include <string>
+#include <vector>
+
+namespace cassidy
+{
+  class Camera;
+
+  // Camera placement along a benchmark path:
+  struct CameraKeyframe
+  {
+    glm::vec3 position    = glm::vec3(0.0f);
+    glm::vec3 eulerAngles = glm::vec3(0.0f);  // (Pitch, Yaw, Roll), in degrees
+  };
+
+  // Keyframed camera path, sampled by normalised progress rather than elapsed time, so that every run renders exactly
+  // the same views regardless of how fast frames are drawn:
+  class CameraPath
+  {
+  public:
+    // One keyframe per line, as "x y z pitch yaw" (lines starting with '#' are ignored):
+    bool load(const std::string& filepath);
+
+    // Circle the origin at a fixed height, always looking at the centre of the scene:
+    void buildOrbit(float radius, float height, uint32_t numKeyframes);
+
+    // Linearly interpolate between keyframes, t = 0 at the first keyframe and t = 1 at the last one:
+    CameraKeyframe sample(float t) const;
+    void apply(cassidy::Camera& camera, float t) const;
+
+    // Getters/setters: ------------------------------------------------------------------------------------------
+    inline const std::vector<CameraKeyframe>& getKeyframes() const { return m_keyframes; }
+    inline bool                               isEmpty()      const { return m_keyframes.empty(); }
+
+  private:
+    std::vector<CameraKeyframe> m_keyframes;
+  };
+}
@@ -0,0 +1,49 @@
+#include <Core/Engine.h>
+#include <Bench/Benchmark.h>
+
+#include <cstring>
+#include <string>
+
+// Usage: CassidyBench [--scenes <scene list>] [--path <camera path>] [--warmup <frames>] [--frames <frames>]
+//                     [--out <output path, without extension>] [--width <pixels>] [--height <pixels>]
+int main(int argc, char* argv[])
+{
+  cassidy::Benchmark::Settings settings;
+  settings.sceneListPath = BENCH_SCENES_FILEPATH;
+  glm::uvec2 dimensions = glm::uvec2(1280, 720);
+
+  for (int i = 1; i < argc; ++i)
+  {
+    const bool hasValue = i + 1 < argc;
+
+    if (strcmp(argv[i], "--scenes") == 0 && hasValue)
+      settings.sceneListPath = argv[++i];
+    else if (strcmp(argv[i], "--path") == 0 && hasValue)
+      settings.cameraPathPath = argv[++i];
+    else if (strcmp(argv[i], "--warmup") == 0 && hasValue)
+      settings.numWarmupFrames = static_cast<uint32_t>(std::stoul(argv[++i]));
+    else if (strcmp(argv[i], "--frames") == 0 && hasValue)
+      settings.numMeasuredFrames = static_cast<uint32_t>(std::stoul(argv[++i]));
+    else if (strcmp(argv[i], "--out") == 0 && hasValue)
+      settings.outputPath = argv[++i];
+    else if (strcmp(argv[i], "--width") == 0 && hasValue)
+      dimensions.x = static_cast<uint32_t>(std::stoul(argv[++i]));
+    else if (strcmp(argv[i], "--height") == 0 && hasValue)
+      dimensions.y = static_cast<uint32_t>(std::stoul(argv[++i]));
+    else
+      CS_LOG_WARN("Unrecognised argument: {0}", argv[i]);
+  }
+
+  // Benchmarks always run headless, so results don't depend on the editor GUI or presentation:
+  cassidy::Engine engine(dimensions);
+  engine.setHeadless({ .enabled = true, .numFrames = 0 });
+
+  engine.init();
+
+  cassidy::Benchmark benchmark;
+  const bool succeeded = benchmark.run(engine, settings);
+
+  engine.release();
+
+  return succeeded ? 0 : 1;
+}
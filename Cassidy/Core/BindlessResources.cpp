@@ -0,0 +1,237 @@
+#include "BindlessResources.h"
+#include <Core/Renderer.h>
+#include <Core/Logger.h>
+#include <Utils/DescriptorBuilder.h>
+#include <Utils/Initialisers.h>
+#include <Utils/Helpers.h>
+
+#include <algorithm>
+#include <cstring>
+
+#define INITIAL_MATERIAL_CAPACITY 256
+
+void cassidy::BindlessResources::init(VkDevice device, VmaAllocator allocator, const VkPhysicalDeviceProperties& gpuProperties,
+  uint32_t maxTextures)
+{
+  m_device = device;
+  m_allocator = allocator;
+  m_maxTextures = maxTextures;
+
+  m_sampler = cassidy::helper::createTextureSampler(m_device, gpuProperties, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_REPEAT, VK_TRUE);
+
+  initLayouts();
+  initTextureSet();
+
+  m_materialBuffers.resize(FRAMES_IN_FLIGHT);
+  for (MaterialBuffer& materialBuffer : m_materialBuffers)
+  {
+    allocateMaterialBuffer(materialBuffer, INITIAL_MATERIAL_CAPACITY);
+  }
+
+  m_isEnabled = true;
+  CS_LOG_INFO("Initialised bindless resources ({0} texture slots)!", m_maxTextures);
+}
+
+void cassidy::BindlessResources::release()
+{
+  if (!m_isEnabled) return;
+
+  for (MaterialBuffer& materialBuffer : m_materialBuffers)
+  {
+    vmaDestroyBuffer(m_allocator, materialBuffer.buffer.buffer, materialBuffer.buffer.allocation);
+  }
+  m_materialBuffers.clear();
+
+  // (sets are freed along with their pool)
+  vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+  vkDestroyDescriptorSetLayout(m_device, m_textureSetLayout, nullptr);
+  vkDestroySampler(m_device, m_sampler, nullptr);
+
+  m_materials.clear();
+  m_freeMaterialIndices.clear();
+  m_freeTextureIndices.clear();
+  m_isEnabled = false;
+}
+
+uint32_t cassidy::BindlessResources::registerTexture(VkImageView view)
+{
+  std::lock_guard<std::mutex> textureLock(m_textureMutex);
+
+  uint32_t textureIndex;
+  if (!m_freeTextureIndices.empty())
+  {
+    textureIndex = m_freeTextureIndices.back();
+    m_freeTextureIndices.pop_back();
+  }
+  else if (m_nextTextureIndex < m_maxTextures)
+  {
+    textureIndex = m_nextTextureIndex++;
+  }
+  else
+  {
+    // Materials sample slot 0 (the magenta fallback) in place of an invalid slot, which makes the problem obvious.
+    // Returning slot 0 itself would let releasing this texture free the fallback's slot for reuse:
+    CS_LOG_ERROR("Out of bindless texture slots ({0})!", m_maxTextures);
+    return UINT32_MAX;
+  }
+
+  // The slot isn't used by any frame in flight, which update-unused-while-pending allows writing even though the set
+  // itself is bound in pending command buffers:
+  VkDescriptorImageInfo imageInfo = cassidy::init::descriptorImageInfo(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, view, VK_NULL_HANDLE);
+  VkWriteDescriptorSet write = cassidy::init::writeDescriptorSet(m_textureSet, 0, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1, &imageInfo);
+  write.dstArrayElement = textureIndex;
+  vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+
+  ++m_numTextures;
+  return textureIndex;
+}
+
+void cassidy::BindlessResources::releaseTexture(uint32_t textureIndex)
+{
+  // Slot 0 holds the fallback for the engine's whole lifetime, and an invalid slot was never taken:
+  if (textureIndex == 0 || textureIndex == UINT32_MAX) return;
+
+  std::lock_guard<std::mutex> textureLock(m_textureMutex);
+
+  // (partially bound, so the stale descriptor can be left in the slot until it's reused)
+  m_freeTextureIndices.push_back(textureIndex);
+  --m_numTextures;
+}
+
+uint32_t cassidy::BindlessResources::registerMaterial(const BindlessMaterialData& data)
+{
+  std::lock_guard<std::mutex> materialLock(m_materialMutex);
+
+  uint32_t materialIndex;
+  if (!m_freeMaterialIndices.empty())
+  {
+    materialIndex = m_freeMaterialIndices.back();
+    m_freeMaterialIndices.pop_back();
+    m_materials[materialIndex] = data;
+  }
+  else
+  {
+    materialIndex = static_cast<uint32_t>(m_materials.size());
+    m_materials.push_back(data);
+  }
+
+  ++m_numMaterials;
+  ++m_materialsVersion;
+  return materialIndex;
+}
+
+void cassidy::BindlessResources::updateMaterial(uint32_t materialIndex, const BindlessMaterialData& data)
+{
+  std::lock_guard<std::mutex> materialLock(m_materialMutex);
+  m_materials[materialIndex] = data;
+  ++m_materialsVersion;
+}
+
+void cassidy::BindlessResources::releaseMaterial(uint32_t materialIndex)
+{
+  std::lock_guard<std::mutex> materialLock(m_materialMutex);
+  m_freeMaterialIndices.push_back(materialIndex);
+  --m_numMaterials;
+}
+
+void cassidy::BindlessResources::uploadMaterials(uint32_t frameIndex)
+{
+  if (!m_isEnabled) return;
+
+  std::lock_guard<std::mutex> materialLock(m_materialMutex);
+
+  MaterialBuffer& materialBuffer = m_materialBuffers[frameIndex];
+  if (materialBuffer.uploadedVersion == m_materialsVersion) return;
+
+  // Only this frame's copy is replaced, and its fence has been waited on, so nothing is still reading it:
+  const uint32_t numMaterials = static_cast<uint32_t>(m_materials.size());
+  if (numMaterials > materialBuffer.capacity)
+  {
+    vmaDestroyBuffer(m_allocator, materialBuffer.buffer.buffer, materialBuffer.buffer.allocation);
+    allocateMaterialBuffer(materialBuffer, std::max(numMaterials, materialBuffer.capacity * 2));
+  }
+
+  // (the whole table is only a few KB, so it's simpler to copy than to track which entries changed)
+  memcpy(materialBuffer.mappedData, m_materials.data(), numMaterials * sizeof(BindlessMaterialData));
+  vmaFlushAllocation(m_allocator, materialBuffer.buffer.allocation, 0, numMaterials * sizeof(BindlessMaterialData));
+  materialBuffer.uploadedVersion = m_materialsVersion;
+}
+
+void cassidy::BindlessResources::bind(VkCommandBuffer cmd, VkPipelineLayout layout, uint32_t frameIndex) const
+{
+  const VkDescriptorSet sets[] = { m_textureSet, m_materialBuffers[frameIndex].set };
+  vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 2, 2, sets, 0, nullptr);
+}
+
+void cassidy::BindlessResources::initLayouts()
+{
+  // Texture array, sampled with one immutable sampler. Update-after-bind lets new textures be written into unused
+  // slots while frames using the set are still in flight:
+  const VkDescriptorSetLayoutBinding textureBindings[] = {
+    cassidy::init::descriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, m_maxTextures, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr),
+    cassidy::init::descriptorSetLayoutBinding(1, VK_DESCRIPTOR_TYPE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, &m_sampler),
+  };
+  const VkDescriptorBindingFlags textureBindingFlags[] = {
+    VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT,
+    0,
+  };
+
+  VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo = {};
+  bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+  bindingFlagsInfo.bindingCount = 2;
+  bindingFlagsInfo.pBindingFlags = textureBindingFlags;
+
+  VkDescriptorSetLayoutCreateInfo textureLayoutInfo = cassidy::init::descriptorSetLayoutCreateInfo(2, textureBindings);
+  textureLayoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+  textureLayoutInfo.pNext = &bindingFlagsInfo;
+  VK_CHECK(vkCreateDescriptorSetLayout(m_device, &textureLayoutInfo, nullptr, &m_textureSetLayout));
+
+  // Material buffer layout has no special flags, so can come from the layout cache:
+  VkDescriptorSetLayoutBinding materialBinding = cassidy::init::descriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+    1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr);
+  VkDescriptorSetLayoutCreateInfo materialLayoutInfo = cassidy::init::descriptorSetLayoutCreateInfo(1, &materialBinding);
+  m_materialSetLayout = cassidy::globals::g_descLayoutCache.createDescLayout(&materialLayoutInfo);
+}
+
+void cassidy::BindlessResources::initTextureSet()
+{
+  const VkDescriptorPoolSize poolSizes[] = {
+    { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, m_maxTextures },
+    { VK_DESCRIPTOR_TYPE_SAMPLER, 1 },
+    { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, FRAMES_IN_FLIGHT },
+  };
+
+  VkDescriptorPoolCreateInfo poolInfo = cassidy::init::descriptorPoolCreateInfo(3, poolSizes, 1 + FRAMES_IN_FLIGHT);
+  poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+  VK_CHECK(vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_descriptorPool));
+
+  VkDescriptorSetAllocateInfo allocInfo = cassidy::init::descriptorSetAllocateInfo(m_descriptorPool, 1, &m_textureSetLayout);
+  VK_CHECK(vkAllocateDescriptorSets(m_device, &allocInfo, &m_textureSet));
+}
+
+void cassidy::BindlessResources::allocateMaterialBuffer(MaterialBuffer& materialBuffer, uint32_t capacity)
+{
+  VkBufferCreateInfo bufferInfo = cassidy::init::bufferCreateInfo(capacity * sizeof(BindlessMaterialData),
+    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+  VmaAllocationCreateInfo allocInfo = cassidy::init::vmaAllocationCreateInfo(VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
+    VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT);
+
+  VmaAllocationInfo allocationInfo;
+  VK_CHECK(vmaCreateBuffer(m_allocator, &bufferInfo, &allocInfo, &materialBuffer.buffer.buffer,
+    &materialBuffer.buffer.allocation, &allocationInfo));
+
+  materialBuffer.mappedData = static_cast<BindlessMaterialData*>(allocationInfo.pMappedData);
+  materialBuffer.capacity = capacity;
+  materialBuffer.uploadedVersion = 0;
+
+  if (materialBuffer.set == VK_NULL_HANDLE)
+  {
+    VkDescriptorSetAllocateInfo setAllocInfo = cassidy::init::descriptorSetAllocateInfo(m_descriptorPool, 1, &m_materialSetLayout);
+    VK_CHECK(vkAllocateDescriptorSets(m_device, &setAllocInfo, &materialBuffer.set));
+  }
+
+  VkDescriptorBufferInfo materialBufferInfo = cassidy::init::descriptorBufferInfo(materialBuffer.buffer.buffer, 0, VK_WHOLE_SIZE);
+  VkWriteDescriptorSet write = cassidy::init::writeDescriptorSet(materialBuffer.set, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1,
+    &materialBufferInfo);
+  vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+}
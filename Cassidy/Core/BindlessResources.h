@@ -0,0 +1,98 @@
+#pragma once
+#include <Utils/Types.h>
+#include "Vendor/vma/vk_mem_alloc.h"
+
+#include <mutex>
+#include <vector>
+
+namespace cassidy
+{
+  // Per-material texture indices, as read by phongLightingBindless.frag (std430):
+  struct BindlessMaterialData
+  {
+    uint32_t albedoIndex    = 0;
+    uint32_t specularIndex  = 0;
+    uint32_t normalIndex    = 0;
+    uint32_t padding        = 0;
+  };
+
+  // Descriptor-indexed ("bindless") texture and material tables. Every texture in the texture library gets a slot in
+  // one large update-after-bind sampled image array (set 2), and every material is reduced to a BindlessMaterialData
+  // in a storage buffer (set 3) indexed with a push constant, so drawing a mesh never has to bind a descriptor set.
+  //
+  // Only used if the device supports descriptor indexing, in which case it's chosen once at startup (textures and
+  // materials are registered for one mode or the other, never both).
+  class BindlessResources
+  {
+  public:
+    void init(VkDevice device, VmaAllocator allocator, const VkPhysicalDeviceProperties& gpuProperties, uint32_t maxTextures);
+    void release();
+
+    // Write a texture's view into a free slot of the texture array. Slots are never written while a frame in flight
+    // might be reading them, so a texture whose image changes is given a new slot and its old one retired. Returns
+    // UINT32_MAX if every slot is taken, which TextureLibrary::getBindlessIndex maps to the fallback in slot 0:
+    uint32_t registerTexture(VkImageView view);
+
+    // The slot must no longer be used by any frame in flight (see ResourceManager::deferDeletion). Releasing slot 0
+    // (the fallback) or UINT32_MAX does nothing:
+    void releaseTexture(uint32_t textureIndex);
+
+    // Material changes are uploaded to each frame's copy of the material buffer when that frame is recorded, so they
+    // never touch data a frame in flight is reading:
+    uint32_t registerMaterial(const BindlessMaterialData& data);
+    void updateMaterial(uint32_t materialIndex, const BindlessMaterialData& data);
+    void releaseMaterial(uint32_t materialIndex);
+
+    // Bring this frame's material buffer up to date, growing it if needed (no-op if disabled). Its fence must have
+    // been waited on:
+    void uploadMaterials(uint32_t frameIndex);
+
+    // Bind the texture array and this frame's material buffer to sets 2 and 3:
+    void bind(VkCommandBuffer cmd, VkPipelineLayout layout, uint32_t frameIndex) const;
+
+    // Getters/setters: ------------------------------------------------------------------------------------------
+    inline bool                   isEnabled()               const { return m_isEnabled; }
+    inline VkDescriptorSetLayout  getTextureSetLayout()     const { return m_textureSetLayout; }
+    inline VkDescriptorSetLayout  getMaterialSetLayout()    const { return m_materialSetLayout; }
+    inline uint32_t               getNumTextures()          const { return m_numTextures; }
+    inline uint32_t               getMaxTextures()          const { return m_maxTextures; }
+    inline uint32_t               getNumMaterials()         const { return m_numMaterials; }
+
+  private:
+    struct MaterialBuffer
+    {
+      AllocatedBuffer buffer = {};
+      BindlessMaterialData* mappedData = nullptr;
+      uint32_t capacity = 0;
+      uint64_t uploadedVersion = 0;
+      VkDescriptorSet set = VK_NULL_HANDLE;
+    };
+
+    void initLayouts();
+    void initTextureSet();
+    void allocateMaterialBuffer(MaterialBuffer& materialBuffer, uint32_t capacity);
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    VmaAllocator m_allocator = VK_NULL_HANDLE;
+    bool m_isEnabled = false;
+
+    VkDescriptorSetLayout m_textureSetLayout = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_materialSetLayout = VK_NULL_HANDLE;
+    VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;   // (update-after-bind, so can't come from the descriptor allocator)
+    VkSampler m_sampler = VK_NULL_HANDLE;   // (immutable, every texture is sampled with the same linear sampler)
+
+    VkDescriptorSet m_textureSet = VK_NULL_HANDLE;
+    uint32_t m_maxTextures = 0;
+    uint32_t m_numTextures = 0;
+    uint32_t m_nextTextureIndex = 0;
+    std::vector<uint32_t> m_freeTextureIndices;
+    std::mutex m_textureMutex;
+
+    std::vector<BindlessMaterialData> m_materials;
+    std::vector<uint32_t> m_freeMaterialIndices;
+    uint32_t m_numMaterials = 0;
+    uint64_t m_materialsVersion = 1;
+    std::mutex m_materialMutex;
+    std::vector<MaterialBuffer> m_materialBuffers;  // (one per frame in flight)
+  };
+}
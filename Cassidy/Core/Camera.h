@@ -17,6 +17,12 @@ namespace cassidy
     void update();
     inline glm::mat4 getLookatMatrix()      { return m_lookat; }
     inline glm::mat4 getPerspectiveMatrix() { return m_proj; }
+    inline glm::vec3 getPosition()          { return m_position; }
+    inline glm::vec3 getEulerAngles()       { return m_eulerAngles; }
+
+    // Place the camera directly, e.g. when replaying a recorded path (takes effect on the next update()):
+    inline void setPosition(const glm::vec3& position)        { m_position = position; }
+    inline void setEulerAngles(const glm::vec3& eulerAngles)  { m_eulerAngles = eulerAngles; }
 
     void moveForward(float speedScalar = 1.0f);
     void moveRight(float speedScalar = 1.0f);
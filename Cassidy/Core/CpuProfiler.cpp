@@ -0,0 +1,105 @@
+#include "CpuProfiler.h"
+#include <Core/Logger.h>
+#include <Utils/Helpers.h>
+
+#include <algorithm>
+#include <fstream>
+
+void cassidy::CpuProfiler::setThreadName(const std::string& name)
+{
+  ThreadBuffer& buffer = get().getThreadBuffer();
+
+  std::lock_guard<std::mutex> registryLock(get().m_registryMutex);
+  buffer.threadName = name;
+}
+
+void cassidy::CpuProfiler::recordScope(const char* name, uint64_t startNs, uint64_t endNs)
+{
+  ThreadBuffer& buffer = get().getThreadBuffer();
+
+  const uint64_t writeIndex = buffer.numWritten.load(std::memory_order_relaxed);
+  buffer.events[writeIndex % EVENTS_PER_THREAD] = { name, startNs, endNs - startNs };
+
+  // Publish the event to exporting threads:
+  buffer.numWritten.store(writeIndex + 1, std::memory_order_release);
+}
+
+bool cassidy::CpuProfiler::writeChromeTrace(const std::string& filepath)
+{
+  std::ofstream file(filepath);
+  if (!file.is_open())
+  {
+    CS_LOG_ERROR("Failed to open {0} for writing CPU trace!", filepath);
+    return false;
+  }
+
+  CpuProfiler& profiler = get();
+  std::lock_guard<std::mutex> registryLock(profiler.m_registryMutex);
+
+  std::vector<Event> events;
+  events.reserve(EVENTS_PER_THREAD);
+
+  uint32_t numEventsWritten = 0;
+  bool isFirstEvent = true;
+  file << "{\"traceEvents\":[\n";
+
+  for (const std::unique_ptr<ThreadBuffer>& buffer : profiler.m_threadBuffers)
+  {
+    // Copy the buffer out first, then drop anything the owning thread may have overwritten during the copy:
+    const uint64_t endIndex = buffer->numWritten.load(std::memory_order_acquire);
+    const uint64_t beginIndex = endIndex > EVENTS_PER_THREAD ? endIndex - EVENTS_PER_THREAD : 0;
+
+    events.clear();
+    for (uint64_t i = beginIndex; i < endIndex; ++i)
+    {
+      events.push_back(buffer->events[i % EVENTS_PER_THREAD]);
+    }
+
+    const uint64_t indexAfterCopy = buffer->numWritten.load(std::memory_order_acquire);
+    const uint64_t firstValidIndex = indexAfterCopy > EVENTS_PER_THREAD ? indexAfterCopy - EVENTS_PER_THREAD + 1 : 0;
+    const size_t numOverwritten = static_cast<size_t>(std::min(endIndex, std::max(firstValidIndex, beginIndex)) - beginIndex);
+
+    if (!buffer->threadName.empty())
+    {
+      file << (isFirstEvent ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId
+        << ",\"args\":{\"name\":\"" << cassidy::helper::escapeJSON(buffer->threadName) << "\"}}";
+      isFirstEvent = false;
+    }
+
+    for (size_t i = numOverwritten; i < events.size(); ++i)
+    {
+      const Event& event = events[i];
+
+      // Trace timestamps are in microseconds:
+      file << (isFirstEvent ? "" : ",\n") << "{\"name\":\"" << cassidy::helper::escapeJSON(event.name) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId
+        << ",\"ts\":" << event.startNs / 1000 << "." << (event.startNs % 1000) / 100
+        << ",\"dur\":" << event.durationNs / 1000 << "." << (event.durationNs % 1000) / 100 << "}";
+      isFirstEvent = false;
+      ++numEventsWritten;
+    }
+  }
+
+  file << "\n]}\n";
+
+  CS_LOG_INFO("Wrote CPU trace with {0} events from {1} threads to {2}", numEventsWritten, profiler.m_threadBuffers.size(), filepath);
+  return file.good();
+}
+
+cassidy::CpuProfiler::ThreadBuffer& cassidy::CpuProfiler::getThreadBuffer()
+{
+  // Current thread's ring buffer, registered with the profiler the first time the thread records a scope:
+  static thread_local ThreadBuffer* t_threadBuffer = nullptr;
+  if (t_threadBuffer)
+    return *t_threadBuffer;
+
+  // Buffers are kept until the profiler is destroyed, so scopes from threads that have since exited still get exported:
+  std::unique_ptr<ThreadBuffer> newBuffer = std::make_unique<ThreadBuffer>();
+  newBuffer->events = std::make_unique<Event[]>(EVENTS_PER_THREAD);
+
+  std::lock_guard<std::mutex> registryLock(m_registryMutex);
+  newBuffer->threadId = static_cast<uint32_t>(m_threadBuffers.size());
+  t_threadBuffer = newBuffer.get();
+  m_threadBuffers.push_back(std::move(newBuffer));
+
+  return *t_threadBuffer;
+}
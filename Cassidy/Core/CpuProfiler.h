@@ -0,0 +1,106 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Time the enclosing scope. Names must be string literals (or otherwise outlive the profiler), since only the
+// pointer is recorded. Cheap enough to leave in release builds, but can be compiled out with CS_DISABLE_PROFILING:
+#ifndef CS_DISABLE_PROFILING
+#define CS_PROFILE_CONCAT_IMPL(a, b) a##b
+#define CS_PROFILE_CONCAT(a, b) CS_PROFILE_CONCAT_IMPL(a, b)
+#define CS_PROFILE_SCOPE(name) const cassidy::ProfileScope CS_PROFILE_CONCAT(profileScope_, __LINE__)(name)
+#define CS_PROFILE_FUNCTION() CS_PROFILE_SCOPE(__FUNCTION__)
+#else
+#define CS_PROFILE_SCOPE(name)
+#define CS_PROFILE_FUNCTION()
+#endif
+
+namespace cassidy
+{
+  // Records timed scopes into a fixed-size ring buffer per thread, which can be exported as Chrome trace JSON
+  // (viewable in chrome://tracing or Perfetto). Each buffer only has one writer, its own thread, so recording
+  // doesn't take locks. Old events are overwritten once a buffer wraps, so a trace holds each thread's most
+  // recent EVENTS_PER_THREAD scopes:
+  class CpuProfiler
+  {
+  public:
+    static constexpr uint32_t EVENTS_PER_THREAD = 1 << 14;
+
+    CpuProfiler(const CpuProfiler&) = delete; // Prevent copy instructions of this singleton.
+    static CpuProfiler& get()
+    {
+      static CpuProfiler s_instance;
+      return s_instance;
+    }
+
+    // Nanoseconds since the profiler was created:
+    static inline uint64_t now()
+    {
+      return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - get().m_startTime).count());
+    }
+
+    static void setThreadName(const std::string& name);
+    static inline void setEnabled(bool isEnabled) { get().m_isEnabled.store(isEnabled, std::memory_order_relaxed); }
+    static inline bool isEnabled()                { return get().m_isEnabled.load(std::memory_order_relaxed); }
+
+    static void recordScope(const char* name, uint64_t startNs, uint64_t endNs);
+
+    // Safe to call while other threads are recording; events overwritten mid-export are left out:
+    static bool writeChromeTrace(const std::string& filepath);
+
+  private:
+    struct Event
+    {
+      const char* name;
+      uint64_t startNs;
+      uint64_t durationNs;
+    };
+
+    struct ThreadBuffer
+    {
+      uint32_t threadId;
+      std::string threadName;
+      std::unique_ptr<Event[]> events;
+      std::atomic<uint64_t> numWritten = 0;   // (total ever written, so the write slot is numWritten % EVENTS_PER_THREAD)
+    };
+
+    CpuProfiler() :
+      m_startTime(std::chrono::steady_clock::now())
+    {}
+
+    ThreadBuffer& getThreadBuffer();
+
+    std::chrono::steady_clock::time_point m_startTime;
+    std::atomic<bool> m_isEnabled = true;
+
+    std::mutex m_registryMutex;   // (only taken when a thread records its first scope, or when exporting)
+    std::vector<std::unique_ptr<ThreadBuffer>> m_threadBuffers;
+  };
+
+  class ProfileScope
+  {
+  public:
+    inline explicit ProfileScope(const char* name) :
+      m_name(CpuProfiler::isEnabled() ? name : nullptr),
+      m_startNs(m_name ? CpuProfiler::now() : 0)
+    {}
+
+    inline ~ProfileScope()
+    {
+      if (m_name)
+        CpuProfiler::recordScope(m_name, m_startNs, CpuProfiler::now());
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+  private:
+    const char* m_name;
+    uint64_t m_startNs;
+  };
+}
@@ -11,7 +11,9 @@
 #include <Core/ResourceManager.h>
 
 #include <Core/Logger.h>
+#include <Core/CpuProfiler.h>
 
+#include <algorithm>
 #include <vector>
 #include <set>
 
@@ -39,11 +41,13 @@ cassidy::Engine::Engine(glm::uvec2 windowDimensions) :
 void cassidy::Engine::init()
 {
   CS_LOG_INFO("Initialising engine...");
+  cassidy::CpuProfiler::setThreadName("Main");
 
-  m_workerThread.init();
+  m_jobSystem.init();
 
   initInstance();
-  initSurface();
+  if (!isHeadless())
+    initSurface();
   initDebugMessenger();
 
   m_camera.init(this);
@@ -57,11 +61,18 @@ void cassidy::Engine::init()
 
 void cassidy::Engine::run()
 {
+  if (isHeadless())
+  {
+    runHeadless();
+    return;
+  }
+
   SDL_Event e;
   bool isRunning = true;
 
   while (isRunning)
   {
+    CS_PROFILE_SCOPE("Frame");
     InputHandler::flushDynamicMouseStates();
 
     while (SDL_PollEvent(&e))
@@ -106,9 +117,58 @@ void cassidy::Engine::run()
   }
 }
 
+void cassidy::Engine::runHeadless()
+{
+  CS_LOG_INFO("Rendering {0} headless frames...", m_headlessSettings.numFrames);
+
+  const bool isCapturing = !m_headlessSettings.capturePath.empty();
+
+  // No window means no events, input or editor GUI, so just update and draw the requested number of frames:
+  for (uint32_t i = 0; i < m_headlessSettings.numFrames; ++i)
+  {
+    // Models still loading on the job system would be missing from the capture, so let them finish before the last
+    // frame (idling the device in captureViewport doesn't wait for CPU-side work):
+    if (isCapturing && i + 1 == m_headlessSettings.numFrames)
+    {
+      cassidy::globals::g_resourceManager.modelManager.waitForPendingLoads(m_renderer.getLogicalDevice(),
+        m_renderer.getUploadContext(), m_jobSystem);
+    }
+
+    renderFrame();
+  }
+
+  if (isCapturing)
+    m_renderer.captureViewport(m_headlessSettings.capturePath);
+
+  CS_LOG_INFO("Finished rendering headless frames!");
+}
+
+void cassidy::Engine::renderFrame()
+{
+  CS_PROFILE_SCOPE("Frame");
+  GlobalTimer::updateGlobalTimer();
+  m_debugContext.timeSinceEngineStartSecs = GlobalTimer::engineTime();
+
+  update();
+  m_renderer.draw();
+}
+
 void cassidy::Engine::release()
 {
-  m_workerThread.release();
+  // Shader reloads and pipeline compiles still queued would be dropped along with the job system, leaving them unfinished:
+  m_renderer.getShaderHotReloader().waitForReloads();
+  cassidy::globals::g_resourceManager.pipelineRegistry.waitForPendingPipelines();
+  m_jobSystem.release();
+
+  // Let go of the engine's model references, so they're unloaded along with everything else:
+  m_scene.clear();
+  constexpr cassidy::ModelManager& modelManager = cassidy::globals::g_resourceManager.modelManager;
+  for (const cassidy::ModelHandle model : m_ownedModels)
+  {
+    modelManager.releaseModel(model);
+  }
+  m_ownedModels.clear();
+
   m_renderer.release();
   m_deletionQueue.execute();
 
@@ -117,6 +177,8 @@ void cassidy::Engine::release()
 
 void cassidy::Engine::processInput()
 {
+  CS_PROFILE_SCOPE("Engine::processInput");
+
   // Log key and mouse state changes between this frame and the previous frame:
   InputHandler::updateKeyStates();
   InputHandler::updateMouseStates();
@@ -193,6 +255,8 @@ void cassidy::Engine::update()
 
 void cassidy::Engine::buildGUI()
 {
+  CS_PROFILE_SCOPE("Engine::buildGUI");
+
   ImGui_ImplVulkan_NewFrame();
   ImGui_ImplSDL2_NewFrame(m_window);
   ImGui::NewFrame();
@@ -217,54 +281,120 @@ void cassidy::Engine::buildGUI()
 
         if (ImGui::TreeNode(texLibraryHeaderText.c_str()))
         {
-          const auto& textureLibrary = texLibrary.getTextureLibraryMap();
-          for (const auto& texture : textureLibrary)
+          const std::vector<std::string> textureNames = texLibrary.getTextureNames();
+          for (const std::string& textureName : textureNames)
           {
-            std::string_view textureFilename = texture.first;
+            std::string_view textureFilename = textureName;
             size_t lastBackSlash = textureFilename.find_last_of('/');
             ++lastBackSlash;  // Advance one character forward to isolate the filename.
             std::string_view textureFilenameSub = textureFilename.substr(lastBackSlash, textureFilename.size() - lastBackSlash);
             ImGui::Text(textureFilenameSub.data());
           }
+
+          const uint32_t numContentLoads = texLibrary.getNumContentLoads();
+          const uint32_t numContentDuplicates = texLibrary.getNumContentDuplicates();
+          ImGui::Text("(Num duplicate textures shared: %u of %u loads, %.1f%%)", numContentDuplicates, numContentLoads,
+            numContentLoads > 0 ? 100.0f * numContentDuplicates / numContentLoads : 0.0f);
+          ImGui::TreePop();
+        }
+
+        if (ImGui::TreeNode("Texture streaming"))
+        {
+          cassidy::TextureStreamer& streamer = texLibrary.getStreamer();
+          const cassidy::TextureStreamer::Stats& streamingStats = streamer.getStats();
+
+          bool isStreamingEnabled = streamer.isEnabled();
+          if (ImGui::Checkbox("Enabled", &isStreamingEnabled))
+            streamer.setEnabled(isStreamingEnabled);
+
+          // (0 uses VMA's budget for device-local memory)
+          int budgetMB = static_cast<int>(streamer.getBudget() / (1024 * 1024));
+          if (ImGui::SliderInt("Budget (MB)", &budgetMB, 0, 8192))
+            streamer.setBudget(static_cast<VkDeviceSize>(budgetMB) * 1024 * 1024);
+
+          ImGui::Text("Streamed textures: %u (%u updates pending)", streamingStats.numStreamedTextures, streamingStats.numPendingUpdates);
+          ImGui::Text("Resident: %.1f MB", streamingStats.residentBytes / (1024.0f * 1024.0f));
+          ImGui::Text("Device memory: %.1f / %.1f MB", streamingStats.deviceUsage / (1024.0f * 1024.0f),
+            streamingStats.deviceBudget / (1024.0f * 1024.0f));
+          ImGui::TreePop();
+        }
+
+        if (ImGui::TreeNode("Bindless resources"))
+        {
+          const cassidy::BindlessResources& bindless = cassidy::globals::g_resourceManager.bindless;
+          if (bindless.isEnabled())
+          {
+            ImGui::Text("Texture slots: %u / %u", bindless.getNumTextures(), bindless.getMaxTextures());
+            ImGui::Text("Materials: %u", bindless.getNumMaterials());
+          }
+          else
+          {
+            ImGui::Text("Not supported, using per-material descriptor sets");
+          }
+          ImGui::TreePop();
+        }
+
+        if (ImGui::TreeNode("Pipelines"))
+        {
+          const cassidy::PipelineRegistry& pipelineRegistry = cassidy::globals::g_resourceManager.pipelineRegistry;
+          ImGui::Text("Registered pipelines: %u", pipelineRegistry.getNumPipelines());
+          ImGui::Text("Built: %u, shared: %u", pipelineRegistry.getNumPipelinesBuilt(), pipelineRegistry.getNumPipelinesShared());
+          ImGui::Text("Compiling: %u", pipelineRegistry.getNumPendingCompiles());
+
+          const cassidy::ShaderHotReloader& shaderHotReloader = m_renderer.getShaderHotReloader();
+          if (shaderHotReloader.isWatching())
+          {
+            ImGui::Text("Shaders reloaded: %u (%u failed)", shaderHotReloader.getNumShadersReloaded(),
+              shaderHotReloader.getNumFailedReloads());
+            ImGui::Text("Pipelines reloaded: %u", pipelineRegistry.getNumPipelinesReloaded());
+          }
+          ImGui::Text("Pipeline cache loaded from disk: %.1f KB", pipelineRegistry.getLoadedCacheSize() / 1024.0f);
           ImGui::TreePop();
         }
 
-        const std::string matLibraryHeaderText = "Material library size: " + std::to_string(matLibrary.getMaterialCache().size());
+        const std::string matLibraryHeaderText = "Material library size: " + std::to_string(matLibrary.getNumMaterials());
 
         if (ImGui::TreeNode(matLibraryHeaderText.c_str()))
         {
-          const auto& materialCache = matLibrary.getMaterialCache();
-          for (const auto& mat : materialCache)
+          const std::vector<std::string> materialNames = matLibrary.getMaterialNames();
+          for (const std::string& matName : materialNames)
           {
-            std::string_view matName = mat.first;
             ImGui::Text(matName.data());
           }
 
           // TODO: Restrict this to debug build?
-          ImGui::Text("(Num duplicate materials prevented: %i)", matLibrary.getNumDuplicateMaterialBuildsPrevented());
+          const uint32_t numMaterialBuilds = matLibrary.getNumMaterialBuildRequests();
+          const uint32_t numDuplicateMaterials = matLibrary.getNumDuplicateMaterialBuildsPrevented();
+          ImGui::Text("(Num duplicate materials prevented: %u of %u builds, %.1f%%)", numDuplicateMaterials, numMaterialBuilds,
+            numMaterialBuilds > 0 ? 100.0f * numDuplicateMaterials / numMaterialBuilds : 0.0f);
           ImGui::TreePop();
         }
 
         const std::string modelManagerHeaderText = std::to_string(modelManager.getNumLoadedModels()) + " loaded models:";
+        const std::vector<cassidy::ModelHandle> modelHandles = modelManager.getModelHandles();
 
         if (ImGui::TreeNode(modelManagerHeaderText.c_str()))
         {
-          const auto& loadedModels = modelManager.getLoadedModels();
-          for (const auto& model : loadedModels)
+          for (const cassidy::ModelHandle handle : modelHandles)
           {
-            std::string_view modelName = model.first;
-            ImGui::Text(modelName.data());
+            if (cassidy::Model* model = modelManager.getModel(handle))
+              ImGui::Text(model->getDebugName().data());
           }
           ImGui::TreePop();
         }
 
+        m_uiContext.selectedModel = std::clamp(m_uiContext.selectedModel, 0, std::max(static_cast<int32_t>(modelHandles.size()) - 1, 0));
+
         if (ImGui::BeginListBox("Loaded models"))
         {
-          for (int8_t i = 0; i < (int8_t)modelManager.getModelsPtrTable().size(); ++i)
+          for (int32_t i = 0; i < static_cast<int32_t>(modelHandles.size()); ++i)
           {
+            cassidy::Model* model = modelManager.getModel(modelHandles[i]);
+            if (!model) continue;
+
             const bool isCurrentlySelected = i == m_uiContext.selectedModel;
 
-            if (ImGui::Selectable(modelManager.getModelsPtrTable()[i]->getDebugName().data(), &isCurrentlySelected))
+            if (ImGui::Selectable(model->getDebugName().data(), &isCurrentlySelected))
               m_uiContext.selectedModel = i;
 
             if (isCurrentlySelected) ImGui::SetItemDefaultFocus();
@@ -273,6 +403,18 @@ void cassidy::Engine::buildGUI()
           ImGui::Text("Current model: %i", m_uiContext.selectedModel);
           ImGui::Text("Post process steps: %u", m_uiContext.importPostProcessSteps);
         }
+
+        // Drop the engine's reference to the selected model, it's unloaded once nothing else (e.g. the scene) uses it:
+        if (ImGui::Button("Unload model") && static_cast<size_t>(m_uiContext.selectedModel) < modelHandles.size())
+        {
+          const cassidy::ModelHandle selectedHandle = modelHandles[m_uiContext.selectedModel];
+          const auto ownedIt = std::find(m_ownedModels.begin(), m_ownedModels.end(), selectedHandle);
+          if (ownedIt != m_ownedModels.end())
+          {
+            modelManager.releaseModel(selectedHandle);
+            m_ownedModels.erase(ownedIt);
+          }
+        }
       }
 
       //ImGui::Text("Directional light:");
@@ -294,22 +436,58 @@ void cassidy::Engine::buildGUI()
     }
     ImGui::End();
 
+    if (ImGui::Begin("Scene"))
+    {
+      constexpr ModelManager& modelManager = cassidy::globals::g_resourceManager.modelManager;
+      const std::vector<cassidy::ModelHandle> modelHandles = modelManager.getModelHandles();
+      const cassidy::ModelHandle selectedModel = static_cast<size_t>(m_uiContext.selectedModel) < modelHandles.size() ?
+        modelHandles[m_uiContext.selectedModel] : cassidy::ModelHandle();
+
+      ImGui::Text("Placed instances: %u", m_scene.getNumInstances());
+
+      if (ImGui::Button("Place model") && selectedModel.isValid())
+        m_uiContext.selectedInstance = m_scene.addInstance(selectedModel);
+
+      ImGui::SliderInt("Grid size", &m_uiContext.instanceGridSize, 1, 100);
+      if (ImGui::Button("Place model grid") && selectedModel.isValid())
+        m_scene.addInstanceGrid(selectedModel, m_uiContext.instanceGridSize, 5.0f);
+
+      if (ImGui::Button("Clear scene"))
+        m_scene.clear();
+
+      if (m_scene.getNumInstances() > 0)
+      {
+        m_uiContext.selectedInstance = std::min(m_uiContext.selectedInstance, static_cast<int32_t>(m_scene.getNumInstances()) - 1);
+        ImGui::SliderInt("Selected instance", &m_uiContext.selectedInstance, 0, m_scene.getNumInstances() - 1);
+
+        SceneInstance& instance = m_scene.getInstances()[m_uiContext.selectedInstance];
+        cassidy::Model* instanceModel = modelManager.getModel(instance.model);
+        ImGui::Text("Model: %s", instanceModel ? instanceModel->getDebugName().data() : "(unloaded)");
+        ImGui::DragFloat3("Position", &instance.position.x, 0.1f);
+        ImGui::DragFloat3("Rotation", &instance.rotation.x, 1.0f, 0.0f, 360.0f);
+        ImGui::DragFloat3("Scale", &instance.scale.x, 0.01f);
+
+        if (ImGui::Button("Remove instance"))
+          m_scene.removeInstance(m_uiContext.selectedInstance);
+      }
+    }
+    ImGui::End();
+
     fileBrowser.Display();
 
     if (fileBrowser.HasSelected())
     {
       const std::string& selectedString = fileBrowser.GetSelected().generic_string();
 
-      m_workerThread.pushJobHighPrio([selectedString, this]() {
-        constexpr cassidy::ModelManager& modelManager = cassidy::globals::g_resourceManager.modelManager;
-        if (modelManager.loadModel(selectedString, &m_renderer, static_cast<aiPostProcessSteps>(m_uiContext.importPostProcessSteps)))
-        {
-          modelManager.getModel(selectedString)->allocateVertexBuffers(m_renderer.getUploadContext().uploadCommandBuffer,
-            cassidy::globals::g_resourceManager.getVmaAllocator(), &m_renderer);
-          modelManager.getModel(selectedString)->allocateIndexBuffers(m_renderer.getUploadContext().uploadCommandBuffer,
-            cassidy::globals::g_resourceManager.getVmaAllocator(), &m_renderer);
-        }
-        });
+      constexpr cassidy::ModelManager& modelManager = cassidy::globals::g_resourceManager.modelManager;
+      const cassidy::ModelHandle loadedModel = modelManager.loadModelAsync(selectedString, &m_renderer,
+        static_cast<aiPostProcessSteps>(m_uiContext.importPostProcessSteps));
+
+      // Loading a model the engine already holds just adds another reference, which isn't needed:
+      if (std::find(m_ownedModels.begin(), m_ownedModels.end(), loadedModel) != m_ownedModels.end())
+        modelManager.releaseModel(loadedModel);
+      else if (loadedModel.isValid())
+        m_ownedModels.push_back(loadedModel);
       fileBrowser.ClearSelected();
     }
 
@@ -361,6 +539,51 @@ void cassidy::Engine::buildGUI()
       ImGui::Text("Swapchain image index: %u", m_debugContext.currentSwapchainImageIndex);
       ImGui::Text("Current frame: %u", m_debugContext.currentFrame);
       if (m_debugContext.currentSwapchainImageIndex == 2) ImGui::Text("Flicker?");
+
+      bool isCpuProfilerEnabled = cassidy::CpuProfiler::isEnabled();
+      if (ImGui::Checkbox("CPU profiler", &isCpuProfilerEnabled))
+        cassidy::CpuProfiler::setEnabled(isCpuProfilerEnabled);
+
+      if (ImGui::Button("Export CPU trace"))
+        cassidy::CpuProfiler::writeChromeTrace("CassidyTrace.json");
+    }
+    ImGui::End();
+
+    if (ImGui::Begin("GPU profiler"))
+    {
+      cassidy::GpuProfiler& gpuProfiler = m_renderer.getGpuProfiler();
+      if (!gpuProfiler.isEnabled())
+      {
+        ImGui::Text("Timestamps aren't supported by the graphics queue.");
+      }
+      else
+      {
+        const float frameTimeMs = gpuProfiler.getFrameTimeMs();
+        ImGui::Text("GPU frame: %.3fms", frameTimeMs);
+
+        if (ImGui::BeginTable("GPU scopes", 3, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV))
+        {
+          ImGui::TableSetupColumn("Pass");
+          ImGui::TableSetupColumn("Average ms");
+          ImGui::TableSetupColumn("% of frame");
+          ImGui::TableHeadersRow();
+
+          for (const cassidy::GpuProfiler::ScopeResult& scope : gpuProfiler.getResults())
+          {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(scope.name.c_str());
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", scope.averageGpuMs);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f%%", frameTimeMs > 0.0f ? 100.0f * scope.gpuMs / frameTimeMs : 0.0f);
+          }
+          ImGui::EndTable();
+        }
+
+        if (ImGui::Button("Export JSON"))
+          gpuProfiler.writeJSON("GpuProfile.json");
+      }
     }
     ImGui::End();
   }
@@ -374,11 +597,60 @@ void cassidy::Engine::updateGlobalTimer()
 }
 
 void cassidy::Engine::initInstance()
+{
+  VkApplicationInfo appInfo = cassidy::init::applicationInfo("Cassidy v0.0.4", 0, 0, 4, 0, VK_API_VERSION_1_3);
+  std::vector<const char*> extensionNames;
+
+  if (isHeadless())
+  {
+    // Only SDL's timer is used, and the instance doesn't need any surface extensions:
+    SDL_Init(SDL_INIT_TIMER);
+    extensionNames = cassidy::Renderer::INSTANCE_EXTENSIONS;
+  }
+  else if (!initWindow(appInfo.pApplicationName, extensionNames))
+    return;
+
+  // Attach debug messenger to instance:
+  VkDebugUtilsMessengerCreateInfoEXT debugMessengerInfo = cassidy::init::debugMessengerCreateInfo(
+    static_cast<VkDebugUtilsMessageSeverityFlagBitsEXT>(VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT |
+      VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT),
+    static_cast<VkDebugUtilsMessageTypeFlagsEXT>(VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT |
+      VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT),
+    debugCallback);
+
+  // Build machines often only have a software ICD installed, so don't fail to start there without validation layers:
+  std::vector<const char*> validationLayers = cassidy::Renderer::VALIDATION_LAYERS;
+  if (isHeadless() && !cassidy::helper::areInstanceLayersAvailable(validationLayers))
+  {
+    CS_LOG_WARN("Validation layers aren't available, running headless without them!");
+    validationLayers.clear();
+  }
+
+  VkInstanceCreateInfo instanceCreateInfo = cassidy::init::instanceCreateInfo(&appInfo, 
+    static_cast<uint32_t>(extensionNames.size()), extensionNames.data(),
+    static_cast<uint32_t>(validationLayers.size()), validationLayers.data(), 
+    &debugMessengerInfo);
+
+  const VkResult result = vkCreateInstance(&instanceCreateInfo, nullptr, &m_instance);
+
+  if (result == VK_SUCCESS)
+    CS_LOG_INFO("Successfully created Vulkan instance!");
+  else
+  {
+    CS_LOG_ERROR("Failed to create Vulkan instance!");
+    return;
+  }
+
+  m_deletionQueue.addFunction([=]() {
+    vkDestroyInstance(m_instance, nullptr);
+  });
+}
+
+bool cassidy::Engine::initWindow(const char* title, std::vector<const char*>& outExtensionNames)
 {
   SDL_Init(SDL_INIT_VIDEO);
 
-  VkApplicationInfo appInfo = cassidy::init::applicationInfo("Cassidy v0.0.4", 0, 0, 4, 0, VK_API_VERSION_1_3);
-  m_window = SDL_CreateWindow(appInfo.pApplicationName, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+  m_window = SDL_CreateWindow(title, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
     m_windowDimensions.x, m_windowDimensions.y, SDL_WindowFlags::SDL_WINDOW_VULKAN | SDL_WindowFlags::SDL_WINDOW_RESIZABLE);
 
   m_deletionQueue.addFunction([=]() {
@@ -390,18 +662,17 @@ void cassidy::Engine::initInstance()
   if (SDL_Vulkan_GetInstanceExtensions(m_window, &numRequiredExtensions, NULL) != SDL_TRUE)
   {
     CS_LOG_ERROR("SDL could not find number of required extensions!");
-    return;
+    return false;
   }
 
-  std::vector<const char*> extensionNames;
-  extensionNames.resize(numRequiredExtensions + cassidy::Renderer::INSTANCE_EXTENSIONS.size());
+  outExtensionNames.resize(numRequiredExtensions + cassidy::Renderer::INSTANCE_EXTENSIONS.size());
 
-  if (SDL_Vulkan_GetInstanceExtensions(m_window, &numRequiredExtensions, extensionNames.data()) == SDL_TRUE)
+  if (SDL_Vulkan_GetInstanceExtensions(m_window, &numRequiredExtensions, outExtensionNames.data()) == SDL_TRUE)
   {
     CS_LOG_INFO("{0} required extensions for SDL:", numRequiredExtensions);
     for (uint8_t i = 0; i < numRequiredExtensions; ++i)
     {
-      CS_LOG_INFO("\t{0}", extensionNames[i]);
+      CS_LOG_INFO("\t{0}", outExtensionNames[i]);
     }
 
     CS_LOG_INFO("{0} required extensions for engine instance:", cassidy::Renderer::INSTANCE_EXTENSIONS.size());
@@ -410,44 +681,16 @@ void cassidy::Engine::initInstance()
       CS_LOG_INFO("\t{0}", cassidy::Renderer::INSTANCE_EXTENSIONS[i]);
     }
 
-    memcpy(extensionNames.data() + numRequiredExtensions,
+    memcpy(outExtensionNames.data() + numRequiredExtensions,
       cassidy::Renderer::INSTANCE_EXTENSIONS.data(),
       cassidy::Renderer::INSTANCE_EXTENSIONS.size() * sizeof(char*));
   }
   else
   {
     CS_LOG_ERROR("SDL could not return all required extensions!");
-    return;
-  }
-
-  // Attach debug messenger to instance:
-  VkDebugUtilsMessengerCreateInfoEXT debugMessengerInfo = cassidy::init::debugMessengerCreateInfo(
-    static_cast<VkDebugUtilsMessageSeverityFlagBitsEXT>(VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT |
-      VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT),
-    static_cast<VkDebugUtilsMessageTypeFlagsEXT>(VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT |
-      VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT),
-    debugCallback);
-
-  const auto& validationLayers = cassidy::Renderer::VALIDATION_LAYERS;
-
-  VkInstanceCreateInfo instanceCreateInfo = cassidy::init::instanceCreateInfo(&appInfo, 
-    static_cast<uint32_t>(extensionNames.size()), extensionNames.data(),
-    static_cast<uint32_t>(validationLayers.size()), validationLayers.data(), 
-    &debugMessengerInfo);
-
-  const VkResult result = vkCreateInstance(&instanceCreateInfo, nullptr, &m_instance);
-
-  if (result == VK_SUCCESS)
-    CS_LOG_INFO("Successfully created Vulkan instance!");
-  else
-  {
-    CS_LOG_ERROR("Failed to create Vulkan instance!");
-    return;
+    return false;
   }
-
-  m_deletionQueue.addFunction([=]() {
-    vkDestroyInstance(m_instance, nullptr);
-  });
+  return true;
 }
 
 void cassidy::Engine::initSurface()
@@ -498,8 +741,11 @@ void cassidy::Engine::initDefaultModels()
 
   constexpr cassidy::ModelManager& modelManager =
     cassidy::globals::g_resourceManager.modelManager;
-  modelManager.registerModel("Primitives/Triangle", triangleMesh);
-  modelManager.loadModel(MESH_ABS_FILEPATH + std::string("Helmet/DamagedHelmet.gltf"), &m_renderer, aiProcess_FlipUVs);
+  m_ownedModels.push_back(modelManager.registerModel("Primitives/Triangle", triangleMesh));
+
+  const cassidy::ModelHandle helmet = modelManager.loadModel(MESH_ABS_FILEPATH + std::string("Helmet/DamagedHelmet.gltf"), &m_renderer, aiProcess_FlipUVs);
+  if (helmet.isValid())
+    m_ownedModels.push_back(helmet);
 
   const VmaAllocator& allocator = cassidy::globals::g_resourceManager.getVmaAllocator();
   modelManager.allocateBuffers(m_renderer.getUploadContext().uploadCommandBuffer, allocator, &m_renderer);
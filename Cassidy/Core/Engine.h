@@ -3,16 +3,27 @@
 #include <Core/EventHandler.h>
 #include <Core/Camera.h>
 #include <Core/Logger.h>
-#include <Core/WorkerThread.h>
+#include <Core/JobSystem.h>
+#include <Core/Scene.h>
 
 #include <Utils/GlobalTimer.h>
 #include <Utils/Types.h>
 
 #include <vulkan/vulkan.h>
 #include <iostream>
+#include <string>
 
 namespace cassidy
 {
+  // Settings for running without a window or swapchain (e.g. automated benchmark and image-diff runs on build
+  // machines with no display):
+  struct HeadlessSettings
+  {
+    bool enabled = false;
+    uint32_t numFrames = 1;
+    std::string capturePath;  // (final frame is written to this PNG file if non-empty)
+  };
+
   class Engine
   {
   public:
@@ -20,11 +31,18 @@ namespace cassidy
     Engine(glm::vec2 windowDimensions);
     Engine(glm::uvec2 windowDimensions);
 
+    // Must be called before init():
+    inline void setHeadless(const HeadlessSettings& settings) { m_headlessSettings = settings; }
+
     void init();
     void run();
     void release();
 
+    // Update and draw one frame without polling window events or building the editor GUI (for headless runs):
+    void renderFrame();
+
   private:
+    void runHeadless();
     void processInput();
     void update();
 
@@ -32,6 +50,7 @@ namespace cassidy
 
     void updateGlobalTimer();
     void initInstance();
+    bool initWindow(const char* title, std::vector<const char*>& outExtensionNames);
     void initSurface();
     void initDebugMessenger();
 
@@ -54,8 +73,8 @@ namespace cassidy
 
     VkInstance m_instance;
 
-    SDL_Window* m_window;
-    VkSurfaceKHR m_surface;
+    SDL_Window* m_window = nullptr;           // (null and VK_NULL_HANDLE when headless)
+    VkSurfaceKHR m_surface = VK_NULL_HANDLE;
     VkDebugUtilsMessengerEXT m_debugMessenger;  // TODO: Move this and surface, instance and window to renderer class(?)
     glm::uvec2 m_windowDimensions;
     glm::uvec2 m_viewportDimensions;
@@ -65,14 +84,19 @@ namespace cassidy
     cassidy::EventHandler m_eventHandler;
     cassidy::Renderer m_renderer;
 
-    WorkerThread m_workerThread;
+    cassidy::JobSystem m_jobSystem;
+    cassidy::Scene m_scene;
+    std::vector<cassidy::ModelHandle> m_ownedModels;  // (models loaded by the engine itself, e.g. defaults and file browser loads)
 
     struct UIContext {
       int32_t selectedModel = 0;
       uint32_t importPostProcessSteps = 0;
+      int32_t selectedInstance = 0;
+      int32_t instanceGridSize = 10;
     } m_uiContext;
 
     DebugContext m_debugContext;
+    HeadlessSettings m_headlessSettings;
 
     DeletionQueue m_deletionQueue;
 
@@ -119,9 +143,12 @@ namespace cassidy
     inline VkInstance       getInstance()       { return m_instance; }
     inline VkSurfaceKHR     getSurface()        { return m_surface; }
     inline cassidy::Camera& getCamera()         { return m_camera; }
+    inline Renderer&        getRenderer()       { return m_renderer; }
     inline double           getDeltaTimeSecs()  { return GlobalTimer::deltaTime(); }
     inline UIContext        getUIContext()      { return m_uiContext; }
-    inline WorkerThread&    getWorkerThread()   { return m_workerThread; }
+    inline JobSystem&       getJobSystem()      { return m_jobSystem; }
+    inline Scene&           getScene()          { return m_scene; }
     inline DebugContext&    getDebugContext()   { return m_debugContext; }
+    inline bool             isHeadless()        { return m_headlessSettings.enabled; }
   };
 }
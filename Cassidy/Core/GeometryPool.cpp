@@ -0,0 +1,160 @@
+#include "GeometryPool.h"
+#include <Core/Logger.h>
+#include <Utils/Helpers.h>
+#include <Utils/Initialisers.h>
+
+void cassidy::GeometryPool::init(VkDevice device, VmaAllocator allocator, const UploadContext& uploadContext,
+  uint32_t vertexCapacity, uint32_t indexCapacity)
+{
+  m_allocator = allocator;
+
+  VkBufferCreateInfo vertexBufferInfo = cassidy::init::bufferCreateInfo(vertexCapacity * static_cast<uint32_t>(sizeof(Vertex)),
+    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+  VkBufferCreateInfo indexBufferInfo = cassidy::init::bufferCreateInfo(indexCapacity * static_cast<uint32_t>(sizeof(uint32_t)),
+    VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+
+  // Streamed models are copied in on the upload queue while the graphics queue draws other ranges of the same
+  // buffers, so share them between both families when they differ:
+  const uint32_t queueFamilies[] = { uploadContext.uploadQueueFamily, uploadContext.graphicsQueueFamily };
+  if (uploadContext.uploadQueueFamily != uploadContext.graphicsQueueFamily)
+  {
+    for (VkBufferCreateInfo* info : { &vertexBufferInfo, &indexBufferInfo })
+    {
+      info->sharingMode = VK_SHARING_MODE_CONCURRENT;
+      info->queueFamilyIndexCount = 2;
+      info->pQueueFamilyIndices = queueFamilies;
+    }
+  }
+
+  VmaAllocationCreateInfo allocInfo = cassidy::init::vmaAllocationCreateInfo(VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
+    VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT);
+
+  VK_CHECK(vmaCreateBuffer(m_allocator, &vertexBufferInfo, &allocInfo, &m_vertexBuffer.buffer, &m_vertexBuffer.allocation, nullptr));
+  VK_CHECK(vmaCreateBuffer(m_allocator, &indexBufferInfo, &allocInfo, &m_indexBuffer.buffer, &m_indexBuffer.allocation, nullptr));
+
+  m_vertexList.reset(vertexCapacity);
+  m_indexList.reset(indexCapacity);
+
+  CS_LOG_INFO("Created geometry pool ({0} vertices, {1} indices)!", vertexCapacity, indexCapacity);
+}
+
+void cassidy::GeometryPool::release()
+{
+  CS_LOG_INFO("Releasing geometry pool ({0} vertices and {1} indices still allocated)",
+    m_vertexList.numAllocated, m_indexList.numAllocated);
+
+  vmaDestroyBuffer(m_allocator, m_vertexBuffer.buffer, m_vertexBuffer.allocation);
+  vmaDestroyBuffer(m_allocator, m_indexBuffer.buffer, m_indexBuffer.allocation);
+  m_vertexBuffer = {};
+  m_indexBuffer = {};
+
+  m_vertexList.reset(0);
+  m_indexList.reset(0);
+}
+
+bool cassidy::GeometryPool::allocateVertices(uint32_t numVertices, Range& outRange)
+{
+  std::lock_guard<std::mutex> poolLock(m_mutex);
+  if (m_vertexList.allocate(numVertices, outRange))
+    return true;
+
+  CS_LOG_ERROR("Geometry pool is out of vertex space! ({0} requested, {1}/{2} in use)",
+    numVertices, m_vertexList.numAllocated, m_vertexList.capacity);
+  return false;
+}
+
+bool cassidy::GeometryPool::allocateIndices(uint32_t numIndices, Range& outRange)
+{
+  std::lock_guard<std::mutex> poolLock(m_mutex);
+  if (m_indexList.allocate(numIndices, outRange))
+    return true;
+
+  CS_LOG_ERROR("Geometry pool is out of index space! ({0} requested, {1}/{2} in use)",
+    numIndices, m_indexList.numAllocated, m_indexList.capacity);
+  return false;
+}
+
+void cassidy::GeometryPool::freeVertices(Range& range)
+{
+  std::lock_guard<std::mutex> poolLock(m_mutex);
+  m_vertexList.free(range);
+  range = {};
+}
+
+void cassidy::GeometryPool::freeIndices(Range& range)
+{
+  std::lock_guard<std::mutex> poolLock(m_mutex);
+  m_indexList.free(range);
+  range = {};
+}
+
+void cassidy::GeometryPool::bind(VkCommandBuffer cmd) const
+{
+  const VkDeviceSize offset = 0;
+  vkCmdBindVertexBuffers(cmd, 0, 1, &m_vertexBuffer.buffer, &offset);
+  vkCmdBindIndexBuffer(cmd, m_indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+}
+
+void cassidy::GeometryPool::FreeList::reset(uint32_t newCapacity)
+{
+  freeBlocks.clear();
+  if (newCapacity > 0)
+    freeBlocks[0] = newCapacity;
+
+  capacity = newCapacity;
+  numAllocated = 0;
+}
+
+bool cassidy::GeometryPool::FreeList::allocate(uint32_t count, Range& outRange)
+{
+  outRange = {};
+  if (count == 0) return false;
+
+  // First fit, taking the front of the block so that the remainder keeps its place in the map:
+  for (auto it = freeBlocks.begin(); it != freeBlocks.end(); ++it)
+  {
+    const uint32_t blockOffset = it->first;
+    const uint32_t blockCount = it->second;
+    if (blockCount < count) continue;
+
+    freeBlocks.erase(it);
+    if (blockCount > count)
+      freeBlocks[blockOffset + count] = blockCount - count;
+
+    outRange = { blockOffset, count };
+    numAllocated += count;
+    return true;
+  }
+  return false;
+}
+
+void cassidy::GeometryPool::FreeList::free(const Range& range)
+{
+  if (!range.isValid()) return;
+
+  uint32_t offset = range.offset;
+  uint32_t count = range.count;
+
+  // Merge with the following free block if it starts where this range ends:
+  auto next = freeBlocks.lower_bound(offset);
+  if (next != freeBlocks.end() && next->first == offset + count)
+  {
+    count += next->second;
+    next = freeBlocks.erase(next);
+  }
+
+  // Merge with the preceding free block if it ends where this range starts:
+  if (next != freeBlocks.begin())
+  {
+    auto prev = std::prev(next);
+    if (prev->first + prev->second == offset)
+    {
+      offset = prev->first;
+      count += prev->second;
+      freeBlocks.erase(prev);
+    }
+  }
+
+  freeBlocks[offset] = count;
+  numAllocated -= range.count;
+}
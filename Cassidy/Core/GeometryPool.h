@@ -0,0 +1,64 @@
+#pragma once
+#include <Utils/Types.h>
+#include <map>
+#include <mutex>
+
+namespace cassidy
+{
+  // Device-local vertex and index buffers shared by every mesh. Meshes are given ranges within them by a
+  // first-fit free-list allocator, so the buffers only need binding once per pass and each mesh is drawn with
+  // its own vertexOffset/firstIndex.
+  class GeometryPool
+  {
+  public:
+    // Offset and length of a sub-allocation, in elements (vertices or indices) rather than bytes:
+    struct Range
+    {
+      uint32_t offset = 0;
+      uint32_t count  = 0;
+
+      inline bool isValid() const { return count > 0; }
+    };
+
+    void init(VkDevice device, VmaAllocator allocator, const UploadContext& uploadContext,
+      uint32_t vertexCapacity, uint32_t indexCapacity);
+    void release();
+
+    // Return false (leaving outRange invalid) if the pool doesn't have a large enough contiguous free range:
+    bool allocateVertices(uint32_t numVertices, Range& outRange);
+    bool allocateIndices(uint32_t numIndices, Range& outRange);
+    void freeVertices(Range& range);
+    void freeIndices(Range& range);
+
+    void bind(VkCommandBuffer cmd) const;
+
+    // Getters/setters: ------------------------------------------------------------------------------------------
+    inline VkBuffer getVertexBuffer()           const { return m_vertexBuffer.buffer; }
+    inline VkBuffer getIndexBuffer()            const { return m_indexBuffer.buffer; }
+    inline uint32_t getNumAllocatedVertices()   const { return m_vertexList.numAllocated; }
+    inline uint32_t getNumAllocatedIndices()    const { return m_indexList.numAllocated; }
+    inline uint32_t getVertexCapacity()         const { return m_vertexList.capacity; }
+    inline uint32_t getIndexCapacity()          const { return m_indexList.capacity; }
+
+  private:
+    struct FreeList
+    {
+      std::map<uint32_t, uint32_t> freeBlocks;  // (offset -> count, sorted so neighbours can be merged)
+      uint32_t capacity = 0;
+      uint32_t numAllocated = 0;
+
+      void reset(uint32_t newCapacity);
+      bool allocate(uint32_t count, Range& outRange);
+      void free(const Range& range);
+    };
+
+    VmaAllocator m_allocator = VK_NULL_HANDLE;
+
+    AllocatedBuffer m_vertexBuffer = {};
+    AllocatedBuffer m_indexBuffer = {};
+
+    FreeList m_vertexList;
+    FreeList m_indexList;
+    std::mutex m_mutex;   // (ranges are allocated from job system workers while models stream in)
+  };
+}
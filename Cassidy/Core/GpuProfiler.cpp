@@ -0,0 +1,159 @@
+#include "GpuProfiler.h"
+#include <Core/Logger.h>
+#include <Utils/Helpers.h>
+
+#include <algorithm>
+#include <fstream>
+
+void cassidy::GpuProfiler::init(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex,
+  uint32_t numFrames, uint32_t maxScopesPerFrame)
+{
+  m_device = device;
+
+  uint32_t numQueueFamilies = 0;
+  vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &numQueueFamilies, nullptr);
+  std::vector<VkQueueFamilyProperties> queueFamilies(numQueueFamilies);
+  vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &numQueueFamilies, queueFamilies.data());
+
+  const uint32_t timestampValidBits = queueFamilies[queueFamilyIndex].timestampValidBits;
+  if (timestampValidBits == 0)
+  {
+    CS_LOG_WARN("Queue family {0} doesn't support timestamps, GPU profiler is disabled!", queueFamilyIndex);
+    return;
+  }
+
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+  m_timestampPeriod = properties.limits.timestampPeriod;
+  m_timestampMask = timestampValidBits >= 64 ? ~0ULL : (1ULL << timestampValidBits) - 1;
+
+  m_maxScopesPerFrame = maxScopesPerFrame;
+  m_frames.resize(numFrames);
+  m_timestamps.resize(maxScopesPerFrame * 2);
+
+  VkQueryPoolCreateInfo poolInfo = {
+    .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+    .pNext = nullptr,
+    .queryType = VK_QUERY_TYPE_TIMESTAMP,
+    .queryCount = numFrames * maxScopesPerFrame * 2,
+  };
+  VK_CHECK(vkCreateQueryPool(m_device, &poolInfo, nullptr, &m_queryPool));
+
+  CS_LOG_INFO("Created GPU profiler ({0} scopes per frame)!", maxScopesPerFrame);
+}
+
+void cassidy::GpuProfiler::release()
+{
+  vkDestroyQueryPool(m_device, m_queryPool, nullptr);
+  m_queryPool = VK_NULL_HANDLE;
+}
+
+void cassidy::GpuProfiler::beginFrame(VkCommandBuffer cmd, uint32_t frameIndex)
+{
+  if (!isEnabled()) return;
+
+  m_currentFrameIndex = frameIndex;
+  FrameScopes& frame = m_frames[frameIndex];
+  const uint32_t firstQuery = frameIndex * m_maxScopesPerFrame * 2;
+
+  if (frame.hasBeenRecorded)
+    readResults(frame, firstQuery);
+
+  vkCmdResetQueryPool(cmd, m_queryPool, firstQuery, m_maxScopesPerFrame * 2);
+  frame.numScopes = 0;
+  frame.hasBeenRecorded = true;
+}
+
+uint32_t cassidy::GpuProfiler::beginScope(VkCommandBuffer cmd, std::string_view name)
+{
+  if (!isEnabled()) return UINT32_MAX;
+
+  FrameScopes& frame = m_frames[m_currentFrameIndex];
+  if (frame.numScopes == m_maxScopesPerFrame)
+  {
+    CS_LOG_WARN("GPU profiler is out of scopes this frame, skipping {0}!", name);
+    return UINT32_MAX;
+  }
+
+  // Names are only replaced when they change, so steady-state frames don't allocate:
+  const uint32_t scopeIndex = frame.numScopes++;
+  if (frame.names.size() <= scopeIndex)
+    frame.names.emplace_back(name);
+  else if (frame.names[scopeIndex] != name)
+    frame.names[scopeIndex] = name;
+
+  const uint32_t query = (m_currentFrameIndex * m_maxScopesPerFrame + scopeIndex) * 2;
+  vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_queryPool, query);
+  return scopeIndex;
+}
+
+void cassidy::GpuProfiler::endScope(VkCommandBuffer cmd, uint32_t scopeIndex)
+{
+  if (!isEnabled() || scopeIndex == UINT32_MAX) return;
+
+  const uint32_t query = (m_currentFrameIndex * m_maxScopesPerFrame + scopeIndex) * 2 + 1;
+  vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_queryPool, query);
+}
+
+void cassidy::GpuProfiler::readResults(FrameScopes& frame, uint32_t firstQuery)
+{
+  if (frame.numScopes == 0) return;
+
+  // The frame's fence has already been waited on, so don't wait for availability here:
+  const VkResult result = vkGetQueryPoolResults(m_device, m_queryPool, firstQuery, frame.numScopes * 2,
+    frame.numScopes * 2 * sizeof(uint64_t), m_timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+  if (result != VK_SUCCESS) return;
+
+  m_results.resize(frame.numScopes);
+
+  uint64_t frameStart = UINT64_MAX;
+  uint64_t frameEnd = 0;
+  for (uint32_t i = 0; i < frame.numScopes; ++i)
+  {
+    const uint64_t start = m_timestamps[i * 2] & m_timestampMask;
+    const uint64_t end = m_timestamps[i * 2 + 1] & m_timestampMask;
+    frameStart = std::min(frameStart, start);
+    frameEnd = std::max(frameEnd, end);
+
+    ScopeResult& scopeResult = m_results[i];
+    const float gpuMs = static_cast<float>(static_cast<double>((end - start) & m_timestampMask) * m_timestampPeriod * 1e-6);
+
+    // Restart the average if a different scope now occupies this slot:
+    const bool isSameScope = scopeResult.name == frame.names[i];
+    if (!isSameScope)
+      scopeResult.name = frame.names[i];
+
+    scopeResult.gpuMs = gpuMs;
+    scopeResult.averageGpuMs = isSameScope ? scopeResult.averageGpuMs + (gpuMs - scopeResult.averageGpuMs) * 0.05f : gpuMs;
+  }
+
+  m_frameTimeMs = static_cast<float>(static_cast<double>((frameEnd - frameStart) & m_timestampMask) * m_timestampPeriod * 1e-6);
+}
+
+bool cassidy::GpuProfiler::writeJSON(const std::string& filepath) const
+{
+  std::ofstream file(filepath);
+  if (!file.is_open())
+  {
+    CS_LOG_ERROR("Failed to open {0} for writing GPU profile!", filepath);
+    return false;
+  }
+
+  file << "{\n";
+  file << "  \"frameMs\": " << m_frameTimeMs << ",\n";
+  file << "  \"scopes\": [\n";
+  for (size_t i = 0; i < m_results.size(); ++i)
+  {
+    const ScopeResult& scope = m_results[i];
+    const float frameFraction = m_frameTimeMs > 0.0f ? scope.gpuMs / m_frameTimeMs : 0.0f;
+
+    file << "    { \"name\": \"" << cassidy::helper::escapeJSON(scope.name) << "\", \"ms\": " << scope.gpuMs << ", \"averageMs\": " << scope.averageGpuMs
+      << ", \"frameFraction\": " << frameFraction << " }" << (i + 1 < m_results.size() ? "," : "") << "\n";
+  }
+  file << "  ]\n";
+  file << "}\n";
+
+  CS_LOG_INFO("Wrote GPU profile to {0}", filepath);
+  return file.good();
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <string>
+#include <vector>
+
+namespace cassidy
+{
+  // Measures GPU time of named scopes with pairs of timestamp queries. Each frame in flight has its own range of the
+  // query pool, and its results are read back when the frame index comes round again (after its fence has been waited
+  // on), so reading never stalls but the figures lag FRAMES_IN_FLIGHT frames behind:
+  class GpuProfiler
+  {
+  public:
+    struct ScopeResult
+    {
+      std::string name;
+      float gpuMs = 0.0f;
+      float averageGpuMs = 0.0f;   // (exponential moving average, for a readable UI)
+    };
+
+    void init(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, uint32_t numFrames,
+      uint32_t maxScopesPerFrame = 32);
+    void release();
+
+    // Read back the results this frame index last produced and reset its queries. Must be recorded before any
+    // scopes, in the first command buffer submitted for the frame:
+    void beginFrame(VkCommandBuffer cmd, uint32_t frameIndex);
+
+    // Scopes can be spread over several command buffers, as long as they're all part of the same frame's submission:
+    uint32_t beginScope(VkCommandBuffer cmd, std::string_view name);
+    void endScope(VkCommandBuffer cmd, uint32_t scopeIndex);
+
+    bool writeJSON(const std::string& filepath) const;
+
+    // Getters/setters: ------------------------------------------------------------------------------------------
+    inline const std::vector<ScopeResult>&  getResults()      const { return m_results; }
+    inline float                            getFrameTimeMs()  const { return m_frameTimeMs; }  // (first scope start to last scope end)
+    inline bool                             isEnabled()       const { return m_queryPool != VK_NULL_HANDLE; }
+
+  private:
+    struct FrameScopes
+    {
+      std::vector<std::string> names;
+      uint32_t numScopes = 0;
+      bool hasBeenRecorded = false;
+    };
+
+    void readResults(FrameScopes& frame, uint32_t firstQuery);
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkQueryPool m_queryPool = VK_NULL_HANDLE;
+    float m_timestampPeriod = 1.0f;     // (nanoseconds per timestamp tick)
+    uint64_t m_timestampMask = ~0ULL;   // (queues can have fewer than 64 valid timestamp bits)
+
+    uint32_t m_maxScopesPerFrame = 0;
+    uint32_t m_currentFrameIndex = 0;
+    std::vector<FrameScopes> m_frames;
+    std::vector<uint64_t> m_timestamps;
+
+    std::vector<ScopeResult> m_results;
+    float m_frameTimeMs = 0.0f;
+  };
+}
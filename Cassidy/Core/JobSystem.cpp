@@ -0,0 +1,204 @@
+#include "JobSystem.h"
+#include <Core/Logger.h>
+#include <Core/CpuProfiler.h>
+
+#include <algorithm>
+#include <iterator>
+
+namespace
+{
+  // Index of the worker owned by the current thread (-1 for threads outside the pool, e.g. the main thread):
+  thread_local int32_t t_workerIndex = -1;
+}
+
+void cassidy::JobSystem::init(uint32_t numWorkers)
+{
+  if (numWorkers == 0)
+  {
+    // Leave a hardware thread for the main thread, which also runs jobs while waiting on them:
+    const uint32_t hardwareThreads = std::thread::hardware_concurrency();
+    numWorkers = std::max(hardwareThreads, 2U) - 1;
+  }
+
+  m_queues.reserve(numWorkers);
+  for (uint32_t i = 0; i < numWorkers; ++i)
+  {
+    m_queues.emplace_back(std::make_unique<WorkerQueue>());
+  }
+
+  m_isRunning = true;
+
+  m_workers.reserve(numWorkers);
+  for (uint32_t i = 0; i < numWorkers; ++i)
+  {
+    m_workers.emplace_back(&JobSystem::workerLoop, this, i);
+  }
+
+  CS_LOG_INFO("Initialised job system with {0} worker threads!", numWorkers);
+}
+
+void cassidy::JobSystem::release()
+{
+  {
+    std::lock_guard<std::mutex> sleepLock(m_sleepMutex);
+    m_isRunning = false;
+  }
+  m_wakeCondVar.notify_all();
+
+  for (auto& worker : m_workers)
+  {
+    worker.join();
+  }
+  m_workers.clear();
+  m_queues.clear();
+
+  CS_LOG_INFO("Job system worker threads joined!");
+}
+
+cassidy::JobHandle cassidy::JobSystem::pushJob(Job jobLambda, Priority priority, JobHandle handle)
+{
+  if (!handle.counter)
+    handle.counter = std::make_shared<std::atomic<uint32_t>>(0);
+
+  handle.counter->fetch_add(1, std::memory_order_relaxed);
+
+  // Workers push onto their own deque, other threads distribute jobs between workers round-robin:
+  const uint32_t queueIndex = t_workerIndex >= 0 ?
+    static_cast<uint32_t>(t_workerIndex) :
+    m_nextExternalQueue.fetch_add(1, std::memory_order_relaxed) % static_cast<uint32_t>(m_queues.size());
+
+  {
+    WorkerQueue& queue = *m_queues[queueIndex];
+    std::lock_guard<std::mutex> queueLock(queue.mutex);
+    queue.jobs[static_cast<size_t>(priority)].push_back({ std::move(jobLambda), handle.counter });
+  }
+
+  {
+    std::lock_guard<std::mutex> sleepLock(m_sleepMutex);
+    ++m_numQueuedJobs;
+  }
+  m_wakeCondVar.notify_one();
+
+  return handle;
+}
+
+cassidy::JobHandle cassidy::JobSystem::parallelFor(uint32_t count, uint32_t batchSize, RangeJob rangeLambda, Priority priority)
+{
+  JobHandle handle;
+  handle.counter = std::make_shared<std::atomic<uint32_t>>(0);
+
+  if (count == 0) return handle;
+  batchSize = std::max(batchSize, 1U);
+
+  // Share one copy of the range lambda between every batch rather than copying it per job:
+  std::shared_ptr<RangeJob> sharedLambda = std::make_shared<RangeJob>(std::move(rangeLambda));
+
+  for (uint32_t begin = 0; begin < count; begin += batchSize)
+  {
+    const uint32_t end = std::min(begin + batchSize, count);
+    pushJob([sharedLambda, begin, end]() { (*sharedLambda)(begin, end); }, priority, handle);
+  }
+
+  return handle;
+}
+
+void cassidy::JobSystem::wait(const JobHandle& handle)
+{
+  while (!handle.isDone())
+  {
+    if (!tryRunJob(handle.counter.get()))
+      std::this_thread::yield();
+  }
+}
+
+void cassidy::JobSystem::workerLoop(uint32_t workerIndex)
+{
+  t_workerIndex = static_cast<int32_t>(workerIndex);
+  cassidy::CpuProfiler::setThreadName("Worker " + std::to_string(workerIndex));
+
+  while (true)
+  {
+    if (tryRunJob())
+      continue;
+
+    std::unique_lock<std::mutex> sleepLock(m_sleepMutex);
+    m_wakeCondVar.wait(sleepLock, [this]() { return m_numQueuedJobs > 0 || !m_isRunning; });
+
+    if (!m_isRunning) break;
+  }
+}
+
+bool cassidy::JobSystem::tryRunJob(const std::atomic<uint32_t>* onlyCounter)
+{
+  if (m_queues.empty()) return false;
+
+  const uint32_t ownIndex = t_workerIndex >= 0 ? static_cast<uint32_t>(t_workerIndex) : 0;
+
+  QueuedJob job;
+  bool foundJob = false;
+
+  for (uint8_t i = 0; i < static_cast<uint8_t>(Priority::NUM_PRIORITIES) && !foundJob; ++i)
+  {
+    const Priority priority = static_cast<Priority>(i);
+    foundJob = (t_workerIndex >= 0 && popOwnJob(ownIndex, priority, onlyCounter, job)) ||
+      stealJob(ownIndex, priority, onlyCounter, job);
+  }
+
+  if (!foundJob) return false;
+
+  --m_numQueuedJobs;
+  {
+    CS_PROFILE_SCOPE("Job");
+    job.func();
+  }
+  job.counter->fetch_sub(1, std::memory_order_release);
+
+  return true;
+}
+
+bool cassidy::JobSystem::popOwnJob(uint32_t queueIndex, Priority priority, const std::atomic<uint32_t>* onlyCounter,
+  QueuedJob& outJob)
+{
+  WorkerQueue& queue = *m_queues[queueIndex];
+  std::lock_guard<std::mutex> queueLock(queue.mutex);
+
+  auto& jobs = queue.jobs[static_cast<size_t>(priority)];
+
+  // Owner takes the most recent job, which is most likely to still have its data in cache:
+  const auto jobIt = std::find_if(jobs.rbegin(), jobs.rend(),
+    [onlyCounter](const QueuedJob& queuedJob) { return !onlyCounter || queuedJob.counter.get() == onlyCounter; });
+  if (jobIt == jobs.rend()) return false;
+
+  outJob = std::move(*jobIt);
+  jobs.erase(std::next(jobIt).base());
+  return true;
+}
+
+bool cassidy::JobSystem::stealJob(uint32_t thiefIndex, Priority priority, const std::atomic<uint32_t>* onlyCounter,
+  QueuedJob& outJob)
+{
+  const uint32_t numQueues = static_cast<uint32_t>(m_queues.size());
+
+  for (uint32_t i = 0; i < numQueues; ++i)
+  {
+    // Start with the next queue along so thieves don't all hammer the first worker:
+    const uint32_t victimIndex = (thiefIndex + 1 + i) % numQueues;
+    if (victimIndex == static_cast<uint32_t>(t_workerIndex)) continue;
+
+    WorkerQueue& queue = *m_queues[victimIndex];
+    std::lock_guard<std::mutex> queueLock(queue.mutex);
+
+    auto& jobs = queue.jobs[static_cast<size_t>(priority)];
+
+    // Steal the oldest job, which is least likely to be touched by the owner soon:
+    const auto jobIt = std::find_if(jobs.begin(), jobs.end(),
+      [onlyCounter](const QueuedJob& queuedJob) { return !onlyCounter || queuedJob.counter.get() == onlyCounter; });
+    if (jobIt == jobs.end()) continue;
+
+    outJob = std::move(*jobIt);
+    jobs.erase(jobIt);
+    return true;
+  }
+
+  return false;
+}
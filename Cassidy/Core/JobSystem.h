@@ -0,0 +1,88 @@
+#pragma once
+#include <Utils/Types.h>
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace cassidy
+{
+  // Handle to one or more pushed jobs, which can be polled or waited on. Jobs pushed with the same handle
+  // share a counter, so the handle only completes once all of them have finished.
+  struct JobHandle
+  {
+    std::shared_ptr<std::atomic<uint32_t>> counter;
+
+    inline bool isDone() const { return !counter || counter->load(std::memory_order_acquire) == 0; }
+  };
+
+  // Pool of worker threads (one per hardware thread, minus the main thread) with a deque of jobs per worker.
+  // Workers pop their own most recently pushed jobs first, and steal the oldest jobs from other workers
+  // once their own deque runs dry. High priority jobs are always taken before low priority ones.
+  class JobSystem
+  {
+  public:
+    enum class Priority : uint8_t
+    {
+      HIGH = 0,
+      LOW = 1,
+      NUM_PRIORITIES,
+    };
+
+    typedef std::function<void()> Job;
+    typedef std::function<void(uint32_t begin, uint32_t end)> RangeJob;
+
+    void init(uint32_t numWorkers = 0);   // (0 = size to hardware thread count)
+    void release();
+
+    JobHandle pushJob(Job jobLambda, Priority priority, JobHandle handle = {});
+    inline JobHandle pushJobHighPrio(Job jobLambda) { return pushJob(std::move(jobLambda), Priority::HIGH); }
+    inline JobHandle pushJobLowPrio(Job jobLambda)  { return pushJob(std::move(jobLambda), Priority::LOW); }
+
+    // Split [0, count) into ranges of at most batchSize and spread them across the workers:
+    JobHandle parallelFor(uint32_t count, uint32_t batchSize, RangeJob rangeLambda, Priority priority = Priority::HIGH);
+
+    // Block until all jobs tracked by handle have finished. The calling thread runs the handle's own pending jobs while
+    // it waits, so waiting from inside a job can't deadlock the pool. Other jobs are left to the workers, so e.g. the
+    // render thread waiting on its recording batches can't pick up a model load and stall the frame.
+    void wait(const JobHandle& handle);
+
+    // Getters/setters: ------------------------------------------------------------------------------------------
+    inline uint32_t getNumWorkers() const { return static_cast<uint32_t>(m_workers.size()); }
+
+  private:
+    struct QueuedJob
+    {
+      Job func;
+      std::shared_ptr<std::atomic<uint32_t>> counter;
+    };
+
+    struct WorkerQueue
+    {
+      std::mutex mutex;
+      std::deque<QueuedJob> jobs[static_cast<size_t>(Priority::NUM_PRIORITIES)];
+    };
+
+    void workerLoop(uint32_t workerIndex);
+    // Jobs can be restricted to those tracked by one handle's counter (any job is taken if it's null):
+    bool tryRunJob(const std::atomic<uint32_t>* onlyCounter = nullptr);
+    bool popOwnJob(uint32_t queueIndex, Priority priority, const std::atomic<uint32_t>* onlyCounter, QueuedJob& outJob);
+    bool stealJob(uint32_t thiefIndex, Priority priority, const std::atomic<uint32_t>* onlyCounter, QueuedJob& outJob);
+
+    std::vector<std::thread> m_workers;
+    std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wakeCondVar;
+
+    std::atomic<uint32_t> m_numQueuedJobs = 0;
+    std::atomic<uint32_t> m_nextExternalQueue = 0;
+    std::atomic<bool> m_isRunning = false;
+  };
+}
@@ -1,15 +1,5 @@
 #include "Material.h"
 
-void cassidy::Material::release(VkDevice device, VmaAllocator allocator)
-{
-  // TODO: Link this to texture library where textures unused by any materials are automatically released
-  // (this would require resource tracking)
-  for (auto [key, val] : m_info.pbrTextures)
-  {
-    val->release(device, allocator);
-  }
-}
-
 cassidy::Material& cassidy::Material::addTexture()
 {
   return *this;
@@ -23,5 +13,5 @@ cassidy::Material& cassidy::Material::setPipeline(Pipeline* pipeline)
 
 bool cassidy::MaterialInfo::operator==(const MaterialInfo& other) const
 {
-    return false;
+  return pbrTextures == other.pbrTextures;
 }
@@ -2,14 +2,16 @@
 #include <Utils/Types.h>
 #include <Core/Pipeline.h>
 #include <Core/Texture.h>
+#include <Utils/ResourcePool.h>
+#include <Utils/Hash.h>
 
 // Forward declarations:
 enum aiTextureType;
 
 namespace cassidy
 {
-  // TODO: Change texture pointer to texture hash (hash of file's absolute filepath, use SHA-1?)
-  typedef std::unordered_map<cassidy::TextureType, cassidy::Texture*> PBRTextures;
+  // (texture library handles, resolved with TextureLibrary::getTexture)
+  typedef std::unordered_map<cassidy::TextureType, cassidy::TextureHandle> PBRTextures;
 
   struct MaterialInfo
   {
@@ -17,23 +19,23 @@ namespace cassidy
     std::string debugName;
     PBRTextures pbrTextures;
 
+    // Materials are equal if they'd produce the same descriptor set, i.e. they use the same textures in the same
+    // slots (the debug name doesn't affect rendering, so isn't compared):
     bool operator==(const MaterialInfo& other) const;
 
     // Source: https://github.com/vblanco20-1/vulkan-guide/blob/engine/extra-engine/material_system.cpp
     size_t hash() const
     {
-      size_t result = std::hash<std::string_view>()(debugName);
-
+      // (XOR keeps the result independent of the map's iteration order)
+      size_t result = 0;
       for (auto& [key, val] : pbrTextures)
       {
-        size_t textureHash =
-          (std::hash<size_t>()((size_t)val->getImage() << 3) & (std::hash<size_t>()((size_t)val->getImageView())));
-        result ^= std::hash<size_t>()(textureHash);
+        result ^= cassidy::hash::combine(static_cast<uint64_t>(key), cassidy::ResourceHandleHash()(val));
       }
       return result;
     }
 
-    void attachTexture(cassidy::Texture* texture, cassidy::TextureType type)
+    void attachTexture(cassidy::TextureHandle texture, cassidy::TextureType type)
     {
       if (pbrTextures.find(type) == pbrTextures.end())
       {
@@ -57,19 +59,21 @@ namespace cassidy
     Material()
       : m_textureDescriptorSet(VK_NULL_HANDLE), m_pipeline(VK_NULL_HANDLE) {}
 
-    void release(VkDevice device, VmaAllocator allocator);
-
     Material& addTexture();
     Material& setPipeline(Pipeline* pipeline);
 
     Pipeline& getPipeline() { return *m_pipeline; }
 
     inline void setMatInfo(const cassidy::MaterialInfo& info) { m_info = info; }
+    inline const cassidy::MaterialInfo& getMatInfo() const { return m_info; }
     inline void setTextureDescSet(VkDescriptorSet set) { m_textureDescriptorSet = set; }
     inline VkDescriptorSet getTextureDescSet() const { return m_textureDescriptorSet; }
+    inline void setBindlessIndex(uint32_t index) { m_bindlessIndex = index; }
+    inline uint32_t getBindlessIndex() const { return m_bindlessIndex; }
 
   private:
     VkDescriptorSet m_textureDescriptorSet;
+    uint32_t m_bindlessIndex = UINT32_MAX;  // (index into the bindless material buffer, used instead of the descriptor set if enabled)
     Pipeline* m_pipeline;
     cassidy::MaterialInfo m_info;
   };
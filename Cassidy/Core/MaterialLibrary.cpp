@@ -1,80 +1,42 @@
 #include "MaterialLibrary.h"
 #include <Core/ResourceManager.h>   // (Texture library contains global texture samplers)
+#include <Core/Renderer.h>
 #include <Core/Logger.h>
 #include <Utils/DescriptorBuilder.h>
 #include <Utils/Initialisers.h>
+#include <algorithm>
 #include <iostream>
 
 #define ERROR_MAT_NAME std::string("Default/ErrorMat")
 
-cassidy::Material* cassidy::MaterialLibrary::buildMaterial(const std::string& materialName, cassidy::MaterialInfo& materialInfo)
+void cassidy::MaterialLibrary::releaseAll()
 {
-  // If material already exists, return reference to it:
-  if (m_materialCache.find(materialName) != m_materialCache.end())
+  // (descriptor sets are freed along with the descriptor allocator's pools, and textures by the texture library)
+  m_materials.clear();
+  m_materialHandles.clear();
+  m_contentHandles.clear();
+  m_retiredDescSets.clear();
+  m_errorMaterialHandle = {};
+  m_errorMaterial = nullptr;
+}
+
+cassidy::MaterialHandle cassidy::MaterialLibrary::buildMaterial(const std::string& materialName, cassidy::MaterialInfo& materialInfo)
+{
+  std::lock_guard<std::mutex> cacheLock(m_cacheMutex);
+  ++m_numMaterialBuildRequests;
+
+  // If material already exists, return reference to it (unless its last reference has just been released):
+  const auto cachedIt = m_materialHandles.find(materialName);
+  if (cachedIt != m_materialHandles.end() && m_materials.addRef(cachedIt->second))
   {
     CS_LOG_WARN("Using cached material {0}", materialName);
     ++m_numDuplicateMaterialBuildsPrevented;
-    return &m_materialCache.at(materialName);
+    return cachedIt->second;
   }
 
-  /*
-    - As part of material creation, keep track of descriptor layouts used
-    - Create pipelines after materials are created, use layouts list to create? (SPIR-V reflect would be perfect for this)
-    - Some way to cache pipelines would make the above process even better (use desc set layouts and push constants to achieve 
-      this, actual shader modules could be detached from pipeline cache)
-    
-    - Couple of options to proceed with material creation and use:
-      - Could create pipelines on a per-material basis which use a specified set of shader modules and push constants, but that raises 
-        the issue of per-pass and -object desc layout attaching (passing data around like that between renderer and model is a massive pain)
-      - Could create pipelines at the current point of the renderer startup process and have materials keep track of their descriptor set layouts,
-        
-    Would materials ever have a different layout for set #2? They always only consist of combined image samplers for PBR textures, and if
-    a mesh doesn't use a particular texture type (e.g. emissive, normal) then the fallback texture will fill in that gap automatically.
-    
-    Pipelines would require the material set layout, need a way to reference the correct layout from layout cache during pipeline creation
-    Could have materials keep track of the descriptor set layout to be referenced?
-
-    Material set layout (in this version of the engine) will always be:
-    - Albedo texture image view, linear sampler
-    - Specular texture image view, linear sampler
-    - Normal texture image view, linear sampler
-
-    When the descriptor builder is making a descriptor set for any material, the layout used will be one of the cached layouts
-    When creating the Phong shading pipeline, it needs the descriptor set layout for the material
-    Material *could* have decscriptor set layout reference since only one actual built layout object will exist
-    VkGuide's material system in the GPU-driven engine has a 'ShaderEffect' struct which contains four different desc set layouts anyway,
-    these are used to build pipeline layouts that SPIR-V reflect consumes later down the line
-    Then the ShaderEffect is used to build a 'ShaderPass', which contains a pointer to the original effect plus the built pipeline and 
-    pipeline layout (latter is probably for contiguous memory usage between pipeline and layout since effect already has built layout)
-
-    An 'EffectTemplate' is the master material, which materials used in draw calls are built from. The final material object contains the
-    descriptor sets used in rendering, plus a pointer to the original EffectTemplate (used in == operator override)
-    The material's rendering data is the descriptor sets used for each render pass type (VkGuide engine uses opaque, transparent and 
-    directional light shadow), handles to the textures used by the material and a pointer to the shader parameters structure used by the material.
-
-    Takeaways from VkGuide's method:
-    - Pipelines are cached based on the underlying pipeline layout data (descriptor set layouts and push constants)
-    - The above data is built from SPIR-V reflection(?) and passed to a pipeline builder which creates the actual pipeline in a shader pass object
-    - The shader passes for each type of pass (opaque forward, transparent forward and shadow) are collected into a master/base material object 
-      which is cached
-    - A built material is created from the descriptor sets allocated with VkGuide's descriptor builder (layout cache used to reuse material set layout 
-      created during pipeline creation, the layout is recreated when the material's images are bound to the descriptor builder) and the resulting
-      descriptor set can be bound during draw call recording
-
-    New system proposal:
-    - Build pipelines after mesh materials have been built (material library is populated)
-    - Create runtime pipeline cache so that duplicate pipelines aren't created, use descriptor set layout and pipeline 
-      debug name (e.g. "texturedPBR", "toon shading") as key
-      - Shader should determine descriptor set layout? (SPIR-V reflect)
-        - Until this is possible the descriptor set layout HAS to be hard-coded to textured Phong lighting shader layout (#0 per-pass, #1 per-object, 
-          #2 per-material, vert + frag push constants).
-      - Material should keep pointer to original material belonging to mesh to easily revert back?
-      - Once materials have been created (minus pipeline attachment), create textured Phong lighting pipeline, iterate through all materials built
-        and attach pipeline to them.
-    - When recording draw calls, 
-
-    v0.0.3: Just leave pipeline creation as-is for now, bind pipeline manually during draw recording and add material binds as Mesh::bindMaterial()
-  */
+  // Materials only own their textures and descriptor set. The pipelines drawing them are shared through
+  // PipelineRegistry, and the set 2 layout they're allocated against comes from DescriptorLayoutCache (the same layout
+  // Renderer::initDescriptorSets reflects for the viewport pipelines).
 
   constexpr cassidy::TextureLibrary& texLibrary = cassidy::globals::g_resourceManager.textureLibrary;
   
@@ -85,45 +47,198 @@ cassidy::Material* cassidy::MaterialLibrary::buildMaterial(const std::string& ma
       materialInfo.attachTexture(texLibrary.getFallbackTexture(type), type);
   }
 
+  // A differently-named material with the same textures would get an identical descriptor set, so share it instead
+  // (textures are deduplicated by content, so this also catches materials from different models):
+  const auto contentIt = m_contentHandles.find(materialInfo);
+  if (contentIt != m_contentHandles.end() && m_materials.addRef(contentIt->second))
+  {
+    CS_LOG_INFO("Material {0} shares its textures with an existing material, reusing it", materialName);
+    ++m_numDuplicateMaterialBuildsPrevented;
+    m_materialHandles[materialName] = contentIt->second;
+    return contentIt->second;
+  }
+
+  // The material holds its own reference to each of its textures, including fallbacks:
+  for (const auto& [type, texture] : materialInfo.pbrTextures)
+  {
+    texLibrary.addRef(texture);
+  }
+
   cassidy::Material newMat;
-  VkDescriptorSet matDescSet;
   newMat.setMatInfo(materialInfo);
 
+  // Bindless materials are just an entry in the material buffer, so don't need a descriptor set of their own:
+  constexpr cassidy::BindlessResources& bindless = cassidy::globals::g_resourceManager.bindless;
+  if (bindless.isEnabled())
+  {
+    newMat.setBindlessIndex(bindless.registerMaterial(getBindlessData(materialInfo)));
+  }
+  else
+  {
+    VkDescriptorSet matDescSet = reuseRetiredDescSet(cassidy::globals::g_resourceManager.getCurrentFrame());
+    writeTextureDescSet(materialInfo, matDescSet);
+    newMat.setTextureDescSet(matDescSet);
+  }
+
+  const cassidy::MaterialHandle newHandle = m_materials.add({ newMat, materialName });
+  m_materialHandles[materialName] = newHandle;
+  m_contentHandles[materialInfo] = newHandle;
+  return newHandle;
+}
+
+void cassidy::MaterialLibrary::addRef(cassidy::MaterialHandle handle)
+{
+  if (!m_materials.addRef(handle))
+    CS_LOG_ERROR("Attempted to add a reference to a material which has already been released!");
+}
+
+void cassidy::MaterialLibrary::releaseMaterial(cassidy::MaterialHandle handle)
+{
+  if (!handle.isValid() || m_materials.removeRef(handle) != 0) return;
+
+  {
+    // Forget every name the material was built under, so building any of them again creates a new material:
+    std::lock_guard<std::mutex> cacheLock(m_cacheMutex);
+    std::erase_if(m_materialHandles, [handle](const auto& named) { return named.second == handle; });
+
+    NamedMaterial* namedMaterial = m_materials.get(handle);
+    const auto contentIt = m_contentHandles.find(namedMaterial->material.getMatInfo());
+    if (contentIt != m_contentHandles.end() && contentIt->second == handle)
+      m_contentHandles.erase(contentIt);
+  }
+
+  cassidy::globals::g_resourceManager.deferDeletion([this, handle]() {
+    constexpr cassidy::TextureLibrary& texLibrary = cassidy::globals::g_resourceManager.textureLibrary;
+    NamedMaterial* namedMaterial = m_materials.get(handle);
+    CS_LOG_INFO("Unloading material {0}", namedMaterial->name);
+
+    for (const auto& [type, texture] : namedMaterial->material.getMatInfo().pbrTextures)
+    {
+      texLibrary.releaseTexture(texture);
+    }
+
+    if (namedMaterial->material.getBindlessIndex() != UINT32_MAX)
+    {
+      cassidy::globals::g_resourceManager.bindless.releaseMaterial(namedMaterial->material.getBindlessIndex());
+    }
+    else
+    {
+      // No frame in flight uses the set any more, but retire it as of now rather than tracking when it was last used:
+      std::lock_guard<std::mutex> cacheLock(m_cacheMutex);
+      m_retiredDescSets.push_back({ namedMaterial->material.getTextureDescSet(), 0 });
+    }
+    m_materials.remove(handle);
+    });
+}
+
+void cassidy::MaterialLibrary::refreshTextureDescSets(cassidy::TextureHandle texture, uint64_t currentFrame)
+{
+  std::lock_guard<std::mutex> cacheLock(m_cacheMutex);
+
+  m_materials.forEach([&](cassidy::MaterialHandle handle, NamedMaterial& namedMaterial) {
+    cassidy::Material& material = namedMaterial.material;
+    const cassidy::PBRTextures& pbrTextures = material.getMatInfo().pbrTextures;
+    const bool usesTexture = std::any_of(pbrTextures.begin(), pbrTextures.end(),
+      [texture](const auto& pbrTexture) { return pbrTexture.second == texture; });
+    if (!usesTexture) return;
+
+    // (the texture has a new slot, uploaded to each frame's material buffer as that frame is recorded)
+    if (material.getBindlessIndex() != UINT32_MAX)
+    {
+      cassidy::globals::g_resourceManager.bindless.updateMaterial(material.getBindlessIndex(), getBindlessData(material.getMatInfo()));
+      return;
+    }
+
+    VkDescriptorSet newDescSet = reuseRetiredDescSet(currentFrame);
+    writeTextureDescSet(material.getMatInfo(), newDescSet);
+
+    m_retiredDescSets.push_back({ material.getTextureDescSet(), currentFrame });
+    material.setTextureDescSet(newDescSet);
+    });
+}
+
+VkDescriptorSet cassidy::MaterialLibrary::reuseRetiredDescSet(uint64_t currentFrame)
+{
+  const auto retiredIt = std::find_if(m_retiredDescSets.begin(), m_retiredDescSets.end(),
+    [currentFrame](const RetiredDescSet& retired) { return retired.retiredFrame + FRAMES_IN_FLIGHT <= currentFrame; });
+  if (retiredIt == m_retiredDescSets.end())
+    return VK_NULL_HANDLE;
+
+  const VkDescriptorSet set = retiredIt->set;
+  m_retiredDescSets.erase(retiredIt);
+  return set;
+}
+
+void cassidy::MaterialLibrary::writeTextureDescSet(const cassidy::MaterialInfo& materialInfo, VkDescriptorSet& set)
+{
+  constexpr cassidy::TextureLibrary& texLibrary = cassidy::globals::g_resourceManager.textureLibrary;
+
   VkDescriptorImageInfo perMaterialAlbedoInfo = cassidy::init::descriptorImageInfo(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 
-    materialInfo.pbrTextures.at(cassidy::TextureType::ALBEDO)->getImageView(), cassidy::globals::m_linearTextureSampler);
+    texLibrary.getTexture(materialInfo.pbrTextures.at(cassidy::TextureType::ALBEDO))->getImageView(), cassidy::globals::m_linearTextureSampler);
   VkDescriptorImageInfo perMaterialSpecularInfo = cassidy::init::descriptorImageInfo(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 
-    materialInfo.pbrTextures.at(cassidy::TextureType::SPECULAR)->getImageView(), cassidy::globals::m_linearTextureSampler);
+    texLibrary.getTexture(materialInfo.pbrTextures.at(cassidy::TextureType::SPECULAR))->getImageView(), cassidy::globals::m_linearTextureSampler);
   VkDescriptorImageInfo perMaterialNormalInfo = cassidy::init::descriptorImageInfo(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-    materialInfo.pbrTextures.at(cassidy::TextureType::NORMAL)->getImageView(), cassidy::globals::m_linearTextureSampler);
+    texLibrary.getTexture(materialInfo.pbrTextures.at(cassidy::TextureType::NORMAL))->getImageView(), cassidy::globals::m_linearTextureSampler);
 
-  cassidy::DescriptorBuilder::begin(&cassidy::globals::g_descAllocator, &cassidy::globals::g_descLayoutCache)
-    .bindImage(0, &perMaterialAlbedoInfo, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
-    .bindImage(1, &perMaterialSpecularInfo, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
-    .bindImage(2, &perMaterialNormalInfo, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
-    .build(matDescSet);
+  if (set == VK_NULL_HANDLE)
+  {
+    // Sampler is baked into the layout, to match the per-material layout the renderer reflects for its pipelines:
+    const VkSampler* sampler = &cassidy::globals::m_linearTextureSampler;
+    cassidy::DescriptorBuilder::begin(&cassidy::globals::g_descAllocator, &cassidy::globals::g_descLayoutCache)
+      .bindImage(0, &perMaterialAlbedoInfo, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, sampler)
+      .bindImage(1, &perMaterialSpecularInfo, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, sampler)
+      .bindImage(2, &perMaterialNormalInfo, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, sampler)
+      .build(set);
+    return;
+  }
 
-  newMat.setTextureDescSet(matDescSet);
+  // Reusing a set that no frame in flight is bound to, so its bindings can be overwritten in place:
+  const VkWriteDescriptorSet writes[] = {
+    cassidy::init::writeDescriptorSet(set, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, &perMaterialAlbedoInfo),
+    cassidy::init::writeDescriptorSet(set, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, &perMaterialSpecularInfo),
+    cassidy::init::writeDescriptorSet(set, 2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, &perMaterialNormalInfo),
+  };
+  vkUpdateDescriptorSets(cassidy::globals::g_descAllocator.getDeviceRef(), 3, writes, 0, nullptr);
+}
 
-  m_materialCache[materialInfo.debugName] = newMat;
+cassidy::BindlessMaterialData cassidy::MaterialLibrary::getBindlessData(const cassidy::MaterialInfo& materialInfo)
+{
+  constexpr cassidy::TextureLibrary& texLibrary = cassidy::globals::g_resourceManager.textureLibrary;
 
-  return &m_materialCache.at(materialInfo.debugName);
+  cassidy::BindlessMaterialData data;
+  data.albedoIndex = texLibrary.getBindlessIndex(materialInfo.pbrTextures.at(cassidy::TextureType::ALBEDO));
+  data.specularIndex = texLibrary.getBindlessIndex(materialInfo.pbrTextures.at(cassidy::TextureType::SPECULAR));
+  data.normalIndex = texLibrary.getBindlessIndex(materialInfo.pbrTextures.at(cassidy::TextureType::NORMAL));
+  return data;
 }
 
 void cassidy::MaterialLibrary::createErrorMaterial()
 {
-  if (m_materialCache.find(ERROR_MAT_NAME) != m_materialCache.end())
+  if (m_errorMaterial)
     return;
 
-  constexpr cassidy::TextureLibrary& texLibrary = cassidy::globals::g_resourceManager.textureLibrary;
-
   cassidy::MaterialInfo errorMatInfo = cassidy::MaterialInfo();
   errorMatInfo.debugName = ERROR_MAT_NAME;
 
-  buildMaterial(errorMatInfo.debugName, errorMatInfo);
+  m_errorMaterialHandle = buildMaterial(errorMatInfo.debugName, errorMatInfo);
+  m_errorMaterial = getMaterial(m_errorMaterialHandle);
   CS_LOG_INFO("Created debug error material!");
 }
 
 cassidy::Material* cassidy::MaterialLibrary::getErrorMaterial()
 {
-  return &m_materialCache.at(ERROR_MAT_NAME);
+  return m_errorMaterial;
+}
+
+std::vector<std::string> cassidy::MaterialLibrary::getMaterialNames()
+{
+  std::lock_guard<std::mutex> cacheLock(m_cacheMutex);
+
+  std::vector<std::string> names;
+  names.reserve(m_materialHandles.size());
+  for (const auto& [name, handle] : m_materialHandles)
+  {
+    names.push_back(name);
+  }
+  return names;
 }
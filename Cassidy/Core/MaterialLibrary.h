@@ -1,6 +1,9 @@
 #pragma once
 #include <Core/Material.h>
+#include <Core/BindlessResources.h>
 #include <unordered_map>
+#include <mutex>
+#include <vector>
 
 namespace cassidy {
   class MaterialLibrary
@@ -8,20 +11,72 @@ namespace cassidy {
   public:
     MaterialLibrary() {}
 
-    inline void releaseAll() { m_materialCache.clear(); }
+    void releaseAll();
 
-    cassidy::Material* buildMaterial(const std::string& materialName, cassidy::MaterialInfo& materialInfo);
+    // Build a material (taking references to its textures), or take a reference to an existing material with the
+    // same name or the same textures (missing textures are filled in with fallbacks before comparing). The returned
+    // handle holds one reference, which the caller has to release:
+    cassidy::MaterialHandle buildMaterial(const std::string& materialName, cassidy::MaterialInfo& materialInfo);
+
+    void addRef(cassidy::MaterialHandle handle);
+
+    // Materials with no references left release their textures, and their descriptor sets are recycled once no frame
+    // in flight can still be using them:
+    void releaseMaterial(cassidy::MaterialHandle handle);
+
+    // Rewrite the descriptor sets of every material using a texture whose image has changed (e.g. after the texture
+    // streamer swaps in more mip levels). Frames still in flight may be using the old sets, so each material gets a
+    // new set, with old ones reused once they're at least FRAMES_IN_FLIGHT frames old. With bindless resources, the
+    // materials' texture indices are updated instead:
+    void refreshTextureDescSets(cassidy::TextureHandle texture, uint64_t currentFrame);
 
     void createErrorMaterial();
     cassidy::Material* getErrorMaterial();
 
-    inline const std::unordered_map<std::string, cassidy::Material>& getMaterialCache() { return m_materialCache; }
-    inline uint32_t getNumDuplicateMaterialBuildsPrevented() { return m_numDuplicateMaterialBuildsPrevented; }
+    // Null if the handle is stale:
+    inline cassidy::Material* getMaterial(cassidy::MaterialHandle handle)
+    {
+      NamedMaterial* namedMaterial = m_materials.get(handle);
+      return namedMaterial ? &namedMaterial->material : nullptr;
+    }
+
+    std::vector<std::string> getMaterialNames();
+    inline uint32_t getNumMaterials() const { return m_materials.getNumResources(); }
+    inline uint32_t getNumMaterialBuildRequests() const { return m_numMaterialBuildRequests; }
+    inline uint32_t getNumDuplicateMaterialBuildsPrevented() const { return m_numDuplicateMaterialBuildsPrevented; }
 
   private:
-    // TODO: Change string key value to texture hash (SHA-1?)
-    std::unordered_map<std::string, cassidy::Material> m_materialCache;
+    struct NamedMaterial
+    {
+      cassidy::Material material;
+      std::string name;
+    };
+
+    struct RetiredDescSet
+    {
+      VkDescriptorSet set;
+      uint64_t retiredFrame;
+    };
+
+    // Reuse a retired descriptor set if one is old enough, otherwise return VK_NULL_HANDLE for a new one to be
+    // allocated. Must be called with the cache mutex locked:
+    VkDescriptorSet reuseRetiredDescSet(uint64_t currentFrame);
+
+    // Write a material's textures into a descriptor set, allocating a new one if set is VK_NULL_HANDLE:
+    static void writeTextureDescSet(const cassidy::MaterialInfo& materialInfo, VkDescriptorSet& set);
+
+    // A material's textures as bindless texture array slots:
+    static cassidy::BindlessMaterialData getBindlessData(const cassidy::MaterialInfo& materialInfo);
+
+    cassidy::ResourcePool<NamedMaterial, cassidy::MaterialHandle> m_materials;
+    std::unordered_map<std::string, cassidy::MaterialHandle> m_materialHandles;   // (several names may share a material)
+    std::unordered_map<cassidy::MaterialInfo, cassidy::MaterialHandle, cassidy::MaterialInfoHash> m_contentHandles;
+    std::mutex m_cacheMutex;  // (guards material names and descriptor allocation when building from job system workers)
+    std::vector<RetiredDescSet> m_retiredDescSets;  // (all material sets share one layout, so any material can reuse these)
+    cassidy::MaterialHandle m_errorMaterialHandle;  // (the library keeps its own reference, so this is never unloaded)
+    cassidy::Material* m_errorMaterial = nullptr;  // (cached so draws recorded on workers don't have to lock the pool)
 
+    uint32_t m_numMaterialBuildRequests = 0;
     uint32_t m_numDuplicateMaterialBuildsPrevented = 0; // TODO: Restrict this to debug build?
   };
 };
\ No newline at end of file
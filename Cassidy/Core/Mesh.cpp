@@ -2,15 +2,19 @@
 #include <Core/Renderer.h>
 #include <Core/Pipeline.h>
 #include <Core/ResourceManager.h>
+#include <Core/TextureStreamer.h>
 #include <Core/Logger.h>
+#include <Core/CpuProfiler.h>
 #include <Utils/Initialisers.h>
 #include <Utils/Helpers.h>
 
+#include <algorithm>
+
 #include <Vendor/assimp/include/assimp/Importer.hpp>
 #include <Vendor/assimp/include/assimp/scene.h>
 #include <Vendor/assimp/include/assimp/postprocess.h>
 
-void cassidy::Model::draw(VkCommandBuffer cmd, const Pipeline* pipeline)
+void cassidy::Model::draw(VkCommandBuffer cmd, const Pipeline* pipeline, uint32_t instanceCount)
 {
   if (m_loadResult != LoadResult::SUCCESS) return;
 
@@ -24,40 +28,105 @@ void cassidy::Model::draw(VkCommandBuffer cmd, const Pipeline* pipeline)
 
     if (meshMaterial != lastMaterial)
     {
-      VkDescriptorSet&& textureSet = meshMaterial->getTextureDescSet();
+      // Bindless materials only need their index into the (already bound) material buffer:
+      const uint32_t bindlessIndex = meshMaterial->getBindlessIndex();
+      if (bindlessIndex != UINT32_MAX)
+      {
+        vkCmdPushConstants(cmd, pipeline->getLayout(), VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(uint32_t), &bindlessIndex);
+      }
+      else
+      {
+        VkDescriptorSet&& textureSet = meshMaterial->getTextureDescSet();
 
-      vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->getLayout(),
-        2, 1, &textureSet, 0, nullptr);
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->getLayout(),
+          2, 1, &textureSet, 0, nullptr);
+      }
       lastMaterial = meshMaterial;
     }
 
-    VkDeviceSize offset = 0;
-    vkCmdBindVertexBuffers(cmd, 0, 1, &mesh.getVertexBuffer()->buffer, &offset);
-    vkCmdBindIndexBuffer(cmd, mesh.getIndexBuffer()->buffer, 0, VK_INDEX_TYPE_UINT32);
+    const GeometryPool::Range& vertexRange = mesh.getVertexRange();
+    const GeometryPool::Range& indexRange = mesh.getIndexRange();
+    if (!vertexRange.isValid() || !indexRange.isValid()) continue;
+
+    vkCmdDrawIndexed(cmd, indexRange.count, instanceCount, indexRange.offset, static_cast<int32_t>(vertexRange.offset), 0);
+  }
+}
+
+void cassidy::Model::requestTextureLevels(const std::vector<PerObjectData>& instances, const glm::vec3& cameraPosition,
+  float pixelsPerUnitAtUnitDistance, cassidy::TextureStreamer& streamer) const
+{
+  constexpr float minDistance = 0.1f;   // (stops meshes the camera is inside of requesting infinite resolution)
+
+  for (const Mesh& mesh : m_meshes)
+  {
+    const cassidy::Material* material = mesh.getMaterial();
+    if (!material || mesh.getWorldUnitsPerUv() <= 0.0f) continue;
+
+    // Closest instance wins, measured to the surface of its bounding sphere:
+    float maxPixelsPerUv = 0.0f;
+    for (const PerObjectData& instance : instances)
+    {
+      const float scale = std::max({ glm::length(glm::vec3(instance.world[0])), glm::length(glm::vec3(instance.world[1])),
+        glm::length(glm::vec3(instance.world[2])) });
+      const glm::vec3 centre = glm::vec3(instance.world * glm::vec4(mesh.getBoundsCentre(), 1.0f));
+      const float distance = std::max(glm::length(centre - cameraPosition) - mesh.getBoundsRadius() * scale, minDistance);
+
+      const float pixelsPerUv = pixelsPerUnitAtUnitDistance / distance * mesh.getWorldUnitsPerUv() * scale;
+      maxPixelsPerUv = std::max(maxPixelsPerUv, pixelsPerUv);
+    }
 
-    vkCmdDrawIndexed(cmd, static_cast<uint32_t>(mesh.getNumIndices()), 1, 0, 0, 0);
+    for (const auto& [type, texture] : material->getMatInfo().pbrTextures)
+    {
+      streamer.requestScreenSize(texture, maxPixelsPerUv);
+    }
   }
 }
 
 void cassidy::Model::release(VkDevice device, VmaAllocator allocator)
 {
-  for (const auto& mesh : m_meshes)
+  for (auto& mesh : m_meshes)
   {
-    mesh.release(device, allocator);
+    mesh.release(cassidy::globals::g_resourceManager.geometryPool);
+    mesh.setMaterial(nullptr);
   }
+
+  for (const cassidy::MaterialHandle material : m_materials)
+  {
+    cassidy::globals::g_resourceManager.materialLibrary.releaseMaterial(material);
+  }
+  m_materials.clear();
+  m_meshCache.reset();
 }
 
 bool cassidy::Model::loadModel(const std::string& filepath, VmaAllocator allocator, cassidy::Renderer* rendererRef, aiPostProcessSteps additionalSteps)
 {
+  CS_PROFILE_SCOPE("Model::loadModel");
   CS_LOG_INFO("Loading new model ({0})", filepath);
 
-  Assimp::Importer importer;
-
-  const aiScene* scene = importer.ReadFile(filepath,
+  const uint32_t importFlags =
     aiProcess_Triangulate |
     aiProcess_CalcTangentSpace |
     aiProcess_GenSmoothNormals |
-    additionalSteps);
+    additionalSteps;
+
+  std::string directory = filepath.substr(0, filepath.find_last_of('/') + 1);
+  if (m_debugName.empty())
+    m_debugName = filepath;
+
+  // Skip the Assimp import entirely if an up-to-date mesh cache exists for this file and set of import flags:
+  const std::string cachePath = cassidy::MeshCache::getCachePath(filepath);
+  const uint64_t sourceHash = cassidy::MeshCache::computeSourceHash(filepath, importFlags);
+
+  if (sourceHash != 0 && loadFromMeshCache(cachePath, sourceHash, directory))
+  {
+    m_loadResult = LoadResult::UPLOADING;
+    CS_LOG_INFO("Successfully loaded model {0} from mesh cache!", filepath);
+    return true;
+  }
+
+  Assimp::Importer importer;
+
+  const aiScene* scene = importer.ReadFile(filepath, importFlags);
 
   if (!scene)
   {
@@ -67,20 +136,95 @@ bool cassidy::Model::loadModel(const std::string& filepath, VmaAllocator allocat
     return false;
   }
 
-  std::string directory = filepath.substr(0, filepath.find_last_of('/') + 1);
-  m_debugName = filepath;
-
   CS_LOG_INFO("Found {0} materials on model!", scene->mNumMaterials);
 
-  BuiltMaterials builtMaterials;
+  MeshCacheBuildData cacheData;
+  cacheData.materials.resize(scene->mNumMaterials);
 
-  processSceneNode(scene->mRootNode, scene, builtMaterials, directory, rendererRef);
+  processSceneNode(scene->mRootNode, scene, cacheData);
+  buildMaterials(scene, directory, rendererRef, cacheData);
 
-  m_loadResult = LoadResult::SUCCESS;
+  // Materials with embedded textures can't be rebuilt from filenames alone, so don't cache those models:
+  const bool isCacheable = std::none_of(cacheData.materials.begin(), cacheData.materials.end(),
+    [](const cassidy::MeshCache::MaterialRecord& record) { return record.hasEmbeddedTextures; });
+
+  if (isCacheable)
+    cassidy::MeshCache::write(cachePath, sourceHash, m_meshes, cacheData.meshMaterialIndices, cacheData.materials);
+
+  // CPU-side data is ready, model becomes drawable once its vertex and index buffers have been uploaded:
+  m_loadResult = LoadResult::UPLOADING;
   CS_LOG_INFO("Successfully loaded model {0}!", filepath);
   return true;
 }
 
+bool cassidy::Model::loadFromMeshCache(const std::string& cachePath, uint64_t sourceHash, const std::string& directory)
+{
+  std::shared_ptr<cassidy::MeshCache> cache = std::make_shared<cassidy::MeshCache>();
+  if (!cache->open(cachePath, sourceHash))
+    return false;
+
+  constexpr TextureLibrary& texLibrary = cassidy::globals::g_resourceManager.textureLibrary;
+  constexpr MaterialLibrary& matLibrary = cassidy::globals::g_resourceManager.materialLibrary;
+
+  m_meshes.clear();
+  m_meshes.resize(cache->getNumMeshes());
+
+  std::vector<bool> isMaterialUsed(cache->getNumMaterials(), false);
+  for (uint32_t i = 0; i < cache->getNumMeshes(); ++i)
+  {
+    const cassidy::MeshCache::MeshRecord& record = cache->getMeshRecord(i);
+    m_meshes[i].setMappedData(cache->getVertices(i), record.numVertices, cache->getIndices(i), record.numIndices);
+    isMaterialUsed[record.materialIndex] = true;
+  }
+
+  // Load every used material's textures as one batch before building any of their descriptor sets:
+  std::vector<cassidy::MeshCache::MaterialRecord> matRecords(cache->getNumMaterials());
+  std::vector<cassidy::TextureLibrary::TextureRequest> textureRequests;
+  for (uint32_t i = 0; i < cache->getNumMaterials(); ++i)
+  {
+    if (!isMaterialUsed[i]) continue;
+
+    matRecords[i] = cache->getMaterial(i);
+    for (const auto& texRef : matRecords[i].textures)
+    {
+      textureRequests.push_back({ directory + texRef.filename, texRef.format, VK_TRUE });
+    }
+  }
+  const std::vector<cassidy::TextureHandle> loadedTextures = texLibrary.loadTextures(textureRequests);
+
+  std::vector<cassidy::MaterialHandle> builtMaterials(cache->getNumMaterials());
+  uint32_t textureIndex = 0;
+  for (uint32_t i = 0; i < cache->getNumMaterials(); ++i)
+  {
+    if (!isMaterialUsed[i]) continue;
+
+    CS_LOG_INFO("Material: {0}", matRecords[i].name);
+
+    cassidy::MaterialInfo matInfo;
+    for (const auto& texRef : matRecords[i].textures)
+    {
+      const cassidy::TextureHandle loadedTexture = loadedTextures[textureIndex++];
+      if (loadedTexture.isValid() && !matInfo.hasTexture(texRef.type))
+        matInfo.attachTexture(loadedTexture, texRef.type);
+    }
+    matInfo.debugName = directory + matRecords[i].name;
+
+    builtMaterials[i] = matLibrary.buildMaterial(matInfo.debugName, matInfo);
+    m_materials.push_back(builtMaterials[i]);
+  }
+
+  // Materials hold their own references to the textures now:
+  texLibrary.releaseTextures(loadedTextures);
+
+  for (uint32_t i = 0; i < cache->getNumMeshes(); ++i)
+  {
+    m_meshes[i].setMaterial(matLibrary.getMaterial(builtMaterials[cache->getMeshRecord(i).materialIndex]));
+  }
+
+  m_meshCache = cache;
+  return true;
+}
+
 // Used for single-mesh models which have their vertices directly set by an array.
 void cassidy::Model::setVertices(const Vertex* data, size_t size)
 {
@@ -102,111 +246,116 @@ void cassidy::Model::setIndices(const uint32_t* data, size_t size)
   m_loadResult = LoadResult::SUCCESS;
 }
 
-void cassidy::Model::allocateVertexBuffers(VkCommandBuffer uploadCmd, VmaAllocator allocator, cassidy::Renderer* rendererRef)
+void cassidy::Model::allocateBuffers(VkCommandBuffer uploadCmd, VmaAllocator allocator, cassidy::Renderer* rendererRef)
 {
+  cassidy::StagingRingBuffer& stagingRing = rendererRef->getUploadContext().stagingRing;
+  cassidy::GeometryPool& geometryPool = cassidy::globals::g_resourceManager.geometryPool;
+
   for (auto& mesh : m_meshes)
   {
-    // Build CPU-side staging buffer:
-    VkBufferCreateInfo stagingBufferInfo = cassidy::init::bufferCreateInfo(mesh.getNumVertices() * sizeof(Vertex),
-      VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-    VmaAllocationCreateInfo bufferAllocInfo = cassidy::init::vmaAllocationCreateInfo(VMA_MEMORY_USAGE_AUTO_PREFER_HOST,
-      VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
-
-    AllocatedBuffer stagingBuffer;
-
-    vmaCreateBuffer(allocator, &stagingBufferInfo, &bufferAllocInfo,
-      &stagingBuffer.buffer,
-      &stagingBuffer.allocation,
-      nullptr);
-
-    // Write vertex data to newly-allocated buffer:
-    void* data;
-    vmaMapMemory(allocator, stagingBuffer.allocation, &data);
-    memcpy(data, mesh.getVertices(), mesh.getNumVertices() * sizeof(Vertex));
-    vmaUnmapMemory(allocator, stagingBuffer.allocation);
-
-    VkBufferCreateInfo vertexBufferInfo = cassidy::init::bufferCreateInfo(mesh.getNumVertices() * sizeof(Vertex),
-      VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
-
-    bufferAllocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+    // Vertex and index ranges are allocated as a pair, so a mesh never holds one without the other:
+    GeometryPool::Range vertexRange;
+    GeometryPool::Range indexRange;
+    if (!geometryPool.allocateVertices(mesh.getNumVertices(), vertexRange))
+      continue;
+    if (!geometryPool.allocateIndices(mesh.getNumIndices(), indexRange))
+    {
+      geometryPool.freeVertices(vertexRange);
+      continue;
+    }
 
-    AllocatedBuffer newBuffer;
+    const VkDeviceSize vertexDataSize = mesh.getNumVertices() * sizeof(Vertex);
+    const VkDeviceSize indexDataSize = mesh.getNumIndices() * sizeof(uint32_t);
 
-    vmaCreateBuffer(allocator, &vertexBufferInfo, &bufferAllocInfo,
-      &newBuffer.buffer,
-      &newBuffer.allocation,
-      nullptr);
+    // Write vertex and index data to staging memory:
+    const cassidy::StagingRingBuffer::Allocation staging = stagingRing.allocate(vertexDataSize + indexDataSize);
+    uint8_t* stagingData = static_cast<uint8_t*>(staging.mappedData);
+    memcpy(stagingData, mesh.getVertices(), vertexDataSize);
+    memcpy(stagingData + vertexDataSize, mesh.getIndices(), indexDataSize);
 
-    // Execute copy command for CPU-side staging buffer -> GPU-side vertex buffer:
+    // Execute copy commands for CPU-side staging buffer -> mesh's ranges of the pooled vertex and index buffers:
     cassidy::helper::immediateSubmit(rendererRef->getLogicalDevice(),
-      rendererRef->getUploadContext(), [=](VkCommandBuffer cmd) {
-        VkBufferCopy copy = {};
-        copy.dstOffset = 0;
-        copy.srcOffset = 0;
-        copy.size = mesh.getNumVertices() * sizeof(Vertex);
-        vkCmdCopyBuffer(cmd, stagingBuffer.buffer, newBuffer.buffer, 1, &copy);
+      rendererRef->getUploadContext(), [=, &geometryPool](VkCommandBuffer cmd) {
+        VkBufferCopy vertexCopy = {};
+        vertexCopy.dstOffset = vertexRange.offset * sizeof(Vertex);
+        vertexCopy.srcOffset = staging.offset;
+        vertexCopy.size = vertexDataSize;
+        vkCmdCopyBuffer(cmd, staging.buffer, geometryPool.getVertexBuffer(), 1, &vertexCopy);
+
+        VkBufferCopy indexCopy = {};
+        indexCopy.dstOffset = indexRange.offset * sizeof(uint32_t);
+        indexCopy.srcOffset = staging.offset + vertexDataSize;
+        indexCopy.size = indexDataSize;
+        vkCmdCopyBuffer(cmd, staging.buffer, geometryPool.getIndexBuffer(), 1, &indexCopy);
       });
 
-    vmaDestroyBuffer(allocator, stagingBuffer.buffer, stagingBuffer.allocation);
+    stagingRing.free(staging);
 
-    mesh.setVertexBuffer(newBuffer);
+    mesh.setVertexRange(vertexRange);
+    mesh.setIndexRange(indexRange);
   }
 }
 
-void cassidy::Model::allocateIndexBuffers(VkCommandBuffer cmd, VmaAllocator allocator, cassidy::Renderer* rendererRef)
+void cassidy::Model::recordBufferUploads(VkCommandBuffer cmd, UploadContext& uploadContext,
+  cassidy::StagingRingBuffer::Allocation& outStaging)
 {
-  for (auto& mesh : m_meshes)
-  {
-    // Build CPU-side staging buffer:
-    VkBufferCreateInfo stagingBufferInfo = cassidy::init::bufferCreateInfo(mesh.getNumIndices() * sizeof(uint32_t),
-      VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-    VmaAllocationCreateInfo bufferAllocInfo = cassidy::init::vmaAllocationCreateInfo(VMA_MEMORY_USAGE_AUTO_PREFER_HOST,
-      VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+  cassidy::GeometryPool& geometryPool = cassidy::globals::g_resourceManager.geometryPool;
 
-    AllocatedBuffer stagingBuffer = {};
+  // Pack every mesh's vertex and index data into one staging allocation:
+  VkDeviceSize stagingSize = 0;
+  for (const auto& mesh : m_meshes)
+  {
+    stagingSize += mesh.getNumVertices() * sizeof(Vertex) + mesh.getNumIndices() * sizeof(uint32_t);
+  }
 
-    vmaCreateBuffer(allocator, &stagingBufferInfo, &bufferAllocInfo,
-      &stagingBuffer.buffer,
-      &stagingBuffer.allocation,
-      nullptr);
+  outStaging = uploadContext.stagingRing.allocate(stagingSize);
+  uint8_t* stagingData = static_cast<uint8_t*>(outStaging.mappedData);
 
-    // Write index data to newly-allocated buffer:
-    void* data;
-    vmaMapMemory(allocator, stagingBuffer.allocation, &data);
-    memcpy(data, mesh.getIndices(), mesh.getNumIndices() * sizeof(uint32_t));
-    vmaUnmapMemory(allocator, stagingBuffer.allocation);
+  std::vector<VkBufferCopy> vertexCopies;
+  std::vector<VkBufferCopy> indexCopies;
+  vertexCopies.reserve(m_meshes.size());
+  indexCopies.reserve(m_meshes.size());
 
-    VkBufferCreateInfo indexBufferInfo = cassidy::init::bufferCreateInfo(mesh.getNumIndices() * sizeof(uint32_t),
-      VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+  VkDeviceSize stagingOffset = outStaging.offset;
+  for (auto& mesh : m_meshes)
+  {
+    GeometryPool::Range vertexRange;
+    GeometryPool::Range indexRange;
+    if (!geometryPool.allocateVertices(mesh.getNumVertices(), vertexRange))
+      continue;
+    if (!geometryPool.allocateIndices(mesh.getNumIndices(), indexRange))
+    {
+      geometryPool.freeVertices(vertexRange);
+      continue;
+    }
 
-    bufferAllocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+    const VkDeviceSize vertexDataSize = mesh.getNumVertices() * sizeof(Vertex);
+    const VkDeviceSize indexDataSize = mesh.getNumIndices() * sizeof(uint32_t);
 
-    AllocatedBuffer newBuffer = {};
+    memcpy(stagingData, mesh.getVertices(), vertexDataSize);
+    memcpy(stagingData + vertexDataSize, mesh.getIndices(), indexDataSize);
 
-    vmaCreateBuffer(allocator, &indexBufferInfo, &bufferAllocInfo,
-      &newBuffer.buffer,
-      &newBuffer.allocation,
-      nullptr);
+    vertexCopies.push_back({ stagingOffset, vertexRange.offset * sizeof(Vertex), vertexDataSize });
+    indexCopies.push_back({ stagingOffset + vertexDataSize, indexRange.offset * sizeof(uint32_t), indexDataSize });
 
-    // Execute copy command for CPU-side staging buffer -> GPU-side vertex buffer:
-    cassidy::helper::immediateSubmit(rendererRef->getLogicalDevice(),
-      rendererRef->getUploadContext(), [=](VkCommandBuffer cmd) {
-        VkBufferCopy copy = {};
-        copy.dstOffset = 0;
-        copy.srcOffset = 0;
-        copy.size = mesh.getNumIndices() * sizeof(uint32_t);
-        vkCmdCopyBuffer(cmd, stagingBuffer.buffer, newBuffer.buffer, 1, &copy);
-      });
+    stagingData += vertexDataSize + indexDataSize;
+    stagingOffset += vertexDataSize + indexDataSize;
 
-    vmaDestroyBuffer(allocator, stagingBuffer.buffer, stagingBuffer.allocation);
+    mesh.setVertexRange(vertexRange);
+    mesh.setIndexRange(indexRange);
+  }
 
-    mesh.setIndexBuffer(newBuffer);
+  // Every mesh lands in the same two pooled buffers, so the whole model is uploaded with two copy commands:
+  if (!vertexCopies.empty())
+  {
+    vkCmdCopyBuffer(cmd, outStaging.buffer, geometryPool.getVertexBuffer(), static_cast<uint32_t>(vertexCopies.size()), vertexCopies.data());
+    vkCmdCopyBuffer(cmd, outStaging.buffer, geometryPool.getIndexBuffer(), static_cast<uint32_t>(indexCopies.size()), indexCopies.data());
   }
 }
 
-void cassidy::Model::processSceneNode(aiNode* node, const aiScene* scene, BuiltMaterials& builtMaterials, const std::string& directory, cassidy::Renderer* rendererRef)
+void cassidy::Model::processSceneNode(aiNode* node, const aiScene* scene, MeshCacheBuildData& cacheData)
 {
-  m_meshes.reserve(node->mNumMeshes);
+  m_meshes.reserve(m_meshes.size() + node->mNumMeshes);
 
   for (uint32_t i = 0; i < node->mNumMeshes; ++i)
   {
@@ -214,28 +363,88 @@ void cassidy::Model::processSceneNode(aiNode* node, const aiScene* scene, BuiltM
     m_meshes.emplace_back(Mesh());
     m_meshes[m_meshes.size() - 1].processMesh(mesh);
 
-    const uint32_t matIndex = mesh->mMaterialIndex;
+    // Materials are built once every mesh has been gathered, so their textures can be loaded in one batch:
+    cacheData.meshMaterialIndices.push_back(mesh->mMaterialIndex);
+  }
 
-    //if (builtMaterials.find(matIndex) != builtMaterials.end())
-    //{
-    //  m_meshes[i].setMaterial(builtMaterials.at(matIndex));
-    //  continue;
-    //}
+  // Recursively iterate over child nodes and their meshes:
+  for (uint32_t i = 0; i < node->mNumChildren; ++i)
+  {
+    processSceneNode(node->mChildren[i], scene, cacheData);
+  }
+}
+
+void cassidy::Model::buildMaterials(const aiScene* scene, const std::string& directory, cassidy::Renderer* rendererRef,
+  MeshCacheBuildData& cacheData)
+{
+  constexpr TextureLibrary& texLibrary = cassidy::globals::g_resourceManager.textureLibrary;
+  constexpr MaterialLibrary& matLibrary = cassidy::globals::g_resourceManager.materialLibrary;
+
+  std::vector<bool> isMaterialUsed(scene->mNumMaterials, false);
+  for (uint32_t matIndex : cacheData.meshMaterialIndices)
+  {
+    isMaterialUsed[matIndex] = true;
+  }
 
-    MaterialInfo matInfo = m_meshes[i].buildMaterialInfo(scene, matIndex, directory, rendererRef);
+  // Gather the textures of every material used by the model first, so they're all decoded and uploaded as one batch:
+  std::vector<std::vector<cassidy::MeshCache::TextureRef>> materialTextures(scene->mNumMaterials);
+  std::vector<cassidy::TextureLibrary::TextureRequest> textureRequests;
+  for (uint32_t matIndex = 0; matIndex < scene->mNumMaterials; ++matIndex)
+  {
+    if (!isMaterialUsed[matIndex]) continue;
+
+    gatherTextureRefs(scene->mMaterials[matIndex], materialTextures[matIndex]);
+    for (const auto& texRef : materialTextures[matIndex])
+    {
+      textureRequests.push_back({ directory + texRef.filename, texRef.format, VK_TRUE });
+    }
+  }
+  std::vector<cassidy::TextureHandle> loadedTextures = texLibrary.loadTextures(textureRequests);
+
+  // Descriptor sets are only built once the whole batch has been uploaded:
+  std::vector<cassidy::MaterialHandle> builtMaterials(scene->mNumMaterials);
+  uint32_t textureIndex = 0;
+  for (uint32_t matIndex = 0; matIndex < scene->mNumMaterials; ++matIndex)
+  {
+    if (!isMaterialUsed[matIndex]) continue;
 
     const aiMaterial* currentMat = scene->mMaterials[matIndex];
+    cassidy::MeshCache::MaterialRecord& cacheRecord = cacheData.materials[matIndex];
+    cacheRecord = {};
+    cacheRecord.name = currentMat->GetName().C_Str();
+    CS_LOG_INFO("Material: {0}", cacheRecord.name);
 
-    constexpr MaterialLibrary& matLibrary = cassidy::globals::g_resourceManager.materialLibrary;
-    cassidy::Material* builtMaterial = matLibrary.buildMaterial(directory + std::string(currentMat->GetName().C_Str()), matInfo);
-    m_meshes[m_meshes.size() - 1].setMaterial(builtMaterial);
-    builtMaterials[matIndex] = builtMaterial;
+    cassidy::MaterialInfo matInfo;
+    for (const auto& texRef : materialTextures[matIndex])
+    {
+      cassidy::TextureHandle& loadedTexture = loadedTextures[textureIndex++];
+      if (!loadedTexture.isValid())
+      {
+        cacheRecord.hasEmbeddedTextures = true;
+        loadedTexture = loadEmbeddedTexture(scene, texRef.filename, directory, rendererRef);
+        if (loadedTexture.isValid())
+          matInfo.attachTexture(loadedTexture, texRef.type);
+        else
+          CS_LOG_ERROR("Could not load texture {0}!", texRef.filename);
+      }
+      else if (!matInfo.hasTexture(texRef.type))
+      {
+        matInfo.attachTexture(loadedTexture, texRef.type);
+        cacheRecord.textures.push_back(texRef);
+      }
+    }
+    matInfo.debugName = directory + cacheRecord.name;
+
+    builtMaterials[matIndex] = matLibrary.buildMaterial(matInfo.debugName, matInfo);
+    m_materials.push_back(builtMaterials[matIndex]);
   }
 
-  // Recursively iterate over child nodes and their meshes:
-  for (uint32_t i = 0; i < node->mNumChildren; ++i)
+  // Materials hold their own references to the textures (including embedded ones) now:
+  texLibrary.releaseTextures(loadedTextures);
+
+  for (size_t i = 0; i < m_meshes.size(); ++i)
   {
-    processSceneNode(node->mChildren[i], scene, builtMaterials, directory, rendererRef);
+    m_meshes[i].setMaterial(matLibrary.getMaterial(builtMaterials[cacheData.meshMaterialIndices[i]]));
   }
 }
 
@@ -289,16 +498,12 @@ void cassidy::Mesh::processMesh(const aiMesh* mesh)
       m_indices.push_back(face.mIndices[j]);
     }
   }
+
+  computeStreamingBounds();
 }
 
-cassidy::MaterialInfo cassidy::Mesh::buildMaterialInfo(const aiScene* scene, uint32_t matIndex, const std::string& texturesDirectory, cassidy::Renderer* rendererRef)
+void cassidy::Model::gatherTextureRefs(const aiMaterial* material, std::vector<cassidy::MeshCache::TextureRef>& outTextureRefs)
 {
-  const aiMaterial* currentMat = scene->mMaterials[matIndex];
-  std::string debugName = texturesDirectory + currentMat->GetName().C_Str();
-  CS_LOG_INFO("Material: {0}", currentMat->GetName().C_Str());
-
-  cassidy::MaterialInfo matInfo;
-
   for (uint8_t i = aiTextureType_DIFFUSE; i < aiTextureType_UNKNOWN; ++i)
   {
     cassidy::TextureType engineTexType;
@@ -328,19 +533,11 @@ cassidy::MaterialInfo cassidy::Mesh::buildMaterialInfo(const aiScene* scene, uin
       texType = "\tEmissive";
       engineTexType = cassidy::TextureType::EMISSIVE;
       break;
-    case aiTextureType_HEIGHT:
-      texType = "\tHeight";
-      format = VK_FORMAT_R8_UNORM;
-      break;
     case aiTextureType_NORMALS:
       texType = "\tNormal";
       format = VK_FORMAT_R8G8B8A8_UNORM;
       engineTexType = cassidy::TextureType::NORMAL;
       break;
-    case aiTextureType_DISPLACEMENT:
-      texType = "\tDisplacement";
-      format = VK_FORMAT_R8_UNORM;
-      break;
     case aiTextureType_METALNESS:
       texType = "\tMetallic";
       format = VK_FORMAT_R8_UNORM;
@@ -351,10 +548,6 @@ cassidy::MaterialInfo cassidy::Mesh::buildMaterialInfo(const aiScene* scene, uin
       format = VK_FORMAT_R8_UNORM;
       engineTexType = cassidy::TextureType::AO;
       break;
-    case aiTextureType_LIGHTMAP:
-      texType = "\tAO (lightmap)";
-      format = VK_FORMAT_R8_UNORM;
-      continue;
     case aiTextureType_BASE_COLOR:
       texType = "\tBase color";
       engineTexType = cassidy::TextureType::ALBEDO;
@@ -365,66 +558,119 @@ cassidy::MaterialInfo cassidy::Mesh::buildMaterialInfo(const aiScene* scene, uin
       engineTexType = cassidy::TextureType::SPECULAR;
       break;
     default:
-      // Skip unneeded texture.
+      // Skip unneeded texture (height, displacement and lightmaps have no engine texture type to attach to).
       continue;
     }
 
-    if (scene->mMaterials[matIndex]->GetTexture(type, 0, &texFilename) == aiReturn::aiReturn_SUCCESS)
+    if (material->GetTexture(type, 0, &texFilename) == aiReturn::aiReturn_SUCCESS)
     {
-      const char* texName = texFilename.C_Str();
-      CS_LOG_INFO("{0}: {1}", texType, texName);
+      CS_LOG_INFO("{0}: {1}", texType, texFilename.C_Str());
+      outTextureRefs.push_back({ engineTexType, format, texFilename.C_Str() });
+    }
+  }
+}
 
-      constexpr TextureLibrary& texLibrary = cassidy::globals::g_resourceManager.textureLibrary;
-      cassidy::Texture* loadedTexture = texLibrary.loadTexture(texturesDirectory + texName, format, VK_TRUE);
+cassidy::TextureHandle cassidy::Model::loadEmbeddedTexture(const aiScene* scene, const std::string& texName, const std::string& texturesDirectory,
+  cassidy::Renderer* rendererRef)
+{
+  // Attempt to find embedded version of texture:
+  const aiTexture* embeddedTex = scene->HasTextures() ? scene->GetEmbeddedTexture(texName.c_str()) : nullptr;
+  if (!embeddedTex) return {};
+
+  // Reuse the texture if another model (or an earlier load of this one) already created it, or embeds the same image:
+  constexpr TextureLibrary& texLibrary = cassidy::globals::g_resourceManager.textureLibrary;
+  const std::string& name = MESH_ABS_FILEPATH + texturesDirectory + texName;
+  const size_t embeddedSize = embeddedTex->mHeight == 0 ?
+    embeddedTex->mWidth :
+    sizeof(aiTexel) * embeddedTex->mWidth * embeddedTex->mHeight;
+  const uint64_t contentHash = cassidy::TextureLibrary::hashContents(embeddedTex->pcData, embeddedSize);
+  if (const cassidy::TextureHandle loadedTexture = texLibrary.acquireTexture(name, contentHash); loadedTexture.isValid())
+    return loadedTexture;
+
+  // When loading embedded textures with ASSIMP, if mHeight is 0 then the texture is in a 
+  // compressed format (e.g. JPEG), and the texture size is mWidth instead of mWidth * mHeight.
+  const VkExtent2D extent = embeddedTex->mHeight == 0 ?
+  VkExtent2D{
+    static_cast<uint32_t>(std::ceil(std::sqrt(embeddedTex->mWidth))),
+    static_cast<uint32_t>(std::ceil(std::sqrt(embeddedTex->mWidth))),
+  } :
+  VkExtent2D{
+    std::max(embeddedTex->mWidth, 1U),
+    std::max(embeddedTex->mHeight, 1U),
+  };
+
+  size_t texSize = embeddedTex->mHeight == 0 ? 
+    extent.width * extent.width :
+    sizeof(aiTexel) * extent.width * extent.height;
+
+  cassidy::Texture engineTex;
+  VmaAllocator allocator = cassidy::globals::g_resourceManager.getVmaAllocator();
+  if (!engineTex.create(reinterpret_cast<unsigned char*>(embeddedTex->pcData), texSize, extent,
+    allocator, rendererRef, VK_FORMAT_R8_UNORM, VK_TRUE))
+    return {};
+
+  return texLibrary.registerTexture(name, engineTex, contentHash);
+}
 
-      if (!loadedTexture)
-      {
-        // Attempt to find embedded version of texture:
-        if (scene->HasTextures())
-        {
-          const aiTexture* embeddedTex = scene->GetEmbeddedTexture(texName);
-
-          // When loading embedded textures with ASSIMP, if mHeight is 0 then the texture is in a 
-          // compressed format (e.g. JPEG), and the texture size is mWidth instead of mWidth * mHeight.
-          const VkExtent2D extent = embeddedTex->mHeight == 0 ?
-          VkExtent2D{
-            static_cast<uint32_t>(std::ceil(std::sqrt(embeddedTex->mWidth))),
-            static_cast<uint32_t>(std::ceil(std::sqrt(embeddedTex->mWidth))),
-          } :
-          VkExtent2D{
-            std::max(embeddedTex->mWidth, 1U),
-            std::max(embeddedTex->mHeight, 1U),
-          };
-
-          size_t texSize = embeddedTex->mHeight == 0 ? 
-            extent.width * extent.width :
-            sizeof(aiTexel) * extent.width * extent.height;
-
-          cassidy::Texture engineTex;
-          VmaAllocator allocator = cassidy::globals::g_resourceManager.getVmaAllocator();
-          if (engineTex.create(reinterpret_cast<unsigned char*>(embeddedTex->pcData), texSize, extent,
-            allocator, rendererRef, VK_FORMAT_R8_UNORM, VK_TRUE))
-          {
-            const std::string& name = MESH_ABS_FILEPATH + texturesDirectory + texName;
-
-            texLibrary.registerTexture(name, engineTex);
-            matInfo.attachTexture(texLibrary.getTexture(name), engineTexType);
-          }
-        }
-        CS_LOG_ERROR("Could not load texture!");
-      }
-      else if (!matInfo.hasTexture(engineTexType))
-      {
-        matInfo.attachTexture(loadedTexture, engineTexType);
-      }
-    }
+void cassidy::Mesh::setMappedData(const Vertex* vertices, uint32_t numVertices, const uint32_t* indices, uint32_t numIndices)
+{
+  m_vertices.clear();
+  m_indices.clear();
+
+  m_mappedVertices = vertices;
+  m_numMappedVertices = numVertices;
+  m_mappedIndices = indices;
+  m_numMappedIndices = numIndices;
+
+  computeStreamingBounds();
+}
+
+void cassidy::Mesh::computeStreamingBounds()
+{
+  const Vertex* vertices = getVertices();
+  const uint32_t* indices = getIndices();
+  const uint32_t numVertices = getNumVertices();
+  const uint32_t numIndices = getNumIndices();
+  if (numVertices == 0) return;
+
+  // Centre of the AABB is close enough to the minimal sphere's for picking mip levels:
+  glm::vec3 minPos = vertices[0].position;
+  glm::vec3 maxPos = vertices[0].position;
+  for (uint32_t i = 1; i < numVertices; ++i)
+  {
+    minPos = glm::min(minPos, vertices[i].position);
+    maxPos = glm::max(maxPos, vertices[i].position);
+  }
+
+  m_boundsCentre = (minPos + maxPos) * 0.5f;
+  float radiusSq = 0.0f;
+  for (uint32_t i = 0; i < numVertices; ++i)
+  {
+    const glm::vec3 offset = vertices[i].position - m_boundsCentre;
+    radiusSq = std::max(radiusSq, glm::dot(offset, offset));
+  }
+  m_boundsRadius = std::sqrt(radiusSq);
+
+  // Ratio of the mesh's total surface area to its total UV area:
+  float worldArea = 0.0f;
+  float uvArea = 0.0f;
+  for (uint32_t i = 0; i + 2 < numIndices; i += 3)
+  {
+    const Vertex& v0 = vertices[indices[i]];
+    const Vertex& v1 = vertices[indices[i + 1]];
+    const Vertex& v2 = vertices[indices[i + 2]];
+
+    worldArea += 0.5f * glm::length(glm::cross(v1.position - v0.position, v2.position - v0.position));
+
+    const glm::vec2 uvEdge0 = v1.uv - v0.uv;
+    const glm::vec2 uvEdge1 = v2.uv - v0.uv;
+    uvArea += 0.5f * std::abs(uvEdge0.x * uvEdge1.y - uvEdge0.y * uvEdge1.x);
   }
-  matInfo.debugName = debugName;
-  return matInfo;
+  m_worldUnitsPerUv = uvArea > 0.0f ? std::sqrt(worldArea / uvArea) : 0.0f;
 }
 
-void cassidy::Mesh::release(VkDevice device, VmaAllocator allocator) const
+void cassidy::Mesh::release(cassidy::GeometryPool& geometryPool)
 {
-  vmaDestroyBuffer(allocator, m_vertexBuffer.buffer, m_vertexBuffer.allocation);
-  vmaDestroyBuffer(allocator, m_indexBuffer.buffer, m_indexBuffer.allocation);
+  geometryPool.freeVertices(m_vertexRange);
+  geometryPool.freeIndices(m_indexRange);
 }
\ No newline at end of file
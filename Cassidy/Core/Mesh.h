@@ -2,7 +2,10 @@
 
 #include <Utils/Types.h>
 #include <Core/Material.h>
+#include <Core/MeshCache.h>
+#include <Core/GeometryPool.h>
 #include <unordered_map>
+#include <memory>
 
 // Forward declarations:
 struct aiNode;
@@ -18,66 +21,111 @@ namespace cassidy
   class Texture;
   class Material;
   class Pipeline;
+  class TextureStreamer;
 
   class Mesh
   {
   public:
-    void release(VkDevice device, VmaAllocator allocator) const;
+    void release(cassidy::GeometryPool& geometryPool);
 
     void processMesh(const aiMesh* mesh);
-    cassidy::MaterialInfo buildMaterialInfo(const aiScene* scene, uint32_t matIndex, const std::string& texturesDirectory, cassidy::Renderer* rendererRef);
 
     inline void setMaterial(cassidy::Material* material) { m_material = material; }
     inline void setVertices(const Vertex* data, size_t size)  { m_vertices.assign(data, data + size); }
     inline void setIndices(const uint32_t* data, size_t size) { m_indices.assign(data, data + size); }
 
-    // Getters/setters: ------------------------------------------------------------------------------------------
-    inline uint32_t                  getNumVertices()  const { return static_cast<uint32_t>(m_vertices.size()); }
-    inline uint32_t                  getNumIndices()   const { return static_cast<uint32_t>(m_indices.size()); }
-    inline Vertex             const* getVertices()     const { return m_vertices.data(); }
-    inline uint32_t           const* getIndices()      const { return m_indices.data(); }
-    inline AllocatedBuffer    const* getVertexBuffer() const { return &m_vertexBuffer; }
-    inline AllocatedBuffer    const* getIndexBuffer()  const { return &m_indexBuffer; }
-    inline cassidy::Material*        getMaterial()     const { return m_material; }
+    // Point mesh at vertex/index data owned elsewhere (e.g. a memory-mapped mesh cache) rather than copying it:
+    void setMappedData(const Vertex* vertices, uint32_t numVertices, const uint32_t* indices, uint32_t numIndices);
 
-    inline void setVertexBuffer(AllocatedBuffer newBuffer)  { m_vertexBuffer = newBuffer; }
-    inline void setIndexBuffer(AllocatedBuffer newBuffer)   { m_indexBuffer = newBuffer; }
+    // Getters/setters: ------------------------------------------------------------------------------------------
+    inline uint32_t                   getNumVertices()  const { return m_mappedVertices ? m_numMappedVertices : static_cast<uint32_t>(m_vertices.size()); }
+    inline uint32_t                   getNumIndices()   const { return m_mappedIndices ? m_numMappedIndices : static_cast<uint32_t>(m_indices.size()); }
+    inline Vertex              const* getVertices()     const { return m_mappedVertices ? m_mappedVertices : m_vertices.data(); }
+    inline uint32_t            const* getIndices()      const { return m_mappedIndices ? m_mappedIndices : m_indices.data(); }
+    inline GeometryPool::Range const& getVertexRange()  const { return m_vertexRange; }
+    inline GeometryPool::Range const& getIndexRange()   const { return m_indexRange; }
+    inline cassidy::Material*         getMaterial()     const { return m_material; }
+    inline glm::vec3                  getBoundsCentre() const { return m_boundsCentre; }
+    inline float                      getBoundsRadius() const { return m_boundsRadius; }
+    inline float                      getWorldUnitsPerUv() const { return m_worldUnitsPerUv; }
+
+    inline void setVertexRange(const GeometryPool::Range& range) { m_vertexRange = range; }
+    inline void setIndexRange(const GeometryPool::Range& range)  { m_indexRange = range; }
 
   private:
+    // Bounding sphere, and the average world-space size of one unit of UV space (used to pick texture mip levels):
+    void computeStreamingBounds();
+
     std::vector<Vertex> m_vertices;
     std::vector<uint32_t> m_indices;
-    AllocatedBuffer m_vertexBuffer;
-    AllocatedBuffer m_indexBuffer;
+    GeometryPool::Range m_vertexRange;  // (sub-allocations of the resource manager's geometry pool)
+    GeometryPool::Range m_indexRange;
+
+    const Vertex* m_mappedVertices = nullptr;
+    const uint32_t* m_mappedIndices = nullptr;
+    uint32_t m_numMappedVertices = 0;
+    uint32_t m_numMappedIndices = 0;
+
+    glm::vec3 m_boundsCentre = glm::vec3(0.0f);
+    float m_boundsRadius = 0.0f;
+    float m_worldUnitsPerUv = 0.0f;   // (0 if the mesh has no UVs)
 
-    cassidy::Material* m_material;
+    cassidy::Material* m_material = nullptr;
   };
 
   class Model
   {
   public:
-    void draw(VkCommandBuffer cmd, const Pipeline* pipeline);
+    // Geometry pool buffers must already be bound. Instances read their transforms from the per-object storage
+    // buffer using gl_InstanceIndex:
+    void draw(VkCommandBuffer cmd, const Pipeline* pipeline, uint32_t instanceCount = 1);
 
+    // Free the model's geometry and release its materials (which may unload their textures):
     void release(VkDevice device, VmaAllocator allocator);
 
     bool loadModel(const std::string& filepath, VmaAllocator allocator, cassidy::Renderer* rendererRef, aiPostProcessSteps additionalSteps = (aiPostProcessSteps)0);
     void setVertices(const Vertex* data, size_t size);
     void setIndices(const uint32_t* data, size_t size);
 
-    void allocateVertexBuffers(VkCommandBuffer cmd, VmaAllocator allocator, cassidy::Renderer* rendererRef);
-    void allocateIndexBuffers(VkCommandBuffer cmd, VmaAllocator allocator, cassidy::Renderer* rendererRef);
+    void allocateBuffers(VkCommandBuffer cmd, VmaAllocator allocator, cassidy::Renderer* rendererRef);
+
+    // Allocate geometry pool ranges for every mesh and record copies into them from one staging allocation,
+    // which the caller must free once the commands have finished executing:
+    void recordBufferUploads(VkCommandBuffer cmd, UploadContext& uploadContext, cassidy::StagingRingBuffer::Allocation& outStaging);
+
+    // Ask the texture streamer for the mip levels each mesh's textures need, given the world transforms it's drawn
+    // with this frame and the viewport's screen-space size of one world unit at unit distance from the camera:
+    void requestTextureLevels(const std::vector<PerObjectData>& instances, const glm::vec3& cameraPosition,
+      float pixelsPerUnitAtUnitDistance, cassidy::TextureStreamer& streamer) const;
 
     inline void setDebugName(const std::string& name) { m_debugName = name; }
+    inline void setLoadResult(LoadResult result) { m_loadResult = result; }
     
-    inline LoadResult getLoadResult() { return m_loadResult; }
+    inline LoadResult getLoadResult() const { return m_loadResult; }
     inline std::string_view getDebugName() { return m_debugName; }
 
+    // Every texture an Assimp material references, along with the format each should be loaded in:
+    static void gatherTextureRefs(const aiMaterial* material, std::vector<cassidy::MeshCache::TextureRef>& outTextureRefs);
+
   private:
-    typedef std::unordered_map<uint32_t, cassidy::Material*> BuiltMaterials;
+    // Material records and per-mesh material indices gathered during import, used to write the mesh cache:
+    struct MeshCacheBuildData
+    {
+      std::vector<cassidy::MeshCache::MaterialRecord> materials;
+      std::vector<uint32_t> meshMaterialIndices;
+    };
+
+    void processSceneNode(aiNode* node, const aiScene* scene, MeshCacheBuildData& cacheData);
+    void buildMaterials(const aiScene* scene, const std::string& directory, cassidy::Renderer* rendererRef, MeshCacheBuildData& cacheData);
 
-    void processSceneNode(aiNode* node, const aiScene* scene, BuiltMaterials& builtMaterials, const std::string& directory, cassidy::Renderer* rendererRef);
+    static cassidy::TextureHandle loadEmbeddedTexture(const aiScene* scene, const std::string& texName, const std::string& texturesDirectory,
+      cassidy::Renderer* rendererRef);
+    bool loadFromMeshCache(const std::string& cachePath, uint64_t sourceHash, const std::string& directory);
 
     std::vector<Mesh> m_meshes;
-    LoadResult m_loadResult = LoadResult::READY_TO_LOAD;
+    std::vector<cassidy::MaterialHandle> m_materials;   // (one reference per material used by the meshes)
+    std::shared_ptr<cassidy::MeshCache> m_meshCache;  // (keeps mapped vertex/index data alive while meshes reference it)
+    AtomicLoadResult m_loadResult = LoadResult::READY_TO_LOAD;
     std::string m_debugName;
   };
 };
\ No newline at end of file
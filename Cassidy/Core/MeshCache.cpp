@@ -0,0 +1,236 @@
+#include "MeshCache.h"
+#include <Core/Mesh.h>
+#include <Core/Logger.h>
+#include <Utils/Hash.h>
+
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+  constexpr uint64_t DATA_ALIGNMENT   = 16;
+
+  inline uint64_t alignUp(uint64_t value, uint64_t alignment)
+  {
+    return (value + alignment - 1) & ~(alignment - 1);
+  }
+
+  inline void copyName(char (&dst)[cassidy::MeshCache::MAX_NAME_LENGTH], const std::string& src)
+  {
+    memset(dst, 0, sizeof(dst));
+    memcpy(dst, src.c_str(), std::min(src.size(), sizeof(dst) - 1));
+  }
+}
+
+uint64_t cassidy::MeshCache::computeSourceHash(const std::string& sourceFilepath, uint32_t importFlags)
+{
+  cassidy::MappedFile file;
+  if (!file.open(sourceFilepath))
+    return 0;
+
+  cassidy::hash::XXHash64 hasher;
+  hasher.update(file.getData().data(), file.getSize());
+
+  // Changing the import flags or the cache format must invalidate existing cache files:
+  const uint32_t version = VERSION;
+  hasher.update(&importFlags, sizeof(importFlags));
+  hasher.update(&version, sizeof(version));
+
+  // (0 is reserved for unreadable source files)
+  const uint64_t hash = hasher.digest();
+  return hash != 0 ? hash : 1;
+}
+
+bool cassidy::MeshCache::write(const std::string& cachePath, uint64_t sourceHash, const std::vector<cassidy::Mesh>& meshes,
+  const std::vector<uint32_t>& meshMaterialIndices, const std::vector<MaterialRecord>& materials)
+{
+  FileHeader header = {};
+  header.magic = MAGIC;
+  header.version = VERSION;
+  header.sourceHash = sourceHash;
+  header.vertexStride = sizeof(Vertex);
+  header.numMeshes = static_cast<uint32_t>(meshes.size());
+  header.numMaterials = static_cast<uint32_t>(materials.size());
+
+  std::vector<MaterialRecordDisk> materialRecords(materials.size());
+  std::vector<TextureRefDisk> textureRefs;
+
+  for (size_t i = 0; i < materials.size(); ++i)
+  {
+    copyName(materialRecords[i].name, materials[i].name);
+    materialRecords[i].firstTextureRef = static_cast<uint32_t>(textureRefs.size());
+    materialRecords[i].numTextureRefs = static_cast<uint32_t>(materials[i].textures.size());
+
+    for (const auto& texRef : materials[i].textures)
+    {
+      TextureRefDisk& diskRef = textureRefs.emplace_back();
+      copyName(diskRef.filename, texRef.filename);
+      diskRef.type = static_cast<uint32_t>(texRef.type);
+      diskRef.format = static_cast<uint32_t>(texRef.format);
+    }
+  }
+  header.numTextureRefs = static_cast<uint32_t>(textureRefs.size());
+
+  // Lay out vertex and index data after the record tables, aligned so the mapped pointers can be used directly:
+  uint64_t offset = sizeof(FileHeader) +
+    sizeof(MeshRecord) * meshes.size() +
+    sizeof(MaterialRecordDisk) * materialRecords.size() +
+    sizeof(TextureRefDisk) * textureRefs.size();
+
+  std::vector<MeshRecord> meshRecords(meshes.size());
+  for (size_t i = 0; i < meshes.size(); ++i)
+  {
+    MeshRecord& record = meshRecords[i];
+    record.numVertices = meshes[i].getNumVertices();
+    record.numIndices = meshes[i].getNumIndices();
+    record.materialIndex = meshMaterialIndices[i];
+
+    offset = alignUp(offset, DATA_ALIGNMENT);
+    record.vertexDataOffset = offset;
+    offset += sizeof(Vertex) * record.numVertices;
+
+    offset = alignUp(offset, DATA_ALIGNMENT);
+    record.indexDataOffset = offset;
+    offset += sizeof(uint32_t) * record.numIndices;
+  }
+
+  // Write to a temporary file first, so an interrupted write can't leave a truncated cache behind:
+  const std::string tempPath = cachePath + ".tmp";
+  {
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+      CS_LOG_WARN("Couldn't open mesh cache file {0} for writing!", tempPath);
+      return false;
+    }
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(meshRecords.data()), sizeof(MeshRecord) * meshRecords.size());
+    file.write(reinterpret_cast<const char*>(materialRecords.data()), sizeof(MaterialRecordDisk) * materialRecords.size());
+    file.write(reinterpret_cast<const char*>(textureRefs.data()), sizeof(TextureRefDisk) * textureRefs.size());
+
+    const char padding[DATA_ALIGNMENT] = {};
+    for (size_t i = 0; i < meshes.size(); ++i)
+    {
+      file.write(padding, meshRecords[i].vertexDataOffset - static_cast<uint64_t>(file.tellp()));
+      file.write(reinterpret_cast<const char*>(meshes[i].getVertices()), sizeof(Vertex) * meshRecords[i].numVertices);
+
+      file.write(padding, meshRecords[i].indexDataOffset - static_cast<uint64_t>(file.tellp()));
+      file.write(reinterpret_cast<const char*>(meshes[i].getIndices()), sizeof(uint32_t) * meshRecords[i].numIndices);
+    }
+
+    if (!file.good())
+    {
+      CS_LOG_WARN("Failed to write mesh cache file {0}!", tempPath);
+      file.close();
+      std::remove(tempPath.c_str());
+      return false;
+    }
+  }
+
+  std::remove(cachePath.c_str());
+  if (std::rename(tempPath.c_str(), cachePath.c_str()) != 0)
+  {
+    CS_LOG_WARN("Failed to move mesh cache file into place ({0})!", cachePath);
+    std::remove(tempPath.c_str());
+    return false;
+  }
+
+  CS_LOG_INFO("Wrote mesh cache {0} ({1} meshes, {2} bytes)", cachePath, meshes.size(), offset);
+  return true;
+}
+
+bool cassidy::MeshCache::open(const std::string& cachePath, uint64_t expectedSourceHash)
+{
+  close();
+
+  if (!m_file.open(cachePath))
+    return false;
+
+  if (!validate(expectedSourceHash))
+  {
+    CS_LOG_INFO("Mesh cache {0} is stale or invalid, ignoring it.", cachePath);
+    close();
+    return false;
+  }
+
+  return true;
+}
+
+void cassidy::MeshCache::close()
+{
+  m_file.close();
+
+  m_header = nullptr;
+  m_meshRecords = nullptr;
+  m_materialRecords = nullptr;
+  m_textureRefs = nullptr;
+}
+
+cassidy::MeshCache::MaterialRecord cassidy::MeshCache::getMaterial(uint32_t index) const
+{
+  const MaterialRecordDisk& diskRecord = m_materialRecords[index];
+
+  MaterialRecord record;
+  record.name = std::string(diskRecord.name, strnlen(diskRecord.name, MAX_NAME_LENGTH));
+  record.textures.reserve(diskRecord.numTextureRefs);
+
+  for (uint32_t i = 0; i < diskRecord.numTextureRefs; ++i)
+  {
+    const TextureRefDisk& diskRef = m_textureRefs[diskRecord.firstTextureRef + i];
+    record.textures.push_back({
+      static_cast<cassidy::TextureType>(diskRef.type),
+      static_cast<VkFormat>(diskRef.format),
+      std::string(diskRef.filename, strnlen(diskRef.filename, MAX_NAME_LENGTH)),
+      });
+  }
+
+  return record;
+}
+
+bool cassidy::MeshCache::validate(uint64_t expectedSourceHash)
+{
+  const std::span<const uint8_t> data = m_file.getData();
+  if (data.size() < sizeof(FileHeader)) return false;
+
+  const FileHeader* header = reinterpret_cast<const FileHeader*>(data.data());
+  if (header->magic != MAGIC ||
+    header->version != VERSION ||
+    header->sourceHash != expectedSourceHash ||
+    header->vertexStride != sizeof(Vertex))
+    return false;
+
+  const uint64_t tablesSize = sizeof(FileHeader) +
+    sizeof(MeshRecord) * static_cast<uint64_t>(header->numMeshes) +
+    sizeof(MaterialRecordDisk) * static_cast<uint64_t>(header->numMaterials) +
+    sizeof(TextureRefDisk) * static_cast<uint64_t>(header->numTextureRefs);
+  if (tablesSize > data.size()) return false;
+
+  const MeshRecord* meshRecords = reinterpret_cast<const MeshRecord*>(data.data() + sizeof(FileHeader));
+  for (uint32_t i = 0; i < header->numMeshes; ++i)
+  {
+    const MeshRecord& record = meshRecords[i];
+    if (record.materialIndex >= header->numMaterials ||
+      record.vertexDataOffset % DATA_ALIGNMENT != 0 || record.indexDataOffset % DATA_ALIGNMENT != 0 ||
+      record.vertexDataOffset + sizeof(Vertex) * static_cast<uint64_t>(record.numVertices) > data.size() ||
+      record.indexDataOffset + sizeof(uint32_t) * static_cast<uint64_t>(record.numIndices) > data.size())
+      return false;
+  }
+
+  const MaterialRecordDisk* materialRecords = reinterpret_cast<const MaterialRecordDisk*>(meshRecords + header->numMeshes);
+  for (uint32_t i = 0; i < header->numMaterials; ++i)
+  {
+    if (static_cast<uint64_t>(materialRecords[i].firstTextureRef) + materialRecords[i].numTextureRefs > header->numTextureRefs)
+      return false;
+  }
+
+  // Header checks out, so cache pointers to each table:
+  m_header = header;
+  m_meshRecords = meshRecords;
+  m_materialRecords = materialRecords;
+  m_textureRefs = reinterpret_cast<const TextureRefDisk*>(materialRecords + header->numMaterials);
+
+  return true;
+}
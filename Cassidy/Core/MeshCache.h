@@ -0,0 +1,118 @@
+#pragma once
+#include <Utils/Types.h>
+#include <Core/Texture.h>
+#include <Utils/FileMapping.h>
+
+#include <string>
+#include <vector>
+
+namespace cassidy
+{
+  class Mesh;
+
+  // Versioned on-disk cache (.csmesh) of a model's post-processed Assimp output. Written after the first
+  // import of a model and memory-mapped on later loads, so vertex and index data can be uploaded straight
+  // from the mapping without running the importer again.
+  class MeshCache
+  {
+  public:
+    static constexpr uint32_t MAGIC           = 0x48534D43;  // "CMSH"
+    static constexpr uint32_t VERSION         = 1;
+    static constexpr uint32_t MAX_NAME_LENGTH = 256;
+
+    struct TextureRef
+    {
+      cassidy::TextureType type;
+      VkFormat format;
+      std::string filename;   // (relative to the model's directory)
+    };
+
+    struct MaterialRecord
+    {
+      std::string name;
+      std::vector<TextureRef> textures;
+      bool hasEmbeddedTextures = false;  // (embedded textures can't be referenced by filename, so aren't cached)
+    };
+
+    // Layout of the records stored in a cache file (all offsets are relative to the start of the file):
+    struct FileHeader
+    {
+      uint32_t magic;
+      uint32_t version;
+      uint64_t sourceHash;
+      uint32_t vertexStride;
+      uint32_t numMeshes;
+      uint32_t numMaterials;
+      uint32_t numTextureRefs;
+    };
+
+    struct MeshRecord
+    {
+      uint64_t vertexDataOffset;
+      uint64_t indexDataOffset;
+      uint32_t numVertices;
+      uint32_t numIndices;
+      uint32_t materialIndex;
+      uint32_t padding;
+    };
+
+    struct MaterialRecordDisk
+    {
+      char name[MAX_NAME_LENGTH];
+      uint32_t firstTextureRef;
+      uint32_t numTextureRefs;
+    };
+
+    struct TextureRefDisk
+    {
+      char filename[MAX_NAME_LENGTH];
+      uint32_t type;
+      uint32_t format;
+    };
+
+    MeshCache() = default;
+    ~MeshCache() { close(); }
+
+    MeshCache(const MeshCache&) = delete;
+    MeshCache& operator=(const MeshCache&) = delete;
+
+    static inline std::string getCachePath(const std::string& sourceFilepath) { return sourceFilepath + ".csmesh"; }
+
+    // Hash of the source file's contents, the Assimp import flags and the cache version (0 if the file can't be read):
+    static uint64_t computeSourceHash(const std::string& sourceFilepath, uint32_t importFlags);
+
+    static bool write(const std::string& cachePath, uint64_t sourceHash, const std::vector<cassidy::Mesh>& meshes,
+      const std::vector<uint32_t>& meshMaterialIndices, const std::vector<MaterialRecord>& materials);
+
+    // Map an existing cache file, failing if it's missing, malformed or was built from different source data:
+    bool open(const std::string& cachePath, uint64_t expectedSourceHash);
+    void close();
+
+    // Getters/setters: ------------------------------------------------------------------------------------------
+    inline bool               isOpen()                        const { return m_header != nullptr; }
+    inline uint32_t           getNumMeshes()                  const { return m_header->numMeshes; }
+    inline uint32_t           getNumMaterials()               const { return m_header->numMaterials; }
+    inline const MeshRecord&  getMeshRecord(uint32_t index)   const { return m_meshRecords[index]; }
+
+    inline const Vertex* getVertices(uint32_t meshIndex) const
+    {
+      return reinterpret_cast<const Vertex*>(m_file.getData().data() + m_meshRecords[meshIndex].vertexDataOffset);
+    }
+    inline const uint32_t* getIndices(uint32_t meshIndex) const
+    {
+      return reinterpret_cast<const uint32_t*>(m_file.getData().data() + m_meshRecords[meshIndex].indexDataOffset);
+    }
+
+    MaterialRecord getMaterial(uint32_t index) const;
+
+  private:
+    bool validate(uint64_t expectedSourceHash);
+
+    cassidy::MappedFile m_file;
+
+    const FileHeader*         m_header = nullptr;
+    const MeshRecord*         m_meshRecords = nullptr;
+    const MaterialRecordDisk* m_materialRecords = nullptr;
+    const TextureRefDisk*     m_textureRefs = nullptr;
+  };
+}
@@ -1,55 +1,298 @@
 #include "ModelManager.h"
 #include <Core/ResourceManager.h>
+#include <Core/Engine.h>
 #include <Core/Logger.h>
+#include <Utils/Initialisers.h>
+#include <Utils/Helpers.h>
+#include <Utils/DescriptorBuilder.h>
 
-void cassidy::ModelManager::releaseAll(VkDevice device, VmaAllocator allocator)
+#include <algorithm>
+
+void cassidy::ModelManager::releaseAll(VkDevice device, VmaAllocator allocator, UploadContext& uploadContext)
 {
-	CS_LOG_INFO("Releasing {0} models...", m_loadedModels.size());
-	for (auto&& model : m_loadedModels)
 	{
-		model.second.release(device, allocator);
+		// Make sure in-flight uploads have finished before their buffers are destroyed:
+		std::lock_guard<std::mutex> pendingLock(m_pendingUploadsMutex);
+		for (const auto& upload : m_pendingUploads)
+		{
+			vkWaitForFences(device, 1, &upload.fence, VK_TRUE, UINT64_MAX);
+			releasePendingUpload(device, uploadContext, upload);
+		}
+		m_pendingUploads.clear();
 	}
+
+	CS_LOG_INFO("Releasing {0} models...", m_models.getNumResources());
+	m_models.forEach([&](cassidy::ModelHandle handle, NamedModel& namedModel) {
+		namedModel.model.release(device, allocator);
+		});
+	m_models.clear();
+	m_modelHandles.clear();
+	m_loadOrder.clear();
 }
 
-bool cassidy::ModelManager::loadModel(const std::string& filepath, cassidy::Renderer* rendererRef, aiPostProcessSteps additionalSteps)
+cassidy::ModelHandle cassidy::ModelManager::loadModel(const std::string& filepath, cassidy::Renderer* rendererRef, aiPostProcessSteps additionalSteps)
 {
-	if (m_loadedModels.find(filepath) != m_loadedModels.end()) 
 	{
-		CS_LOG_INFO("Model already loaded! ({0})", filepath);
-		return true;
+		std::lock_guard<std::mutex> modelsLock(m_modelsMutex);
+		const cassidy::ModelHandle existingModel = acquireModel(filepath);
+		if (existingModel.isValid())
+		{
+			CS_LOG_INFO("Model already loaded! ({0})", filepath);
+			return existingModel;
+		}
 	}
 
 	Model newModel;
+	newModel.setDebugName(filepath);
 	const VmaAllocator& alloc = cassidy::globals::g_resourceManager.getVmaAllocator();
 	if (!newModel.loadModel(filepath, alloc, rendererRef, additionalSteps))
-		return false;
+	{
+		newModel.release(rendererRef->getLogicalDevice(), alloc);
+		return {};
+	}
+
+	std::lock_guard<std::mutex> modelsLock(m_modelsMutex);
+	const cassidy::ModelHandle existingModel = acquireModel(filepath);
+	if (existingModel.isValid())
+	{
+		// Another thread finished loading the same file first, so keep theirs:
+		newModel.release(rendererRef->getLogicalDevice(), alloc);
+		return existingModel;
+	}
+	return addModel(filepath, newModel);
+}
+
+cassidy::ModelHandle cassidy::ModelManager::registerModel(const std::string& name, const cassidy::Model& model)
+{
+	std::lock_guard<std::mutex> modelsLock(m_modelsMutex);
+	const cassidy::ModelHandle existingModel = acquireModel(name);
+	if (existingModel.isValid())
+	{
+		CS_LOG_WARN("A model is already registered with this name! ({0})", name);
+		return existingModel;
+	}
 
-	m_loadedModels[filepath] = newModel;
-	m_modelsPtrTable.emplace_back(&m_loadedModels.at(filepath));
-	return true;
+	CS_LOG_INFO("New model registered with model manager ({0})!", name);
+	return addModel(name, model);
+}
+
+void cassidy::ModelManager::addRef(cassidy::ModelHandle handle)
+{
+	if (handle.isValid() && !m_models.addRef(handle))
+		CS_LOG_WARN("Tried to reference a model that has been unloaded!");
 }
 
-void cassidy::ModelManager::registerModel(const std::string& name, const cassidy::Model& model)
+void cassidy::ModelManager::releaseModel(cassidy::ModelHandle handle)
 {
-	if (m_loadedModels.find(name) != m_loadedModels.end())
+	if (!handle.isValid() || m_models.removeRef(handle) != 0) return;
+
+	// Forget the model straight away so it can be loaded again, but keep its geometry alive until no frame in flight
+	// can still be drawing it:
 	{
-		CS_LOG_INFO("New model registered with model manager ({0})!", name);
-		return;
+		std::lock_guard<std::mutex> modelsLock(m_modelsMutex);
+		forgetModel(handle);
 	}
-	m_loadedModels[name] = model;
-	m_modelsPtrTable.emplace_back(&m_loadedModels.at(name));
+
+	cassidy::globals::g_resourceManager.deferDeletion([this, handle]() {
+		NamedModel* namedModel = m_models.get(handle);
+		CS_LOG_INFO("Unloading model {0}", namedModel->name);
+
+		namedModel->model.release(cassidy::globals::g_descAllocator.getDeviceRef(),
+			cassidy::globals::g_resourceManager.getVmaAllocator());
+		m_models.remove(handle);
+		});
 }
 
 void cassidy::ModelManager::allocateBuffers(VkCommandBuffer cmd, VmaAllocator allocator, cassidy::Renderer* rendererRef)
 {
 	CS_LOG_INFO("Allocating vertex and index buffers...");
 
-	for (auto&& model : m_loadedModels)
+	m_models.forEach([&](cassidy::ModelHandle handle, NamedModel& namedModel) {
+		cassidy::Model& model = namedModel.model;
+		if (model.getLoadResult() == LoadResult::NOT_FOUND)
+			return;
+
+		model.allocateBuffers(cmd, allocator, rendererRef);
+		model.setLoadResult(LoadResult::SUCCESS);
+		});
+}
+
+cassidy::ModelHandle cassidy::ModelManager::findModel(const std::string& name)
+{
+	std::lock_guard<std::mutex> modelsLock(m_modelsMutex);
+	const auto loadedIt = m_modelHandles.find(name);
+	return loadedIt != m_modelHandles.end() ? loadedIt->second : cassidy::ModelHandle();
+}
+
+std::vector<cassidy::ModelHandle> cassidy::ModelManager::getModelHandles()
+{
+	std::lock_guard<std::mutex> modelsLock(m_modelsMutex);
+	return m_loadOrder;
+}
+
+cassidy::ModelHandle cassidy::ModelManager::loadModelAsync(const std::string& filepath, cassidy::Renderer* rendererRef, aiPostProcessSteps additionalSteps)
+{
+	cassidy::ModelHandle handle;
+	cassidy::Model* model;
+	{
+		std::lock_guard<std::mutex> modelsLock(m_modelsMutex);
+		const cassidy::ModelHandle existingModel = acquireModel(filepath);
+		if (existingModel.isValid())
+		{
+			CS_LOG_INFO("Model already loaded! ({0})", filepath);
+			return existingModel;
+		}
+
+		// Placeholder stays undrawable until its upload has finished:
+		cassidy::Model placeholder;
+		placeholder.setDebugName(filepath);
+		handle = addModel(filepath, placeholder);
+		model = getModel(handle);
+	}
+
+	// The load keeps the model alive until its upload has finished, even if the caller lets go of it first:
+	m_models.addRef(handle);
+
+	std::lock_guard<std::mutex> modelsLock(m_modelsMutex);
+	m_loadJobs = rendererRef->getEngineRef()->getJobSystem().pushJob([this, handle, model, filepath, rendererRef, additionalSteps]() {
+		const VmaAllocator allocator = cassidy::globals::g_resourceManager.getVmaAllocator();
+		if (!model->loadModel(filepath, allocator, rendererRef, additionalSteps))
+		{
+			// Model is left marked NOT_FOUND for anyone still holding it, but its name is freed up so a later load
+			// of the same file tries again rather than finding this placeholder:
+			CS_LOG_ERROR("Failed to load model {0} asynchronously!", filepath);
+			{
+				std::lock_guard<std::mutex> modelsLock(m_modelsMutex);
+				forgetModel(handle);
+			}
+			releaseModel(handle);
+			return;
+		}
+
+		streamModelBuffers(handle, model, rendererRef);
+		}, cassidy::JobSystem::Priority::HIGH, m_loadJobs);
+
+	return handle;
+}
+
+void cassidy::ModelManager::pollPendingUploads(VkDevice device, UploadContext& uploadContext)
+{
+	std::lock_guard<std::mutex> pendingLock(m_pendingUploadsMutex);
+
+	for (auto it = m_pendingUploads.begin(); it != m_pendingUploads.end();)
 	{
-		if (model.second.getLoadResult() == LoadResult::NOT_FOUND)
+		if (vkGetFenceStatus(device, it->fence) != VK_SUCCESS)
+		{
+			++it;
 			continue;
+		}
+
+		releasePendingUpload(device, uploadContext, *it);
+		it->model->setLoadResult(LoadResult::SUCCESS);
+		CS_LOG_INFO("Finished streaming model {0}!", it->model->getDebugName());
+		releaseModel(it->handle);
 
-		model.second.allocateVertexBuffers(cmd, allocator, rendererRef);
-		model.second.allocateIndexBuffers(cmd, allocator, rendererRef);
+		it = m_pendingUploads.erase(it);
 	}
-}
\ No newline at end of file
+}
+
+void cassidy::ModelManager::waitForPendingLoads(VkDevice device, UploadContext& uploadContext, cassidy::JobSystem& jobSystem)
+{
+	cassidy::JobHandle loadJobs;
+	{
+		std::lock_guard<std::mutex> modelsLock(m_modelsMutex);
+		loadJobs = m_loadJobs;
+	}
+
+	// Once every load job has run, each successful load has submitted its upload:
+	jobSystem.wait(loadJobs);
+	{
+		std::lock_guard<std::mutex> pendingLock(m_pendingUploadsMutex);
+		for (const auto& upload : m_pendingUploads)
+		{
+			vkWaitForFences(device, 1, &upload.fence, VK_TRUE, UINT64_MAX);
+		}
+	}
+
+	pollPendingUploads(device, uploadContext);
+}
+
+void cassidy::ModelManager::streamModelBuffers(cassidy::ModelHandle handle, cassidy::Model* model, cassidy::Renderer* rendererRef)
+{
+	const VkDevice device = rendererRef->getLogicalDevice();
+	UploadContext& uploadContext = rendererRef->getUploadContext();
+
+	PendingUpload upload = {};
+	upload.handle = handle;
+	upload.model = model;
+
+	// Each streamed model records into its own transient pool, so workers never share a command buffer:
+	VkCommandPoolCreateInfo poolInfo = cassidy::init::commandPoolCreateInfo(VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+		uploadContext.uploadQueueFamily);
+	VK_CHECK(vkCreateCommandPool(device, &poolInfo, nullptr, &upload.commandPool));
+
+	VkCommandBuffer uploadCmd;
+	VkCommandBufferAllocateInfo allocInfo = cassidy::init::commandBufferAllocInfo(upload.commandPool,
+		VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1);
+	VK_CHECK(vkAllocateCommandBuffers(device, &allocInfo, &uploadCmd));
+
+	VkCommandBufferBeginInfo beginInfo = cassidy::init::commandBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, nullptr);
+	vkBeginCommandBuffer(uploadCmd, &beginInfo);
+	{
+		model->recordBufferUploads(uploadCmd, uploadContext, upload.staging);
+	}
+	vkEndCommandBuffer(uploadCmd);
+
+	VkFenceCreateInfo fenceInfo = cassidy::init::fenceCreateInfo(0);
+	VK_CHECK(vkCreateFence(device, &fenceInfo, nullptr, &upload.fence));
+
+	VkSubmitInfo submitInfo = cassidy::init::submitInfo(0, nullptr, 0, 0, nullptr, 1, &uploadCmd);
+	{
+		// Queue access has to be externally synchronised with other upload submissions:
+		std::lock_guard<std::mutex> submitLock(uploadContext.submitMutex);
+		VK_CHECK(vkQueueSubmit(uploadContext.uploadQueue, 1, &submitInfo, upload.fence));
+	}
+	uploadContext.stagingRing.retire(upload.staging, upload.fence);
+
+	std::lock_guard<std::mutex> pendingLock(m_pendingUploadsMutex);
+	m_pendingUploads.push_back(upload);
+	CS_LOG_INFO("Submitted buffer uploads for model {0}!", model->getDebugName());
+}
+
+void cassidy::ModelManager::releasePendingUpload(VkDevice device, UploadContext& uploadContext, const PendingUpload& upload)
+{
+	uploadContext.stagingRing.free(upload.staging);
+	vkDestroyFence(device, upload.fence, nullptr);
+	vkDestroyCommandPool(device, upload.commandPool, nullptr);
+}
+cassidy::ModelHandle cassidy::ModelManager::addModel(const std::string& name, const cassidy::Model& model)
+{
+	const cassidy::ModelHandle handle = m_models.add({ model, name });
+	m_modelHandles[name] = handle;
+	m_loadOrder.push_back(handle);
+
+	cassidy::Model* addedModel = getModel(handle);
+	if (addedModel->getDebugName().empty())
+		addedModel->setDebugName(name);
+
+	return handle;
+}
+
+void cassidy::ModelManager::forgetModel(cassidy::ModelHandle handle)
+{
+	NamedModel* namedModel = m_models.get(handle);
+	const auto loadedIt = m_modelHandles.find(namedModel->name);
+	if (loadedIt != m_modelHandles.end() && loadedIt->second == handle)
+		m_modelHandles.erase(loadedIt);
+
+	m_loadOrder.erase(std::remove(m_loadOrder.begin(), m_loadOrder.end(), handle), m_loadOrder.end());
+}
+
+cassidy::ModelHandle cassidy::ModelManager::acquireModel(const std::string& name)
+{
+	const auto loadedIt = m_modelHandles.find(name);
+	if (loadedIt == m_modelHandles.end() || !m_models.addRef(loadedIt->second))
+		return {};
+
+	return loadedIt->second;
+}
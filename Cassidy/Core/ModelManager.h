@@ -1,5 +1,8 @@
 #pragma once
 #include <Core/Mesh.h>
+#include <Core/JobSystem.h>
+#include <Utils/ResourcePool.h>
+#include <mutex>
 
 enum aiPostProcessSteps;
 
@@ -7,25 +10,85 @@ namespace cassidy {
 	class ModelManager
 	{
 	public:
-		typedef std::unordered_map<std::string, cassidy::Model> LoadedModels;
-
 		ModelManager() {}
 
-		void releaseAll(VkDevice device, VmaAllocator allocator);
+		void releaseAll(VkDevice device, VmaAllocator allocator, UploadContext& uploadContext);
+
+		// Models are reference counted, every handle returned by a load or register call holds one reference which the
+		// caller has to release. Loading a model that's already loaded just takes another reference to it:
+		cassidy::ModelHandle loadModel(const std::string& filepath, cassidy::Renderer* rendererRef, aiPostProcessSteps additionalSteps = (aiPostProcessSteps)0);
+
+		// Register the model straight away, then decode it on a job system worker and stream its buffers to the GPU
+		// with one submission on the upload queue. The model reports LoadResult::UPLOADING until pollPendingUploads()
+		// sees that submission's fence signal (the load holds its own reference until then). If decoding fails the model
+		// reports LoadResult::NOT_FOUND instead, and is no longer found by name, so loading the file again retries it.
+		cassidy::ModelHandle loadModelAsync(const std::string& filepath, cassidy::Renderer* rendererRef, aiPostProcessSteps additionalSteps = (aiPostProcessSteps)0);
+		void pollPendingUploads(VkDevice device, UploadContext& uploadContext);
+
+		// Block until every async load has been decoded and its upload has finished, e.g. so a frame that's about to
+		// be captured includes them:
+		void waitForPendingLoads(VkDevice device, UploadContext& uploadContext, cassidy::JobSystem& jobSystem);
+		cassidy::ModelHandle registerModel(const std::string& name, const cassidy::Model& model);
 
-		bool loadModel(const std::string& filepath, cassidy::Renderer* rendererRef, aiPostProcessSteps additionalSteps = (aiPostProcessSteps)0);
-		void registerModel(const std::string& name, const cassidy::Model& model);
+		void addRef(cassidy::ModelHandle handle);
+
+		// Models with no references left have their geometry and materials released once no frame in flight can still
+		// be drawing them:
+		void releaseModel(cassidy::ModelHandle handle);
 
 		void allocateBuffers(VkCommandBuffer cmd, VmaAllocator allocator, cassidy::Renderer* rendererRef);
 
-		inline Model* getModel(const std::string& name) { return m_loadedModels.find(name) != m_loadedModels.end() ? &m_loadedModels.at(name) : nullptr; }
+		// Null if the handle is stale:
+		inline cassidy::Model* getModel(cassidy::ModelHandle handle)
+		{
+			NamedModel* namedModel = m_models.get(handle);
+			return namedModel ? &namedModel->model : nullptr;
+		}
+
+		// Look up a loaded model without taking a reference (invalid handle if it isn't loaded):
+		cassidy::ModelHandle findModel(const std::string& name);
+
+		inline uint32_t getNumLoadedModels() const { return m_models.getNumResources(); }
 
-		inline size_t getNumLoadedModels() { return m_loadedModels.size(); }
-		inline LoadedModels& getLoadedModels() { return m_loadedModels; }
-		inline std::vector<cassidy::Model*> getModelsPtrTable() { return m_modelsPtrTable; }
+		// Every loaded model, in the order they were loaded:
+		std::vector<cassidy::ModelHandle> getModelHandles();
 
 	private:
-		LoadedModels m_loadedModels;
-		std::vector<cassidy::Model*> m_modelsPtrTable;
+		struct NamedModel
+		{
+			cassidy::Model model;
+			std::string name;
+		};
+
+		struct PendingUpload
+		{
+			cassidy::ModelHandle handle;
+			cassidy::Model* model;
+			VkCommandPool commandPool;
+			VkFence fence;
+			cassidy::StagingRingBuffer::Allocation staging;
+		};
+
+		// Add a model under a name not yet in use, must be called with the models mutex locked:
+		cassidy::ModelHandle addModel(const std::string& name, const cassidy::Model& model);
+
+		// Take a reference to an already-loaded model, must be called with the models mutex locked:
+		cassidy::ModelHandle acquireModel(const std::string& name);
+
+		// Stop the model being found by name or listed as loaded (it stays alive while referenced), must be called
+		// with the models mutex locked:
+		void forgetModel(cassidy::ModelHandle handle);
+
+		void streamModelBuffers(cassidy::ModelHandle handle, cassidy::Model* model, cassidy::Renderer* rendererRef);
+		void releasePendingUpload(VkDevice device, UploadContext& uploadContext, const PendingUpload& upload);
+
+		cassidy::ResourcePool<NamedModel, cassidy::ModelHandle> m_models;
+		std::unordered_map<std::string, cassidy::ModelHandle> m_modelHandles;
+		std::vector<cassidy::ModelHandle> m_loadOrder;
+		std::mutex m_modelsMutex;	// (models may be loaded from several job system workers at once)
+		cassidy::JobHandle m_loadJobs;	// (every async load job shares this handle's counter, guarded by the models mutex)
+
+		std::vector<PendingUpload> m_pendingUploads;
+		std::mutex m_pendingUploadsMutex;
 	};
 };
\ No newline at end of file
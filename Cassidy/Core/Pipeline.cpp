@@ -1,73 +1,84 @@
 #include "Pipeline.h"
 #include <Core/Renderer.h>
+#include <Core/ResourceManager.h>
+#include <Core/Engine.h>
+#include <Core/CpuProfiler.h>
 #include <Core/Logger.h>
 #include <Utils/Initialisers.h>
+#include <Utils/DescriptorBuilder.h>
 #include <Utils/Helpers.h>
 #include <Utils/Types.h>
+#include <Utils/Hash.h>
 
-#include <fstream>
+namespace
+{
+  void createShaderModules(VkDevice device, const cassidy::PipelineRegistry::ShaderStages& shaderStages,
+    std::vector<VkShaderModule>& outModules, std::vector<VkPipelineShaderStageCreateInfo>& outStageInfos)
+  {
+    for (const cassidy::PipelineRegistry::ShaderStage& shaderStage : shaderStages)
+    {
+      VkShaderModuleCreateInfo moduleInfo = cassidy::init::shaderModuleCreateInfo(
+        shaderStage.code.size() * sizeof(uint32_t), const_cast<uint32_t*>(shaderStage.code.data()));
+
+      VkShaderModule shaderModule;
+      vkCreateShaderModule(device, &moduleInfo, nullptr, &shaderModule);
+
+      outModules.push_back(shaderModule);
+      outStageInfos.push_back(cassidy::init::pipelineShaderStageCreateInfo(shaderStage.stage, shaderModule));
+    }
+  }
+}
 
 void cassidy::Pipeline::release(VkDevice device)
 {
-  vkDestroyPipeline(device, m_pipeline, nullptr);
-  vkDestroyPipelineLayout(device, m_pipelineLayout, nullptr);
+  if (m_stateHash != 0)
+  {
+    cassidy::globals::g_resourceManager.pipelineRegistry.releasePipeline(m_stateHash);
+  }
+  else
+  {
+    vkDestroyPipeline(device, m_pipeline, nullptr);
+    vkDestroyPipelineLayout(device, m_pipelineLayout, nullptr);
+  }
+  m_pipeline = VK_NULL_HANDLE;
+  m_pipelineLayout = VK_NULL_HANDLE;
+  m_sharedPipeline.reset();
+  m_stateHash = 0;
 }
 
-void cassidy::GraphicsPipeline::buildGraphicsPipeline(
-  uint32_t numDescSetLayouts, VkDescriptorSetLayout* descSetLayouts, 
-  uint32_t numPushConstantRanges, VkPushConstantRange* pushConstantRanges, 
+VkPipeline cassidy::GraphicsPipeline::compileGraphicsPipeline(VkDevice device, VkPipelineCache pipelineCache, VkPipelineLayout layout,
   uint32_t numShaderStages, VkPipelineShaderStageCreateInfo* shaderStages, 
   VkPipelineVertexInputStateCreateInfo* vertexInputStateInfo, VkPipelineInputAssemblyStateCreateInfo* inputAssemblyStateInfo, 
   VkPipelineViewportStateCreateInfo* viewportStateInfo, VkPipelineRasterizationStateCreateInfo* rasterisationStateInfo, 
   VkPipelineMultisampleStateCreateInfo* multisampleStateInfo, VkPipelineDepthStencilStateCreateInfo* depthStencilStateInfo, 
   VkPipelineColorBlendAttachmentState* colourBlendAttachState, VkPipelineDynamicStateCreateInfo* dynamicStateInfo, 
-  VkRenderPass renderPass, uint32_t subpass,
-  cassidy::Renderer* rendererRef)
+  VkRenderPass renderPass, uint32_t subpass)
 {
-  CS_LOG_INFO("Building graphics pipeline ({0})...", m_debugName);
-
-  VkPipelineLayoutCreateInfo pipelineLayoutInfo = cassidy::init::pipelineLayoutCreateInfo(
-    numDescSetLayouts, descSetLayouts, numPushConstantRanges, pushConstantRanges);
-
-  vkCreatePipelineLayout(rendererRef->getLogicalDevice(), &pipelineLayoutInfo, nullptr, &m_pipelineLayout);
-
   VkPipelineColorBlendStateCreateInfo colourBlendState = cassidy::init::pipelineColorBlendStateCreateInfo(
     1, colourBlendAttachState, 0.0f, 0.0f, 0.0f, 0.0f);
 
   VkGraphicsPipelineCreateInfo graphicsPipelineInfo = cassidy::init::graphicsPipelineCreateInfo(
-    2, shaderStages,
+    numShaderStages, shaderStages,
     vertexInputStateInfo, inputAssemblyStateInfo,
     viewportStateInfo, rasterisationStateInfo,
     multisampleStateInfo, depthStencilStateInfo,
     &colourBlendState, dynamicStateInfo,
-    m_pipelineLayout, renderPass, 0);
+    layout, renderPass, subpass);
 
-  vkCreateGraphicsPipelines(rendererRef->getLogicalDevice(), VK_NULL_HANDLE, 1, &graphicsPipelineInfo, nullptr, &m_pipeline);
+  VkPipeline pipeline = VK_NULL_HANDLE;
+  vkCreateGraphicsPipelines(device, pipelineCache, 1, &graphicsPipelineInfo, nullptr, &pipeline);
+  return pipeline;
 }
 
-void cassidy::ComputePipeline::buildComputePipeline(
-  uint32_t numDescSetLayouts, VkDescriptorSetLayout* descSetLayouts, 
-  uint32_t numPushConstantRanges, VkPushConstantRange* pushConstantRanges, 
-  VkPipelineShaderStageCreateInfo* computeShaderStage, 
-  cassidy::Renderer* rendererRef)
+VkPipeline cassidy::ComputePipeline::compileComputePipeline(VkDevice device, VkPipelineCache pipelineCache, VkPipelineLayout layout,
+  VkPipelineShaderStageCreateInfo* computeShaderStage)
 {
-  CS_LOG_INFO("Building compute pipeline ({0})...", m_debugName);
-
-  VkPipelineLayoutCreateInfo pipelineLayoutInfo = cassidy::init::pipelineLayoutCreateInfo(
-    numDescSetLayouts, descSetLayouts, numPushConstantRanges, pushConstantRanges);
-
-  vkCreatePipelineLayout(rendererRef->getLogicalDevice(), &pipelineLayoutInfo, nullptr, &m_pipelineLayout);
-
   VkComputePipelineCreateInfo computePipelineInfo = cassidy::init::computePipelineCreateInfo(
-    computeShaderStage, m_pipelineLayout);
-
-  vkCreateComputePipelines(rendererRef->getLogicalDevice(), VK_NULL_HANDLE, 1, &computePipelineInfo, nullptr, &m_pipeline);
-}
+    computeShaderStage, layout);
 
-cassidy::PipelineBuilder::~PipelineBuilder()
-{
-  for (const auto& stage : m_shaderStages)
-    delete[] stage.second.codeBuffer;
+  VkPipeline pipeline = VK_NULL_HANDLE;
+  vkCreateComputePipelines(device, pipelineCache, 1, &computePipelineInfo, nullptr, &pipeline);
+  return pipeline;
 }
 
 cassidy::PipelineBuilder& cassidy::PipelineBuilder::addShaderStage(VkShaderStageFlagBits stage, const std::string& filepath)
@@ -86,14 +97,14 @@ cassidy::PipelineBuilder& cassidy::PipelineBuilder::addShaderStage(VkShaderStage
     break;
   }
 
-  // Remove existing shader stage code if one already exists:
-  if (m_shaderStages.find(stage) != m_shaderStages.end())
-    delete[] m_shaderStages[stage].codeBuffer;
-
-  SpirvShaderCode shaderCode = loadSpirv(SHADER_ABS_FILEPATH + filepath);
+  // (replaces the stage's existing code, if it has any, but only once the new code has loaded)
+  cassidy::MappedFile shaderFile;
+  SpirvShaderCode shaderCode = loadSpirv(SHADER_ABS_FILEPATH + filepath, shaderFile);
   if (shaderCode.codeBuffer)
   {
     m_shaderStages[stage] = shaderCode;
+    m_shaderFiles[stage] = std::move(shaderFile);
+    m_shaderFilenames[stage] = filepath;
     CS_LOG_INFO("Updated pipeline builder shader stage ({0}: {1})", stageName, filepath);
   }
 
@@ -107,6 +118,40 @@ cassidy::PipelineBuilder& cassidy::PipelineBuilder::addPushConstantRange(VkShade
 }
 
 bool cassidy::PipelineBuilder::buildGraphicsPipeline(GraphicsPipeline& pipeline)
+{
+  cassidy::JobHandle compileJob;
+  if (!startGraphicsPipeline(pipeline, cassidy::JobSystem::Priority::HIGH, compileJob))
+    return false;
+
+  // (the waiting thread helps run jobs, so this often compiles the pipeline itself)
+  m_rendererRef->getEngineRef()->getJobSystem().wait(compileJob);
+  return pipeline.isReady();
+}
+
+bool cassidy::PipelineBuilder::buildComputePipeline(ComputePipeline& pipeline)
+{
+  cassidy::JobHandle compileJob;
+  if (!startComputePipeline(pipeline, cassidy::JobSystem::Priority::HIGH, compileJob))
+    return false;
+
+  m_rendererRef->getEngineRef()->getJobSystem().wait(compileJob);
+  return pipeline.isReady();
+}
+
+bool cassidy::PipelineBuilder::buildGraphicsPipelineAsync(GraphicsPipeline& pipeline)
+{
+  cassidy::JobHandle compileJob;
+  return startGraphicsPipeline(pipeline, cassidy::JobSystem::Priority::LOW, compileJob);
+}
+
+bool cassidy::PipelineBuilder::buildComputePipelineAsync(ComputePipeline& pipeline)
+{
+  cassidy::JobHandle compileJob;
+  return startComputePipeline(pipeline, cassidy::JobSystem::Priority::LOW, compileJob);
+}
+
+bool cassidy::PipelineBuilder::startGraphicsPipeline(GraphicsPipeline& pipeline, cassidy::JobSystem::Priority priority,
+  cassidy::JobHandle& outCompileJob)
 {
   bool wasBuildSuccessful = true;
   const std::string_view name = pipeline.getDebugName();
@@ -131,62 +176,90 @@ bool cassidy::PipelineBuilder::buildGraphicsPipeline(GraphicsPipeline& pipeline)
 
   if (!wasBuildSuccessful) return false;
 
-  VkShaderModuleCreateInfo vertexModuleInfo = cassidy::init::shaderModuleCreateInfo(m_shaderStages.at(VK_SHADER_STAGE_VERTEX_BIT));
-  VkShaderModuleCreateInfo fragmentModuleInfo = cassidy::init::shaderModuleCreateInfo(m_shaderStages.at(VK_SHADER_STAGE_FRAGMENT_BIT));
-
-  VkShaderModule vertexModule;
-  VkShaderModule fragmentModule;
-
-  vkCreateShaderModule(m_rendererRef->getLogicalDevice(), &vertexModuleInfo, nullptr, &vertexModule);
-  vkCreateShaderModule(m_rendererRef->getLogicalDevice(), &fragmentModuleInfo, nullptr, &fragmentModule);
-
-  VkPipelineShaderStageCreateInfo shaderStages[] = {
-    cassidy::init::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT, vertexModule),
-    cassidy::init::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_FRAGMENT_BIT, fragmentModule),
-  };
-
-  VkViewport viewport = {
-    .x = 0.0f,
-    .y = 0.0f,
-    .width = static_cast<float>(m_rendererRef->getSwapchain().extent.width),
-    .height = static_cast<float>(m_rendererRef->getSwapchain().extent.height),
-    .minDepth = 0.0f,
-    .maxDepth = 1.0f,
-  };
-
-  VkRect2D scissor = {
-    .offset = { 0, 0 },
-    .extent = m_rendererRef->getSwapchain().extent,
-  };
-
-  VkPipelineViewportStateCreateInfo viewportInfo = cassidy::init::pipelineViewportStateCreateInfo(1, &viewport, 1, &scissor);
-
-  VkPipelineDynamicStateCreateInfo dynamicStateInfo = cassidy::init::pipelineDynamicStateCreateinfo(
-    static_cast<uint32_t>(cassidy::Renderer::DYNAMIC_STATES.size()), cassidy::Renderer::DYNAMIC_STATES.data());
-
-  auto bindingDescription = Vertex::getBindingDesc();
-  auto attributeDescriptions = Vertex::getAttributeDescs();
+  // Pipelines are often built more than once with identical state (e.g. once per render pass using the same
+  // shaders), in which case share the one already built:
+  constexpr cassidy::PipelineRegistry& registry = cassidy::globals::g_resourceManager.pipelineRegistry;
+  const uint64_t stateHash = hashPipelineState(VK_PIPELINE_BIND_POINT_GRAPHICS);
+  if (registry.acquirePipeline(stateHash, pipeline, outCompileJob))
+  {
+    CS_LOG_INFO("Sharing existing graphics pipeline with identical state ({0})", name);
+    return true;
+  }
 
-  m_vertexInputStateInfo = cassidy::init::pipelineVertexInputStateCreateInfo(
-    1, &bindingDescription, static_cast<uint32_t>(attributeDescriptions.size()), attributeDescriptions.data());
+  CS_LOG_INFO("Building graphics pipeline ({0})...", name);
 
-  pipeline.buildGraphicsPipeline(
+  // Layout is cheap to create, so make it now (letting the pipeline be bound to descriptor sets before it's compiled):
+  const VkDevice device = m_rendererRef->getLogicalDevice();
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo = cassidy::init::pipelineLayoutCreateInfo(
     static_cast<uint32_t>(m_descSetLayouts.size()), m_descSetLayouts.data(),
-    static_cast<uint32_t>(m_pushConstantRanges.size()), m_pushConstantRanges.data(),
-    2, shaderStages,
-    &m_vertexInputStateInfo, &m_inputAssemblyStateInfo,
-    &viewportInfo, &m_rasterisationStateInfo,
-    &m_multisampleStateInfo, &m_depthStencilStateInfo,
-    &m_colourBlendAttachState, &dynamicStateInfo,
-    m_currentRenderPass, 0, m_rendererRef);
-
-  vkDestroyShaderModule(m_rendererRef->getLogicalDevice(), vertexModule, nullptr);
-  vkDestroyShaderModule(m_rendererRef->getLogicalDevice(), fragmentModule, nullptr);
+    static_cast<uint32_t>(m_pushConstantRanges.size()), m_pushConstantRanges.data());
+
+  VkPipelineLayout layout;
+  vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &layout);
+
+  // Everything the compile needs is copied, since the builder may be reset or destroyed before it runs (and the
+  // registry may run it again to recompile the pipeline with new shader code):
+  auto compile = [device, pipelineCache = registry.getCache(), debugName = std::string(name),
+    inputAssemblyStateInfo = m_inputAssemblyStateInfo, rasterisationStateInfo = m_rasterisationStateInfo,
+    multisampleStateInfo = m_multisampleStateInfo, depthStencilStateInfo = m_depthStencilStateInfo,
+    colourBlendAttachState = m_colourBlendAttachState, renderPass = m_currentRenderPass,
+    extent = m_rendererRef->getSwapchain().extent](VkPipelineLayout layout, const PipelineRegistry::ShaderStages& shaderStages) mutable
+  {
+    CS_PROFILE_SCOPE("PipelineBuilder::compileGraphicsPipeline");
+
+    std::vector<VkShaderModule> shaderModules;
+    std::vector<VkPipelineShaderStageCreateInfo> shaderStageInfos;
+    createShaderModules(device, shaderStages, shaderModules, shaderStageInfos);
+
+    VkViewport viewport = {
+      .x = 0.0f,
+      .y = 0.0f,
+      .width = static_cast<float>(extent.width),
+      .height = static_cast<float>(extent.height),
+      .minDepth = 0.0f,
+      .maxDepth = 1.0f,
+    };
+
+    VkRect2D scissor = {
+      .offset = { 0, 0 },
+      .extent = extent,
+    };
+
+    VkPipelineViewportStateCreateInfo viewportInfo = cassidy::init::pipelineViewportStateCreateInfo(1, &viewport, 1, &scissor);
+
+    VkPipelineDynamicStateCreateInfo dynamicStateInfo = cassidy::init::pipelineDynamicStateCreateinfo(
+      static_cast<uint32_t>(cassidy::Renderer::DYNAMIC_STATES.size()), cassidy::Renderer::DYNAMIC_STATES.data());
+
+    auto bindingDescription = Vertex::getBindingDesc();
+    auto attributeDescriptions = Vertex::getAttributeDescs();
+
+    VkPipelineVertexInputStateCreateInfo vertexInputStateInfo = cassidy::init::pipelineVertexInputStateCreateInfo(
+      1, &bindingDescription, static_cast<uint32_t>(attributeDescriptions.size()), attributeDescriptions.data());
+
+    const VkPipeline pipeline = GraphicsPipeline::compileGraphicsPipeline(device, pipelineCache, layout,
+      static_cast<uint32_t>(shaderStageInfos.size()), shaderStageInfos.data(),
+      &vertexInputStateInfo, &inputAssemblyStateInfo,
+      &viewportInfo, &rasterisationStateInfo,
+      &multisampleStateInfo, &depthStencilStateInfo,
+      &colourBlendAttachState, &dynamicStateInfo,
+      renderPass, 0);
+
+    for (const VkShaderModule shaderModule : shaderModules)
+      vkDestroyShaderModule(device, shaderModule, nullptr);
+
+    if (pipeline == VK_NULL_HANDLE)
+      CS_LOG_ERROR("Failed to compile graphics pipeline ({0})!", debugName);
+    else
+      CS_LOG_INFO("Compiled graphics pipeline ({0})", debugName);
+    return pipeline;
+  };
 
+  outCompileJob = registry.compilePipeline(stateHash, pipeline, layout, copyShaderStages(), std::move(compile), priority);
   return true;
 }
 
-bool cassidy::PipelineBuilder::buildComputePipeline(ComputePipeline& pipeline)
+bool cassidy::PipelineBuilder::startComputePipeline(ComputePipeline& pipeline, cassidy::JobSystem::Priority priority,
+  cassidy::JobHandle& outCompileJob)
 {
   bool wasBuildSuccessful = true;
   const std::string_view name = pipeline.getDebugName();
@@ -199,35 +272,87 @@ bool cassidy::PipelineBuilder::buildComputePipeline(ComputePipeline& pipeline)
 
   if (!wasBuildSuccessful) return false;
 
-  VkShaderModuleCreateInfo computeModuleInfo = cassidy::init::shaderModuleCreateInfo(m_shaderStages.at(VK_SHADER_STAGE_COMPUTE_BIT));
+  constexpr cassidy::PipelineRegistry& registry = cassidy::globals::g_resourceManager.pipelineRegistry;
+  const uint64_t stateHash = hashPipelineState(VK_PIPELINE_BIND_POINT_COMPUTE);
+  if (registry.acquirePipeline(stateHash, pipeline, outCompileJob))
+  {
+    CS_LOG_INFO("Sharing existing compute pipeline with identical state ({0})", name);
+    return true;
+  }
 
-  VkShaderModule computeModule;
+  CS_LOG_INFO("Building compute pipeline ({0})...", name);
 
-  vkCreateShaderModule(m_rendererRef->getLogicalDevice(), &computeModuleInfo, nullptr, &computeModule);
+  const VkDevice device = m_rendererRef->getLogicalDevice();
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo = cassidy::init::pipelineLayoutCreateInfo(
+    static_cast<uint32_t>(m_descSetLayouts.size()), m_descSetLayouts.data(),
+    static_cast<uint32_t>(m_pushConstantRanges.size()), m_pushConstantRanges.data());
 
-  VkPipelineShaderStageCreateInfo stageInfo = cassidy::init::pipelineShaderStageCreateInfo(
-    VK_SHADER_STAGE_COMPUTE_BIT, computeModule);
+  VkPipelineLayout layout;
+  vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &layout);
 
-  pipeline.buildComputePipeline(
-    static_cast<uint32_t>(m_descSetLayouts.size()), m_descSetLayouts.data(),
-    static_cast<uint32_t>(m_pushConstantRanges.size()), m_pushConstantRanges.data(),
-    &stageInfo, m_rendererRef);
+  auto compile = [device, pipelineCache = registry.getCache(), debugName = std::string(name)]
+    (VkPipelineLayout layout, const PipelineRegistry::ShaderStages& shaderStages)
+  {
+    CS_PROFILE_SCOPE("PipelineBuilder::compileComputePipeline");
 
-  vkDestroyShaderModule(m_rendererRef->getLogicalDevice(), computeModule, nullptr);
+    std::vector<VkShaderModule> shaderModules;
+    std::vector<VkPipelineShaderStageCreateInfo> shaderStageInfos;
+    createShaderModules(device, shaderStages, shaderModules, shaderStageInfos);
 
+    const VkPipeline pipeline = ComputePipeline::compileComputePipeline(device, pipelineCache, layout, shaderStageInfos.data());
+
+    for (const VkShaderModule shaderModule : shaderModules)
+      vkDestroyShaderModule(device, shaderModule, nullptr);
+
+    if (pipeline == VK_NULL_HANDLE)
+      CS_LOG_ERROR("Failed to compile compute pipeline ({0})!", debugName);
+    else
+      CS_LOG_INFO("Compiled compute pipeline ({0})", debugName);
+    return pipeline;
+  };
+
+  outCompileJob = registry.compilePipeline(stateHash, pipeline, layout, copyShaderStages(), std::move(compile), priority);
   return true;
 }
 
+cassidy::PipelineBuilder& cassidy::PipelineBuilder::addReflectedLayouts()
+{
+  const cassidy::SpirvReflection reflection = reflectShaderStages();
+
+  for (uint32_t set = static_cast<uint32_t>(m_descSetLayouts.size()); set < reflection.getNumSets(); ++set)
+    m_descSetLayouts.push_back(reflection.createSetLayout(set, cassidy::globals::g_descLayoutCache));
+
+  if (m_pushConstantRanges.empty())
+    m_pushConstantRanges = reflection.getPushConstantRanges();
+
+  return *this;
+}
+
+VkDescriptorSetLayout cassidy::PipelineBuilder::getReflectedSetLayout(uint32_t set) const
+{
+  return reflectShaderStages().createSetLayout(set, cassidy::globals::g_descLayoutCache);
+}
+
+cassidy::PipelineBuilder& cassidy::PipelineBuilder::overrideDescriptorType(uint32_t set, uint32_t binding, VkDescriptorType type)
+{
+  m_descriptorOverrides.push_back({ set, binding, type, nullptr });
+  return *this;
+}
+
+cassidy::PipelineBuilder& cassidy::PipelineBuilder::setImmutableSamplers(uint32_t set, uint32_t binding, const VkSampler* immutableSamplers)
+{
+  m_descriptorOverrides.push_back({ set, binding, VK_DESCRIPTOR_TYPE_MAX_ENUM, immutableSamplers });
+  return *this;
+}
+
 cassidy::PipelineBuilder& cassidy::PipelineBuilder::resetToDefaults()
 {
-  for (const auto& stage : m_shaderStages)
-  {
-    delete[] stage.second.codeBuffer;
-    const VkShaderStageFlagBits stageType = stage.first;
-    m_shaderStages.erase(stageType);
-  }
+  m_shaderStages.clear();
+  m_shaderFiles.clear();
+  m_shaderFilenames.clear();
   m_pushConstantRanges.clear();
   m_descSetLayouts.clear();
+  m_descriptorOverrides.clear();
   m_currentRenderPass = VK_NULL_HANDLE;
 
   m_inputAssemblyStateInfo = cassidy::init::pipelineInputAssemblyStateCreateInfo(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
@@ -247,22 +372,135 @@ cassidy::PipelineBuilder& cassidy::PipelineBuilder::resetToDefaults()
   return *this;
 }
 
-SpirvShaderCode cassidy::PipelineBuilder::loadSpirv(const std::string& filepath)
+uint64_t cassidy::PipelineBuilder::hashPipelineState(VkPipelineBindPoint bindPoint) const
 {
-  std::ifstream file(filepath, std::ios::ate | std::ios::binary);
+  cassidy::hash::XXHash64 hasher;
+  const auto hashValue = [&hasher](const auto& value) { hasher.update(&value, sizeof(value)); };
 
-  if (!file.is_open())
+  hashValue(bindPoint);
+
+  // (shader stage map's iteration order isn't fixed, so visit stages in a set order)
+  for (const VkShaderStageFlagBits stage : { VK_SHADER_STAGE_VERTEX_BIT, VK_SHADER_STAGE_FRAGMENT_BIT, VK_SHADER_STAGE_COMPUTE_BIT })
+  {
+    const auto stageIt = m_shaderStages.find(stage);
+    if (stageIt == m_shaderStages.end()) continue;
+
+    hashValue(stage);
+    hashValue(stageIt->second.codeSize);
+    hasher.update(stageIt->second.codeBuffer, stageIt->second.codeSize);
+  }
+
+  // Set layouts come from the layout cache, so identical layouts share a handle:
+  hashValue(m_descSetLayouts.size());
+  hasher.update(m_descSetLayouts.data(), sizeof(VkDescriptorSetLayout) * m_descSetLayouts.size());
+  hashValue(m_pushConstantRanges.size());
+  hasher.update(m_pushConstantRanges.data(), sizeof(VkPushConstantRange) * m_pushConstantRanges.size());
+
+  if (bindPoint != VK_PIPELINE_BIND_POINT_GRAPHICS)
+  {
+    const uint64_t hash = hasher.digest();
+    return hash != 0 ? hash : 1;
+  }
+
+  // Fixed-function state is hashed field by field, since the create infos also hold pointers and padding:
+  hashValue(m_inputAssemblyStateInfo.topology);
+  hashValue(m_inputAssemblyStateInfo.primitiveRestartEnable);
+
+  hashValue(m_rasterisationStateInfo.depthClampEnable);
+  hashValue(m_rasterisationStateInfo.rasterizerDiscardEnable);
+  hashValue(m_rasterisationStateInfo.polygonMode);
+  hashValue(m_rasterisationStateInfo.cullMode);
+  hashValue(m_rasterisationStateInfo.frontFace);
+  hashValue(m_rasterisationStateInfo.depthBiasEnable);
+  hashValue(m_rasterisationStateInfo.depthBiasConstantFactor);
+  hashValue(m_rasterisationStateInfo.depthBiasClamp);
+  hashValue(m_rasterisationStateInfo.depthBiasSlopeFactor);
+  hashValue(m_rasterisationStateInfo.lineWidth);
+
+  hashValue(m_multisampleStateInfo.rasterizationSamples);
+  hashValue(m_multisampleStateInfo.sampleShadingEnable);
+  hashValue(m_multisampleStateInfo.minSampleShading);
+  hashValue(m_multisampleStateInfo.alphaToCoverageEnable);
+  hashValue(m_multisampleStateInfo.alphaToOneEnable);
+
+  hashValue(m_depthStencilStateInfo.depthTestEnable);
+  hashValue(m_depthStencilStateInfo.depthWriteEnable);
+  hashValue(m_depthStencilStateInfo.depthCompareOp);
+  hashValue(m_depthStencilStateInfo.depthBoundsTestEnable);
+  hashValue(m_depthStencilStateInfo.stencilTestEnable);
+  hashValue(m_depthStencilStateInfo.front);
+  hashValue(m_depthStencilStateInfo.back);
+  hashValue(m_depthStencilStateInfo.minDepthBounds);
+  hashValue(m_depthStencilStateInfo.maxDepthBounds);
+
+  hashValue(m_colourBlendAttachState);
+  hashValue(Vertex::getBindingDesc());
+  for (const VkVertexInputAttributeDescription& attribute : Vertex::getAttributeDescs())
+  {
+    hashValue(attribute);
+  }
+  hasher.update(cassidy::Renderer::DYNAMIC_STATES.data(), sizeof(VkDynamicState) * cassidy::Renderer::DYNAMIC_STATES.size());
+  hashValue(m_currentRenderPass);
+
+  const uint64_t hash = hasher.digest();
+  return hash != 0 ? hash : 1;   // (0 means "not registered")
+}
+
+cassidy::PipelineRegistry::ShaderStages cassidy::PipelineBuilder::copyShaderStages() const
+{
+  cassidy::PipelineRegistry::ShaderStages shaderStages;
+
+  for (const VkShaderStageFlagBits stage : { VK_SHADER_STAGE_VERTEX_BIT, VK_SHADER_STAGE_FRAGMENT_BIT, VK_SHADER_STAGE_COMPUTE_BIT })
+  {
+    const auto stageIt = m_shaderStages.find(stage);
+    if (stageIt == m_shaderStages.end()) continue;
+
+    const SpirvShaderCode& code = stageIt->second;
+    shaderStages.push_back({ stage, m_shaderFilenames.at(stage),
+      std::vector<uint32_t>(code.codeBuffer, code.codeBuffer + code.codeSize / sizeof(uint32_t)) });
+  }
+
+  return shaderStages;
+}
+
+cassidy::SpirvReflection cassidy::PipelineBuilder::reflectShaderStages() const
+{
+  cassidy::SpirvReflection reflection;
+
+  // (fixed stage order, so merged bindings come out the same however the stages were added)
+  for (const VkShaderStageFlagBits stage : { VK_SHADER_STAGE_VERTEX_BIT, VK_SHADER_STAGE_FRAGMENT_BIT, VK_SHADER_STAGE_COMPUTE_BIT })
+  {
+    const auto stageIt = m_shaderStages.find(stage);
+    if (stageIt != m_shaderStages.end())
+      reflection.addStage(stage, stageIt->second);
+  }
+
+  for (const DescriptorOverride& descOverride : m_descriptorOverrides)
+  {
+    if (descOverride.type != VK_DESCRIPTOR_TYPE_MAX_ENUM)
+      reflection.setDescriptorType(descOverride.set, descOverride.binding, descOverride.type);
+    if (descOverride.immutableSamplers)
+      reflection.setImmutableSamplers(descOverride.set, descOverride.binding, descOverride.immutableSamplers);
+  }
+
+  return reflection;
+}
+
+SpirvShaderCode cassidy::PipelineBuilder::loadSpirv(const std::string& filepath, cassidy::MappedFile& outFile)
+{
+  if (!outFile.open(filepath))
   {
     CS_LOG_ERROR("Could not load SPIR-V file! ({0})", filepath.c_str());
     return { 0, nullptr };
   }
 
-  size_t fileSize = static_cast<size_t>(file.tellg());
-  char* buffer = new char[fileSize];
-
-  file.seekg(0);
-  file.read(buffer, fileSize);
-  file.close();
+  if (outFile.getSize() % sizeof(uint32_t) != 0)
+  {
+    CS_LOG_ERROR("{0} isn't a valid SPIR-V file (size isn't a whole number of words)!", filepath.c_str());
+    outFile.close();
+    return { 0, nullptr };
+  }
 
-  return { fileSize, reinterpret_cast<uint32_t*>(buffer) };
+  // (mappings start on a page boundary, so the code can be read as words in place)
+  return { outFile.getSize(), reinterpret_cast<const uint32_t*>(outFile.getData().data()) };
 }
@@ -1,6 +1,12 @@
 #pragma once
 #include "Utils/Types.h"
+#include <Utils/SpirvReflect.h>
+#include <Utils/FileMapping.h>
+#include <Core/JobSystem.h>
+#include <Core/PipelineRegistry.h>
 
+#include <atomic>
+#include <memory>
 #include <string>
 
 namespace cassidy
@@ -12,27 +18,35 @@ namespace cassidy
   {
   public:
     Pipeline() : m_pipeline(VK_NULL_HANDLE), m_pipelineLayout(VK_NULL_HANDLE), m_debugName("") {}
+
+    // Pipelines built through a PipelineBuilder are shared via the pipeline registry, so only drop this reference:
     void release(VkDevice device);
 
+    // False while the pipeline is still being compiled, in which case anything drawn with it should be skipped:
+    inline bool isReady() const { return getPipeline() != VK_NULL_HANDLE; }
+
     // Getters/setters: ------------------------------------------------------------------------------------------
-    inline VkPipeline         getPipeline()     const { return m_pipeline; }
+    inline VkPipeline         getPipeline()             const { return m_sharedPipeline ? m_sharedPipeline->load(std::memory_order_acquire) : m_pipeline; }
     inline VkPipelineLayout   getLayout()               const { return m_pipelineLayout; }
     inline std::string_view   getDebugName()            const { return m_debugName; }
 
     void setDebugName(const std::string& name) { m_debugName = name; }
 
   protected:
+    friend class PipelineRegistry;
+
     VkPipeline m_pipeline;
     VkPipelineLayout m_pipelineLayout;
     std::string m_debugName;
+    uint64_t m_stateHash = 0;   // (key into the pipeline registry, 0 if the pipeline isn't registered)
+    std::shared_ptr<const std::atomic<VkPipeline>> m_sharedPipeline;  // (registered pipelines' handle, set once compiled)
   };
 
   class GraphicsPipeline : public Pipeline
   {
   public:
-    void buildGraphicsPipeline(
-      uint32_t numDescSetLayouts, VkDescriptorSetLayout* descSetLayouts,
-      uint32_t numPushConstantRanges, VkPushConstantRange* pushConstantRanges,
+    // Create a pipeline with an existing layout. Thread-safe, so pipelines can be compiled on the job system:
+    static VkPipeline compileGraphicsPipeline(VkDevice device, VkPipelineCache pipelineCache, VkPipelineLayout layout,
       uint32_t numShaderStages, VkPipelineShaderStageCreateInfo* shaderStages,
       VkPipelineVertexInputStateCreateInfo* vertexInputStateInfo,
       VkPipelineInputAssemblyStateCreateInfo* inputAssemblyStateInfo,
@@ -42,8 +56,7 @@ namespace cassidy
       VkPipelineDepthStencilStateCreateInfo* depthStencilStateInfo,
       VkPipelineColorBlendAttachmentState* colourBlendAttachState,
       VkPipelineDynamicStateCreateInfo* dynamicStateInfo,
-      VkRenderPass renderPass, uint32_t subpass,
-      cassidy::Renderer* rendererRef);
+      VkRenderPass renderPass, uint32_t subpass);
 
   private:
 
@@ -52,11 +65,8 @@ namespace cassidy
   class ComputePipeline : public Pipeline
   {
   public:
-    void buildComputePipeline(
-      uint32_t numDescSetLayouts, VkDescriptorSetLayout* descSetLayouts,
-      uint32_t numPushConstantRanges, VkPushConstantRange* pushConstantRanges,
-      VkPipelineShaderStageCreateInfo* computeShaderStage,
-      cassidy::Renderer* rendererRef);
+    static VkPipeline compileComputePipeline(VkDevice device, VkPipelineCache pipelineCache, VkPipelineLayout layout,
+      VkPipelineShaderStageCreateInfo* computeShaderStage);
 
   private:
 
@@ -67,7 +77,6 @@ namespace cassidy
   public:
     PipelineBuilder(cassidy::Renderer* rendererRef) :
       m_rendererRef(rendererRef), m_currentRenderPass(VK_NULL_HANDLE) { resetToDefaults(); }
-    ~PipelineBuilder();
 
     PipelineBuilder& setVertexInputStateInfo(VkPipelineVertexInputStateCreateInfo vertexInputStateInfo)         { m_vertexInputStateInfo = vertexInputStateInfo; return *this; }
     PipelineBuilder& setInputAssemblyStateInfo(VkPipelineInputAssemblyStateCreateInfo inputAssemblyStateInfo)   { m_inputAssemblyStateInfo = inputAssemblyStateInfo; return *this; }
@@ -81,18 +90,49 @@ namespace cassidy
     PipelineBuilder& addPushConstantRange(VkShaderStageFlags stageFlags, uint32_t offset, uint32_t size);
     PipelineBuilder& setRenderPass(VkRenderPass renderPass) { m_currentRenderPass = renderPass; return *this; }
 
+    // Descriptor set layouts and push constant ranges can be reflected from the shader stages added so far, instead of
+    // being added by hand. Sets already added are kept (e.g. ones with create flags reflection can't know about), and
+    // push constant ranges are only reflected if none have been added:
+    PipelineBuilder& addReflectedLayouts();
+    VkDescriptorSetLayout getReflectedSetLayout(uint32_t set) const;
+
+    // Properties of a reflected binding that the shaders can't express, applied whenever layouts are reflected:
+    PipelineBuilder& overrideDescriptorType(uint32_t set, uint32_t binding, VkDescriptorType type);
+    PipelineBuilder& setImmutableSamplers(uint32_t set, uint32_t binding, const VkSampler* immutableSamplers);
+
+    // Build a pipeline (or share an identical one that's already registered), blocking until it's compiled:
     bool buildGraphicsPipeline(GraphicsPipeline& pipeline);
     bool buildComputePipeline(ComputePipeline& pipeline);
 
+    // Start compiling a pipeline on the job system and return straight away. Its layout can be used immediately, but
+    // it isn't ready to bind until isReady() returns true, which can be polled from any copy of the pipeline:
+    bool buildGraphicsPipelineAsync(GraphicsPipeline& pipeline);
+    bool buildComputePipelineAsync(ComputePipeline& pipeline);
+
     PipelineBuilder& resetToDefaults();
 
   private:
     PipelineBuilder() = delete; // Require reference to renderer in object creation
     
-    SpirvShaderCode loadSpirv(const std::string& filepath);
+    // Map a SPIR-V file, returning a view of its code that stays valid for as long as outFile is open:
+    SpirvShaderCode loadSpirv(const std::string& filepath, cassidy::MappedFile& outFile);
+
+    // Validate the builder's state, then share a registered pipeline or queue a compile of a new one:
+    bool startGraphicsPipeline(GraphicsPipeline& pipeline, cassidy::JobSystem::Priority priority, cassidy::JobHandle& outCompileJob);
+    bool startComputePipeline(ComputePipeline& pipeline, cassidy::JobSystem::Priority priority, cassidy::JobHandle& outCompileJob);
+
+    cassidy::SpirvReflection reflectShaderStages() const;
+
+    // Copy of each stage's code and filename in a fixed stage order, for the registry to compile (and recompile) from:
+    cassidy::PipelineRegistry::ShaderStages copyShaderStages() const;
+
+    // Hash of everything the pipeline would be created from, used as its key in the pipeline registry:
+    uint64_t hashPipelineState(VkPipelineBindPoint bindPoint) const;
 
     typedef std::unordered_map<VkShaderStageFlagBits, SpirvShaderCode> ShaderStageMap;
-    ShaderStageMap m_shaderStages;
+    ShaderStageMap m_shaderStages;                                              // (views into m_shaderFiles)
+    std::unordered_map<VkShaderStageFlagBits, cassidy::MappedFile> m_shaderFiles;
+    std::unordered_map<VkShaderStageFlagBits, std::string> m_shaderFilenames;
 
     VkPipelineVertexInputStateCreateInfo			m_vertexInputStateInfo;
     VkPipelineInputAssemblyStateCreateInfo		m_inputAssemblyStateInfo;
@@ -103,6 +143,15 @@ namespace cassidy
 
     std::vector<VkPushConstantRange> m_pushConstantRanges;
     std::vector<VkDescriptorSetLayout> m_descSetLayouts;
+
+    struct DescriptorOverride
+    {
+      uint32_t set;
+      uint32_t binding;
+      VkDescriptorType type;                // (VK_DESCRIPTOR_TYPE_MAX_ENUM to keep the reflected type)
+      const VkSampler* immutableSamplers;   // (nullptr to leave unset)
+    };
+    std::vector<DescriptorOverride> m_descriptorOverrides;
     VkRenderPass m_currentRenderPass;
 
     cassidy::Renderer* m_rendererRef;
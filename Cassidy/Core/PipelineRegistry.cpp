@@ -0,0 +1,379 @@
+#include "PipelineRegistry.h"
+#include <Core/Pipeline.h>
+#include <Core/ResourceManager.h>
+#include <Core/Logger.h>
+#include <Utils/Helpers.h>
+#include <Utils/Hash.h>
+#include <Utils/SpirvReflect.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#define PIPELINE_CACHE_MAGIC    0x50495043  // "CPIP"
+#define PIPELINE_CACHE_VERSION  1
+
+void cassidy::PipelineRegistry::init(VkDevice device, const VkPhysicalDeviceProperties& gpuProperties, const std::string& cacheFilepath,
+  cassidy::JobSystem* jobSystemRef)
+{
+  m_device = device;
+  m_jobSystemRef = jobSystemRef;
+  m_cacheFilepath = cacheFilepath;
+
+  m_deviceHeader.magic = PIPELINE_CACHE_MAGIC;
+  m_deviceHeader.version = PIPELINE_CACHE_VERSION;
+  m_deviceHeader.vendorID = gpuProperties.vendorID;
+  m_deviceHeader.deviceID = gpuProperties.deviceID;
+  m_deviceHeader.driverVersion = gpuProperties.driverVersion;
+  memcpy(m_deviceHeader.pipelineCacheUUID, gpuProperties.pipelineCacheUUID, VK_UUID_SIZE);
+
+  const std::vector<uint8_t> cacheData = loadCacheData();
+  m_loadedCacheSize = cacheData.size();
+
+  VkPipelineCacheCreateInfo cacheInfo = {};
+  cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  cacheInfo.initialDataSize = cacheData.size();
+  cacheInfo.pInitialData = cacheData.empty() ? nullptr : cacheData.data();
+
+  VK_CHECK(vkCreatePipelineCache(m_device, &cacheInfo, nullptr, &m_cache));
+
+  if (m_loadedCacheSize > 0)
+    CS_LOG_INFO("Loaded pipeline cache {0} ({1} KB)", m_cacheFilepath, m_loadedCacheSize / 1024);
+}
+
+void cassidy::PipelineRegistry::release()
+{
+  if (m_cache == VK_NULL_HANDLE) return;
+
+  if (!m_pipelines.empty())
+    CS_LOG_WARN("Destroying {0} pipelines still held when the pipeline registry was released!", m_pipelines.size());
+
+  for (auto& [stateHash, registered] : m_pipelines)
+  {
+    destroyPipeline(registered);
+  }
+  m_pipelines.clear();
+
+  for (PipelineReload& reload : m_supersededReloads)
+  {
+    discardReload(reload);
+  }
+  m_supersededReloads.clear();
+
+  saveCacheData();
+  vkDestroyPipelineCache(m_device, m_cache, nullptr);
+  m_cache = VK_NULL_HANDLE;
+}
+
+bool cassidy::PipelineRegistry::acquirePipeline(uint64_t stateHash, cassidy::Pipeline& pipeline, cassidy::JobHandle& outCompileJob)
+{
+  std::lock_guard<std::mutex> registryLock(m_registryMutex);
+
+  const auto registeredIt = m_pipelines.find(stateHash);
+  if (registeredIt == m_pipelines.end())
+    return false;
+
+  RegisteredPipeline& registered = registeredIt->second;
+  ++registered.refCount;
+  ++m_numPipelinesShared;
+  pipeline.m_sharedPipeline = registered.pipeline;
+  pipeline.m_pipelineLayout = registered.layout;
+  pipeline.m_stateHash = stateHash;
+  outCompileJob = registered.compileJob;
+  return true;
+}
+
+cassidy::JobHandle cassidy::PipelineRegistry::compilePipeline(uint64_t stateHash, cassidy::Pipeline& pipeline, VkPipelineLayout layout,
+  ShaderStages&& shaderStages, CompileFunc&& compile, cassidy::JobSystem::Priority priority)
+{
+  std::lock_guard<std::mutex> registryLock(m_registryMutex);
+
+  const auto [registeredIt, wasInserted] = m_pipelines.try_emplace(stateHash);
+  RegisteredPipeline& registered = registeredIt->second;
+  if (!wasInserted)
+  {
+    vkDestroyPipelineLayout(m_device, layout, nullptr);
+    ++m_numPipelinesShared;
+  }
+  else
+  {
+    registered.pipeline = std::make_shared<std::atomic<VkPipeline>>(VK_NULL_HANDLE);
+    registered.layout = layout;
+    registered.compile = std::make_shared<const CompileFunc>(std::move(compile));
+    registered.shaderStages = std::make_shared<const ShaderStages>(std::move(shaderStages));
+    registered.compileJob = pushCompileJob(registered, registered.pipeline, priority);
+    ++m_numPipelinesBuilt;
+  }
+
+  ++registered.refCount;
+  pipeline.m_sharedPipeline = registered.pipeline;
+  pipeline.m_pipelineLayout = registered.layout;
+  pipeline.m_stateHash = stateHash;
+  return registered.compileJob;
+}
+
+bool cassidy::PipelineRegistry::reloadShader(const std::string& filename, const std::vector<uint32_t>& code, uint32_t& outNumPipelines)
+{
+  std::lock_guard<std::mutex> registryLock(m_registryMutex);
+
+  outNumPipelines = 0;
+  const auto usesShader = [&filename](const ShaderStage& stage) { return stage.filename == filename; };
+
+  // Pipeline layouts (and the descriptor sets bound with them) were built from what the old code declares, so code
+  // declaring different bindings or push constants can't be swapped in under them. Check every pipeline before
+  // touching any, so the reload is either applied everywhere or nowhere:
+  for (const auto& [stateHash, registered] : m_pipelines)
+  {
+    for (const ShaderStage& shaderStage : *registered.shaderStages)
+    {
+      if (!usesShader(shaderStage)) continue;
+
+      cassidy::SpirvReflection oldReflection;
+      cassidy::SpirvReflection newReflection;
+      oldReflection.addStage(shaderStage.stage, { shaderStage.code.size() * sizeof(uint32_t), shaderStage.code.data() });
+      if (!newReflection.addStage(shaderStage.stage, { code.size() * sizeof(uint32_t), code.data() }) ||
+        !newReflection.hasSameLayout(oldReflection))
+      {
+        CS_LOG_ERROR("Shader {0} no longer matches the layout its pipelines were built with, restart to apply it", filename);
+        return false;
+      }
+    }
+  }
+
+  for (auto& [stateHash, registered] : m_pipelines)
+  {
+    if (std::none_of(registered.shaderStages->begin(), registered.shaderStages->end(), usesShader)) continue;
+
+    // (a reload swapped in before the first compile finished would just be overwritten by it)
+    if (!registered.compileJob.isDone())
+    {
+      CS_LOG_WARN("Pipeline using {0} is still compiling, skipping its reload", filename);
+      continue;
+    }
+
+    // Stages may still be read by a running reload, so are replaced rather than modified:
+    ShaderStages shaderStages = *registered.shaderStages;
+    for (ShaderStage& shaderStage : shaderStages)
+    {
+      if (usesShader(shaderStage))
+        shaderStage.code = code;
+    }
+    registered.shaderStages = std::make_shared<const ShaderStages>(std::move(shaderStages));
+
+    if (registered.pendingReload.pipeline)
+      m_supersededReloads.push_back(std::move(registered.pendingReload));
+
+    registered.pendingReload.pipeline = std::make_shared<std::atomic<VkPipeline>>(VK_NULL_HANDLE);
+    registered.pendingReload.reloadJob = pushCompileJob(registered, registered.pendingReload.pipeline,
+      cassidy::JobSystem::Priority::LOW);
+    ++outNumPipelines;
+  }
+
+  return true;
+}
+
+void cassidy::PipelineRegistry::swapReloadedPipelines()
+{
+  std::lock_guard<std::mutex> registryLock(m_registryMutex);
+
+  for (auto& [stateHash, registered] : m_pipelines)
+  {
+    PipelineReload& reload = registered.pendingReload;
+    if (!reload.pipeline || !reload.reloadJob.isDone()) continue;
+
+    const VkPipeline reloadedPipeline = reload.pipeline->load(std::memory_order_acquire);
+    reload = {};
+
+    // (a failed compile has already logged its errors, so just keep drawing with the old pipeline)
+    if (reloadedPipeline == VK_NULL_HANDLE) continue;
+
+    // Frames already submitted still reference the old pipeline, so it's only destroyed once they've finished:
+    const VkPipeline replacedPipeline = registered.pipeline->exchange(reloadedPipeline, std::memory_order_acq_rel);
+    cassidy::globals::g_resourceManager.deferDeletion([device = m_device, replacedPipeline]() {
+      vkDestroyPipeline(device, replacedPipeline, nullptr);
+      });
+    ++m_numPipelinesReloaded;
+  }
+
+  const auto finishedIt = std::partition(m_supersededReloads.begin(), m_supersededReloads.end(), [](const PipelineReload& reload) {
+    return !reload.reloadJob.isDone();
+    });
+  for (auto reloadIt = finishedIt; reloadIt != m_supersededReloads.end(); ++reloadIt)
+  {
+    discardReload(*reloadIt);
+  }
+  m_supersededReloads.erase(finishedIt, m_supersededReloads.end());
+}
+
+void cassidy::PipelineRegistry::releasePipeline(uint64_t stateHash)
+{
+  RegisteredPipeline released;
+  {
+    std::lock_guard<std::mutex> registryLock(m_registryMutex);
+
+    const auto registeredIt = m_pipelines.find(stateHash);
+    if (registeredIt == m_pipelines.end() || --registeredIt->second.refCount > 0) return;
+
+    released = std::move(registeredIt->second);
+    m_pipelines.erase(registeredIt);
+  }
+
+  // (outside the lock, since waiting on a compile may run other jobs that build pipelines)
+  destroyPipeline(released);
+}
+
+void cassidy::PipelineRegistry::waitForPendingPipelines()
+{
+  std::vector<cassidy::JobHandle> compileJobs;
+  {
+    std::lock_guard<std::mutex> registryLock(m_registryMutex);
+    for (const auto& [stateHash, registered] : m_pipelines)
+    {
+      if (!registered.compileJob.isDone())
+        compileJobs.push_back(registered.compileJob);
+      if (!registered.pendingReload.reloadJob.isDone())
+        compileJobs.push_back(registered.pendingReload.reloadJob);
+    }
+    for (const PipelineReload& reload : m_supersededReloads)
+    {
+      if (!reload.reloadJob.isDone())
+        compileJobs.push_back(reload.reloadJob);
+    }
+  }
+
+  for (const cassidy::JobHandle& compileJob : compileJobs)
+  {
+    m_jobSystemRef->wait(compileJob);
+  }
+}
+
+cassidy::JobHandle cassidy::PipelineRegistry::pushCompileJob(const RegisteredPipeline& registered,
+  std::shared_ptr<std::atomic<VkPipeline>> compiledPipeline, cassidy::JobSystem::Priority priority)
+{
+  ++m_numPendingCompiles;
+
+  // (the compiled handle is only published once the pipeline is complete, with release ordering so recording
+  // threads that see it also see everything the driver wrote)
+  return m_jobSystemRef->pushJob([this, compiledPipeline = std::move(compiledPipeline), layout = registered.layout,
+    compile = registered.compile, shaderStages = registered.shaderStages]() {
+      compiledPipeline->store((*compile)(layout, *shaderStages), std::memory_order_release);
+      --m_numPendingCompiles;
+    }, priority);
+}
+
+void cassidy::PipelineRegistry::destroyPipeline(RegisteredPipeline& registered)
+{
+  // A pipeline released while it's still compiling has to finish before it can be destroyed:
+  if (!registered.compileJob.isDone())
+    m_jobSystemRef->wait(registered.compileJob);
+
+  if (registered.pendingReload.pipeline)
+    discardReload(registered.pendingReload);
+
+  vkDestroyPipeline(m_device, registered.pipeline->load(std::memory_order_acquire), nullptr);
+  vkDestroyPipelineLayout(m_device, registered.layout, nullptr);
+}
+
+void cassidy::PipelineRegistry::discardReload(PipelineReload& reload)
+{
+  if (!reload.reloadJob.isDone())
+    m_jobSystemRef->wait(reload.reloadJob);
+
+  vkDestroyPipeline(m_device, reload.pipeline->load(std::memory_order_acquire), nullptr);
+  reload = {};
+}
+
+std::vector<uint8_t> cassidy::PipelineRegistry::loadCacheData()
+{
+  std::ifstream file(m_cacheFilepath, std::ios::binary | std::ios::ate);
+  if (!file.is_open())
+  {
+    CS_LOG_INFO("No pipeline cache found at {0}, pipelines will be built from scratch", m_cacheFilepath);
+    return {};
+  }
+
+  const size_t fileSize = static_cast<size_t>(file.tellg());
+  file.seekg(0);
+
+  CacheFileHeader header = {};
+  if (fileSize < sizeof(header) || !file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+  {
+    CS_LOG_WARN("Pipeline cache {0} is truncated, ignoring it", m_cacheFilepath);
+    return {};
+  }
+
+  // Another GPU's or driver's cache would at best be rejected by the driver, and at worst crash it:
+  if (header.magic != m_deviceHeader.magic ||
+    header.version != m_deviceHeader.version ||
+    header.vendorID != m_deviceHeader.vendorID ||
+    header.deviceID != m_deviceHeader.deviceID ||
+    header.driverVersion != m_deviceHeader.driverVersion ||
+    memcmp(header.pipelineCacheUUID, m_deviceHeader.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+  {
+    CS_LOG_WARN("Pipeline cache {0} was saved by a different device or driver, ignoring it", m_cacheFilepath);
+    return {};
+  }
+
+  if (header.dataSize != fileSize - sizeof(header))
+  {
+    CS_LOG_WARN("Pipeline cache {0} is truncated, ignoring it", m_cacheFilepath);
+    return {};
+  }
+
+  std::vector<uint8_t> cacheData(header.dataSize);
+  if (!file.read(reinterpret_cast<char*>(cacheData.data()), cacheData.size()) ||
+    cassidy::hash::xxHash64(cacheData.data(), cacheData.size()) != header.dataHash)
+  {
+    CS_LOG_WARN("Pipeline cache {0} is corrupt, ignoring it", m_cacheFilepath);
+    return {};
+  }
+
+  return cacheData;
+}
+
+void cassidy::PipelineRegistry::saveCacheData()
+{
+  size_t dataSize = 0;
+  VK_CHECK(vkGetPipelineCacheData(m_device, m_cache, &dataSize, nullptr));
+
+  std::vector<uint8_t> cacheData(dataSize);
+  VK_CHECK(vkGetPipelineCacheData(m_device, m_cache, &dataSize, cacheData.data()));
+  cacheData.resize(dataSize);
+
+  CacheFileHeader header = m_deviceHeader;
+  header.dataSize = cacheData.size();
+  header.dataHash = cassidy::hash::xxHash64(cacheData.data(), cacheData.size());
+
+  // Write to a temporary file first, so an interrupted write can't leave a truncated cache behind:
+  const std::string tempPath = m_cacheFilepath + ".tmp";
+  {
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+      CS_LOG_WARN("Couldn't open pipeline cache file {0} for writing!", tempPath);
+      return;
+    }
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(cacheData.data()), cacheData.size());
+
+    if (!file.good())
+    {
+      CS_LOG_WARN("Failed to write pipeline cache file {0}!", tempPath);
+      file.close();
+      std::remove(tempPath.c_str());
+      return;
+    }
+  }
+
+  std::remove(m_cacheFilepath.c_str());
+  if (std::rename(tempPath.c_str(), m_cacheFilepath.c_str()) != 0)
+  {
+    CS_LOG_WARN("Failed to move pipeline cache file into place ({0})!", m_cacheFilepath);
+    std::remove(tempPath.c_str());
+    return;
+  }
+
+  CS_LOG_INFO("Saved pipeline cache {0} ({1} KB)", m_cacheFilepath, cacheData.size() / 1024);
+}
@@ -0,0 +1,144 @@
+#pragma once
+#include <Utils/Types.h>
+#include <Core/JobSystem.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace cassidy
+{
+  class Pipeline;
+
+  // Owns every pipeline the renderer builds, keyed on a hash of the pipeline's full create state (shader code, layouts,
+  // fixed-function state and render pass) so identical pipelines are only ever built once and shared. Pipelines are
+  // compiled on the job system through a VkPipelineCache, which is loaded from disk at startup and saved back on
+  // shutdown so later runs skip most of the driver's shader compilation.
+  //
+  // A pipeline that's still compiling has its layout but no VkPipeline yet (Pipeline::isReady() is false). The handle
+  // is published atomically once compiled, so recording threads either see the whole pipeline or skip it. Pipelines
+  // keep the shader code they were compiled from, so they can be recompiled in the background when a shader changes
+  // and swapped in between frames.
+  class PipelineRegistry
+  {
+  public:
+    struct ShaderStage
+    {
+      VkShaderStageFlagBits stage;
+      std::string filename;         // (relative to the shader directory)
+      std::vector<uint32_t> code;
+    };
+    typedef std::vector<ShaderStage> ShaderStages;
+
+    // Compiles a pipeline from the given layout and shader stages. May be called again (on any thread) to recompile it
+    // with new shader code, so mustn't depend on anything that outlives the build:
+    typedef std::function<VkPipeline(VkPipelineLayout layout, const ShaderStages& shaderStages)> CompileFunc;
+
+    void init(VkDevice device, const VkPhysicalDeviceProperties& gpuProperties, const std::string& cacheFilepath,
+      cassidy::JobSystem* jobSystemRef);
+
+    // Save the pipeline cache to disk and destroy it, along with any pipelines still registered. Compiles must have
+    // finished (see waitForPendingPipelines), since the job system is shut down first:
+    void release();
+
+    // If a pipeline with the given state is registered (compiled or not), point the pipeline at it and take a
+    // reference. outCompileJob tracks the compile if it's still running:
+    bool acquirePipeline(uint64_t stateHash, cassidy::Pipeline& pipeline, cassidy::JobHandle& outCompileJob);
+
+    // Register a new pipeline with one reference, and compile it on the job system with the given layout (which the
+    // registry takes ownership of). If another thread registered the same state first, the layout is destroyed and the
+    // existing pipeline shared instead:
+    cassidy::JobHandle compilePipeline(uint64_t stateHash, cassidy::Pipeline& pipeline, VkPipelineLayout layout,
+      ShaderStages&& shaderStages, CompileFunc&& compile, cassidy::JobSystem::Priority priority);
+
+    // Recompile every pipeline using the given shader file with its new code, on the job system. Pipelines keep using
+    // their old code until the recompile has finished and swapReloadedPipelines is called. Thread-safe. Returns false
+    // (reloading nothing) if the new code's reflected bindings or push constants differ from the old code's, since the
+    // pipelines' layouts can't change under them:
+    bool reloadShader(const std::string& filename, const std::vector<uint32_t>& code, uint32_t& outNumPipelines);
+
+    // Publish recompiled pipelines in place of the ones they replace, which are destroyed once no frame in flight can
+    // be using them. Called between frames:
+    void swapReloadedPipelines();
+
+    // Pipelines with no references left are destroyed straight away (once compiled), so they must no longer be in use:
+    void releasePipeline(uint64_t stateHash);
+
+    // Block until every pipeline compile has finished:
+    void waitForPendingPipelines();
+
+    // Getters/setters: ------------------------------------------------------------------------------------------
+    inline VkPipelineCache  getCache()                const { return m_cache; }
+    inline uint32_t         getNumPipelines()         const { return static_cast<uint32_t>(m_pipelines.size()); }
+    inline uint32_t         getNumPipelinesBuilt()    const { return m_numPipelinesBuilt; }
+    inline uint32_t         getNumPipelinesShared()   const { return m_numPipelinesShared; }
+    inline uint32_t         getNumPendingCompiles()   const { return m_numPendingCompiles; }
+    inline uint32_t         getNumPipelinesReloaded() const { return m_numPipelinesReloaded; }
+    inline size_t           getLoadedCacheSize()      const { return m_loadedCacheSize; }
+
+  private:
+    // Written ahead of the driver's cache data, which is only reused if it was saved by the same device and driver
+    // (VkPipelineCacheHeaderVersionOne doesn't include the driver version, and nothing checks the data is intact):
+    struct CacheFileHeader
+    {
+      uint32_t magic;
+      uint32_t version;
+      uint32_t vendorID;
+      uint32_t deviceID;
+      uint32_t driverVersion;
+      uint32_t padding;
+      uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+      uint64_t dataSize;
+      uint64_t dataHash;
+    };
+
+    // A recompile with new shader code, whose pipeline is swapped in once it's finished:
+    struct PipelineReload
+    {
+      std::shared_ptr<std::atomic<VkPipeline>> pipeline;
+      cassidy::JobHandle reloadJob;
+    };
+
+    struct RegisteredPipeline
+    {
+      std::shared_ptr<std::atomic<VkPipeline>> pipeline;  // (shared with every Pipeline using it, null until compiled)
+      VkPipelineLayout layout;
+      uint32_t refCount;
+      cassidy::JobHandle compileJob;
+
+      std::shared_ptr<const CompileFunc> compile;
+      std::shared_ptr<const ShaderStages> shaderStages;
+      PipelineReload pendingReload;
+    };
+
+    cassidy::JobHandle pushCompileJob(const RegisteredPipeline& registered, std::shared_ptr<std::atomic<VkPipeline>> compiledPipeline,
+      cassidy::JobSystem::Priority priority);
+    void destroyPipeline(RegisteredPipeline& registered);
+
+    // Wait for a reload to finish and destroy its pipeline (which was never published, so can't be in use):
+    void discardReload(PipelineReload& reload);
+
+    // Read the cache file's data if it's valid for this device, otherwise return an empty vector:
+    std::vector<uint8_t> loadCacheData();
+    void saveCacheData();
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    cassidy::JobSystem* m_jobSystemRef = nullptr;
+    VkPipelineCache m_cache = VK_NULL_HANDLE;   // (internally synchronised, pipelines can be built from any thread)
+    std::string m_cacheFilepath;
+    CacheFileHeader m_deviceHeader = {};        // (header expected of a cache file saved by this device and driver)
+    size_t m_loadedCacheSize = 0;
+
+    std::unordered_map<uint64_t, RegisteredPipeline> m_pipelines;
+    std::vector<PipelineReload> m_supersededReloads;  // (replaced by a newer reload of the same pipeline before being swapped in)
+    std::mutex m_registryMutex;
+    uint32_t m_numPipelinesBuilt = 0;
+    uint32_t m_numPipelinesShared = 0;
+    uint32_t m_numPipelinesReloaded = 0;
+    std::atomic<uint32_t> m_numPendingCompiles = 0;
+  };
+}
@@ -46,15 +46,19 @@ void cassidy::PostProcessStack::recordCommands(VkCommandBuffer cmd, uint32_t fra
 	if (m_postProcessStack.empty()) return;
 
 	VkExtent2D imageExtent = m_rendererRef->getSwapchain().extent;
+	cassidy::GpuProfiler& gpuProfiler = m_rendererRef->getGpuProfiler();
 
 	for (std::vector<PostProcessResources>::iterator it = m_postProcessStack.begin(); it != m_postProcessStack.end(); ++it)
 	{
-		if (!(*it).isActive) continue;
+		// (effects pushed at runtime are compiled in the background, so are skipped until their pipeline is ready)
+		if (!(*it).isActive || !(*it).pipeline.isReady()) continue;
 
+		const uint32_t effectScope = gpuProfiler.beginScope(cmd, (*it).pipeline.getDebugName());
 		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, (*it).pipeline.getPipeline());
 		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, (*it).pipeline.getLayout(), 
 			0, 1, &(*it).descriptorSets[frameIndex], 0, nullptr);
 
 		vkCmdDispatch(cmd, std::ceil(imageExtent.width / 16.0), std::ceil(imageExtent.height / 16.0), 1);
+		gpuProfiler.endScope(cmd, effectScope);
 	}
 }
\ No newline at end of file
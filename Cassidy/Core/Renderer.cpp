@@ -2,10 +2,12 @@
 #include <Core/Engine.h>
 #include <Core/ResourceManager.h>
 #include <Core/Logger.h>
+#include <Core/CpuProfiler.h>
 
 #include <Utils/DescriptorBuilder.h>
 #include <Utils/Helpers.h>
 #include <Utils/Initialisers.h>
+#include <Utils/ImageWriter.h>
 
 #include <SDL.h>
 #include <SDL_vulkan.h>
@@ -18,28 +20,52 @@
 
 #include <assimp/postprocess.h>
 
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
 #include <set>
 #include <iostream>
 
 void cassidy::Renderer::init(cassidy::Engine* engine)
 {
   m_engineRef = engine;
+  m_isHeadless = engine->isHeadless();
 
   initLogicalDevice();
   initSyncObjects();
+  initGpuProfiler();
   initCommandPool();
   initCommandBuffers();
   initResourceManager();
-  initSwapchain();
-  transitionSwapchainImages();
+  if (m_isHeadless)
+  {
+    initHeadlessTarget();
+  }
+  else
+  {
+    initSwapchain();
+    transitionSwapchainImages();
+  }
   initEditorResources();
   initDescriptorSets();
-  initImGui();
+  if (!m_isHeadless)
+    initImGui();
+  initViewportResources();
   initPostProcessResources();
   initPipelines();
   initSwapchainFramebuffers();  // (swapchain framebuffers are dependent on back buffer pipeline's render pass)
-  initVertexBuffers();
-  initIndexBuffers();
+  initGeometryBuffers();
+
+  // Startup pipelines are compiled in parallel on the job system, and have to be ready before the first frame:
+  cassidy::globals::g_resourceManager.pipelineRegistry.waitForPendingPipelines();
+
+  if (!m_isHeadless)
+  {
+    m_shaderHotReloader.init(SHADER_ABS_FILEPATH, &engine->getJobSystem());
+    m_deletionQueue.addFunction([=]() {
+      m_shaderHotReloader.release();
+      });
+  }
 
   m_currentFrameIndex = 0;
   m_swapchainImageIndex = 0;
@@ -48,7 +74,15 @@ void cassidy::Renderer::init(cassidy::Engine* engine)
 
 void cassidy::Renderer::draw()
 {
+  CS_PROFILE_SCOPE("Renderer::draw");
+
   vkWaitForFences(m_device, 1, &m_inFlightFences[m_currentFrameIndex], VK_TRUE, UINT64_MAX);
+  if (m_isHeadless)
+  {
+    // No swapchain to acquire from, so cycle through one set of viewport images per frame in flight instead:
+    m_swapchainImageIndex = m_currentFrameIndex;
+  }
+  else
   {
     const VkResult acquireImageResult = vkAcquireNextImageKHR(m_device, m_swapchain.swapchain, UINT64_MAX,
       m_imageAvailableSemaphores[m_currentFrameIndex], VK_NULL_HANDLE, &m_swapchainImageIndex);
@@ -66,15 +100,38 @@ void cassidy::Renderer::draw()
   const FrameData& currentFrameData = getCurrentFrameData();
   const int32_t& currentModelIndex = m_engineRef->getUIContext().selectedModel;
   constexpr ModelManager& modelManager = cassidy::globals::g_resourceManager.modelManager;
-  m_currentModel = modelManager.getModelsPtrTable()[currentModelIndex];
+  modelManager.pollPendingUploads(m_device, m_uploadContext);
+
+  // This frame's fence has been waited on, so resources released FRAMES_IN_FLIGHT frames ago are no longer in use:
+  cassidy::globals::g_resourceManager.collectGarbage(m_currentFrame);
+
+  // Swap in pipelines recompiled since the last frame (pipelines they replace are destroyed like any other garbage):
+  m_shaderHotReloader.update();
+
+  // Hold a reference to the previewed model, so unloading it in the editor can't pull it out from under this frame:
+  const std::vector<cassidy::ModelHandle> modelHandles = modelManager.getModelHandles();
+  const cassidy::ModelHandle selectedModel = static_cast<size_t>(currentModelIndex) < modelHandles.size() ?
+    modelHandles[currentModelIndex] : cassidy::ModelHandle();
+  if (selectedModel != m_currentModel)
+  {
+    modelManager.addRef(selectedModel);
+    modelManager.releaseModel(m_currentModel);
+    m_currentModel = selectedModel;
+  }
 
   DebugContext& engineDebugContext = m_engineRef->getDebugContext();
   engineDebugContext.currentFrame = m_currentFrame;
   engineDebugContext.currentSwapchainImageIndex = m_swapchainImageIndex;
 
   updateBuffers(currentFrameData);
+
+  // (after updateBuffers, which lets the texture streamer swap in new images and so change materials' texture slots)
+  cassidy::globals::g_resourceManager.bindless.uploadMaterials(m_currentFrameIndex);
+
   recordViewportCommands(m_swapchainImageIndex);
-  recordEditorCommands(m_swapchainImageIndex);
+  if (!m_isHeadless)
+    recordEditorCommands(m_swapchainImageIndex);
+  m_uniformAllocator.flush();
   submitCommandBuffers(m_swapchainImageIndex);
 
   m_currentFrameIndex = (m_currentFrameIndex + 1) % FRAMES_IN_FLIGHT;
@@ -86,6 +143,9 @@ void cassidy::Renderer::release()
   // Wait on device idle to prevent in-use resources from being destroyed:
   vkDeviceWaitIdle(m_device);
 
+  cassidy::globals::g_resourceManager.modelManager.releaseModel(m_currentModel);
+  m_currentModel = {};
+
   m_deletionQueue.execute();
   
   CS_LOG_INFO("Renderer shut down!");
@@ -93,6 +153,8 @@ void cassidy::Renderer::release()
 
 void cassidy::Renderer::updateBuffers(const FrameData& currentFrameData)
 {
+  CS_PROFILE_SCOPE("Renderer::updateBuffers");
+
   const VmaAllocator allocator = getVmaAllocator();
 
   MatrixBufferData matrixBufferData;
@@ -101,10 +163,8 @@ void cassidy::Renderer::updateBuffers(const FrameData& currentFrameData)
   matrixBufferData.viewProj = matrixBufferData.proj * matrixBufferData.view;
   matrixBufferData.invViewProj = glm::inverse(matrixBufferData.viewProj);
 
-  void* matrixBufferDataPtr;
-  vmaMapMemory(allocator, currentFrameData.perPassMatrixUniformBuffer.allocation, &matrixBufferDataPtr);
-  memcpy(matrixBufferDataPtr, &matrixBufferData, sizeof(MatrixBufferData));
-  vmaUnmapMemory(allocator, currentFrameData.perPassMatrixUniformBuffer.allocation);
+  memcpy(currentFrameData.perPassMatrixMappedData, &matrixBufferData, sizeof(MatrixBufferData));
+  vmaFlushAllocation(allocator, currentFrameData.perPassMatrixUniformBuffer.allocation, 0, VK_WHOLE_SIZE);
 
   LightBufferData lightBufferData;
   lightBufferData.numActiveLights = m_numActiveLights;
@@ -119,27 +179,137 @@ void cassidy::Renderer::updateBuffers(const FrameData& currentFrameData)
     lightBufferData.dirLights[i].ambient = m_lightAmbient[i];
   }
 
-  void* lightBufferDataPtr;
-  vmaMapMemory(allocator, currentFrameData.perPassLightUniformBuffer.allocation, &lightBufferDataPtr);
-  memcpy(lightBufferDataPtr, &lightBufferData, sizeof(LightBufferData));
-  vmaUnmapMemory(allocator, currentFrameData.perPassLightUniformBuffer.allocation);
+  memcpy(currentFrameData.perPassLightMappedData, &lightBufferData, sizeof(LightBufferData));
+  vmaFlushAllocation(allocator, currentFrameData.perPassLightUniformBuffer.allocation, 0, VK_WHOLE_SIZE);
+
+  updatePerObjectBuffers();
+  updateTextureStreaming(matrixBufferData.proj);
+}
+
+void cassidy::Renderer::updatePerObjectBuffers()
+{
+  const cassidy::Scene& scene = m_engineRef->getScene();
+
+  // Upper bound on the space needed, as if every instance were in its own group:
+  const uint32_t perObjectSize = cassidy::helper::padUniformBufferSize(sizeof(PerObjectData), m_physicalDeviceProperties);
+  const uint32_t requiredBytesPerFrame = std::max(scene.getNumInstances(), 1U) * perObjectSize;
+  if (requiredBytesPerFrame > m_uniformAllocator.getBytesPerFrame())
+    growUniformAllocator(requiredBytesPerFrame);
+
+  // This frame's fence has been waited on, so its region of the uniform allocator can be reused:
+  m_uniformAllocator.beginFrame(m_currentFrameIndex);
+  m_instanceDraws.clear();
+
+  // Group placements of the same model, so each group is drawn with one instanced draw per mesh (group vectors are
+  // kept between frames to reuse their capacity):
+  // Models that were unloaded since last frame no longer have a group to reuse:
+  constexpr ModelManager& modelManager = cassidy::globals::g_resourceManager.modelManager;
+  for (auto it = m_instanceGroups.begin(); it != m_instanceGroups.end();)
+  {
+    it->second.model = modelManager.getModel(it->first);
+    it->second.instances.clear();
+    it = it->second.model ? std::next(it) : m_instanceGroups.erase(it);
+  }
+
+  // Nothing placed yet, so just preview the model selected in the editor:
+  if (scene.getNumInstances() == 0)
+  {
+    cassidy::ModelHandle previewModel = m_currentModel;
+    if (!modelManager.getModel(previewModel))
+      previewModel = modelManager.findModel("Helmet/DamagedHelmet.gltf");
+
+    glm::mat4 objectWorld = glm::rotate(glm::mat4(1.0f), glm::radians(m_objectRotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
+    objectWorld = glm::rotate(objectWorld, glm::radians(m_objectRotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
+    objectWorld = glm::rotate(objectWorld, glm::radians(m_objectRotation.z), glm::vec3(0.0f, 0.0f, 1.0f));  
+
+    if (cassidy::Model* model = modelManager.getModel(previewModel))
+    {
+      InstanceGroup& group = m_instanceGroups[previewModel];
+      group.model = model;
+      group.instances.push_back({ objectWorld });
+    }
+  }
+
+  // Instances of the same model are usually placed together, so only look models up when the handle changes:
+  cassidy::ModelHandle lastHandle;
+  cassidy::Model* lastModel = nullptr;
+  for (const auto& instance : scene.getInstances())
+  {
+    if (instance.model != lastHandle)
+    {
+      lastHandle = instance.model;
+      lastModel = modelManager.getModel(instance.model);
+    }
+
+    // Skip models that are still streaming in rather than spending uniform space on them:
+    if (!lastModel || lastModel->getLoadResult() != LoadResult::SUCCESS)
+      continue;
+
+    InstanceGroup& group = m_instanceGroups[instance.model];
+    group.model = lastModel;
+    group.instances.push_back({ instance.getWorldMatrix() });
+  }
+
+  for (const auto& group : m_instanceGroups)
+  {
+    const std::vector<PerObjectData>& groupData = group.second.instances;
+    if (groupData.empty()) continue;
+
+    // Each group's transforms are contiguous, indexed by gl_InstanceIndex from the group's dynamic offset:
+    const uint32_t groupDataSize = static_cast<uint32_t>(groupData.size() * sizeof(PerObjectData));
+    const cassidy::LinearUniformAllocator::Allocation allocation = m_uniformAllocator.allocate(groupDataSize);
+    if (!allocation.mappedData) continue;
+
+    memcpy(allocation.mappedData, groupData.data(), groupDataSize);
+    m_instanceDraws.push_back({ group.second.model, allocation.dynamicOffset, static_cast<uint32_t>(groupData.size()) });
+  }
+}
+
+void cassidy::Renderer::updateTextureStreaming(const glm::mat4& proj)
+{
+  CS_PROFILE_SCOPE("Renderer::updateTextureStreaming");
+
+  cassidy::TextureStreamer& streamer = cassidy::globals::g_resourceManager.textureLibrary.getStreamer();
+
+  // Screen-space size of one world unit at unit distance, so models can work out the mip levels they need:
+  const float pixelsPerUnitAtUnitDistance = 0.5f * static_cast<float>(m_engineRef->getViewportDim().y) * std::abs(proj[1][1]);
+  const glm::vec3 cameraPosition = m_engineRef->getCamera().getPosition();
+
+  for (const auto& group : m_instanceGroups)
+  {
+    const std::vector<PerObjectData>& groupData = group.second.instances;
+    if (groupData.empty() || group.second.model->getLoadResult() != LoadResult::SUCCESS) continue;
+
+    group.second.model->requestTextureLevels(groupData, cameraPosition, pixelsPerUnitAtUnitDistance, streamer);
+  }
+
+  streamer.update(m_currentFrame);
+}
+
+void cassidy::Renderer::growUniformAllocator(uint32_t requiredBytesPerFrame)
+{
+  // Other frames in flight may still be reading from the old buffer, this only happens when the scene outgrows it:
+  vkDeviceWaitIdle(m_device);
 
-  glm::mat4 objectWorld = glm::rotate(glm::mat4(1.0f), glm::radians(m_objectRotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
-  objectWorld = glm::rotate(objectWorld, glm::radians(m_objectRotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
-  objectWorld = glm::rotate(objectWorld, glm::radians(m_objectRotation.z), glm::vec3(0.0f, 0.0f, 1.0f));  
+  const uint32_t newBytesPerFrame = std::max(requiredBytesPerFrame, m_uniformAllocator.getBytesPerFrame() * 2);
+  m_uniformAllocator.resize(newBytesPerFrame);
 
-  PerObjectData perObjectData;
-  perObjectData.world = objectWorld;
+  for (uint8_t i = 0; i < FRAMES_IN_FLIGHT; ++i)
+  {
+    VkDescriptorBufferInfo perObjectBufferInfo = cassidy::init::descriptorBufferInfo(
+      m_uniformAllocator.getBuffer(), 0, VK_WHOLE_SIZE);
+    VkWriteDescriptorSet perObjectWrite = cassidy::init::writeDescriptorSet(m_frameData[i].perObjectSet, 0,
+      VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1, &perObjectBufferInfo);
 
-  char* perObjectDataPtr;
-  vmaMapMemory(allocator, m_perObjectUniformBufferDynamic.allocation, (void**)&perObjectDataPtr);
-  perObjectDataPtr += m_currentFrameIndex * cassidy::helper::padUniformBufferSize(sizeof(PerObjectData), m_physicalDeviceProperties);
-  memcpy(perObjectDataPtr, &perObjectData, sizeof(PerObjectData));
-  vmaUnmapMemory(allocator, m_perObjectUniformBufferDynamic.allocation);
+    vkUpdateDescriptorSets(m_device, 1, &perObjectWrite, 0, nullptr);
+  }
+  CS_LOG_INFO("Grew per-object uniform data to {0} KB per frame!", m_uniformAllocator.getBytesPerFrame() / 1024);
 }
  
 void cassidy::Renderer::recordViewportCommands(uint32_t imageIndex)
 {
+  CS_PROFILE_SCOPE("Renderer::recordViewportCommands");
+
   const VkCommandBuffer& cmd = m_viewportCommandBuffers[m_currentFrameIndex];
 
   VK_CHECK(vkResetCommandBuffer(cmd, 0));
@@ -147,6 +317,9 @@ void cassidy::Renderer::recordViewportCommands(uint32_t imageIndex)
   VkCommandBufferBeginInfo beginInfo = cassidy::init::commandBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, nullptr);
   vkBeginCommandBuffer(cmd, &beginInfo);
 
+  // Viewport commands are the first submitted each frame, so this frame's profiler queries are reset here:
+  m_gpuProfiler.beginFrame(cmd, m_currentFrameIndex);
+
   VkClearValue clearValues[2];
   clearValues[0].color = { std::powf(0.2f, 2.2f), std::powf(0.3f, 2.2f), std::powf(0.3f, 2.2f), 1.0f };
   clearValues[1].depthStencil = { 1.0f, 0 };
@@ -159,43 +332,103 @@ void cassidy::Renderer::recordViewportCommands(uint32_t imageIndex)
   VkRenderPassBeginInfo renderPassInfo = cassidy::init::renderPassBeginInfo(m_viewportRenderPass,
     m_viewportFramebuffers[imageIndex], { 0, 0 }, extent, 2, clearValues);
 
-  vkCmdBeginRenderPass(cmd, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+  const uint32_t viewportScope = m_gpuProfiler.beginScope(cmd, "Viewport pass");
+  vkCmdBeginRenderPass(cmd, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
   {
-    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_viewportPipeline.getPipeline());
-
-    VkViewport viewport = cassidy::init::viewport(0.0f, 0.0f, extent.width, extent.height);
-    vkCmdSetViewport(cmd, 0, 1, &viewport);
-
-    VkRect2D scissor = cassidy::init::scissor({ 0, 0 }, extent);
-    vkCmdSetScissor(cmd, 0, 1, &scissor);
-
-    // Bind per-pass descriptor set to slot 0:
-    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_viewportPipeline.getLayout(),
-      0, 1, &getCurrentFrameData().perPassSet, 0, nullptr);
+    std::vector<RecordingSlot>& recordingSlots = m_viewportRecordingSlots[m_currentFrameIndex];
+
+    // Use as many slots as there are threads, without giving any slot fewer than the minimum batch size:
+    const uint32_t numDraws = static_cast<uint32_t>(m_instanceDraws.size());
+    const uint32_t numBatches = std::clamp((numDraws + MIN_DRAWS_PER_RECORDING_BATCH - 1) / MIN_DRAWS_PER_RECORDING_BATCH,
+      1U, static_cast<uint32_t>(recordingSlots.size()));
+    const uint32_t drawsPerBatch = (numDraws + numBatches - 1) / numBatches;
+
+    VkCommandBufferInheritanceInfo inheritanceInfo = {};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.renderPass = m_viewportRenderPass;
+    inheritanceInfo.subpass = 0;
+    inheritanceInfo.framebuffer = m_viewportFramebuffers[imageIndex];
+
+    cassidy::JobSystem& jobSystem = m_engineRef->getJobSystem();
+    const cassidy::JobHandle recordHandle = jobSystem.parallelFor(numBatches, 1, [&](uint32_t begin, uint32_t end) {
+      for (uint32_t i = begin; i < end; ++i)
+      {
+        const RecordingSlot& slot = recordingSlots[i];
+        VK_CHECK(vkResetCommandPool(m_device, slot.commandPool, 0));
+
+        VkCommandBufferBeginInfo secondaryBeginInfo = cassidy::init::commandBufferBeginInfo(
+          VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT, &inheritanceInfo);
+        vkBeginCommandBuffer(slot.commandBuffer, &secondaryBeginInfo);
+
+        recordViewportDraws(slot.commandBuffer, extent, std::min(i * drawsPerBatch, numDraws),
+          std::min((i + 1) * drawsPerBatch, numDraws));
+
+        VK_CHECK(vkEndCommandBuffer(slot.commandBuffer));
+      }
+      });
+    jobSystem.wait(recordHandle);
 
-    // Bind per-object dynamic descriptor set to slot 1:
-    const uint32_t dynamicUniformOffset = m_currentFrameIndex * cassidy::helper::padUniformBufferSize(sizeof(PerObjectData), m_physicalDeviceProperties);
-    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_viewportPipeline.getLayout(),
-      1, 1, &getCurrentFrameData().perObjectSet, 1, &dynamicUniformOffset);
-    
-    if (!m_currentModel)
+    std::vector<VkCommandBuffer> secondaryCmds(numBatches);
+    for (uint32_t i = 0; i < numBatches; ++i)
     {
-      constexpr ModelManager& modelManager = cassidy::globals::g_resourceManager.modelManager;
-      modelManager.getModel("Helmet/DamagedHelmet.gltf")->draw(cmd, &m_viewportPipeline);
+      secondaryCmds[i] = recordingSlots[i].commandBuffer;
     }
-    else
-      m_currentModel->draw(cmd, &m_viewportPipeline);
+    vkCmdExecuteCommands(cmd, numBatches, secondaryCmds.data());
   }
   vkCmdEndRenderPass(cmd);
+  m_gpuProfiler.endScope(cmd, viewportScope);
   
-  // Record post process dispatch commands:
+  // Record post process dispatch commands (each effect is profiled separately):
   m_postProcessStack.recordCommands(cmd, imageIndex);
 
   VK_CHECK(vkEndCommandBuffer(cmd));
 }
 
+void cassidy::Renderer::recordViewportDraws(VkCommandBuffer cmd, const VkExtent2D& extent, uint32_t firstDraw, uint32_t lastDraw)
+{
+  CS_PROFILE_SCOPE("Renderer::recordViewportDraws");
+
+  // (a pipeline being rebuilt is skipped rather than stalling the frame, leaving the viewport cleared until it's ready)
+  if (!m_viewportPipeline.isReady()) return;
+
+  // Secondary command buffers don't inherit any state, so every batch has to set it up again:
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_viewportPipeline.getPipeline());
+
+  VkViewport viewport = cassidy::init::viewport(0.0f, 0.0f, extent.width, extent.height);
+  vkCmdSetViewport(cmd, 0, 1, &viewport);
+
+  VkRect2D scissor = cassidy::init::scissor({ 0, 0 }, extent);
+  vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+  // Bind per-pass descriptor set to slot 0:
+  vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_viewportPipeline.getLayout(),
+    0, 1, &getCurrentFrameData().perPassSet, 0, nullptr);
+
+  // Every mesh's geometry lives in the shared pool, so its buffers only need binding once per batch:
+  cassidy::globals::g_resourceManager.geometryPool.bind(cmd);
+
+  // Likewise every bindless texture and material, leaving draws to select materials with a push constant:
+  const cassidy::BindlessResources& bindless = cassidy::globals::g_resourceManager.bindless;
+  if (bindless.isEnabled())
+    bindless.bind(cmd, m_viewportPipeline.getLayout(), m_currentFrameIndex);
+
+  for (uint32_t i = firstDraw; i < lastDraw; ++i)
+  {
+    const InstanceDraw& instanceDraw = m_instanceDraws[i];
+    if (!instanceDraw.model) continue;
+
+    // Bind per-object dynamic descriptor set to slot 1, at this group's slice of the uniform allocator:
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_viewportPipeline.getLayout(),
+      1, 1, &getCurrentFrameData().perObjectSet, 1, &instanceDraw.perObjectOffset);
+
+    instanceDraw.model->draw(cmd, &m_viewportPipeline, instanceDraw.instanceCount);
+  }
+}
+
 void cassidy::Renderer::recordEditorCommands(uint32_t imageIndex)
 {
+  CS_PROFILE_SCOPE("Renderer::recordEditorCommands");
+
   const VkCommandBuffer& cmd = m_commandBuffers[m_currentFrameIndex];
 
   VK_CHECK(vkResetCommandBuffer(cmd, 0));
@@ -219,12 +452,15 @@ void cassidy::Renderer::recordEditorCommands(uint32_t imageIndex)
     m_editorFramebuffers[imageIndex], { 0, 0 }, m_swapchain.extent, 2, clearValues);
 
   // Draw ImGui contents:
+  const uint32_t editorScope = m_gpuProfiler.beginScope(cmd, "ImGui editor pass");
   vkCmdBeginRenderPass(cmd, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
   ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), cmd);
   vkCmdEndRenderPass(cmd);
+  m_gpuProfiler.endScope(cmd, editorScope);
 
   // Transition editor image and swapchain image to transfer layout:
   // (editor render pass has implicit UNDEFINED -> TRANSFER_SRC transition)
+  const uint32_t blitScope = m_gpuProfiler.beginScope(cmd, "Swapchain blit");
   cassidy::helper::transitionImageLayout(cmd,
     m_swapchain.images[imageIndex], m_swapchain.imageFormat,
     VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
@@ -257,34 +493,30 @@ void cassidy::Renderer::recordEditorCommands(uint32_t imageIndex)
     VK_ACCESS_NONE, VK_ACCESS_MEMORY_READ_BIT,
     VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
     1);
+  m_gpuProfiler.endScope(cmd, blitScope);
 
   VK_CHECK(vkEndCommandBuffer(cmd));
 }
 
 void cassidy::Renderer::submitCommandBuffers(uint32_t imageIndex)
 {
-  cassidy::TextureLibrary& texLibrary = cassidy::globals::g_resourceManager.textureLibrary;
+  CS_PROFILE_SCOPE("Renderer::submitCommandBuffers");
 
   VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-  VkCommandBuffer submitBuffers[] = {
-    m_viewportCommandBuffers[m_currentFrameIndex],
-    m_commandBuffers[m_currentFrameIndex],
-    texLibrary.getBlitCommandsList().cmd,
-  };
+  VkCommandBuffer submitBuffers[2];
 
-  uint32_t numCmdBuffers = 2;
-  if (texLibrary.getBlitCommandsList().numTextureCommandsRecorded > 0)
-  {
-    cassidy::TextureLibrary::BlitCommandsList& blitCommandsList = texLibrary.getBlitCommandsList();
-    std::unique_lock<std::mutex> lock(blitCommandsList.recordingMutex, std::defer_lock);
+  // Editor commands (ImGui and swapchain blit) aren't recorded when headless:
+  uint32_t numCmdBuffers = 0;
+  submitBuffers[numCmdBuffers++] = m_viewportCommandBuffers[m_currentFrameIndex];
+  if (!m_isHeadless)
+    submitBuffers[numCmdBuffers++] = m_commandBuffers[m_currentFrameIndex];
 
-    if (lock.try_lock())
-    {
-      CS_LOG_INFO("Merged {0} blit commands into render loop command submission!", blitCommandsList.numTextureCommandsRecorded);
-      numCmdBuffers = 3;
-      vkEndCommandBuffer(blitCommandsList.cmd);
-      blitCommandsList.numTextureCommandsRecorded = 0;
-    }
+  // Nothing is acquired or presented when headless, so the frame's fence is the only synchronisation needed:
+  if (m_isHeadless)
+  {
+    VkSubmitInfo submitInfo = cassidy::init::submitInfo(0, nullptr, nullptr, 0, nullptr, numCmdBuffers, submitBuffers);
+    VK_CHECK(vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, m_inFlightFences[m_currentFrameIndex]));
+    return;
   }
 
   VkSubmitInfo submitInfo = cassidy::init::submitInfo(1, &m_imageAvailableSemaphores[m_currentFrameIndex], waitStages, 
@@ -307,30 +539,16 @@ void cassidy::Renderer::submitCommandBuffers(uint32_t imageIndex)
 AllocatedBuffer cassidy::Renderer::allocateVertexBuffer(const std::vector<Vertex>& vertices)
 {
   const VmaAllocator allocator = getVmaAllocator();
+  const VkDeviceSize vertexDataSize = vertices.size() * sizeof(Vertex);
 
-  // Build CPU-side staging buffer:
-  VkBufferCreateInfo stagingBufferInfo = cassidy::init::bufferCreateInfo(
-    static_cast<uint32_t>(vertices.size()) * sizeof(Vertex), VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-  VmaAllocationCreateInfo bufferAllocInfo = cassidy::init::vmaAllocationCreateInfo(
-    VMA_MEMORY_USAGE_AUTO_PREFER_HOST, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
-
-  AllocatedBuffer stagingBuffer;
-
-  vmaCreateBuffer(allocator, &stagingBufferInfo, &bufferAllocInfo,
-    &stagingBuffer.buffer,
-    &stagingBuffer.allocation,
-    nullptr);
-
-  // Write vertex data to newly-allocated buffer:
-  void* data;
-  vmaMapMemory(allocator, stagingBuffer.allocation, &data);
-  memcpy(data, vertices.data(), vertices.size() * sizeof(Vertex));
-  vmaUnmapMemory(allocator, stagingBuffer.allocation);
+  // Write vertex data to staging memory:
+  const cassidy::StagingRingBuffer::Allocation staging = m_uploadContext.stagingRing.allocate(vertexDataSize);
+  memcpy(staging.mappedData, vertices.data(), vertexDataSize);
 
   VkBufferCreateInfo vertexBufferInfo = cassidy::init::bufferCreateInfo(
-    static_cast<uint32_t>(vertices.size()) * sizeof(Vertex), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
-
-  bufferAllocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+    static_cast<uint32_t>(vertexDataSize), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+  VmaAllocationCreateInfo bufferAllocInfo = cassidy::init::vmaAllocationCreateInfo(
+    VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, 0);
 
   AllocatedBuffer newBuffer;
 
@@ -343,35 +561,43 @@ AllocatedBuffer cassidy::Renderer::allocateVertexBuffer(const std::vector<Vertex
   immediateSubmit([=](VkCommandBuffer cmd) {
     VkBufferCopy copy = {};
     copy.dstOffset = 0;
-    copy.srcOffset = 0;
-    copy.size = vertices.size() * sizeof(Vertex);
-    vkCmdCopyBuffer(cmd, stagingBuffer.buffer, newBuffer.buffer, 1, &copy);
+    copy.srcOffset = staging.offset;
+    copy.size = vertexDataSize;
+    vkCmdCopyBuffer(cmd, staging.buffer, newBuffer.buffer, 1, &copy);
     });
 
+  m_uploadContext.stagingRing.free(staging);
+
   m_deletionQueue.addFunction([=]() {
     vmaDestroyBuffer(allocator, newBuffer.buffer, newBuffer.allocation);
     });
 
-  vmaDestroyBuffer(allocator, stagingBuffer.buffer, stagingBuffer.allocation);
-
   return newBuffer;
 }
 
-AllocatedBuffer cassidy::Renderer::allocateBuffer(uint32_t allocSize, VkBufferUsageFlags usageFlags, VmaMemoryUsage memoryUsage, VmaAllocationCreateFlagBits allocFlags)
+AllocatedBuffer cassidy::Renderer::allocateBuffer(uint32_t allocSize, VkBufferUsageFlags usageFlags, VmaMemoryUsage memoryUsage, VmaAllocationCreateFlags allocFlags,
+  void** outMappedData)
 {
   VkBufferCreateInfo bufferInfo = cassidy::init::bufferCreateInfo(allocSize, usageFlags);
 
   VmaAllocationCreateInfo allocInfo = cassidy::init::vmaAllocationCreateInfo(memoryUsage, allocFlags);
 
   AllocatedBuffer newBuffer;
+  VmaAllocationInfo allocationInfo = {};
+
+  vmaCreateBuffer(getVmaAllocator(), &bufferInfo, &allocInfo, &newBuffer.buffer, &newBuffer.allocation, &allocationInfo);
 
-  vmaCreateBuffer(getVmaAllocator(), &bufferInfo, &allocInfo, &newBuffer.buffer, &newBuffer.allocation, nullptr);
+  // Only non-null if the buffer was created with VMA_ALLOCATION_CREATE_MAPPED_BIT:
+  if (outMappedData)
+    *outMappedData = allocationInfo.pMappedData;
 
   return newBuffer;
 }
 
 void cassidy::Renderer::immediateSubmit(std::function<void(VkCommandBuffer cmd)>&& function)
 {
+  std::lock_guard<std::mutex> submitLock(m_uploadContext.submitMutex);
+
   VkCommandBufferBeginInfo beginInfo = cassidy::init::commandBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
     nullptr);
 
@@ -390,6 +616,84 @@ void cassidy::Renderer::immediateSubmit(std::function<void(VkCommandBuffer cmd)>
   vkResetCommandPool(m_device, m_uploadContext.uploadCommandPool, 0);
 }
 
+bool cassidy::Renderer::captureViewport(const std::string& filepath)
+{
+  vkDeviceWaitIdle(m_device);
+
+  const AllocatedImage& image = m_postProcessStack.get(0).resultsImages[m_swapchainImageIndex];
+  const VkExtent2D extent = m_swapchain.extent;
+
+  const bool isBGRA = image.format == VK_FORMAT_B8G8R8A8_UNORM || image.format == VK_FORMAT_B8G8R8A8_SRGB;
+  if (!isBGRA && image.format != VK_FORMAT_R8G8B8A8_UNORM && image.format != VK_FORMAT_R8G8B8A8_SRGB)
+  {
+    CS_LOG_ERROR("Can't capture viewport image with format {0}!", static_cast<int32_t>(image.format));
+    return false;
+  }
+
+  const uint32_t imageSize = extent.width * extent.height * 4;
+  void* mappedData = nullptr;
+  AllocatedBuffer readbackBuffer = allocateBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_HOST,
+    VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT, &mappedData);
+
+  // Post process images are owned by the graphics queue family, so copy on the graphics queue (the editor command
+  // buffers are free to use since the device is idle). The capture gets its own fence, since workers streaming assets
+  // can be waiting on and resetting the upload context's fence under its submit mutex at the same time:
+  VkFence captureFence;
+  VkFenceCreateInfo fenceInfo = cassidy::init::fenceCreateInfo(0);
+  VK_CHECK(vkCreateFence(m_device, &fenceInfo, nullptr, &captureFence));
+
+  UploadContext captureContext =
+  {
+    .uploadCommandPool = m_graphicsCommandPool,
+    .uploadCommandBuffer = m_commandBuffers[m_currentFrameIndex],
+    .uploadFence = captureFence,
+    .uploadQueue = m_graphicsQueue,
+  };
+
+  cassidy::helper::immediateSubmit(m_device, captureContext, [&](VkCommandBuffer cmd) {
+    // Make the post process dispatch's writes visible to the copy (image stays in GENERAL layout):
+    VkMemoryBarrier computeToTransfer = {
+      .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+      .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+      .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+    };
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+      1, &computeToTransfer, 0, nullptr, 0, nullptr);
+
+    VkBufferImageCopy region = {
+      .bufferOffset = 0,
+      .bufferRowLength = 0,
+      .bufferImageHeight = 0,
+      .imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 },
+      .imageOffset = { 0, 0, 0 },
+      .imageExtent = { extent.width, extent.height, 1 },
+    };
+    vkCmdCopyImageToBuffer(cmd, image.image, VK_IMAGE_LAYOUT_GENERAL, readbackBuffer.buffer, 1, &region);
+
+    VkMemoryBarrier transferToHost = {
+      .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+      .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+      .dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+    };
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+      1, &transferToHost, 0, nullptr, 0, nullptr);
+    });
+
+  vkDestroyFence(m_device, captureFence, nullptr);
+  vmaInvalidateAllocation(getVmaAllocator(), readbackBuffer.allocation, 0, VK_WHOLE_SIZE);
+
+  std::vector<uint8_t> pixels(static_cast<const uint8_t*>(mappedData), static_cast<const uint8_t*>(mappedData) + imageSize);
+  vmaDestroyBuffer(getVmaAllocator(), readbackBuffer.buffer, readbackBuffer.allocation);
+
+  if (isBGRA)
+  {
+    for (size_t i = 0; i < pixels.size(); i += 4)
+      std::swap(pixels[i], pixels[i + 2]);
+  }
+
+  return cassidy::helper::writePNG(filepath, extent.width, extent.height, pixels.data());
+}
+
 void cassidy::Renderer::initLogicalDevice()
 {
   CS_LOG_INFO("Picking physical device...");
@@ -414,13 +718,37 @@ void cassidy::Renderer::initLogicalDevice()
     queueInfos.push_back(queueInfo);
   }
 
+  VkPhysicalDeviceFeatures supportedFeatures;
+  vkGetPhysicalDeviceFeatures(m_physicalDevice, &supportedFeatures);
+
   VkPhysicalDeviceFeatures deviceFeatures = {};
   deviceFeatures.samplerAnisotropy = VK_TRUE;
 
+  // Block-compressed textures are optional, images fall back to their uncompressed source files without them:
+  m_supportsBlockCompression = supportedFeatures.textureCompressionBC == VK_TRUE;
+  deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+  if (!m_supportsBlockCompression)
+    CS_LOG_WARN("Device doesn't support BC texture compression, loading uncompressed textures instead!");
+
+  // Nothing is presented when headless, so don't require swapchain support from the device:
+  std::vector<const char*> deviceExtensions = DEVICE_EXTENSIONS;
+  if (m_isHeadless)
+  {
+    std::erase_if(deviceExtensions, [](const char* extension) {
+      return strcmp(extension, VK_KHR_SWAPCHAIN_EXTENSION_NAME) == 0;
+      });
+  }
+
+  // Bindless textures and materials need descriptor indexing (core since 1.2, an extension before that). Also optional,
+  // materials fall back to a descriptor set each without it:
+  VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures = initBindlessSupport(deviceExtensions);
+
   VkDeviceCreateInfo deviceInfo = cassidy::init::deviceCreateInfo(
     static_cast<uint32_t>(queueInfos.size()), queueInfos.data(), &deviceFeatures,
-    static_cast<uint32_t>(DEVICE_EXTENSIONS.size()), DEVICE_EXTENSIONS.data(), 
+    static_cast<uint32_t>(deviceExtensions.size()), deviceExtensions.data(),
     static_cast<uint32_t>(VALIDATION_LAYERS.size()), VALIDATION_LAYERS.data());
+  if (m_supportsBindless)
+    deviceInfo.pNext = &indexingFeatures;
 
   CS_LOG_INFO("Creating logical device...");
   const VkResult deviceCreateResult = vkCreateDevice(m_physicalDevice, &deviceInfo, nullptr, &m_device);
@@ -431,6 +759,8 @@ void cassidy::Renderer::initLogicalDevice()
   vkGetDeviceQueue(m_device, indices.uploadFamily.value(), 0, &m_uploadContext.uploadQueue);
 
   m_uploadContext.graphicsQueueRef = m_graphicsQueue;
+  m_uploadContext.uploadQueueFamily = indices.uploadFamily.value();
+  m_uploadContext.graphicsQueueFamily = indices.graphicsFamily.value();
 
   m_deletionQueue.addFunction([=]() {
     vkDestroyDevice(m_device, nullptr);
@@ -439,6 +769,80 @@ void cassidy::Renderer::initLogicalDevice()
   CS_LOG_INFO("Created logical device!");
 }
 
+VkPhysicalDeviceDescriptorIndexingFeatures cassidy::Renderer::initBindlessSupport(std::vector<const char*>& deviceExtensions)
+{
+  VkPhysicalDeviceDescriptorIndexingFeatures enabledFeatures = {};
+  enabledFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+  m_supportsBindless = false;
+
+  const bool isCoreFeature = m_physicalDeviceProperties.apiVersion >= VK_API_VERSION_1_2;
+  if (!isCoreFeature)
+  {
+    std::vector<VkExtensionProperties> availableExtensions;
+    cassidy::helper::queryAvailableExtensions(m_physicalDevice, nullptr, availableExtensions);
+    const bool hasExtension = std::any_of(availableExtensions.begin(), availableExtensions.end(),
+      [](const VkExtensionProperties& extension) {
+        return strcmp(extension.extensionName, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) == 0;
+      });
+
+    if (!hasExtension)
+    {
+      CS_LOG_WARN("Device doesn't support descriptor indexing, using per-material descriptor sets instead!");
+      return enabledFeatures;
+    }
+  }
+
+  VkPhysicalDeviceDescriptorIndexingFeatures supportedFeatures = {};
+  supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+  VkPhysicalDeviceFeatures2 features2 = {};
+  features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  features2.pNext = &supportedFeatures;
+  vkGetPhysicalDeviceFeatures2(m_physicalDevice, &features2);
+
+  VkPhysicalDeviceDescriptorIndexingProperties indexingProperties = {};
+  indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+  VkPhysicalDeviceProperties2 properties2 = {};
+  properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+  properties2.pNext = &indexingProperties;
+  vkGetPhysicalDeviceProperties2(m_physicalDevice, &properties2);
+
+  const bool hasRequiredFeatures =
+    supportedFeatures.shaderSampledImageArrayNonUniformIndexing &&
+    supportedFeatures.descriptorBindingSampledImageUpdateAfterBind &&
+    supportedFeatures.descriptorBindingUpdateUnusedWhilePending &&
+    supportedFeatures.descriptorBindingPartiallyBound &&
+    supportedFeatures.runtimeDescriptorArray;
+
+  if (!hasRequiredFeatures)
+  {
+    CS_LOG_WARN("Device is missing descriptor indexing features, using per-material descriptor sets instead!");
+    return enabledFeatures;
+  }
+
+  // Bindless or not is fixed for the renderer's lifetime, so the shader has to be there up front:
+  if (!std::filesystem::exists(std::string(SHADER_ABS_FILEPATH) + BINDLESS_FRAGMENT_SHADER))
+  {
+    CS_LOG_WARN("{0} hasn't been compiled, using per-material descriptor sets instead!", BINDLESS_FRAGMENT_SHADER);
+    return enabledFeatures;
+  }
+
+  if (!isCoreFeature)
+    deviceExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+
+  enabledFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+  enabledFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+  enabledFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+  enabledFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+  enabledFeatures.runtimeDescriptorArray = VK_TRUE;
+
+  m_supportsBindless = true;
+  m_maxBindlessTextures = std::min({ MAX_BINDLESS_TEXTURES, indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+    indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages });
+  CS_LOG_INFO("Using bindless textures ({0} slots)", m_maxBindlessTextures);
+
+  return enabledFeatures;
+}
+
 void cassidy::Renderer::initSwapchain()
 {
   SwapchainSupportDetails details = cassidy::helper::querySwapchainSupport(m_physicalDevice, m_engineRef->getSurface());
@@ -516,6 +920,18 @@ void cassidy::Renderer::initSwapchain()
   CS_LOG_INFO("Created swapchain!");
 }
 
+void cassidy::Renderer::initHeadlessTarget()
+{
+  // There are no swapchain images to render into, so only fill in the extent and format that the viewport and post
+  // process images are created with:
+  const glm::uvec2 windowDim = m_engineRef->getWindowDim();
+  m_swapchain.swapchain = VK_NULL_HANDLE;
+  m_swapchain.extent = { windowDim.x, windowDim.y };
+  m_swapchain.imageFormat = HEADLESS_TARGET_FORMAT;
+
+  CS_LOG_INFO("Rendering headless with extent ({0}, {1})", m_swapchain.extent.width, m_swapchain.extent.height);
+}
+
 void cassidy::Renderer::initResourceManager()
 {
   CS_LOG_INFO("Initialising resource manager...");
@@ -667,15 +1083,29 @@ void cassidy::Renderer::initPipelines()
 
   PipelineBuilder pipelineBuilder(this);
   pipelineBuilder.addShaderStage(VK_SHADER_STAGE_VERTEX_BIT, "helloTriangleVert.spv")
-    .addShaderStage(VK_SHADER_STAGE_FRAGMENT_BIT, "phongLightingFrag.spv")
     .setRenderPass(m_editorRenderPass)
     .addDescriptorSetLayout(m_perPassSetLayout)
-    .addDescriptorSetLayout(m_perObjectSetLayout)
-    .addDescriptorSetLayout(m_perMaterialSetLayout)
-    .buildGraphicsPipeline(m_helloTrianglePipeline);
+    .addDescriptorSetLayout(m_perObjectSetLayout);
+
+  // Bindless materials read their textures from the shared texture array and material buffer (sets 2 and 3), and
+  // are selected with a push constant index rather than by binding a set per material:
+  const cassidy::BindlessResources& bindless = cassidy::globals::g_resourceManager.bindless;
+  if (bindless.isEnabled())
+  {
+    pipelineBuilder.addShaderStage(VK_SHADER_STAGE_FRAGMENT_BIT, BINDLESS_FRAGMENT_SHADER)
+      .addDescriptorSetLayout(bindless.getTextureSetLayout())
+      .addDescriptorSetLayout(bindless.getMaterialSetLayout())
+      .addReflectedLayouts();   // (every set is given, so this only picks up the material index push constant)
+  }
+  else
+  {
+    pipelineBuilder.addShaderStage(VK_SHADER_STAGE_FRAGMENT_BIT, "phongLightingFrag.spv")
+      .addDescriptorSetLayout(m_perMaterialSetLayout);
+  }
+  pipelineBuilder.buildGraphicsPipelineAsync(m_helloTrianglePipeline);
 
   pipelineBuilder.setRenderPass(m_viewportRenderPass)
-    .buildGraphicsPipeline(m_viewportPipeline);
+    .buildGraphicsPipelineAsync(m_viewportPipeline);
 
   m_deletionQueue.addFunction([=]() {
     m_helloTrianglePipeline.release(m_device);
@@ -735,15 +1165,6 @@ void cassidy::Renderer::initCommandBuffers()
 
   CS_LOG_INFO("Created {0} graphics command buffers!", FRAMES_IN_FLIGHT);
 
-  // Allocate command buffer for blit commands to generate mipmaps:
-  VkCommandBufferAllocateInfo blitAllocInfo = cassidy::init::commandBufferAllocInfo(
-    m_graphicsCommandPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1);
-
-  cassidy::TextureLibrary& texLibrary = cassidy::globals::g_resourceManager.textureLibrary;
-  vkAllocateCommandBuffers(m_device, &blitAllocInfo, &texLibrary.getBlitCommandsList().cmd);
-
-  CS_LOG_INFO("Created mipmap blit command buffer!");
-
   // Allocate command buffer for upload commands:
   VkCommandBufferAllocateInfo uploadAllocInfo = cassidy::init::commandBufferAllocInfo(
     m_uploadContext.uploadCommandPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1);
@@ -785,27 +1206,48 @@ void cassidy::Renderer::initSyncObjects()
   CS_LOG_INFO("Created synchronisation objects!");
 }
 
+void cassidy::Renderer::initGpuProfiler()
+{
+  QueueFamilyIndices indices = cassidy::helper::findQueueFamilies(m_physicalDevice, m_engineRef->getSurface());
+  m_gpuProfiler.init(m_device, m_physicalDevice, indices.graphicsFamily.value(), FRAMES_IN_FLIGHT);
+
+  m_deletionQueue.addFunction([=]() {
+    m_gpuProfiler.release();
+  });
+}
+
 void cassidy::Renderer::initDescriptorSets()
 {
   initUniformBuffers();
   
   CS_LOG_INFO("Building descriptor sets...");
-  constexpr uint32_t NUM_BINDINGS = 3;
-  VkDescriptorSetLayoutBinding bindings[NUM_BINDINGS];
-  for (uint32_t i = 0; i < 3; ++i)
+
+  // Layouts are reflected from the viewport shaders, so they can't drift out of sync with what the shaders declare.
+  // Only which buffers are bound with dynamic offsets, and the material textures' sampler, have to be given:
+  constexpr uint32_t NUM_MATERIAL_TEXTURES = 3;
+  cassidy::PipelineBuilder layoutBuilder(this);
+  layoutBuilder.addShaderStage(VK_SHADER_STAGE_VERTEX_BIT, "helloTriangleVert.spv")
+    .addShaderStage(VK_SHADER_STAGE_FRAGMENT_BIT, "phongLightingFrag.spv")
+    .overrideDescriptorType(1, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC);
+  for (uint32_t i = 0; i < NUM_MATERIAL_TEXTURES; ++i)
+    layoutBuilder.setImmutableSamplers(2, i, &cassidy::globals::m_linearTextureSampler);
+
+  m_perPassSetLayout = layoutBuilder.getReflectedSetLayout(0);
+  m_perObjectSetLayout = layoutBuilder.getReflectedSetLayout(1);
+  m_perMaterialSetLayout = layoutBuilder.getReflectedSetLayout(2);
+
+  // Material sets are allocated against a layout with the same sampler baked in, so a layout without it means the
+  // two have drifted apart and material sets won't be compatible with the viewport pipelines:
+  const cassidy::DescriptorLayoutCache::DescriptorLayoutInfo* perMaterialInfo =
+    cassidy::globals::g_descLayoutCache.getLayoutInfo(m_perMaterialSetLayout);
+  for (uint32_t i = 0; i < NUM_MATERIAL_TEXTURES; ++i)
   {
-    bindings[i] =
+    if (!perMaterialInfo || i >= perMaterialInfo->immutableSamplers.size() ||
+      perMaterialInfo->immutableSamplers[i] != std::vector<VkSampler>{ cassidy::globals::m_linearTextureSampler })
     {
-        .binding = i,
-        .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-        .descriptorCount = 1,
-        .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
-        .pImmutableSamplers = &cassidy::globals::m_linearTextureSampler,
-    };
-  };
-
-  VkDescriptorSetLayoutCreateInfo materialLayoutInfo = cassidy::init::descriptorSetLayoutCreateInfo(NUM_BINDINGS, bindings);
-  m_perMaterialSetLayout = cassidy::globals::g_descLayoutCache.createDescLayout(&materialLayoutInfo);
+      CS_LOG_ERROR("Per-material set layout binding {0} doesn't have the linear texture sampler baked in!", i);
+    }
+  }
 
   for (uint8_t i = 0; i < FRAMES_IN_FLIGHT; ++i)
   {
@@ -814,17 +1256,18 @@ void cassidy::Renderer::initDescriptorSets()
     VkDescriptorBufferInfo lightBufferInfo = cassidy::init::descriptorBufferInfo(
       m_frameData[i].perPassLightUniformBuffer.buffer, 0, sizeof(LightBufferData));
 
+    // Whole buffer rather than one PerObjectData, since instanced draws read an array of them from the dynamic offset:
     VkDescriptorBufferInfo perObjectBufferInfo = cassidy::init::descriptorBufferInfo(
-      m_perObjectUniformBufferDynamic.buffer, 0, sizeof(PerObjectData));
+      m_uniformAllocator.getBuffer(), 0, VK_WHOLE_SIZE);
 
     cassidy::DescriptorBuilder::begin(&cassidy::globals::g_descAllocator, &cassidy::globals::g_descLayoutCache)
       .bindBuffer(0, &matrixBufferInfo, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
       .bindBuffer(1, &lightBufferInfo, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
-      .build(m_frameData[i].perPassSet, m_perPassSetLayout);
+      .buildWithLayout(m_frameData[i].perPassSet, m_perPassSetLayout);
 
     cassidy::DescriptorBuilder::begin(&cassidy::globals::g_descAllocator, &cassidy::globals::g_descLayoutCache)
-      .bindBuffer(0, &perObjectBufferInfo, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT)
-      .build(m_frameData[i].perObjectSet, m_perObjectSetLayout);
+      .bindBuffer(0, &perObjectBufferInfo, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT)
+      .buildWithLayout(m_frameData[i].perObjectSet, m_perObjectSetLayout);
   }
 
   m_deletionQueue.addFunction([=]() {
@@ -834,12 +1277,12 @@ void cassidy::Renderer::initDescriptorSets()
   CS_LOG_INFO("Built descriptor sets!");
 }
 
-void cassidy::Renderer::initVertexBuffers()
+void cassidy::Renderer::initGeometryBuffers()
 {
-  CS_LOG_INFO("Creating vertex buffers...");
+  CS_LOG_INFO("Creating vertex and index buffers...");
   const VmaAllocator allocator = cassidy::globals::g_resourceManager.getVmaAllocator();
-  m_triangleMesh.allocateVertexBuffers(m_uploadContext.uploadCommandBuffer, allocator, this);
-  m_backpackMesh.allocateVertexBuffers(m_uploadContext.uploadCommandBuffer, allocator, this);
+  m_triangleMesh.allocateBuffers(m_uploadContext.uploadCommandBuffer, allocator, this);
+  m_backpackMesh.allocateBuffers(m_uploadContext.uploadCommandBuffer, allocator, this);
 
   m_deletionQueue.addFunction([=]() {
     const VmaAllocator allocator = cassidy::globals::g_resourceManager.getVmaAllocator();
@@ -848,38 +1291,31 @@ void cassidy::Renderer::initVertexBuffers()
     m_backpackMesh.release(m_device, allocator);
     });
 
-  CS_LOG_INFO("Created vertex buffers!");
-}
-
-void cassidy::Renderer::initIndexBuffers()
-{
-  CS_LOG_INFO("Creating index buffers...");
-  const VmaAllocator allocator = cassidy::globals::g_resourceManager.getVmaAllocator();
-  m_backpackMesh.allocateIndexBuffers(m_uploadContext.uploadCommandBuffer, allocator, this);
-  m_triangleMesh.allocateIndexBuffers(m_uploadContext.uploadCommandBuffer, allocator, this);
-  CS_LOG_INFO("Created index buffers!");
+  CS_LOG_INFO("Created vertex and index buffers!");
 }
 
 void cassidy::Renderer::initUniformBuffers()
 {
   CS_LOG_INFO("Allocating uniform buffers...");
-  const uint32_t objectBufferSize = FRAMES_IN_FLIGHT * cassidy::helper::padUniformBufferSize(sizeof(PerObjectData),
-    m_physicalDeviceProperties);
-  m_perObjectUniformBufferDynamic = allocateBuffer(objectBufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-    VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+  m_uniformAllocator.init(getVmaAllocator(), m_physicalDeviceProperties, UNIFORM_ALLOCATOR_FRAME_SIZE, FRAMES_IN_FLIGHT,
+    VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+
+  // Per-pass buffers are written every frame, so keep them mapped rather than mapping and unmapping each time:
+  constexpr VmaAllocationCreateFlags perPassAllocFlags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
+    VMA_ALLOCATION_CREATE_MAPPED_BIT;
 
   for (uint8_t i = 0; i < FRAMES_IN_FLIGHT; ++i)
   {
     m_frameData[i].perPassMatrixUniformBuffer = allocateBuffer(sizeof(MatrixBufferData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-      VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+      VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, perPassAllocFlags, &m_frameData[i].perPassMatrixMappedData);
 
     m_frameData[i].perPassLightUniformBuffer = allocateBuffer(sizeof(LightBufferData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-      VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+      VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, perPassAllocFlags, &m_frameData[i].perPassLightMappedData);
   }
 
   m_deletionQueue.addFunction([=]() {
     const VmaAllocator allocator = cassidy::globals::g_resourceManager.getVmaAllocator();
-    vmaDestroyBuffer(allocator, m_perObjectUniformBufferDynamic.buffer, m_perObjectUniformBufferDynamic.allocation);
+    m_uniformAllocator.release();
 
     for (uint8_t i = 0; i < FRAMES_IN_FLIGHT; ++i)
     {
@@ -962,17 +1398,32 @@ void cassidy::Renderer::initImGui()
   m_viewportSampler = cassidy::helper::createTextureSampler(m_device, m_physicalDeviceProperties,
     VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FALSE);
 
+  // Solution for full ImGui setup w/ viewport: https://github.com/ocornut/imgui/issues/5110
+
+  ImGui_ImplVulkan_DestroyFontUploadObjects();
+
+  m_deletionQueue.addFunction([&, imGuiPool]() {
+    vkDestroyDescriptorPool(m_device, imGuiPool, nullptr);
+    vkDestroySampler(m_device, m_viewportSampler, nullptr);
+
+    ImGui_ImplVulkan_Shutdown();
+    ImGui_ImplSDL2_Shutdown();
+    ImGui::DestroyContext();
+  });
+
+  CS_LOG_INFO("ImGui initialised!");
+}
+
+void cassidy::Renderer::initViewportResources()
+{
   initViewportCommandPool();
   initViewportCommandBuffers();
+  initViewportRecordingSlots();
   initViewportImages();
   initViewportRenderPass();
   initViewportFramebuffers();
 
-  // Solution for full ImGui setup w/ viewport: https://github.com/ocornut/imgui/issues/5110
-
-  ImGui_ImplVulkan_DestroyFontUploadObjects();
-
-  m_deletionQueue.addFunction([&, imGuiPool]() {
+  m_deletionQueue.addFunction([&]() {
     const VmaAllocator allocator = cassidy::globals::g_resourceManager.getVmaAllocator();
     
     for (auto fb : m_viewportFramebuffers)
@@ -990,23 +1441,19 @@ void cassidy::Renderer::initImGui()
     vkDestroyImageView(m_device, m_viewportDepthImage.view, nullptr);
 
     vkDestroyCommandPool(m_device, m_viewportCommandPool, nullptr);
+    for (const auto& frameSlots : m_viewportRecordingSlots)
+    {
+      for (const auto& slot : frameSlots)
+        vkDestroyCommandPool(m_device, slot.commandPool, nullptr);
+    }
     vkDestroyRenderPass(m_device, m_viewportRenderPass, nullptr);
-
-    vkDestroyDescriptorPool(m_device, imGuiPool, nullptr);
-    vkDestroySampler(m_device, m_viewportSampler, nullptr);
-
-    ImGui_ImplVulkan_Shutdown();
-    ImGui_ImplSDL2_Shutdown();
-    ImGui::DestroyContext();
   });
-
-  CS_LOG_INFO("ImGui initialised!");
 }
 
 void cassidy::Renderer::initViewportImages()
 {
   CS_LOG_INFO("Creating viewport image objects...");
-  m_viewportImages.resize(m_swapchain.images.size());
+  m_viewportImages.resize(getNumTargetImages());
   const VmaAllocator allocator = cassidy::globals::g_resourceManager.getVmaAllocator();
 
   for (size_t i = 0; i < m_viewportImages.size(); ++i)
@@ -1101,15 +1548,19 @@ void cassidy::Renderer::initViewportImages()
   
   VK_CHECK(vkCreateImageView(m_device, &depthViewInfo, nullptr, &m_viewportDepthImage.view));
 
-  m_viewportDescSets.resize(m_swapchain.images.size());
-  for (uint32_t i = 0; i < m_viewportDescSets.size(); ++i)
+  // Viewport images are only displayed through ImGui when there's an editor to show them in:
+  if (!m_isHeadless)
   {
-    m_viewportDescSets[i] = ImGui_ImplVulkan_AddTexture(m_viewportSampler,
-      m_viewportImages[i].view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    m_viewportDescSets.resize(m_swapchain.images.size());
+    for (uint32_t i = 0; i < m_viewportDescSets.size(); ++i)
+    {
+      m_viewportDescSets[i] = ImGui_ImplVulkan_AddTexture(m_viewportSampler,
+        m_viewportImages[i].view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
   }
   CS_LOG_INFO("Created viewport images!");
 
-  // (Deletion of viewport resources is handled in ImGui deletion queue function)
+  // (Deletion of viewport resources is handled in viewport resources deletion queue function)
 }
 
 void cassidy::Renderer::initViewportRenderPass()
@@ -1211,10 +1662,36 @@ void cassidy::Renderer::initViewportCommandBuffers()
   CS_LOG_INFO("Allocated {0} viewport commmand buffers!", m_viewportCommandBuffers.size());
 }
 
+void cassidy::Renderer::initViewportRecordingSlots()
+{
+  QueueFamilyIndices indices = cassidy::helper::findQueueFamilies(m_physicalDevice, m_engineRef->getSurface());
+
+  // One slot per job system worker, plus one for the main thread which helps record while it waits:
+  const uint32_t numSlots = m_engineRef->getJobSystem().getNumWorkers() + 1;
+
+  for (uint8_t frame = 0; frame < FRAMES_IN_FLIGHT; ++frame)
+  {
+    m_viewportRecordingSlots[frame].resize(numSlots);
+
+    for (auto& slot : m_viewportRecordingSlots[frame])
+    {
+      // Pools are reset as a whole each frame rather than resetting individual command buffers:
+      VkCommandPoolCreateInfo poolInfo = cassidy::init::commandPoolCreateInfo(VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+        indices.graphicsFamily.value());
+      VK_CHECK(vkCreateCommandPool(m_device, &poolInfo, nullptr, &slot.commandPool));
+
+      VkCommandBufferAllocateInfo allocInfo = cassidy::init::commandBufferAllocInfo(slot.commandPool,
+        VK_COMMAND_BUFFER_LEVEL_SECONDARY, 1);
+      VK_CHECK(vkAllocateCommandBuffers(m_device, &allocInfo, &slot.commandBuffer));
+    }
+  }
+  CS_LOG_INFO("Allocated {0} viewport recording slots per frame!", numSlots);
+}
+
 void cassidy::Renderer::initViewportFramebuffers()
 {
   CS_LOG_INFO("Creating viewport framebuffers...");
-  m_viewportFramebuffers.resize(m_swapchain.imageViews.size());
+  m_viewportFramebuffers.resize(getNumTargetImages());
 
   for (size_t i = 0; i < m_viewportFramebuffers.size(); ++i)
   {
@@ -1252,10 +1729,10 @@ void cassidy::Renderer::initPostProcessResources()
   for (size_t i = 0; i < NUM_DEFAULT_EFFECTS; ++i)
   {
     PostProcessResources res = {};
-    res.resultsImages.resize(m_swapchain.images.size());
-    res.descriptorSets.resize(m_swapchain.images.size());
+    res.resultsImages.resize(getNumTargetImages());
+    res.descriptorSets.resize(getNumTargetImages());
 
-    for (uint8_t j = 0; j < m_swapchain.images.size(); ++j)
+    for (uint8_t j = 0; j < getNumTargetImages(); ++j)
     {
       res.resultsImages[j] = createPostProcessImage();
 
@@ -1311,7 +1788,8 @@ AllocatedImage cassidy::Renderer::createPostProcessImage()
     .arrayLayers = 1,
     .samples = VK_SAMPLE_COUNT_1_BIT,
     .tiling = VK_IMAGE_TILING_OPTIMAL,
-    .usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
+    .usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT
+              | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,  // (final frame can be read back by captureViewport())
     .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
     .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
   };
@@ -1352,29 +1830,13 @@ AllocatedImage cassidy::Renderer::createPostProcessImage()
 
 void cassidy::Renderer::initPostProcessPipelines()
 {
-  constexpr DescriptorLayoutCache& cache = cassidy::globals::g_descLayoutCache;
-
-  VkDescriptorSetLayoutBinding resultsImageBinding = cassidy::init::descriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1,
-    VK_SHADER_STAGE_COMPUTE_BIT, &cassidy::globals::m_linearTextureSampler);
-  VkDescriptorSetLayoutBinding viewportImageBinding = cassidy::init::descriptorSetLayoutBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1,
-    VK_SHADER_STAGE_COMPUTE_BIT, &cassidy::globals::m_linearTextureSampler);
-
-  VkDescriptorSetLayoutBinding bindings[] = {
-    resultsImageBinding,
-    viewportImageBinding,
-  };
-
-  VkDescriptorSetLayoutCreateInfo layoutInfo = cassidy::init::descriptorSetLayoutCreateInfo(2, bindings);
-
-  VkDescriptorSetLayout gammaCorrectLayout = cache.createDescLayout(&layoutInfo);
-
   m_gammaCorrectPipeline.setDebugName("gammaCorrectPipeline");
 
   cassidy::PipelineBuilder pipelineBuilder(this);
 
   pipelineBuilder.addShaderStage(VK_SHADER_STAGE_COMPUTE_BIT, "gammaCorrectComp.spv")
-    .addDescriptorSetLayout(gammaCorrectLayout)
-    .buildComputePipeline(m_gammaCorrectPipeline);
+    .addReflectedLayouts()
+    .buildComputePipelineAsync(m_gammaCorrectPipeline);
 }
 
 void cassidy::Renderer::transitionSwapchainImages()
@@ -5,8 +5,11 @@
 #include <Core/Pipeline.h>
 #include <Core/Mesh.h>
 #include <Core/Texture.h>
-#include <Core/WorkerThread.h>
+#include <Core/JobSystem.h>
 #include <Core/PostProcessStack.h>
+#include <Core/GpuProfiler.h>
+#include <Core/ShaderHotReloader.h>
+#include <Utils/LinearUniformAllocator.h>
 
 #include <Vendor/imgui-docking/imgui.h>
 #include <Vendor/imgui-docking/imfilebrowser.h>
@@ -44,6 +47,13 @@ namespace cassidy
   };
 
   constexpr uint8_t FRAMES_IN_FLIGHT = 2;
+  constexpr VkDeviceSize STAGING_RING_SIZE = 64 * 1024 * 1024;
+  constexpr uint32_t UNIFORM_ALLOCATOR_FRAME_SIZE = 2 * 1024 * 1024;
+  constexpr uint32_t MIN_DRAWS_PER_RECORDING_BATCH = 32;  // (below this, recording on another thread isn't worth the overhead)
+  constexpr uint32_t GEOMETRY_POOL_VERTEX_CAPACITY = 4 * 1024 * 1024;   // (128 MB of vertex data)
+  constexpr uint32_t GEOMETRY_POOL_INDEX_CAPACITY = 16 * 1024 * 1024;   // (64 MB of index data)
+  constexpr VkFormat HEADLESS_TARGET_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;  // (storage-capable everywhere, and read back as-is)
+  constexpr const char* PIPELINE_CACHE_FILENAME = "pipelineCache.cspipelines";
 
   class Renderer
   {
@@ -55,6 +65,9 @@ namespace cassidy
     void rebuildSwapchain();
     void immediateSubmit(std::function<void(VkCommandBuffer cmd)>&& function);
 
+    // Wait for the device to finish, then read back the most recently drawn (post-processed) viewport image to a PNG:
+    bool captureViewport(const std::string& filepath);
+
     // Constant/static members and methods: ----------------------------------------------------------------------
     static inline std::vector<const char*> VALIDATION_LAYERS = {
       "VK_LAYER_KHRONOS_validation",
@@ -64,6 +77,10 @@ namespace cassidy
       VK_KHR_SWAPCHAIN_EXTENSION_NAME,
     };
 
+    // Upper bound on the bindless texture array, further limited by the device:
+    static constexpr uint32_t MAX_BINDLESS_TEXTURES = 4096;
+    static constexpr const char* BINDLESS_FRAGMENT_SHADER = "phongLightingBindlessFrag.spv";
+
     static inline std::vector<const char*> INSTANCE_EXTENSIONS = {
       VK_EXT_DEBUG_UTILS_EXTENSION_NAME,
     };
@@ -82,18 +99,32 @@ namespace cassidy
     inline VkDescriptorSet&           getViewportDescSet()      { return m_viewportDescSets[m_swapchainImageIndex]; }
     inline ImGui::FileBrowser&        getEditorFileBrowser()    { return m_editorFilebrowser; }
     inline cassidy::Engine*           getEngineRef()            { return m_engineRef; }
+    inline cassidy::GpuProfiler&      getGpuProfiler()          { return m_gpuProfiler; }
+    inline cassidy::ShaderHotReloader& getShaderHotReloader()   { return m_shaderHotReloader; }
+    inline float                      getGpuFrameTimeMs()       { return m_gpuProfiler.getFrameTimeMs(); }  // (from FRAMES_IN_FLIGHT frames ago)
+    inline bool                       supportsBlockCompression() const { return m_supportsBlockCompression; }
+    inline bool                       supportsBindless()        const { return m_supportsBindless; }
+    inline uint32_t                   getMaxBindlessTextures()  const { return m_maxBindlessTextures; }
 
   private:
     void updateBuffers(const FrameData& currentFrameData);
+    void updatePerObjectBuffers();
+    void updateTextureStreaming(const glm::mat4& proj);
+    void growUniformAllocator(uint32_t requiredBytesPerFrame);
     void recordViewportCommands(uint32_t imageIndex); // Record model rendering and post processing commands
+    void recordViewportDraws(VkCommandBuffer cmd, const VkExtent2D& extent, uint32_t firstDraw, uint32_t lastDraw);
     void recordEditorCommands(uint32_t imageIndex);   // Record ImGui and swapchain blit commands
     void submitCommandBuffers(uint32_t imageIndex);
 
     AllocatedBuffer allocateVertexBuffer(const std::vector<Vertex>& vertices);
-    AllocatedBuffer allocateBuffer(uint32_t allocSize, VkBufferUsageFlags usageFlags, VmaMemoryUsage memoryUsage, VmaAllocationCreateFlagBits allocFlags);
+    AllocatedBuffer allocateBuffer(uint32_t allocSize, VkBufferUsageFlags usageFlags, VmaMemoryUsage memoryUsage, VmaAllocationCreateFlags allocFlags,
+      void** outMappedData = nullptr);
 
     void initLogicalDevice();
+    // Check descriptor indexing support, adding the extension if needed, and return the features to enable:
+    VkPhysicalDeviceDescriptorIndexingFeatures initBindlessSupport(std::vector<const char*>& deviceExtensions);
     void initSwapchain();
+    void initHeadlessTarget();
 
     void initResourceManager();
 
@@ -106,18 +137,20 @@ namespace cassidy
     void initCommandPool();
     void initCommandBuffers();
     void initSyncObjects();
+    void initGpuProfiler();
 
     void initDescriptorSets();
 
-    void initVertexBuffers();
-    void initIndexBuffers();
+    void initGeometryBuffers();
     void initUniformBuffers();
 
     void initImGui();
+    void initViewportResources();
     void initViewportImages();
     void initViewportRenderPass();
     void initViewportCommandPool();
     void initViewportCommandBuffers();
+    void initViewportRecordingSlots();
     void initViewportFramebuffers();
 
     void initPostProcessResources();
@@ -133,6 +166,9 @@ namespace cassidy
     inline uint32_t getCurrentFrameIndex() { return m_currentFrameIndex; }
     inline uint32_t getCurrentSwapchainImageIndex() { return m_swapchainImageIndex; }
 
+    // Viewport and post process images are duplicated per swapchain image, or per frame in flight when headless:
+    inline uint32_t getNumTargetImages() { return m_isHeadless ? FRAMES_IN_FLIGHT : static_cast<uint32_t>(m_swapchain.images.size()); }
+
     cassidy::Engine* m_engineRef;
 
     // Essential objects:
@@ -149,10 +185,27 @@ namespace cassidy
 
     // Rendering data (buffers and descriptor sets):
     FrameData m_frameData[FRAMES_IN_FLIGHT];
-    AllocatedBuffer m_perObjectUniformBufferDynamic;
+    cassidy::LinearUniformAllocator m_uniformAllocator;  // (per-draw data, bound through the dynamic per-object set)
+
+    // Models to draw this frame, each with the dynamic offset of its instances' per-object data:
+    struct InstanceDraw
+    {
+      cassidy::Model* model;
+      uint32_t perObjectOffset;
+      uint32_t instanceCount;
+    };
+    std::vector<InstanceDraw> m_instanceDraws;
+
+    // Placements of one model this frame (the model is looked up from its handle once per frame):
+    struct InstanceGroup
+    {
+      cassidy::Model* model = nullptr;
+      std::vector<PerObjectData> instances;
+    };
+    std::unordered_map<cassidy::ModelHandle, InstanceGroup, cassidy::ResourceHandleHash> m_instanceGroups;
 
     // Meshes:
-    Model* m_currentModel = nullptr;
+    cassidy::ModelHandle m_currentModel;  // (the renderer holds a reference to the previewed model)
     Model m_triangleMesh;
     Model m_backpackMesh;
 
@@ -206,15 +259,34 @@ namespace cassidy
     VkCommandPool                 m_viewportCommandPool;
     std::vector<VkFramebuffer>    m_viewportFramebuffers;
     std::vector<VkCommandBuffer>  m_viewportCommandBuffers;
+
+    // Viewport draws are split into batches recorded in parallel into secondary command buffers. Each batch slot has
+    // its own pool per frame in flight, since a pool can only be used by one thread at a time:
+    struct RecordingSlot
+    {
+      VkCommandPool commandPool;
+      VkCommandBuffer commandBuffer;
+    };
+    std::vector<RecordingSlot>    m_viewportRecordingSlots[FRAMES_IN_FLIGHT];
     std::vector<VkDescriptorSet>  m_viewportDescSets;
 
     PostProcessStack m_postProcessStack;
 
+    // Per-pass GPU timings, read back once each frame's fence has signalled:
+    cassidy::GpuProfiler m_gpuProfiler;
+
+    // Recompiles pipelines whose shaders change on disk (editor only):
+    cassidy::ShaderHotReloader m_shaderHotReloader;
+
     // Misc.:
     DeletionQueue m_deletionQueue;
     uint32_t m_currentFrameIndex;
     uint32_t m_swapchainImageIndex;
     uint64_t m_currentFrame;
+    bool m_isHeadless = false;  // (no surface, swapchain or editor GUI, frames are only drawn into the viewport images)
+    bool m_supportsBlockCompression = false;  // (textureCompressionBC device feature)
+    bool m_supportsBindless = false;          // (descriptor indexing features, plus the bindless fragment shader)
+    uint32_t m_maxBindlessTextures = 0;
     VkPhysicalDeviceProperties m_physicalDeviceProperties;
   };
 }
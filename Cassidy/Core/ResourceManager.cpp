@@ -4,14 +4,32 @@
 #include <Core/Logger.h>
 #include <Utils/DescriptorBuilder.h>
 
+#include <algorithm>
+
 void cassidy::ResourceManager::init(cassidy::Renderer* rendererRef, cassidy::Engine* engineRef)
 {
 	m_rendererRef = rendererRef;
 	initVmaAllocator(engineRef);
 
+	// Staging ring has to exist before any textures (including fallbacks) are uploaded:
+	rendererRef->getUploadContext().stagingRing.init(rendererRef->getLogicalDevice(), m_allocator, STAGING_RING_SIZE);
+	geometryPool.init(rendererRef->getLogicalDevice(), m_allocator, rendererRef->getUploadContext(),
+		GEOMETRY_POOL_VERTEX_CAPACITY, GEOMETRY_POOL_INDEX_CAPACITY);
+
 	cassidy::globals::g_descAllocator.init(rendererRef->getLogicalDevice());
 	cassidy::globals::g_descLayoutCache.init(rendererRef->getLogicalDevice());
 
+	// Kept next to the shaders it's built from, and only reused by the same device and driver that saved it:
+	pipelineRegistry.init(rendererRef->getLogicalDevice(), rendererRef->getPhysDeviceProperties(),
+		std::string(SHADER_ABS_FILEPATH) + PIPELINE_CACHE_FILENAME, &engineRef->getJobSystem());
+
+	// Texture library registers its fallback textures, so bindless tables have to exist first:
+	if (rendererRef->supportsBindless())
+	{
+		bindless.init(rendererRef->getLogicalDevice(), m_allocator, rendererRef->getPhysDeviceProperties(),
+			rendererRef->getMaxBindlessTextures());
+	}
+
 	textureLibrary.init(&m_allocator, rendererRef);
 	materialLibrary.createErrorMaterial();
 
@@ -21,13 +39,51 @@ void cassidy::ResourceManager::init(cassidy::Renderer* rendererRef, cassidy::Eng
 void cassidy::ResourceManager::release(VkDevice device)
 {
 	CS_LOG_INFO("Releasing resource manager...");
+
+	// Device is idle by now, so every queued deletion can run straight away (running them can queue more):
+	while (!m_deferredDeletions.empty())
+		collectGarbage(UINT64_MAX);
+
 	materialLibrary.releaseAll();
 	textureLibrary.releaseAll(device, m_allocator);
-	modelManager.releaseAll(device, m_allocator);
+	modelManager.releaseAll(device, m_allocator, m_rendererRef->getUploadContext());
+	bindless.release();
+	pipelineRegistry.release();
 
+	geometryPool.release();
+	m_rendererRef->getUploadContext().stagingRing.release();
 	vmaDestroyAllocator(m_allocator);
 }
 
+void cassidy::ResourceManager::deferDeletion(std::function<void()>&& deleter)
+{
+	std::lock_guard<std::mutex> deletionLock(m_deferredDeletionsMutex);
+	m_deferredDeletions.push_back({ std::move(deleter), m_currentFrame });
+}
+
+void cassidy::ResourceManager::collectGarbage(uint64_t currentFrame)
+{
+	if (currentFrame != UINT64_MAX)
+		m_currentFrame = currentFrame;
+
+	// Take the ready deletions out of the queue before running any, since deleters may queue more:
+	std::vector<DeferredDeletion> readyDeletions;
+	{
+		std::lock_guard<std::mutex> deletionLock(m_deferredDeletionsMutex);
+		auto readyIt = std::stable_partition(m_deferredDeletions.begin(), m_deferredDeletions.end(), [currentFrame](const DeferredDeletion& deletion) {
+			return deletion.queuedFrame + FRAMES_IN_FLIGHT > currentFrame;
+			});
+
+		readyDeletions.assign(std::make_move_iterator(readyIt), std::make_move_iterator(m_deferredDeletions.end()));
+		m_deferredDeletions.erase(readyIt, m_deferredDeletions.end());
+	}
+
+	for (DeferredDeletion& deletion : readyDeletions)
+	{
+		deletion.deleter();
+	}
+}
+
 void cassidy::ResourceManager::initVmaAllocator(cassidy::Engine* engineRef)
 {
 	VmaAllocatorCreateInfo info = {};
@@ -2,6 +2,13 @@
 #include <Core/MaterialLibrary.h>
 #include <Core/TextureLibrary.h>
 #include <Core/ModelManager.h>
+#include <Core/GeometryPool.h>
+#include <Core/BindlessResources.h>
+#include <Core/PipelineRegistry.h>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <vector>
 
 namespace cassidy
 {
@@ -14,17 +21,38 @@ namespace cassidy
 		void init(cassidy::Renderer* rendererRef, cassidy::Engine* engineRef);
 		void release(VkDevice device);
 
+		// Queue a resource's destruction for once every frame in flight that could be using it has finished. Thread-safe,
+		// deleters run on the main thread (and may queue further deletions):
+		void deferDeletion(std::function<void()>&& deleter);
+
+		// Run deleters queued at least FRAMES_IN_FLIGHT frames ago. Called once per frame, after waiting on the frame's fence:
+		void collectGarbage(uint64_t currentFrame);
+
 		inline VmaAllocator getVmaAllocator() { return m_allocator; }
+		inline uint64_t getCurrentFrame() const { return m_currentFrame; }
 
 		TextureLibrary textureLibrary;
 		MaterialLibrary materialLibrary;
 		ModelManager modelManager;
+		GeometryPool geometryPool;
+		PipelineRegistry pipelineRegistry;
+		BindlessResources bindless;	// (only enabled if the renderer supports descriptor indexing)
 
 	private:
+		struct DeferredDeletion
+		{
+			std::function<void()> deleter;
+			uint64_t queuedFrame;
+		};
+
 		void initVmaAllocator(cassidy::Engine* engineRef);
 
 		VmaAllocator m_allocator;
 		cassidy::Renderer* m_rendererRef;
+
+		std::vector<DeferredDeletion> m_deferredDeletions;
+		std::mutex m_deferredDeletionsMutex;
+		std::atomic<uint64_t> m_currentFrame = 0;
 	};
 
 	namespace globals
@@ -0,0 +1,54 @@
+#include "Scene.h"
+#include <Core/ResourceManager.h>
+
+glm::mat4 cassidy::SceneInstance::getWorldMatrix() const
+{
+  glm::mat4 world = glm::translate(glm::mat4(1.0f), position);
+  world = glm::rotate(world, glm::radians(rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
+  world = glm::rotate(world, glm::radians(rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
+  world = glm::rotate(world, glm::radians(rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
+  return glm::scale(world, scale);
+}
+
+uint32_t cassidy::Scene::addInstance(cassidy::ModelHandle model, const glm::vec3& position)
+{
+  cassidy::globals::g_resourceManager.modelManager.addRef(model);
+
+  SceneInstance newInstance;
+  newInstance.model = model;
+  newInstance.position = position;
+
+  m_instances.push_back(newInstance);
+  return static_cast<uint32_t>(m_instances.size() - 1);
+}
+
+void cassidy::Scene::addInstanceGrid(cassidy::ModelHandle model, uint32_t gridSize, float spacing)
+{
+  const float halfExtent = (gridSize - 1) * spacing * 0.5f;
+  m_instances.reserve(m_instances.size() + gridSize * gridSize);
+
+  for (uint32_t z = 0; z < gridSize; ++z)
+  {
+    for (uint32_t x = 0; x < gridSize; ++x)
+    {
+      addInstance(model, glm::vec3(x * spacing - halfExtent, 0.0f, z * spacing - halfExtent));
+    }
+  }
+}
+
+void cassidy::Scene::removeInstance(uint32_t index)
+{
+  if (index >= m_instances.size()) return;
+
+  cassidy::globals::g_resourceManager.modelManager.releaseModel(m_instances[index].model);
+  m_instances.erase(m_instances.begin() + index);
+}
+
+void cassidy::Scene::clear()
+{
+  for (const SceneInstance& instance : m_instances)
+  {
+    cassidy::globals::g_resourceManager.modelManager.releaseModel(instance.model);
+  }
+  m_instances.clear();
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <Utils/Types.h>
+#include <Utils/ResourcePool.h>
+#include <vector>
+
+namespace cassidy
+{
+  // A model placed in the scene, drawn with its own per-object uniform data. Each instance holds a reference to its
+  // model, so the model stays loaded while it's in the scene:
+  struct SceneInstance
+  {
+    cassidy::ModelHandle model;
+    glm::vec3 position  = glm::vec3(0.0f);
+    glm::vec3 rotation  = glm::vec3(0.0f);  // (Pitch, Yaw, Roll), in degrees
+    glm::vec3 scale     = glm::vec3(1.0f);
+
+    glm::mat4 getWorldMatrix() const;
+  };
+
+  class Scene
+  {
+  public:
+    uint32_t addInstance(cassidy::ModelHandle model, const glm::vec3& position = glm::vec3(0.0f));
+
+    // Place a square grid of instances centred on the origin, e.g. for stress testing many draws:
+    void addInstanceGrid(cassidy::ModelHandle model, uint32_t gridSize, float spacing);
+
+    void removeInstance(uint32_t index);
+    void clear();
+
+    // Getters/setters: ------------------------------------------------------------------------------------------
+    inline std::vector<SceneInstance>&        getInstances()          { return m_instances; }
+    inline const std::vector<SceneInstance>&  getInstances()    const { return m_instances; }
+    inline uint32_t                           getNumInstances() const { return static_cast<uint32_t>(m_instances.size()); }
+
+  private:
+    std::vector<SceneInstance> m_instances;
+  };
+}
@@ -0,0 +1,281 @@
+#include "ShaderHotReloader.h"
+#include <Core/ResourceManager.h>
+#include <Core/CpuProfiler.h>
+#include <Core/Logger.h>
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iterator>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#ifdef CS_SHADERC_AVAILABLE
+#include <shaderc/shaderc.hpp>
+#endif
+
+namespace
+{
+#ifdef CS_SHADERC_AVAILABLE
+  // Named the way CompileShaders.bat names them, e.g. "phongLighting.frag" -> "phongLightingFrag.spv":
+  std::string getSpirvFilename(const std::filesystem::path& sourcePath)
+  {
+    std::string stageName = sourcePath.extension().string().substr(1);
+    stageName[0] = static_cast<char>(std::toupper(stageName[0]));
+    return sourcePath.stem().string() + stageName + ".spv";
+  }
+
+  bool compileGlsl(const std::string& filepath, std::vector<uint32_t>& outSpirv)
+  {
+    const std::string extension = std::filesystem::path(filepath).extension().string();
+    const shaderc_shader_kind shaderKind =
+      extension == ".vert" ? shaderc_vertex_shader :
+      extension == ".frag" ? shaderc_fragment_shader :
+      shaderc_compute_shader;
+
+    std::ifstream file(filepath, std::ios::binary);
+    if (!file.is_open())
+    {
+      CS_LOG_ERROR("Could not open shader source! ({0})", filepath);
+      return false;
+    }
+    const std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    // (a compiler per compile, so several shaders can be compiled at once on different workers)
+    shaderc::Compiler compiler;
+    shaderc::CompileOptions options;
+    options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_3);
+
+    const shaderc::SpvCompilationResult result = compiler.CompileGlslToSpv(source, shaderKind, filepath.c_str(), options);
+    if (result.GetCompilationStatus() != shaderc_compilation_status_success)
+    {
+      CS_LOG_ERROR("Failed to compile shader {0}:\n{1}", filepath, result.GetErrorMessage());
+      return false;
+    }
+
+    outSpirv.assign(result.cbegin(), result.cend());
+    return true;
+  }
+#else
+  // (read rather than mapped, as whatever wrote the file may still be rewriting it, and truncating a mapped file
+  // faults any read of the truncated pages)
+  bool readSpirv(const std::string& filepath, std::vector<uint32_t>& outSpirv)
+  {
+    std::ifstream file(filepath, std::ios::ate | std::ios::binary);
+    if (!file.is_open())
+    {
+      CS_LOG_ERROR("Could not load SPIR-V file! ({0})", filepath);
+      return false;
+    }
+
+    const size_t fileSize = static_cast<size_t>(file.tellg());
+    outSpirv.resize(fileSize / sizeof(uint32_t));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(outSpirv.data()), outSpirv.size() * sizeof(uint32_t));
+    return file.good();
+  }
+#endif
+}
+
+void cassidy::ShaderHotReloader::init(const std::string& shaderDirectory, cassidy::JobSystem* jobSystemRef)
+{
+  m_shaderDirectory = shaderDirectory;
+  m_jobSystemRef = jobSystemRef;
+
+#ifdef __linux__
+  // Editors either rewrite files in place (close after write) or write a temporary file and rename it over the original
+  // (moved to), so both are watched for:
+  m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (m_inotifyFd < 0 || inotify_add_watch(m_inotifyFd, m_shaderDirectory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+  {
+    CS_LOG_WARN("Couldn't watch shader directory {0}, shader hot-reload is disabled", m_shaderDirectory);
+    release();
+    return;
+  }
+#else
+  // Record current timestamps, so only files changed from here on are reloaded:
+  pollChangedFiles();
+#endif
+
+  m_isWatching = true;
+#ifdef CS_SHADERC_AVAILABLE
+  CS_LOG_INFO("Watching {0} for shader source changes", m_shaderDirectory);
+#else
+  CS_LOG_INFO("Watching {0} for SPIR-V changes (built without shaderc, so sources must be compiled by hand)", m_shaderDirectory);
+#endif
+}
+
+void cassidy::ShaderHotReloader::release()
+{
+#ifdef __linux__
+  // (closing the descriptor removes its watch too)
+  if (m_inotifyFd >= 0)
+    close(m_inotifyFd);
+  m_inotifyFd = -1;
+#else
+  m_lastWriteTimes.clear();
+#endif
+
+  m_reloadJobs.clear();
+  m_deferredReloads.clear();
+  m_isWatching = false;
+}
+
+void cassidy::ShaderHotReloader::update()
+{
+  CS_PROFILE_SCOPE("ShaderHotReloader::update");
+
+  if (m_isWatching)
+  {
+    std::vector<std::string> changedFiles = pollChangedFiles();
+    changedFiles.insert(changedFiles.end(), m_deferredReloads.begin(), m_deferredReloads.end());
+    m_deferredReloads.clear();
+
+    // (one save can raise several events for the same file)
+    std::sort(changedFiles.begin(), changedFiles.end());
+    changedFiles.erase(std::unique(changedFiles.begin(), changedFiles.end()), changedFiles.end());
+
+    for (const std::string& filename : changedFiles)
+    {
+      if (!isReloadableFile(filename)) continue;
+
+      // Reloads of the same shader can't overlap, or an older compile could finish last and win:
+      const auto jobIt = m_reloadJobs.find(filename);
+      if (jobIt != m_reloadJobs.end() && !jobIt->second.isDone())
+      {
+        m_deferredReloads.push_back(filename);
+        continue;
+      }
+
+      reloadShader(filename);
+    }
+  }
+
+  cassidy::globals::g_resourceManager.pipelineRegistry.swapReloadedPipelines();
+}
+
+void cassidy::ShaderHotReloader::waitForReloads()
+{
+  for (const auto& [filename, reloadJob] : m_reloadJobs)
+  {
+    m_jobSystemRef->wait(reloadJob);
+  }
+}
+
+std::vector<std::string> cassidy::ShaderHotReloader::pollChangedFiles()
+{
+  std::vector<std::string> changedFiles;
+
+#ifdef __linux__
+  alignas(inotify_event) char eventBuffer[4096];
+  while (true)
+  {
+    // (non-blocking, so fails with EAGAIN once every queued event has been read)
+    const ssize_t numBytesRead = read(m_inotifyFd, eventBuffer, sizeof(eventBuffer));
+    if (numBytesRead <= 0) break;
+
+    for (ssize_t offset = 0; offset < numBytesRead;)
+    {
+      const inotify_event* event = reinterpret_cast<const inotify_event*>(eventBuffer + offset);
+      if (event->len > 0)
+        changedFiles.emplace_back(event->name);
+      offset += sizeof(inotify_event) + event->len;
+    }
+  }
+#else
+  const auto currentTime = std::chrono::steady_clock::now();
+  if (m_isWatching && currentTime - m_lastPollTime < std::chrono::duration<float>(SHADER_POLL_INTERVAL_SECS))
+    return changedFiles;
+  m_lastPollTime = currentTime;
+
+  std::error_code error;
+  for (const auto& entry : std::filesystem::directory_iterator(m_shaderDirectory, error))
+  {
+    if (!entry.is_regular_file(error)) continue;
+
+    const std::string filename = entry.path().filename().string();
+    const std::filesystem::file_time_type writeTime = entry.last_write_time(error);
+    if (error) continue;
+
+    const auto [timeIt, wasInserted] = m_lastWriteTimes.try_emplace(filename, writeTime);
+    if (!wasInserted && timeIt->second != writeTime)
+    {
+      timeIt->second = writeTime;
+      changedFiles.push_back(filename);
+    }
+  }
+#endif
+
+  return changedFiles;
+}
+
+void cassidy::ShaderHotReloader::reloadShader(const std::string& filename)
+{
+  CS_LOG_INFO("Shader {0} changed, reloading...", filename);
+
+  m_reloadJobs[filename] = m_jobSystemRef->pushJobLowPrio([this, filename]() {
+    CS_PROFILE_SCOPE("ShaderHotReloader::reloadShader");
+
+    const std::string filepath = m_shaderDirectory + filename;
+    std::vector<uint32_t> spirv;
+
+#ifdef CS_SHADERC_AVAILABLE
+    const std::string spirvFilename = getSpirvFilename(filename);
+    if (!compileGlsl(filepath, spirv))
+    {
+      ++m_numFailedReloads;
+      return;
+    }
+
+    // Write the new SPIR-V out too, so it's what gets loaded next time the engine starts. It's written to a temporary
+    // file and renamed over the old one, as truncating the file in place would break any mapping of it still open:
+    const std::string spirvPath = m_shaderDirectory + spirvFilename;
+    const std::string tempPath = spirvPath + ".tmp";
+    bool wasWritten;
+    {
+      std::ofstream spirvFile(tempPath, std::ios::binary | std::ios::trunc);
+      spirvFile.write(reinterpret_cast<const char*>(spirv.data()), spirv.size() * sizeof(uint32_t));
+      wasWritten = spirvFile.good();
+    }
+
+    std::error_code error;
+    if (wasWritten)
+      std::filesystem::rename(tempPath, spirvPath, error);
+    if (!wasWritten || error)
+    {
+      CS_LOG_WARN("Failed to write compiled shader {0}!", spirvFilename);
+      std::filesystem::remove(tempPath, error);
+    }
+#else
+    const std::string& spirvFilename = filename;
+    if (!readSpirv(filepath, spirv))
+    {
+      ++m_numFailedReloads;
+      return;
+    }
+#endif
+
+    uint32_t numPipelines;
+    if (!cassidy::globals::g_resourceManager.pipelineRegistry.reloadShader(spirvFilename, spirv, numPipelines))
+    {
+      ++m_numFailedReloads;
+      return;
+    }
+
+    ++m_numShadersReloaded;
+    CS_LOG_INFO("Reloaded shader {0}, recompiling {1} pipelines", spirvFilename, numPipelines);
+    });
+}
+
+bool cassidy::ShaderHotReloader::isReloadableFile(const std::string& filename)
+{
+  const std::string extension = std::filesystem::path(filename).extension().string();
+#ifdef CS_SHADERC_AVAILABLE
+  return extension == ".vert" || extension == ".frag" || extension == ".comp";
+#else
+  return extension == ".spv";
+#endif
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <Core/JobSystem.h>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace cassidy
+{
+  constexpr float SHADER_POLL_INTERVAL_SECS = 0.5f;   // (only used where file changes are polled for, not watched)
+
+  // Watches the shader directory, and when a shader changes has the pipeline registry recompile every pipeline built
+  // from it in the background. Recompiled pipelines are swapped in between frames, so shaders can be iterated on
+  // without restarting.
+  //
+  // If the build found shaderc (CS_SHADERC_AVAILABLE), changed GLSL sources are compiled in-process on the job system
+  // and their .spv written next to them, named as CompileShaders.bat names them. Otherwise changed .spv files are
+  // reloaded instead, so recompiling shaders by hand still takes effect straight away. Changes are watched for with
+  // inotify on Linux, and polled for by timestamp elsewhere.
+  //
+  // Only a shader's code can change while running, not its interface. Layouts aren't re-reflected on reload, so a
+  // change to the descriptor bindings or push constants a shader declares is rejected (and counted as a failed
+  // reload) rather than swapped in under pipeline layouts and descriptor sets built for the old ones. Its compiled
+  // .spv is still written out, so restarting picks it up.
+  class ShaderHotReloader
+  {
+  public:
+    void init(const std::string& shaderDirectory, cassidy::JobSystem* jobSystemRef);
+    void release();
+
+    // Start reloading shaders changed since the last update, and swap in pipelines that have finished recompiling.
+    // Called once per frame, between frames:
+    void update();
+
+    // Block until every shader being reloaded has been compiled (pipeline recompiles are waited on by the registry):
+    void waitForReloads();
+
+    // Getters/setters: ------------------------------------------------------------------------------------------
+    inline bool       isWatching()              const { return m_isWatching; }
+    inline uint32_t   getNumShadersReloaded()   const { return m_numShadersReloaded; }
+    inline uint32_t   getNumFailedReloads()     const { return m_numFailedReloads; }
+
+  private:
+    // Filenames (relative to the shader directory) of files written since the last poll:
+    std::vector<std::string> pollChangedFiles();
+    void reloadShader(const std::string& filename);
+
+    static bool isReloadableFile(const std::string& filename);
+
+    std::string m_shaderDirectory;
+    cassidy::JobSystem* m_jobSystemRef = nullptr;
+    bool m_isWatching = false;
+
+    std::unordered_map<std::string, cassidy::JobHandle> m_reloadJobs;   // (by filename, only one reload of a shader runs at once)
+    std::vector<std::string> m_deferredReloads;                         // (changed again while being reloaded)
+
+#ifdef __linux__
+    int m_inotifyFd = -1;
+#else
+    std::unordered_map<std::string, std::filesystem::file_time_type> m_lastWriteTimes;
+    std::chrono::steady_clock::time_point m_lastPollTime;
+#endif
+
+    std::atomic<uint32_t> m_numShadersReloaded = 0;
+    std::atomic<uint32_t> m_numFailedReloads = 0;
+  };
+}
@@ -3,13 +3,97 @@
 #include <Utils/Initialisers.h>
 #include <Utils/Helpers.h>
 #include <Core/Renderer.h>
+#include <Core/CpuProfiler.h>
+#include <Core/Logger.h>
+#include <Utils/BlockCompression.h>
+#include <Utils/TextureContainer.h>
+#include <Utils/FileMapping.h>
+
+#include <filesystem>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <Vendor/stb/stb_image.h>
 
+namespace
+{
+  // Copy offsets into staging memory must be multiples of the texel block size and 4, BC blocks are at most 16 bytes:
+  constexpr VkDeviceSize STAGING_LEVEL_ALIGNMENT = 16;
+
+  bool isNewerOrSameAge(const std::string& filepath, const std::string& otherFilepath)
+  {
+    std::error_code errorCode;
+    const auto writeTime = std::filesystem::last_write_time(filepath, errorCode);
+    if (errorCode) return false;
+
+    const auto otherWriteTime = std::filesystem::last_write_time(otherFilepath, errorCode);
+    return errorCode || writeTime >= otherWriteTime;
+  }
+
+  bool isSrgbFormat(VkFormat format)
+  {
+    return format == VK_FORMAT_R8_SRGB || format == VK_FORMAT_R8G8B8A8_SRGB;
+  }
+}
+
 cassidy::Texture* cassidy::Texture::load(std::string filepath, VmaAllocator allocator, cassidy::Renderer* rendererRef, 
   VkFormat format, VkBool32 shouldGenMipmaps)
 {
+  CS_PROFILE_SCOPE("Texture::load");
+
+  DecodedImage decodedImage;
+  if (!decode(filepath, format, rendererRef->supportsBlockCompression(), decodedImage))
+  {
+    m_loadResult = LoadResult::NOT_FOUND;
+    return nullptr;
+  }
+
+  if (shouldGenMipmaps == VK_TRUE)
+    generateMipChain(decodedImage);
+
+  upload(decodedImage, allocator, rendererRef);
+  freeDecoded(decodedImage);
+
+  m_loadResult = LoadResult::SUCCESS;
+  return this;
+}
+
+bool cassidy::Texture::decode(const std::string& filepath, VkFormat format, bool supportsBlockCompression, DecodedImage& outImage)
+{
+  CS_PROFILE_SCOPE("Texture::decode");
+
+  // Prefer a pre-built (usually block-compressed, with its whole mip chain) version of the image, as long as it
+  // isn't older than its source. Containers can also be requested directly:
+  std::string containerPath;
+  if (cassidy::helper::isTextureContainerPath(filepath))
+    containerPath = filepath;
+  else if (const std::string compressedPath = getCompressedPath(filepath); isNewerOrSameAge(compressedPath, filepath))
+    containerPath = compressedPath;
+
+  if (!containerPath.empty())
+  {
+    cassidy::helper::ContainerImage containerImage;
+    if (cassidy::helper::readTextureContainer(containerPath, isSrgbFormat(format), containerImage))
+    {
+      if (supportsBlockCompression || !cassidy::helper::isBlockCompressed(containerImage.format))
+      {
+        outImage.containerData = std::move(containerImage.data);
+        outImage.pixels = outImage.containerData.data();
+        outImage.size = outImage.containerData.size();
+        outImage.extent = containerImage.extent;
+        outImage.format = containerImage.format;
+        outImage.levelOffsets = std::move(containerImage.levelOffsets);
+        return true;
+      }
+    }
+    else
+    {
+      CS_LOG_WARN("Failed to read texture container {0}, falling back to its source image", containerPath);
+    }
+
+    if (containerPath == filepath)
+      return false;
+  }
+
   int texWidth, texHeight, numChannels;
 
   int requiredComponents = 0;
@@ -25,64 +109,154 @@ cassidy::Texture* cassidy::Texture::load(std::string filepath, VmaAllocator allo
     requiredComponents = STBI_rgb_alpha;
   }
 
-  stbi_uc* data = stbi_load(filepath.c_str(), &texWidth, &texHeight, &numChannels, requiredComponents);
+  // Decode straight from a mapping of the file, rather than having stb read it through stdio:
+  cassidy::MappedFile file;
+  if (!file.open(filepath))
+    return false;
+
+  const std::span<const uint8_t> fileData = file.getData();
+  stbi_uc* data = stbi_load_from_memory(fileData.data(), static_cast<int>(fileData.size()), &texWidth, &texHeight,
+    &numChannels, requiredComponents);
 
   if (!data)
+    return false;
+
+  const int bytesPerPixel = requiredComponents != 0 ? requiredComponents : numChannels;
+
+  outImage.pixels = data;
+  outImage.size = static_cast<size_t>(texWidth) * texHeight * bytesPerPixel;
+  outImage.extent = {
+    static_cast<uint32_t>(texWidth),
+    static_cast<uint32_t>(texHeight)
+  };
+  outImage.format = format;
+  return true;
+}
+
+void cassidy::Texture::freeDecoded(DecodedImage& image)
+{
+  if (image.containerData.empty())
+    stbi_image_free(image.pixels);
+  image = {};
+}
+
+size_t cassidy::Texture::DecodedImage::getLevelSize(uint32_t level) const
+{
+  if (levelOffsets.empty()) return size;
+
+  const VkDeviceSize levelEnd = level + 1 < levelOffsets.size() ? levelOffsets[level + 1] : size;
+  return static_cast<size_t>(levelEnd - levelOffsets[level]);
+}
+
+VkDeviceSize cassidy::Texture::getStagingSize(const DecodedImage& image, uint32_t firstLevel)
+{
+  VkDeviceSize stagingSize = 0;
+  for (uint32_t level = firstLevel; level < image.getNumLevels(); ++level)
+    stagingSize += (image.getLevelSize(level) + STAGING_LEVEL_ALIGNMENT - 1) & ~(STAGING_LEVEL_ALIGNMENT - 1);
+
+  return stagingSize;
+}
+
+void cassidy::Texture::copyToStaging(const DecodedImage& image, uint8_t* stagingData, std::vector<VkDeviceSize>& outLevelOffsets,
+  uint32_t firstLevel)
+{
+  outLevelOffsets.clear();
+
+  VkDeviceSize stagingOffset = 0;
+  for (uint32_t level = firstLevel; level < image.getNumLevels(); ++level)
   {
-    m_loadResult = LoadResult::NOT_FOUND;
-    return nullptr;
+    const size_t levelSize = image.getLevelSize(level);
+    const VkDeviceSize sourceOffset = image.levelOffsets.empty() ? 0 : image.levelOffsets[level];
+    memcpy(stagingData + stagingOffset, image.pixels + sourceOffset, levelSize);
+
+    outLevelOffsets.push_back(stagingOffset);
+    stagingOffset += (levelSize + STAGING_LEVEL_ALIGNMENT - 1) & ~(STAGING_LEVEL_ALIGNMENT - 1);
   }
+}
 
-  size_t textureSize = texWidth * texHeight * requiredComponents;
+void cassidy::Texture::generateMipChain(DecodedImage& image, cassidy::helper::MipFilter filter)
+{
+  if (image.getNumLevels() > 1 || cassidy::helper::isBlockCompressed(image.format)) return;
 
-  const VkExtent2D extent = { 
-    static_cast<uint32_t>(texWidth), 
-    static_cast<uint32_t>(texHeight) 
-  };
+  const size_t numPixels = static_cast<size_t>(image.extent.width) * image.extent.height;
+  const uint32_t numChannels = numPixels > 0 ? static_cast<uint32_t>(image.size / numPixels) : 0;
+  if (numChannels < 1 || numChannels > 4) return;
 
-  create(data, textureSize, extent, allocator, rendererRef, format, shouldGenMipmaps);
+  CS_PROFILE_SCOPE("Texture::generateMipChain");
 
-  m_loadResult = LoadResult::SUCCESS;
-  return this;
+  std::vector<uint8_t> mipChainData;
+  std::vector<VkDeviceSize> levelOffsets;
+  cassidy::helper::generateMipChain(image.pixels, image.extent.width, image.extent.height, numChannels,
+    isSrgbFormat(image.format), filter, mipChainData, levelOffsets);
+
+  // The mip chain now owns the pixels, so free the original decoded image's:
+  if (image.containerData.empty())
+    stbi_image_free(image.pixels);
+
+  image.containerData = std::move(mipChainData);
+  image.levelOffsets = std::move(levelOffsets);
+  image.pixels = image.containerData.data();
+  image.size = image.containerData.size();
+}
+
+std::string cassidy::Texture::getCompressedPath(const std::string& filepath)
+{
+  return std::filesystem::path(filepath).replace_extension(".dds").string();
 }
 
 cassidy::Texture* cassidy::Texture::create(unsigned char* data, size_t size, VkExtent2D textureDim, 
   VmaAllocator allocator, cassidy::Renderer* rendererRef, VkFormat format, VkBool32 shouldGenMipmaps)
 {
-  m_loadResult = LoadResult::UPLOADING;
+  // Wrap the caller's pixels without taking ownership, unless a mip chain is generated from them:
+  DecodedImage image;
+  if (shouldGenMipmaps == VK_TRUE)
+  {
+    image.containerData.assign(data, data + size);
+    image.pixels = image.containerData.data();
+  }
+  else
+  {
+    image.pixels = data;
+  }
+  image.size = size;
+  image.extent = textureDim;
+  image.format = format;
 
-  VkBufferCreateInfo stagingBufferInfo = cassidy::init::bufferCreateInfo(static_cast<uint32_t>(size),
-    VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-  VmaAllocationCreateInfo bufferAllocInfo = cassidy::init::vmaAllocationCreateInfo(VMA_MEMORY_USAGE_AUTO_PREFER_HOST,
-    VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+  if (shouldGenMipmaps == VK_TRUE)
+    generateMipChain(image);
 
-  AllocatedBuffer stagingBuffer;
+  upload(image, allocator, rendererRef);
 
-  vmaCreateBuffer(allocator, &stagingBufferInfo, &bufferAllocInfo,
-    &stagingBuffer.buffer,
-    &stagingBuffer.allocation,
-    nullptr);
+  m_loadResult = LoadResult::SUCCESS;
+  return this;
+}
 
-  void* mappingData;
-  vmaMapMemory(allocator, stagingBuffer.allocation, &mappingData);
-  memcpy(mappingData, data, size);
-  vmaUnmapMemory(allocator, stagingBuffer.allocation);
+void cassidy::Texture::upload(const DecodedImage& image, VmaAllocator allocator, cassidy::Renderer* rendererRef)
+{
+  cassidy::StagingRingBuffer& stagingRing = rendererRef->getUploadContext().stagingRing;
+  const cassidy::StagingRingBuffer::Allocation staging = stagingRing.allocate(getStagingSize(image), STAGING_LEVEL_ALIGNMENT);
 
-  // Check support for linear filtering necessary for generating mipmaps, skip mipmap generation if it isn't:
-  VkFormatProperties formatProperties;
-  vkGetPhysicalDeviceFormatProperties(rendererRef->getPhysicalDevice(), format, &formatProperties);
+  std::vector<VkDeviceSize> levelOffsets;
+  copyToStaging(image, static_cast<uint8_t*>(staging.mappedData), levelOffsets);
 
-  if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT))
-    shouldGenMipmaps = VK_FALSE;
+  allocateImage(image.extent, allocator, rendererRef, image.format, image.getNumLevels());
 
-  const uint32_t mipLevels = shouldGenMipmaps == VK_TRUE ?
-    std::min(static_cast<uint32_t>(
-      std::floor(std::log2(std::max(textureDim.width, textureDim.height)))), 16U) + 1 :
-    1;
+  cassidy::helper::immediateSubmit(rendererRef->getLogicalDevice(),
+    rendererRef->getUploadContext(), [&](VkCommandBuffer cmd)
+    {
+      recordUpload(cmd, staging.buffer, staging.offset, levelOffsets);
+    });
+
+  stagingRing.free(staging);
+}
+
+void cassidy::Texture::allocateImage(VkExtent2D textureDim, VmaAllocator allocator, cassidy::Renderer* rendererRef,
+  VkFormat format, uint32_t numLevels)
+{
+  m_loadResult = LoadResult::UPLOADING;
 
-  // If generating mipmaps for this texture, add TRANSFER_SRC to usage flags:
-  VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
-  if (shouldGenMipmaps == VK_TRUE) usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+  m_mipLevels = std::max(numLevels, 1U);
+  const VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 
   const VkExtent3D extent = {
     textureDim.width,
@@ -90,43 +264,49 @@ cassidy::Texture* cassidy::Texture::create(unsigned char* data, size_t size, VkE
     1
   };
 
-  VkImageCreateInfo imageInfo = cassidy::init::imageCreateInfo(VK_IMAGE_TYPE_2D, extent, mipLevels,
+  VkImageCreateInfo imageInfo = cassidy::init::imageCreateInfo(VK_IMAGE_TYPE_2D, extent, m_mipLevels,
     format, VK_IMAGE_TILING_OPTIMAL, usage);
 
+  // Images are uploaded and transitioned on the upload queue but sampled on the graphics queue, so share them between
+  // both families when they differ rather than transferring ownership after every upload:
+  const UploadContext& uploadContext = rendererRef->getUploadContext();
+  const uint32_t queueFamilies[] = { uploadContext.uploadQueueFamily, uploadContext.graphicsQueueFamily };
+  if (uploadContext.uploadQueueFamily != uploadContext.graphicsQueueFamily)
+  {
+    imageInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+    imageInfo.queueFamilyIndexCount = 2;
+    imageInfo.pQueueFamilyIndices = queueFamilies;
+  }
+
   VmaAllocationCreateInfo imageAllocInfo = {};
   imageAllocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
 
   vmaCreateImage(allocator, &imageInfo, &imageAllocInfo, &m_image.image, &m_image.allocation, nullptr);
 
   m_dimensions = VkExtent2D(textureDim.width, textureDim.height);
-
-  cassidy::helper::immediateSubmit(rendererRef->getLogicalDevice(),
-    rendererRef->getUploadContext(), [=](VkCommandBuffer cmd)
-    {
-      cassidy::helper::transitionImageLayout(cmd, m_image.image, format,
-        VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-        0, VK_ACCESS_TRANSFER_WRITE_BIT,
-        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
-        mipLevels);
-
-      copyBufferToImage(cmd, stagingBuffer.buffer, textureDim.width, textureDim.height);
-
-      if (shouldGenMipmaps != VK_TRUE)
-        cassidy::helper::transitionImageLayout(cmd, m_image.image, format,
-          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-          VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_MEMORY_READ_BIT,
-          VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
-          mipLevels);
-    });
+  m_format = format;
 
   VkImageViewCreateInfo viewInfo = cassidy::init::imageViewCreateInfo(m_image.image, format,
-    VK_IMAGE_ASPECT_COLOR_BIT, mipLevels);
+    VK_IMAGE_ASPECT_COLOR_BIT, m_mipLevels);
   vkCreateImageView(rendererRef->getLogicalDevice(), &viewInfo, nullptr, &m_image.view);
+}
 
-  vmaDestroyBuffer(allocator, stagingBuffer.buffer, stagingBuffer.allocation);
-
-  m_loadResult = LoadResult::SUCCESS;
-  return this;
+void cassidy::Texture::recordUpload(VkCommandBuffer cmd, VkBuffer stagingBuffer, VkDeviceSize stagingOffset,
+  const std::vector<VkDeviceSize>& levelOffsets)
+{
+  cassidy::helper::transitionImageLayout(cmd, m_image.image, m_format,
+    VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+    0, VK_ACCESS_TRANSFER_WRITE_BIT,
+    VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+    m_mipLevels);
+
+  copyBufferToImage(cmd, stagingBuffer, stagingOffset, m_dimensions.width, m_dimensions.height, levelOffsets);
+
+  cassidy::helper::transitionImageLayout(cmd, m_image.image, m_format,
+    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+    VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_MEMORY_READ_BIT,
+    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+    m_mipLevels);
 }
 
 void cassidy::Texture::release(VkDevice device, VmaAllocator allocator)
@@ -137,6 +317,13 @@ void cassidy::Texture::release(VkDevice device, VmaAllocator allocator)
   vkDestroyImageView(device, m_image.view, nullptr);
 }
 
+void cassidy::Texture::swapImage(cassidy::Texture& other)
+{
+  std::swap(m_image, other.m_image);
+  std::swap(m_dimensions, other.m_dimensions);
+  std::swap(m_mipLevels, other.m_mipLevels);
+}
+
 void cassidy::Texture::transitionImageLayout(VkCommandBuffer cmd, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint8_t mipLevels)
 {
   VkImageSubresourceRange range = {};
@@ -185,114 +372,29 @@ void cassidy::Texture::transitionImageLayout(VkCommandBuffer cmd, VkFormat forma
     1, &barrier);
 }
 
-void cassidy::Texture::copyBufferToImage(VkCommandBuffer cmd, VkBuffer stagingBuffer, uint32_t width, uint32_t height)
-{
-  VkBufferImageCopy region = {};
-  region.bufferOffset = 0;
-  region.bufferRowLength = 0;
-  region.bufferImageHeight = 0;
-
-  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-  region.imageSubresource.mipLevel = 0;
-  region.imageSubresource.baseArrayLayer = 0;
-  region.imageSubresource.layerCount = 1;
-
-  region.imageOffset = { 0, 0, 0 };
-  region.imageExtent = { width, height, 1 };
-
-  vkCmdCopyBufferToImage(cmd, stagingBuffer, m_image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-}
-
-void cassidy::Texture::generateMipmaps(VkCommandBuffer cmd, VkFormat format, uint32_t width, uint32_t height, uint8_t mipLevels)
+void cassidy::Texture::copyBufferToImage(VkCommandBuffer cmd, VkBuffer stagingBuffer, VkDeviceSize bufferOffset, uint32_t width, uint32_t height,
+  const std::vector<VkDeviceSize>& levelOffsets)
 {
-  VkImageSubresourceRange range = {
-    .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-    .levelCount = 1,
-    .baseArrayLayer = 0,
-    .layerCount = 1,
-  };
-
-  VkImageMemoryBarrier barrier = {
-    .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-    .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-    .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-    .image = m_image.image,
-    .subresourceRange = range,
-  };
+  // Copy every provided mip level in one command, one region per level:
+  const uint32_t numLevels = levelOffsets.empty() ? 1 : static_cast<uint32_t>(std::min<size_t>(levelOffsets.size(), m_mipLevels));
+  std::vector<VkBufferImageCopy> regions(numLevels);
 
-  int32_t mipWidth = width;
-  int32_t mipHeight = height;
-
-  // Blit lower mip level into level above it at progressively halving resolutions:
-  for (uint8_t i = 1; i < mipLevels; ++i)
+  for (uint32_t level = 0; level < numLevels; ++level)
   {
-    // Transition layout of current mip level to TRANSFER_SRC for blit:
-    barrier.subresourceRange.baseMipLevel = i - 1;
-    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-
-    vkCmdPipelineBarrier(cmd,
-      VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
-      0,
-      0, nullptr,
-      0, nullptr,
-      1, &barrier);
-
-    const VkImageSubresourceLayers srcLayers = {
-      .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-      .mipLevel = static_cast<uint32_t>(i - 1),
-      .baseArrayLayer = 0,
-      .layerCount = 1,
-    };
-    const VkImageSubresourceLayers dstLayers = {
-      .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-      .mipLevel = i,
-      .baseArrayLayer = 0,
-      .layerCount = 1,
-    };
-
-    VkImageBlit blit = {
-      .srcSubresource = srcLayers,
-      .srcOffsets = { { 0, 0, 0, }, { mipWidth, mipHeight, 1} },
-      .dstSubresource = dstLayers,
-      .dstOffsets = { { 0, 0, 0 }, { mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1 } },
-    };
-
-    vkCmdBlitImage(cmd,
-      m_image.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-      m_image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-      1, &blit, VK_FILTER_LINEAR);
-
-    // Transition layout of current mip level to SHADER_READ_ONLY_OPTIMAL:
-    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-    vkCmdPipelineBarrier(cmd, 
-      VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-      0,
-      0, nullptr,
-      0, nullptr,
-      1, &barrier);
-
-    if (mipWidth > 1) mipWidth /= 2;
-    if (mipHeight > 1) mipHeight /= 2;
+    VkBufferImageCopy& region = regions[level];
+    region.bufferOffset = bufferOffset + (levelOffsets.empty() ? 0 : levelOffsets[level]);
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = level;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+
+    region.imageOffset = { 0, 0, 0 };
+    region.imageExtent = { std::max(width >> level, 1U), std::max(height >> level, 1U), 1 };
   }
 
-  // Transition final mip level:
-  barrier.subresourceRange.baseMipLevel = mipLevels - 1;
-  barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-  barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-  vkCmdPipelineBarrier(cmd,
-    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-    0,
-    0, nullptr,
-    0, nullptr,
-    1, &barrier);
+  vkCmdCopyBufferToImage(cmd, stagingBuffer, m_image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+    numLevels, regions.data());
 }
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Utils/Types.h"
+#include <Utils/MipGenerator.h>
+#include <vector>
 
 namespace cassidy
 {
@@ -20,25 +22,78 @@ namespace cassidy
   class Texture
   {
   public:
+    // Pixels decoded on the CPU, not yet copied into staging memory. Images read from a DDS/KTX2 container may be
+    // block-compressed and carry their own mip chain, in which case the container's data owns the pixels:
+    struct DecodedImage
+    {
+      unsigned char* pixels = nullptr;
+      size_t size = 0;
+      VkExtent2D extent = {};
+      VkFormat format = VK_FORMAT_UNDEFINED;    // (may differ from the requested format if a container was loaded)
+      std::vector<VkDeviceSize> levelOffsets;   // (into pixels, one per provided mip level, empty if only the base level is provided)
+      std::vector<uint8_t> containerData;
+
+      inline uint32_t getNumLevels() const { return levelOffsets.empty() ? 1 : static_cast<uint32_t>(levelOffsets.size()); }
+      size_t getLevelSize(uint32_t level) const;
+    };
+
+    // Decode an image file without touching the device, so several can be decoded on different threads at once.
+    // If an up-to-date block-compressed version of the file exists (see getCompressedPath) and the device supports
+    // BC formats, that is loaded instead:
+    static bool decode(const std::string& filepath, VkFormat format, bool supportsBlockCompression, DecodedImage& outImage);
+    static void freeDecoded(DecodedImage& image);
+
+    // Replace an uncompressed image's single level with its full mip chain, generated on the CPU. Images which
+    // already provide their mip chain (or are block-compressed) are left as they are:
+    static void generateMipChain(DecodedImage& image, cassidy::helper::MipFilter filter = cassidy::helper::MipFilter::BOX);
+
+    // Size of a decoded image's staging copy, and copying it there with every mip level suitably aligned for
+    // vkCmdCopyBufferToImage (level offsets are written relative to the start of the copy). Levels before firstLevel
+    // are skipped, for images only partially resident on the device:
+    static VkDeviceSize getStagingSize(const DecodedImage& image, uint32_t firstLevel = 0);
+    static void copyToStaging(const DecodedImage& image, uint8_t* stagingData, std::vector<VkDeviceSize>& outLevelOffsets,
+      uint32_t firstLevel = 0);
+
+    // Where the offline texture converter writes the block-compressed version of a source image:
+    static std::string getCompressedPath(const std::string& filepath);
+
     cassidy::Texture* load(std::string filepath, VmaAllocator allocator, cassidy::Renderer* rendererRef,
       VkFormat format, VkBool32 shouldGenMipmaps = VK_FALSE);
     cassidy::Texture* create(unsigned char* data, size_t size, VkExtent2D textureDim, VmaAllocator allocator, 
       cassidy::Renderer* rendererRef, VkFormat format, VkBool32 shouldGenMipmaps = VK_FALSE);
     void release(VkDevice device, VmaAllocator allocator);
-    void generateMipmaps(VkCommandBuffer cmd, VkFormat format, uint32_t width, uint32_t height, uint8_t mipLevels);
+
+    // Create the image and its view, then record its upload separately, so several textures can share one staging
+    // allocation and submission. Every mip level is uploaded, none are generated on the device:
+    void allocateImage(VkExtent2D textureDim, VmaAllocator allocator, cassidy::Renderer* rendererRef,
+      VkFormat format, uint32_t numLevels = 1);
+    void recordUpload(VkCommandBuffer cmd, VkBuffer stagingBuffer, VkDeviceSize stagingOffset,
+      const std::vector<VkDeviceSize>& levelOffsets = {});
+
+    // Exchange images (and their dimensions and mip counts) with another texture of the same format, so a streamed
+    // texture can switch to a newly uploaded image while anything referencing the texture stays valid:
+    void swapImage(cassidy::Texture& other);
 
     // Getters/setters: ------------------------------------------------------------------------------------------
     inline VkImage      getImage()      { return m_image.image; }
     inline VkImageView  getImageView()  { return m_image.view; }
     inline LoadResult   getLoadResult() { return m_loadResult; }
     inline VkExtent2D   getDimensions() { return m_dimensions; }
+    inline VkFormat     getFormat()     { return m_format; }
+    inline uint32_t     getMipLevels()  { return m_mipLevels; }
+
+    inline void setLoadResult(LoadResult result) { m_loadResult = result; }
 
   private:
+    void upload(const DecodedImage& image, VmaAllocator allocator, cassidy::Renderer* rendererRef);
     void transitionImageLayout(VkCommandBuffer cmd, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint8_t mipLevels);
-    void copyBufferToImage(VkCommandBuffer cmd, VkBuffer stagingBuffer, uint32_t width, uint32_t height);
+    void copyBufferToImage(VkCommandBuffer cmd, VkBuffer stagingBuffer, VkDeviceSize bufferOffset, uint32_t width, uint32_t height,
+      const std::vector<VkDeviceSize>& levelOffsets);
 
     AllocatedImage m_image;
     VkExtent2D m_dimensions;
+    VkFormat m_format = VK_FORMAT_UNDEFINED;
+    uint32_t m_mipLevels = 1;
     LoadResult m_loadResult = LoadResult::READY_TO_LOAD;
   };
 }
\ No newline at end of file
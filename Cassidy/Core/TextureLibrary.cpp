@@ -1,12 +1,32 @@
 #include "TextureLibrary.h"
 #include <Core/Renderer.h>
 #include <Core/Engine.h>
+#include <Core/ResourceManager.h>
 #include <Core/Logger.h>
+#include <Core/CpuProfiler.h>
 #include <Utils/Helpers.h>
 #include <Utils/Initialisers.h>
+#include <Utils/Hash.h>
+
+#include <algorithm>
 
 #define FALLBACK_TEXTURE_PREFIX std::string("Fallback_")
 
+namespace
+{
+  // Key decoded images on their pixels plus everything else that changes what ends up on the device. Mip levels are
+  // generated from the base level, so only whether they will be needs hashing:
+  uint64_t hashDecodedImage(const cassidy::Texture::DecodedImage& image, VkBool32 shouldGenMipmaps)
+  {
+    uint64_t seed = cassidy::hash::combine(image.format, (static_cast<uint64_t>(image.extent.width) << 32) | image.extent.height);
+    seed = cassidy::hash::combine(seed, shouldGenMipmaps);
+    const uint64_t hash = cassidy::hash::xxHash64(image.pixels, image.size, seed);
+
+    // (0 means "not hashed")
+    return hash != 0 ? hash : 1;
+  }
+}
+
 void cassidy::TextureLibrary::init(VmaAllocator* allocatorRef, cassidy::Renderer* rendererRef)
 {
   if (m_isInitialised) return;
@@ -20,76 +40,369 @@ void cassidy::TextureLibrary::init(VmaAllocator* allocatorRef, cassidy::Renderer
     m_rendererRef->getPhysDeviceProperties(), VK_FILTER_NEAREST, VK_SAMPLER_ADDRESS_MODE_REPEAT, VK_TRUE);
 
   generateFallbackTextures();
+  m_streamer.init(*m_allocatorRef, m_rendererRef);
 
   m_isInitialised = true;
 }
 
-cassidy::Texture* cassidy::TextureLibrary::loadTexture(const std::string& filepath, VkFormat format, VkBool32 shouldGenMipmaps)
+cassidy::TextureHandle cassidy::TextureLibrary::loadTexture(const std::string& filepath, VkFormat format, VkBool32 shouldGenMipmaps)
 {
-  // If the texture has already been loaded, return the already-existing version:
-  if (m_loadedTextures.find(filepath) != m_loadedTextures.end())
+  return loadTextures({ { filepath, format, shouldGenMipmaps } })[0];
+}
+
+std::vector<cassidy::TextureHandle> cassidy::TextureLibrary::loadTextures(const std::vector<TextureRequest>& requests)
+{
+  CS_PROFILE_SCOPE("TextureLibrary::loadTextures");
+
+  std::vector<cassidy::TextureHandle> loadedTextures(requests.size());
+
+  // Skip textures which are already in the library, and only load textures requested more than once in the batch once:
+  std::unordered_map<std::string, uint32_t> firstRequestIndices;
+  std::vector<uint32_t> newRequestIndices;
+  {
+    std::lock_guard<std::mutex> libraryLock(m_libraryMutex);
+    for (uint32_t i = 0; i < requests.size(); ++i)
+    {
+      // (a texture whose last reference has just been released can't be revived, so gets loaded again)
+      const auto loadedIt = m_textureHandles.find(requests[i].filepath);
+      if (loadedIt != m_textureHandles.end() && m_textures.addRef(loadedIt->second))
+        loadedTextures[i] = loadedIt->second;
+      else if (firstRequestIndices.emplace(requests[i].filepath, i).second)
+        newRequestIndices.push_back(i);
+    }
+  }
+
+  if (newRequestIndices.empty()) return loadedTextures;
+
+  const uint32_t numNewTextures = static_cast<uint32_t>(newRequestIndices.size());
+  std::vector<cassidy::Texture::DecodedImage> decodedImages(numNewTextures);
+
+  // Decode every image (and generate its mip chain, unless one was provided) in parallel. The calling thread runs decode jobs too while it waits, so this is safe to call
+  // from a job system worker (e.g. when streaming a model):
+  cassidy::JobSystem& jobSystem = m_rendererRef->getEngineRef()->getJobSystem();
+  const bool supportsBlockCompression = m_rendererRef->supportsBlockCompression();
+  std::vector<uint64_t> contentHashes(numNewTextures, 0);
+  const cassidy::JobHandle decodeHandle = jobSystem.parallelFor(numNewTextures, 1, [&](uint32_t begin, uint32_t end) {
+    for (uint32_t i = begin; i < end; ++i)
+    {
+      const TextureRequest& request = requests[newRequestIndices[i]];
+      if (!cassidy::Texture::decode(request.filepath, request.format, supportsBlockCompression, decodedImages[i]))
+        continue;
+
+      contentHashes[i] = hashDecodedImage(decodedImages[i], request.shouldGenMipmaps);
+      if (request.shouldGenMipmaps == VK_TRUE)
+        cassidy::Texture::generateMipChain(decodedImages[i]);
+    }
+    });
+  jobSystem.wait(decodeHandle);
+
+  // Images with the same contents as a loaded texture, or as an earlier image in this batch, share that texture
+  // instead of being uploaded again:
+  std::vector<uint32_t> contentSourceIndices(numNewTextures, UINT32_MAX);
+  {
+    std::lock_guard<std::mutex> libraryLock(m_libraryMutex);
+    std::unordered_map<uint64_t, uint32_t> firstContentIndices;
+    for (uint32_t i = 0; i < numNewTextures; ++i)
+    {
+      if (!decodedImages[i].pixels) continue;
+      ++m_numContentLoads;
+
+      const uint32_t requestIndex = newRequestIndices[i];
+      const cassidy::TextureHandle existingTexture = acquireByContent(contentHashes[i]);
+      if (existingTexture.isValid())
+      {
+        loadedTextures[requestIndex] = existingTexture;
+        m_textureHandles[requests[requestIndex].filepath] = existingTexture;
+      }
+      else if (const auto [firstIt, isFirst] = firstContentIndices.emplace(contentHashes[i], i); !isFirst)
+      {
+        contentSourceIndices[i] = firstIt->second;
+      }
+      else continue;
+
+      ++m_numContentDuplicates;
+      cassidy::Texture::freeDecoded(decodedImages[i]);
+    }
+  }
+
+  // Pack every decoded image (and each of their provided mip levels) into one staging allocation. Textures big
+  // enough to stream start out with only the levels from their initial one onwards:
+  constexpr VkDeviceSize stagingAlignment = 16;
+  std::vector<VkDeviceSize> stagingOffsets(numNewTextures, 0);
+  std::vector<std::vector<VkDeviceSize>> levelOffsets(numNewTextures);
+  std::vector<uint32_t> initialLevels(numNewTextures, 0);
+  VkDeviceSize stagingSize = 0;
+  uint32_t numDecoded = 0;
+  for (uint32_t i = 0; i < numNewTextures; ++i)
+  {
+    if (!decodedImages[i].pixels) continue;
+
+    if (m_streamer.isEnabled())
+      initialLevels[i] = cassidy::TextureStreamer::getInitialLevel(decodedImages[i]);
+
+    ++numDecoded;
+    stagingOffsets[i] = stagingSize;
+    stagingSize += cassidy::Texture::getStagingSize(decodedImages[i], initialLevels[i]);
+  }
+
+  std::vector<cassidy::Texture> newTextures(numNewTextures);
+  if (stagingSize > 0)
+  {
+    UploadContext& uploadContext = m_rendererRef->getUploadContext();
+    const cassidy::StagingRingBuffer::Allocation staging = uploadContext.stagingRing.allocate(stagingSize, stagingAlignment);
+
+    for (uint32_t i = 0; i < numNewTextures; ++i)
+    {
+      const cassidy::Texture::DecodedImage& decodedImage = decodedImages[i];
+      if (!decodedImage.pixels) continue;
+
+      const uint32_t initialLevel = initialLevels[i];
+      const VkExtent2D initialExtent = {
+        std::max(decodedImage.extent.width >> initialLevel, 1U),
+        std::max(decodedImage.extent.height >> initialLevel, 1U),
+      };
+
+      cassidy::Texture::copyToStaging(decodedImage, static_cast<uint8_t*>(staging.mappedData) + stagingOffsets[i], levelOffsets[i],
+        initialLevel);
+      newTextures[i].allocateImage(initialExtent, *m_allocatorRef, m_rendererRef, decodedImage.format,
+        decodedImage.getNumLevels() - initialLevel);
+    }
+
+    // Record every texture's upload into one command buffer, submitted once and waited on with one fence:
+    cassidy::helper::immediateSubmit(m_rendererRef->getLogicalDevice(), uploadContext, [&](VkCommandBuffer cmd) {
+      for (uint32_t i = 0; i < numNewTextures; ++i)
+      {
+        if (decodedImages[i].pixels)
+          newTextures[i].recordUpload(cmd, staging.buffer, staging.offset + stagingOffsets[i], levelOffsets[i]);
+      }
+      });
+
+    uploadContext.stagingRing.free(staging);
+    CS_LOG_INFO("Uploaded {0} textures in one batch ({1} KB)!", numDecoded, stagingSize / 1024);
+  }
+
   {
-    CS_LOG_WARN("Texture {0} has already been loaded into memory!", filepath);
-    return &m_loadedTextures.at(filepath);
+    std::lock_guard<std::mutex> libraryLock(m_libraryMutex);
+    for (uint32_t i = 0; i < numNewTextures; ++i)
+    {
+      cassidy::Texture::DecodedImage& decodedImage = decodedImages[i];
+      if (!decodedImage.pixels) continue;
+
+      newTextures[i].setLoadResult(LoadResult::SUCCESS);
+
+      // Another thread may have loaded the same texture while this batch was decoding, in which case use theirs:
+      const std::string& filepath = requests[newRequestIndices[i]].filepath;
+      const auto loadedIt = m_textureHandles.find(filepath);
+      cassidy::TextureHandle existingTexture = loadedIt != m_textureHandles.end() && m_textures.addRef(loadedIt->second) ?
+        loadedIt->second : acquireByContent(contentHashes[i]);
+      if (existingTexture.isValid())
+      {
+        newTextures[i].release(m_rendererRef->getLogicalDevice(), *m_allocatorRef);
+        cassidy::Texture::freeDecoded(decodedImage);
+        loadedTextures[newRequestIndices[i]] = existingTexture;
+        m_textureHandles[filepath] = existingTexture;
+        continue;
+      }
+
+      const cassidy::TextureHandle newHandle = m_textures.add({ newTextures[i], filepath, contentHashes[i],
+        registerBindlessSlot(newTextures[i]) });
+      m_textureHandles[filepath] = newHandle;
+      m_contentHandles[contentHashes[i]] = newHandle;
+
+      // Streamed textures keep their full mip chain in system memory, for the streamer to upload higher levels from:
+      if (initialLevels[i] > 0)
+        m_streamer.registerTexture(newHandle, getTexture(newHandle), std::move(decodedImage), initialLevels[i]);
+      else
+        cassidy::Texture::freeDecoded(decodedImage);
+
+      loadedTextures[newRequestIndices[i]] = newHandle;
+    }
   }
 
-  // Otherwise, load the texture and add it to the libary, if the file loading is successful:
-  cassidy::Texture newTexture;
-  if (newTexture.load(filepath, *m_allocatorRef, m_rendererRef, format, shouldGenMipmaps))
+  // Point images whose contents matched an earlier one in the batch at its texture, under their own names too:
   {
-    m_loadedTextures[filepath] = newTexture;
-    if (shouldGenMipmaps == VK_TRUE)
+    std::lock_guard<std::mutex> libraryLock(m_libraryMutex);
+    for (uint32_t i = 0; i < numNewTextures; ++i)
     {
-      const VkExtent2D dimensions = newTexture.getDimensions();
-      const uint32_t mipLevels = std::min(static_cast<uint32_t>(
-        std::floor(std::log2(std::max(dimensions.width, dimensions.height)))), 16U) + 1;
-
-      std::string stringCopy = filepath;
-      m_rendererRef->getEngineRef()->getWorkerThread().pushJobLowPrio([&, dimensions, mipLevels, stringCopy]() {
-        std::unique_lock<std::mutex> recordCommandsLock(m_blitCommandsList.recordingMutex);
-        if (m_blitCommandsList.numTextureCommandsRecorded == 0)
-        {
-          VkCommandBufferBeginInfo beginInfo = cassidy::init::commandBufferBeginInfo(
-            VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, nullptr);
-          vkBeginCommandBuffer(m_blitCommandsList.cmd, &beginInfo);
-        }
-        cassidy::helper::generateMipmaps(m_loadedTextures[stringCopy].getImage(), m_blitCommandsList.cmd,
-          format, dimensions.width, dimensions.height, mipLevels);
-
-        ++m_blitCommandsList.numTextureCommandsRecorded;
-        });
-      CS_LOG_INFO("Pushed blit command job to worker thread!");
+      if (contentSourceIndices[i] == UINT32_MAX) continue;
+
+      const cassidy::TextureHandle sourceTexture = loadedTextures[newRequestIndices[contentSourceIndices[i]]];
+      if (!sourceTexture.isValid() || !m_textures.addRef(sourceTexture)) continue;
+
+      loadedTextures[newRequestIndices[i]] = sourceTexture;
+      m_textureHandles[requests[newRequestIndices[i]].filepath] = sourceTexture;
     }
+  }
+
+  // Point duplicate requests at the texture loaded for the first of them, each with its own reference:
+  for (uint32_t i = 0; i < requests.size(); ++i)
+  {
+    if (loadedTextures[i].isValid()) continue;
+
+    loadedTextures[i] = loadedTextures[firstRequestIndices.at(requests[i].filepath)];
+    if (loadedTextures[i].isValid())
+      m_textures.addRef(loadedTextures[i]);
+  }
+
+  return loadedTextures;
+}
+
+cassidy::TextureHandle cassidy::TextureLibrary::registerTexture(const std::string& name, const cassidy::Texture& texture, uint64_t contentHash)
+{
+  std::lock_guard<std::mutex> libraryLock(m_libraryMutex);
+
+  const auto loadedIt = m_textureHandles.find(name);
+  if (loadedIt != m_textureHandles.end() && m_textures.addRef(loadedIt->second))
+  {
+    CS_LOG_WARN("Texture {0} is already registered with the texture library, using the existing texture", name);
+    return loadedIt->second;
+  }
+
+  cassidy::Texture newTexture = texture;
+  const cassidy::TextureHandle newHandle = m_textures.add({ newTexture, name, contentHash, registerBindlessSlot(newTexture) });
+  m_textureHandles[name] = newHandle;
+
+  if (contentHash != 0)
+  {
+    ++m_numContentLoads;
+    m_contentHandles.emplace(contentHash, newHandle);
+  }
+  return newHandle;
+}
+
+cassidy::TextureHandle cassidy::TextureLibrary::acquireTexture(const std::string& name, uint64_t contentHash)
+{
+  std::lock_guard<std::mutex> libraryLock(m_libraryMutex);
+
+  const auto loadedIt = m_textureHandles.find(name);
+  if (loadedIt != m_textureHandles.end() && m_textures.addRef(loadedIt->second))
+    return loadedIt->second;
 
-    return &m_loadedTextures.at(filepath);
+  const cassidy::TextureHandle existingTexture = acquireByContent(contentHash);
+  if (existingTexture.isValid())
+  {
+    ++m_numContentLoads;
+    ++m_numContentDuplicates;
+    m_textureHandles[name] = existingTexture;
   }
+  return existingTexture;
+}
+
+uint64_t cassidy::TextureLibrary::hashContents(const void* data, size_t size)
+{
+  // (0 means "not hashed")
+  const uint64_t hash = cassidy::hash::xxHash64(data, size);
+  return hash != 0 ? hash : 1;
+}
+
+cassidy::TextureHandle cassidy::TextureLibrary::acquireByContent(uint64_t contentHash)
+{
+  if (contentHash == 0) return {};
+
+  const auto contentIt = m_contentHandles.find(contentHash);
+  if (contentIt == m_contentHandles.end() || !m_textures.addRef(contentIt->second))
+    return {};
+
+  return contentIt->second;
+}
 
-  return nullptr;
+void cassidy::TextureLibrary::addRef(cassidy::TextureHandle handle)
+{
+  if (!m_textures.addRef(handle))
+    CS_LOG_ERROR("Attempted to add a reference to a texture which has already been released!");
 }
 
-void cassidy::TextureLibrary::registerTexture(const std::string& name, const cassidy::Texture& texture)
+void cassidy::TextureLibrary::releaseTexture(cassidy::TextureHandle handle)
 {
-  if (m_loadedTextures.find(name) != m_loadedTextures.end())
+  if (!handle.isValid() || m_textures.removeRef(handle) != 0) return;
+
+  // Forget the texture's names and contents straight away so it can be loaded again, but keep the image alive until
+  // no frame in flight can still be sampling it:
   {
-    CS_LOG_ERROR("Attempted to register texture {0} into library when a texture with this name already exists!", name);
-    return;
+    std::lock_guard<std::mutex> libraryLock(m_libraryMutex);
+    std::erase_if(m_textureHandles, [handle](const auto& named) { return named.second == handle; });
+
+    NamedTexture* namedTexture = m_textures.get(handle);
+    const auto contentIt = m_contentHandles.find(namedTexture->contentHash);
+    if (contentIt != m_contentHandles.end() && contentIt->second == handle)
+      m_contentHandles.erase(contentIt);
   }
 
-  m_loadedTextures[name] = texture;
+  cassidy::globals::g_resourceManager.deferDeletion([this, handle]() {
+    NamedTexture* namedTexture = m_textures.get(handle);
+    CS_LOG_INFO("Unloading texture {0}", namedTexture->name);
+
+    m_streamer.unregisterTexture(handle);
+    if (namedTexture->bindlessIndex != UINT32_MAX)
+      cassidy::globals::g_resourceManager.bindless.releaseTexture(namedTexture->bindlessIndex);
+    namedTexture->texture.release(m_rendererRef->getLogicalDevice(), *m_allocatorRef);
+    m_textures.remove(handle);
+    });
+}
+
+uint32_t cassidy::TextureLibrary::getBindlessIndex(cassidy::TextureHandle handle)
+{
+  NamedTexture* namedTexture = m_textures.get(handle);
+  return namedTexture && namedTexture->bindlessIndex != UINT32_MAX ? namedTexture->bindlessIndex : 0;
+}
+
+void cassidy::TextureLibrary::refreshBindlessSlot(cassidy::TextureHandle handle)
+{
+  constexpr cassidy::BindlessResources& bindless = cassidy::globals::g_resourceManager.bindless;
+
+  NamedTexture* namedTexture = m_textures.get(handle);
+  if (!bindless.isEnabled() || !namedTexture) return;
+
+  // Frames in flight may still be sampling the old image through the old slot, so it can't be overwritten in place:
+  const uint32_t oldIndex = namedTexture->bindlessIndex;
+  namedTexture->bindlessIndex = bindless.registerTexture(namedTexture->texture.getImageView());
+  cassidy::globals::g_resourceManager.deferDeletion([oldIndex]() {
+    cassidy::globals::g_resourceManager.bindless.releaseTexture(oldIndex);
+    });
+}
+
+uint32_t cassidy::TextureLibrary::registerBindlessSlot(cassidy::Texture& texture)
+{
+  constexpr cassidy::BindlessResources& bindless = cassidy::globals::g_resourceManager.bindless;
+  return bindless.isEnabled() ? bindless.registerTexture(texture.getImageView()) : UINT32_MAX;
+}
+
+void cassidy::TextureLibrary::releaseTextures(const std::vector<cassidy::TextureHandle>& handles)
+{
+  for (const cassidy::TextureHandle handle : handles)
+  {
+    releaseTexture(handle);
+  }
 }
 
 void cassidy::TextureLibrary::releaseAll(VkDevice device, VmaAllocator allocator)
 {
+  m_streamer.release();
+
   vkDestroySampler(device, cassidy::globals::m_linearTextureSampler, nullptr);
   vkDestroySampler(device, cassidy::globals::m_nearestTextureSampler, nullptr);
 
-  CS_LOG_INFO("Releasing {0} textures...", m_loadedTextures.size());
-  for (auto& [key, val] : m_loadedTextures)
+  CS_LOG_INFO("Releasing {0} textures...", m_textures.getNumResources());
+  m_textures.forEach([&](cassidy::TextureHandle handle, NamedTexture& namedTexture) {
+    namedTexture.texture.release(device, allocator);
+    });
+  m_textures.clear();
+  m_textureHandles.clear();
+  m_contentHandles.clear();
+  m_isInitialised = false;
+}
+
+std::vector<std::string> cassidy::TextureLibrary::getTextureNames()
+{
+  std::lock_guard<std::mutex> libraryLock(m_libraryMutex);
+
+  std::vector<std::string> names;
+  names.reserve(m_textureHandles.size());
+  for (const auto& [name, handle] : m_textureHandles)
   {
-    val.release(device, allocator);
+    names.push_back(name);
   }
-  m_loadedTextures.clear();
-  m_isInitialised = false;
+  return names;
 }
 
 void cassidy::TextureLibrary::generateFallbackTextures()
@@ -108,38 +421,34 @@ void cassidy::TextureLibrary::generateFallbackTextures()
   blackTex.create(blackColour, fallbackTexSize, fallbackTexDim, *m_allocatorRef, m_rendererRef, VK_FORMAT_R8G8B8A8_SRGB);
   whiteTex.create(whiteColour, fallbackTexSize, fallbackTexDim, *m_allocatorRef, m_rendererRef, VK_FORMAT_R8G8B8A8_SRGB);
 
-  const std::string magentaKeyVal = FALLBACK_TEXTURE_PREFIX + std::string("magenta");
-  const std::string normalKeyVal  = FALLBACK_TEXTURE_PREFIX + std::string("normal");
-  const std::string blackKeyVal   = FALLBACK_TEXTURE_PREFIX + std::string("black");
-  const std::string whiteKeyVal   = FALLBACK_TEXTURE_PREFIX + std::string("white");
-
-  m_loadedTextures[magentaKeyVal] = magentaTex;
-  m_loadedTextures[normalKeyVal]  = normalTex;
-  m_loadedTextures[blackKeyVal]   = blackTex;
-  m_loadedTextures[whiteKeyVal]   = whiteTex;
+  // The library keeps its own reference to each fallback texture, so they're never unloaded:
+  m_fallbackTextures[0] = registerTexture(FALLBACK_TEXTURE_PREFIX + std::string("magenta"), magentaTex);
+  m_fallbackTextures[1] = registerTexture(FALLBACK_TEXTURE_PREFIX + std::string("normal"), normalTex);
+  m_fallbackTextures[2] = registerTexture(FALLBACK_TEXTURE_PREFIX + std::string("black"), blackTex);
+  m_fallbackTextures[3] = registerTexture(FALLBACK_TEXTURE_PREFIX + std::string("white"), whiteTex);
 }
 
-cassidy::Texture* cassidy::TextureLibrary::getFallbackTexture(cassidy::TextureType type)
+cassidy::TextureHandle cassidy::TextureLibrary::getFallbackTexture(cassidy::TextureType type)
 {
   // Return default 1x1 white, black, magenta or (0.5, 0.5, 1.0) normal texture based on type:
   
   switch (type)
   {
   case cassidy::TextureType::ALBEDO:
-    return &m_loadedTextures.at(FALLBACK_TEXTURE_PREFIX + std::string("magenta"));
+    return m_fallbackTextures[0];
 
   case cassidy::TextureType::NORMAL:
-    return &m_loadedTextures.at(FALLBACK_TEXTURE_PREFIX + std::string("normal"));
+    return m_fallbackTextures[1];
 
   case cassidy::TextureType::EMISSIVE:
   case cassidy::TextureType::ROUGHNESS:
   case cassidy::TextureType::METALLIC:
-    return &m_loadedTextures.at(FALLBACK_TEXTURE_PREFIX + std::string("black"));
+    return m_fallbackTextures[2];
 
   case cassidy::TextureType::AO:
   case cassidy::TextureType::SPECULAR:
-    return &m_loadedTextures.at(FALLBACK_TEXTURE_PREFIX + std::string("white"));
+    return m_fallbackTextures[3];
   }
   CS_LOG_ERROR("No suitable fallback texture for TextureType {0}, defaulting to magenta", static_cast<uint8_t>(type));
-  return &m_loadedTextures.at(FALLBACK_TEXTURE_PREFIX + std::string("magenta"));
+  return m_fallbackTextures[0];
 }
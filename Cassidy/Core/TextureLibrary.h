@@ -1,7 +1,11 @@
 #pragma once
 #include <Core/Texture.h>
+#include <Core/TextureStreamer.h>
+#include <Utils/ResourcePool.h>
 #include <unordered_map>
+#include <atomic>
 #include <mutex>
+#include <vector>
 
 namespace cassidy
 {
@@ -16,32 +20,96 @@ namespace cassidy
   public:
     TextureLibrary() {}
 
-    struct BlitCommandsList {
-      VkCommandBuffer cmd;
-      std::mutex recordingMutex;
-      volatile uint8_t numTextureCommandsRecorded;  // TODO: Volatile necessary?
+    struct TextureRequest
+    {
+      std::string filepath;
+      VkFormat format;
+      VkBool32 shouldGenMipmaps = VK_FALSE;
     };
 
     void init(VmaAllocator* allocatorRef, cassidy::Renderer* rendererRef);
 
-    cassidy::Texture* loadTexture(const std::string& filepath, VkFormat format, VkBool32 shouldGenMipmaps = VK_FALSE);
-    void registerTexture(const std::string& name, const cassidy::Texture& texture);
+    // Textures are reference counted, every handle returned by a load or register call holds one reference which the
+    // caller has to release. Textures with no references left are unloaded a few frames later:
+    cassidy::TextureHandle loadTexture(const std::string& filepath, VkFormat format, VkBool32 shouldGenMipmaps = VK_FALSE);
+
+    // Decode every requested texture (generating mip chains on the CPU where requested) in parallel on the job system,
+    // then upload them all from one staging allocation with a single submission. Large textures with a mip chain
+    // only have their lowest levels uploaded, and are handed to the streamer for the rest. Decoded images with the
+    // same contents as a loaded texture (e.g. the same file reached through another path) share that texture instead.
+    // Returns one handle per request, or an invalid handle where the file couldn't be loaded:
+    std::vector<cassidy::TextureHandle> loadTextures(const std::vector<TextureRequest>& requests);
+
+    // Add a texture created elsewhere under the given name, or take a reference to the texture already using that name.
+    // Pass a hash of the texture's source data (see hashContents) to let later loads of the same data share it:
+    cassidy::TextureHandle registerTexture(const std::string& name, const cassidy::Texture& texture, uint64_t contentHash = 0);
+
+    // Take a reference to an already-loaded texture by name, or failing that by content hash, in which case the name
+    // is added as another name for the texture (invalid handle if neither is loaded):
+    cassidy::TextureHandle acquireTexture(const std::string& name, uint64_t contentHash = 0);
+
+    // Hash of a texture's source data, e.g. an embedded texture's compressed bytes:
+    static uint64_t hashContents(const void* data, size_t size);
+
+    void addRef(cassidy::TextureHandle handle);
+    void releaseTexture(cassidy::TextureHandle handle);
+    void releaseTextures(const std::vector<cassidy::TextureHandle>& handles);
 
     void releaseAll(VkDevice device, VmaAllocator allocator);
 
     void generateFallbackTextures();
-    cassidy::Texture* getFallbackTexture(cassidy::TextureType type);
 
-    inline cassidy::Texture* getTexture(const std::string& name) { return &m_loadedTextures.at(name); }
-    inline size_t getNumLoadedTextures() { return m_loadedTextures.size(); }
-    inline const std::unordered_map<std::string, cassidy::Texture>& getTextureLibraryMap() { return m_loadedTextures; }
-    inline BlitCommandsList& getBlitCommandsList() { return m_blitCommandsList; }
+    // Fallback textures are never unloaded, so their handles can be used without taking a reference:
+    cassidy::TextureHandle getFallbackTexture(cassidy::TextureType type);
+
+    // Null if the handle is stale:
+    inline cassidy::Texture* getTexture(cassidy::TextureHandle handle)
+    {
+      NamedTexture* namedTexture = m_textures.get(handle);
+      return namedTexture ? &namedTexture->texture : nullptr;
+    }
+
+    // Slot of a texture in the bindless texture array (0, the magenta fallback, if the handle is stale):
+    uint32_t getBindlessIndex(cassidy::TextureHandle handle);
+
+    // Give a texture whose image has been swapped a new bindless slot, retiring its old one once no frame in flight
+    // can be sampling it. Called by the streamer before materials are refreshed:
+    void refreshBindlessSlot(cassidy::TextureHandle handle);
+
+    std::vector<std::string> getTextureNames();
+    inline uint32_t getNumLoadedTextures() const { return m_textures.getNumResources(); }
+
+    // Textures created from source data (decoded or embedded), and how many of those were shared with an existing
+    // texture with the same contents rather than uploaded:
+    inline uint32_t getNumContentLoads() const { return m_numContentLoads; }
+    inline uint32_t getNumContentDuplicates() const { return m_numContentDuplicates; }
+    inline cassidy::TextureStreamer& getStreamer() { return m_streamer; }
 
   private:
-    std::unordered_map<std::string, cassidy::Texture> m_loadedTextures;
+    struct NamedTexture
+    {
+      cassidy::Texture texture;
+      std::string name;
+      uint64_t contentHash = 0;   // (0 if the texture wasn't created from hashed source data)
+      uint32_t bindlessIndex = UINT32_MAX;  // (only assigned if bindless resources are enabled)
+    };
+
+    // Register a new texture's image with the bindless texture array, if enabled:
+    static uint32_t registerBindlessSlot(cassidy::Texture& texture);
+
+    // Take a reference to a loaded texture with the given contents, must be called with the library mutex locked:
+    cassidy::TextureHandle acquireByContent(uint64_t contentHash);
+
+    cassidy::ResourcePool<NamedTexture, cassidy::TextureHandle> m_textures;
+    std::unordered_map<std::string, cassidy::TextureHandle> m_textureHandles;   // (several names may share a texture)
+    std::unordered_map<uint64_t, cassidy::TextureHandle> m_contentHandles;
+    cassidy::TextureHandle m_fallbackTextures[4];   // (magenta, normal, black and white)
     VmaAllocator* m_allocatorRef;
     cassidy::Renderer* m_rendererRef;
     bool m_isInitialised = false;
-    BlitCommandsList m_blitCommandsList;
+    std::mutex m_libraryMutex;  // (guards the name and content maps, textures may be loaded from several job system workers at once)
+    std::atomic<uint32_t> m_numContentLoads = 0;
+    std::atomic<uint32_t> m_numContentDuplicates = 0;
+    cassidy::TextureStreamer m_streamer;
   };
 }
\ No newline at end of file
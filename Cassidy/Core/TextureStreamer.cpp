@@ -0,0 +1,410 @@
+#include "TextureStreamer.h"
+#include <Core/Renderer.h>
+#include <Core/Engine.h>
+#include <Core/ResourceManager.h>
+#include <Core/Logger.h>
+#include <Core/CpuProfiler.h>
+#include <Utils/Initialisers.h>
+#include <Utils/Helpers.h>
+
+#include <algorithm>
+#include <cmath>
+
+void cassidy::TextureStreamer::init(VmaAllocator allocator, cassidy::Renderer* rendererRef)
+{
+  m_allocator = allocator;
+  m_rendererRef = rendererRef;
+}
+
+void cassidy::TextureStreamer::release()
+{
+  const VkDevice device = m_rendererRef->getLogicalDevice();
+
+  // Updates still being recorded push themselves to the pending list, so wait for those jobs first:
+  m_rendererRef->getEngineRef()->getJobSystem().wait(m_updateJobs);
+
+  {
+    std::lock_guard<std::mutex> pendingLock(m_pendingUpdatesMutex);
+    for (PendingUpdate& update : m_pendingUpdates)
+    {
+      vkWaitForFences(device, 1, &update.fence, VK_TRUE, UINT64_MAX);
+      update.newTexture.release(device, m_allocator);
+      releasePendingUpdate(update);
+    }
+    m_pendingUpdates.clear();
+  }
+
+  for (RetiredImage& retired : m_retiredImages)
+  {
+    retired.texture.release(device, m_allocator);
+  }
+  m_retiredImages.clear();
+
+  // Streamed textures themselves are owned (and released) by the texture library:
+  for (StreamedTexture& streamed : m_streamedTextures)
+  {
+    cassidy::Texture::freeDecoded(streamed.fullChain);
+  }
+  m_streamedTextures.clear();
+  m_streamedIndices.clear();
+  m_freeIndices.clear();
+
+  std::lock_guard<std::mutex> newTexturesLock(m_newTexturesMutex);
+  for (StreamedTexture& streamed : m_newTextures)
+  {
+    cassidy::Texture::freeDecoded(streamed.fullChain);
+  }
+  m_newTextures.clear();
+}
+
+uint32_t cassidy::TextureStreamer::getInitialLevel(const cassidy::Texture::DecodedImage& image)
+{
+  uint32_t level = 0;
+  while (level + 1 < image.getNumLevels() &&
+    std::max(image.extent.width >> level, image.extent.height >> level) > STREAMING_INITIAL_MAX_DIMENSION)
+  {
+    ++level;
+  }
+  return level;
+}
+
+void cassidy::TextureStreamer::registerTexture(cassidy::TextureHandle handle, cassidy::Texture* texture,
+  cassidy::Texture::DecodedImage&& fullChain, uint32_t initialLevel)
+{
+  StreamedTexture streamed;
+  streamed.handle = handle;
+  streamed.texture = texture;
+  streamed.fullChain = std::move(fullChain);
+  streamed.initialLevel = initialLevel;
+  streamed.residentLevel = initialLevel;
+  streamed.targetLevel = initialLevel;
+  streamed.requestedLevel = static_cast<float>(initialLevel);
+  streamed.lastRequestFrame = 0;
+  streamed.isRequested = false;
+
+  std::lock_guard<std::mutex> newTexturesLock(m_newTexturesMutex);
+  m_newTextures.push_back(std::move(streamed));
+}
+
+void cassidy::TextureStreamer::unregisterTexture(cassidy::TextureHandle handle)
+{
+  {
+    // Might not have been picked up by an update() yet:
+    std::lock_guard<std::mutex> newTexturesLock(m_newTexturesMutex);
+    const auto newIt = std::find_if(m_newTextures.begin(), m_newTextures.end(),
+      [handle](const StreamedTexture& streamed) { return streamed.handle == handle; });
+    if (newIt != m_newTextures.end())
+    {
+      cassidy::Texture::freeDecoded(newIt->fullChain);
+      m_newTextures.erase(newIt);
+      return;
+    }
+  }
+
+  const auto indexIt = m_streamedIndices.find(handle);
+  if (indexIt == m_streamedIndices.end()) return;
+
+  const uint32_t streamedIndex = indexIt->second;
+  m_streamedIndices.erase(indexIt);
+
+  // An update still in flight is reading the mip chain, so leave freeing it to pollPendingUpdates():
+  StreamedTexture& streamed = m_streamedTextures[streamedIndex];
+  streamed.texture = nullptr;
+  if (streamed.targetLevel == streamed.residentLevel)
+  {
+    cassidy::Texture::freeDecoded(streamed.fullChain);
+    m_freeIndices.push_back(streamedIndex);
+  }
+}
+
+void cassidy::TextureStreamer::requestScreenSize(cassidy::TextureHandle handle, float pixelsPerUv)
+{
+  const auto indexIt = m_streamedIndices.find(handle);
+  if (indexIt == m_streamedIndices.end() || pixelsPerUv <= 0.0f) return;
+
+  // Level whose texels are closest to one per pixel, going by the geometric mean of the base level's dimensions:
+  StreamedTexture& streamed = m_streamedTextures[indexIt->second];
+  const float baseTexelsPerUv = std::sqrt(static_cast<float>(streamed.fullChain.extent.width) * streamed.fullChain.extent.height);
+  const float level = std::log2(baseTexelsPerUv / pixelsPerUv);
+
+  streamed.requestedLevel = std::min(streamed.requestedLevel, std::max(level, 0.0f));
+  streamed.isRequested = true;
+}
+
+void cassidy::TextureStreamer::update(uint64_t currentFrame)
+{
+  CS_PROFILE_SCOPE("TextureStreamer::update");
+
+  pollPendingUpdates(currentFrame);
+
+  // Destroy images swapped out long enough ago that no frame in flight can still be sampling them:
+  const VkDevice device = m_rendererRef->getLogicalDevice();
+  std::erase_if(m_retiredImages, [&](RetiredImage& retired) {
+    if (retired.retiredFrame + FRAMES_IN_FLIGHT > currentFrame) return false;
+
+    retired.texture.release(device, m_allocator);
+    return true;
+    });
+
+  {
+    std::lock_guard<std::mutex> newTexturesLock(m_newTexturesMutex);
+    for (StreamedTexture& streamed : m_newTextures)
+    {
+      if (!m_freeIndices.empty())
+      {
+        m_streamedIndices[streamed.handle] = m_freeIndices.back();
+        m_streamedTextures[m_freeIndices.back()] = std::move(streamed);
+        m_freeIndices.pop_back();
+        continue;
+      }
+
+      m_streamedIndices[streamed.handle] = static_cast<uint32_t>(m_streamedTextures.size());
+      m_streamedTextures.push_back(std::move(streamed));
+    }
+    m_newTextures.clear();
+  }
+
+  VkDeviceSize deviceUsage, deviceBudget;
+  queryDeviceMemory(deviceUsage, deviceBudget);
+
+  // Work out which level each texture wants, and the memory its in-flight updates will add or free:
+  std::vector<uint32_t> wantedLevels(m_streamedTextures.size());
+  int64_t pendingDelta = 0;
+  VkDeviceSize residentBytes = 0;
+  for (uint32_t i = 0; i < m_streamedTextures.size(); ++i)
+  {
+    StreamedTexture& streamed = m_streamedTextures[i];
+    if (!streamed.texture) continue;
+
+    if (streamed.isRequested)
+      streamed.lastRequestFrame = currentFrame;
+
+    wantedLevels[i] = streamed.isRequested ?
+      std::min(static_cast<uint32_t>(streamed.requestedLevel), streamed.initialLevel) :
+      streamed.residentLevel;
+    streamed.requestedLevel = static_cast<float>(streamed.initialLevel);
+    streamed.isRequested = false;
+
+    residentBytes += getResidentSize(streamed, streamed.residentLevel);
+    if (streamed.targetLevel != streamed.residentLevel)
+      pendingDelta += static_cast<int64_t>(getResidentSize(streamed, streamed.targetLevel)) -
+        static_cast<int64_t>(getResidentSize(streamed, streamed.residentLevel));
+  }
+
+  int64_t projectedUsage = static_cast<int64_t>(deviceUsage) + pendingDelta;
+  uint32_t numScheduled = 0;
+  VkDeviceSize numBytesScheduled = 0;
+
+  auto isIdle = [&](const StreamedTexture& streamed) { return streamed.texture && streamed.targetLevel == streamed.residentLevel; };
+
+  if (m_isEnabled && projectedUsage > static_cast<int64_t>(deviceBudget))
+  {
+    // Over budget, so evict the top levels of the least recently used textures first. Textures that haven't been
+    // used for a while drop straight back to their initial levels, ones still in use lose one level at a time:
+    std::vector<uint32_t> candidates;
+    for (uint32_t i = 0; i < m_streamedTextures.size(); ++i)
+    {
+      const StreamedTexture& streamed = m_streamedTextures[i];
+      if (isIdle(streamed) && streamed.residentLevel < streamed.initialLevel)
+        candidates.push_back(i);
+    }
+    std::sort(candidates.begin(), candidates.end(), [&](uint32_t a, uint32_t b) {
+      return m_streamedTextures[a].lastRequestFrame < m_streamedTextures[b].lastRequestFrame;
+      });
+
+    for (uint32_t i : candidates)
+    {
+      if (projectedUsage <= static_cast<int64_t>(deviceBudget) || numScheduled >= STREAMING_MAX_UPDATES_PER_FRAME) break;
+
+      const StreamedTexture& streamed = m_streamedTextures[i];
+      const bool isUnused = streamed.lastRequestFrame + STREAMING_UNUSED_FRAMES < currentFrame;
+      const uint32_t newLevel = isUnused ? streamed.initialLevel : streamed.residentLevel + 1;
+
+      projectedUsage -= static_cast<int64_t>(getResidentSize(streamed, streamed.residentLevel) - getResidentSize(streamed, newLevel));
+      numBytesScheduled += getResidentSize(streamed, newLevel);
+      scheduleUpdate(i, newLevel);
+      ++numScheduled;
+    }
+  }
+  else if (m_isEnabled)
+  {
+    // Under budget, so stream in the levels wanted by the most recently used textures (biggest jump first):
+    std::vector<uint32_t> candidates;
+    for (uint32_t i = 0; i < m_streamedTextures.size(); ++i)
+    {
+      if (isIdle(m_streamedTextures[i]) && wantedLevels[i] < m_streamedTextures[i].residentLevel)
+        candidates.push_back(i);
+    }
+    std::sort(candidates.begin(), candidates.end(), [&](uint32_t a, uint32_t b) {
+      const StreamedTexture& streamedA = m_streamedTextures[a];
+      const StreamedTexture& streamedB = m_streamedTextures[b];
+      if (streamedA.lastRequestFrame != streamedB.lastRequestFrame)
+        return streamedA.lastRequestFrame > streamedB.lastRequestFrame;
+      return streamedA.residentLevel - wantedLevels[a] > streamedB.residentLevel - wantedLevels[b];
+      });
+
+    for (uint32_t i : candidates)
+    {
+      if (numScheduled >= STREAMING_MAX_UPDATES_PER_FRAME || numBytesScheduled >= STREAMING_MAX_UPLOAD_BYTES_PER_FRAME) break;
+
+      const StreamedTexture& streamed = m_streamedTextures[i];
+      const VkDeviceSize newSize = getResidentSize(streamed, wantedLevels[i]);
+      const int64_t growth = static_cast<int64_t>(newSize - getResidentSize(streamed, streamed.residentLevel));
+      if (projectedUsage + growth > static_cast<int64_t>(deviceBudget)) continue;
+
+      projectedUsage += growth;
+      numBytesScheduled += newSize;
+      scheduleUpdate(i, wantedLevels[i]);
+      ++numScheduled;
+    }
+  }
+
+  std::lock_guard<std::mutex> pendingLock(m_pendingUpdatesMutex);
+  m_stats.numStreamedTextures = static_cast<uint32_t>(m_streamedIndices.size());
+  m_stats.numPendingUpdates = static_cast<uint32_t>(m_pendingUpdates.size()) + numScheduled;
+  m_stats.residentBytes = residentBytes;
+  m_stats.deviceUsage = deviceUsage;
+  m_stats.deviceBudget = deviceBudget;
+}
+
+void cassidy::TextureStreamer::pollPendingUpdates(uint64_t currentFrame)
+{
+  const VkDevice device = m_rendererRef->getLogicalDevice();
+  constexpr cassidy::TextureLibrary& texLibrary = cassidy::globals::g_resourceManager.textureLibrary;
+  constexpr cassidy::MaterialLibrary& matLibrary = cassidy::globals::g_resourceManager.materialLibrary;
+
+  std::lock_guard<std::mutex> pendingLock(m_pendingUpdatesMutex);
+  for (auto it = m_pendingUpdates.begin(); it != m_pendingUpdates.end();)
+  {
+    if (vkGetFenceStatus(device, it->fence) != VK_SUCCESS)
+    {
+      ++it;
+      continue;
+    }
+
+    // Swap the texture over to its new image, leaving the old one in the update's texture to be retired:
+    StreamedTexture& streamed = m_streamedTextures[it->streamedIndex];
+    if (streamed.texture)
+    {
+      streamed.texture->swapImage(it->newTexture);
+      texLibrary.refreshBindlessSlot(streamed.handle);
+      matLibrary.refreshTextureDescSets(streamed.handle, currentFrame);
+    }
+    else
+    {
+      // Unregistered while this update was in flight, so nothing needs the new image or the mip chain any more:
+      cassidy::Texture::freeDecoded(streamed.fullChain);
+      m_freeIndices.push_back(it->streamedIndex);
+    }
+    streamed.residentLevel = streamed.targetLevel;
+    m_retiredImages.push_back({ it->newTexture, currentFrame });
+
+    releasePendingUpdate(*it);
+    it = m_pendingUpdates.erase(it);
+  }
+}
+
+void cassidy::TextureStreamer::scheduleUpdate(uint32_t streamedIndex, uint32_t newLevel)
+{
+  StreamedTexture& streamed = m_streamedTextures[streamedIndex];
+  streamed.targetLevel = newLevel;
+
+  // Copying the levels into staging memory can take a while for large textures, so record and submit on a worker:
+  const cassidy::Texture::DecodedImage* fullChain = &streamed.fullChain;
+  m_updateJobs = m_rendererRef->getEngineRef()->getJobSystem().pushJob([this, streamedIndex, fullChain, newLevel]() {
+    recordUpdate(streamedIndex, *fullChain, newLevel);
+    }, cassidy::JobSystem::Priority::LOW, m_updateJobs);
+}
+
+void cassidy::TextureStreamer::recordUpdate(uint32_t streamedIndex, const cassidy::Texture::DecodedImage& fullChain, uint32_t newLevel)
+{
+  CS_PROFILE_SCOPE("TextureStreamer::recordUpdate");
+
+  const VkDevice device = m_rendererRef->getLogicalDevice();
+  UploadContext& uploadContext = m_rendererRef->getUploadContext();
+
+  PendingUpdate update = {};
+  update.streamedIndex = streamedIndex;
+
+  update.staging = uploadContext.stagingRing.allocate(cassidy::Texture::getStagingSize(fullChain, newLevel));
+  std::vector<VkDeviceSize> levelOffsets;
+  cassidy::Texture::copyToStaging(fullChain, static_cast<uint8_t*>(update.staging.mappedData), levelOffsets, newLevel);
+
+  const VkExtent2D levelExtent = {
+    std::max(fullChain.extent.width >> newLevel, 1U),
+    std::max(fullChain.extent.height >> newLevel, 1U),
+  };
+  update.newTexture.allocateImage(levelExtent, m_allocator, m_rendererRef, fullChain.format, fullChain.getNumLevels() - newLevel);
+
+  // Each update records into its own transient pool, so workers never share a command buffer:
+  VkCommandPoolCreateInfo poolInfo = cassidy::init::commandPoolCreateInfo(VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+    uploadContext.uploadQueueFamily);
+  VK_CHECK(vkCreateCommandPool(device, &poolInfo, nullptr, &update.commandPool));
+
+  VkCommandBuffer uploadCmd;
+  VkCommandBufferAllocateInfo allocInfo = cassidy::init::commandBufferAllocInfo(update.commandPool,
+    VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1);
+  VK_CHECK(vkAllocateCommandBuffers(device, &allocInfo, &uploadCmd));
+
+  VkCommandBufferBeginInfo beginInfo = cassidy::init::commandBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, nullptr);
+  vkBeginCommandBuffer(uploadCmd, &beginInfo);
+  {
+    update.newTexture.recordUpload(uploadCmd, update.staging.buffer, update.staging.offset, levelOffsets);
+  }
+  vkEndCommandBuffer(uploadCmd);
+
+  VkFenceCreateInfo fenceInfo = cassidy::init::fenceCreateInfo(0);
+  VK_CHECK(vkCreateFence(device, &fenceInfo, nullptr, &update.fence));
+
+  VkSubmitInfo submitInfo = cassidy::init::submitInfo(0, nullptr, 0, 0, nullptr, 1, &uploadCmd);
+  {
+    // Queue access has to be externally synchronised with other upload submissions:
+    std::lock_guard<std::mutex> submitLock(uploadContext.submitMutex);
+    VK_CHECK(vkQueueSubmit(uploadContext.uploadQueue, 1, &submitInfo, update.fence));
+  }
+  uploadContext.stagingRing.retire(update.staging, update.fence);
+  update.newTexture.setLoadResult(LoadResult::SUCCESS);
+
+  std::lock_guard<std::mutex> pendingLock(m_pendingUpdatesMutex);
+  m_pendingUpdates.push_back(update);
+}
+
+void cassidy::TextureStreamer::releasePendingUpdate(const PendingUpdate& update)
+{
+  const VkDevice device = m_rendererRef->getLogicalDevice();
+
+  m_rendererRef->getUploadContext().stagingRing.free(update.staging);
+  vkDestroyFence(device, update.fence, nullptr);
+  vkDestroyCommandPool(device, update.commandPool, nullptr);
+}
+
+VkDeviceSize cassidy::TextureStreamer::getResidentSize(const StreamedTexture& streamed, uint32_t firstLevel) const
+{
+  VkDeviceSize size = 0;
+  for (uint32_t level = firstLevel; level < streamed.fullChain.getNumLevels(); ++level)
+    size += streamed.fullChain.getLevelSize(level);
+
+  return size;
+}
+
+void cassidy::TextureStreamer::queryDeviceMemory(VkDeviceSize& outUsage, VkDeviceSize& outBudget) const
+{
+  const VkPhysicalDeviceMemoryProperties* memoryProperties;
+  vmaGetMemoryProperties(m_allocator, &memoryProperties);
+
+  VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+  vmaGetHeapBudgets(m_allocator, budgets);
+
+  outUsage = 0;
+  outBudget = 0;
+  for (uint32_t i = 0; i < memoryProperties->memoryHeapCount; ++i)
+  {
+    if (!(memoryProperties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)) continue;
+
+    outUsage += budgets[i].usage;
+    outBudget += budgets[i].budget;
+  }
+
+  if (m_budgetBytes > 0)
+    outBudget = std::min(outBudget, m_budgetBytes);
+}
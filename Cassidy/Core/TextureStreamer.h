@@ -0,0 +1,130 @@
+#pragma once
+#include <Core/Texture.h>
+#include <Core/JobSystem.h>
+#include <Utils/ResourcePool.h>
+
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace cassidy
+{
+  class Renderer;
+
+  constexpr uint32_t STREAMING_INITIAL_MAX_DIMENSION = 128;   // (largest level uploaded when a streamed texture is first loaded)
+  constexpr uint32_t STREAMING_MAX_UPDATES_PER_FRAME = 4;
+  constexpr VkDeviceSize STREAMING_MAX_UPLOAD_BYTES_PER_FRAME = 32 * 1024 * 1024;
+  constexpr uint32_t STREAMING_UNUSED_FRAMES = 120;           // (frames without a request before a texture counts as unused)
+
+  // Keeps the full mip chains of streamed textures in system memory, with only some of each chain resident on the
+  // device. Textures start out with just their lowest levels, then have higher levels streamed in as the renderer
+  // requests them based on their screen-space usage. If device-local memory goes over budget, the top levels of the
+  // least recently used textures are evicted again.
+  //
+  // Changing a texture's resident levels creates a new image, uploaded on the upload queue without blocking the
+  // frame. Once that finishes, the texture swaps to the new image, materials using it get new descriptor sets,
+  // and the old image is destroyed when no frame in flight can still be sampling it.
+  class TextureStreamer
+  {
+  public:
+    struct Stats
+    {
+      uint32_t numStreamedTextures = 0;
+      uint32_t numPendingUpdates = 0;
+      VkDeviceSize residentBytes = 0;   // (of streamed textures only)
+      VkDeviceSize deviceUsage = 0;     // (every device-local heap, as reported by VMA)
+      VkDeviceSize deviceBudget = 0;    // (after applying the configured budget, if any)
+    };
+
+    void init(VmaAllocator allocator, cassidy::Renderer* rendererRef);
+    void release();
+
+    // First level to upload of a newly decoded texture, or 0 if it's too small to be worth streaming:
+    static uint32_t getInitialLevel(const cassidy::Texture::DecodedImage& image);
+
+    // Take ownership of a texture's full mip chain, once its levels from initialLevel onwards have been uploaded.
+    // Thread-safe, registered textures start streaming on the next update():
+    void registerTexture(cassidy::TextureHandle handle, cassidy::Texture* texture, cassidy::Texture::DecodedImage&& fullChain,
+      uint32_t initialLevel);
+
+    // Stop streaming a texture that's about to be destroyed, dropping its mip chain (once any upload still reading
+    // it has finished). Called on the main thread:
+    void unregisterTexture(cassidy::TextureHandle handle);
+
+    // Ask for enough of a texture's levels to be resident to draw it at the given number of screen pixels per unit of
+    // UV space (the largest request each frame wins). Called on the main thread between update()s, textures that
+    // aren't streamed are ignored:
+    void requestScreenSize(cassidy::TextureHandle handle, float pixelsPerUv);
+
+    // Finish completed uploads, then schedule new ones (or evictions) from this frame's requests. Called on the
+    // main thread once per frame, before any draws are recorded:
+    void update(uint64_t currentFrame);
+
+    // Cap on device-local memory usage (0 uses VMA's budget, which is a share of the heap unless VK_EXT_memory_budget
+    // is enabled):
+    inline void setBudget(VkDeviceSize budgetBytes) { m_budgetBytes = budgetBytes; }
+
+    // Getters/setters: ------------------------------------------------------------------------------------------
+    inline VkDeviceSize getBudget()         const { return m_budgetBytes; }
+    inline const Stats& getStats()          const { return m_stats; }
+    inline bool         isEnabled()         const { return m_isEnabled; }
+    inline void         setEnabled(bool isEnabled) { m_isEnabled = isEnabled; }
+
+  private:
+    struct StreamedTexture
+    {
+      cassidy::TextureHandle handle;
+      cassidy::Texture* texture;  // (null once unregistered)
+      cassidy::Texture::DecodedImage fullChain;
+      uint32_t initialLevel;      // (never evicted past this)
+      uint32_t residentLevel;
+      uint32_t targetLevel;       // (level being streamed to, equal to residentLevel when idle)
+      float requestedLevel;       // (lowest level requested since the last update)
+      uint64_t lastRequestFrame;
+      bool isRequested;
+    };
+
+    struct PendingUpdate
+    {
+      uint32_t streamedIndex;
+      cassidy::Texture newTexture;
+      VkCommandPool commandPool;
+      VkFence fence;
+      cassidy::StagingRingBuffer::Allocation staging;
+    };
+
+    struct RetiredImage
+    {
+      cassidy::Texture texture;
+      uint64_t retiredFrame;
+    };
+
+    void pollPendingUpdates(uint64_t currentFrame);
+    void scheduleUpdate(uint32_t streamedIndex, uint32_t newLevel);
+    void recordUpdate(uint32_t streamedIndex, const cassidy::Texture::DecodedImage& fullChain, uint32_t newLevel);
+    void releasePendingUpdate(const PendingUpdate& update);
+
+    VkDeviceSize getResidentSize(const StreamedTexture& streamed, uint32_t firstLevel) const;
+    void queryDeviceMemory(VkDeviceSize& outUsage, VkDeviceSize& outBudget) const;
+
+    VmaAllocator m_allocator = VK_NULL_HANDLE;
+    cassidy::Renderer* m_rendererRef = nullptr;
+    bool m_isEnabled = true;
+    VkDeviceSize m_budgetBytes = 0;
+    Stats m_stats;
+
+    std::deque<StreamedTexture> m_streamedTextures;   // (deque so update jobs can hold onto elements as more are added)
+    std::unordered_map<cassidy::TextureHandle, uint32_t, cassidy::ResourceHandleHash> m_streamedIndices;
+    std::vector<uint32_t> m_freeIndices;  // (of unregistered textures, reused by newly registered ones)
+
+    std::vector<StreamedTexture> m_newTextures;   // (registered since the last update)
+    std::mutex m_newTexturesMutex;
+
+    std::vector<PendingUpdate> m_pendingUpdates;
+    std::mutex m_pendingUpdatesMutex;
+    cassidy::JobHandle m_updateJobs;
+
+    std::vector<RetiredImage> m_retiredImages;
+  };
+}
@@ -0,0 +1,180 @@
+#include <Core/Mesh.h>
+#include <Core/Texture.h>
+#include <Core/Logger.h>
+#include <Utils/BlockCompression.h>
+#include <Utils/MipGenerator.h>
+#include <Utils/TextureContainer.h>
+#include <Utils/FileMapping.h>
+
+#include <Vendor/assimp/include/assimp/Importer.hpp>
+#include <Vendor/assimp/include/assimp/scene.h>
+#include <Vendor/stb/stb_image.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace
+{
+  // Pick the BC format a texture requested in the given uncompressed format is converted to:
+  VkFormat chooseBCFormat(VkFormat requestedFormat, const std::vector<uint8_t>& rgbaPixels)
+  {
+    switch (requestedFormat)
+    {
+    case VK_FORMAT_R8_UNORM:
+    case VK_FORMAT_R8_SRGB:
+      return VK_FORMAT_BC4_UNORM_BLOCK;
+    case VK_FORMAT_R8G8_UNORM:
+      return VK_FORMAT_BC5_UNORM_BLOCK;
+    case VK_FORMAT_R8G8B8A8_UNORM:
+      // (only normal maps are loaded as linear RGBA, keep their XY and reconstruct Z when sampling)
+      return VK_FORMAT_BC5_UNORM_BLOCK;
+    default:
+    {
+      bool isOpaque = true;
+      for (size_t i = 3; i < rgbaPixels.size() && isOpaque; i += 4)
+        isOpaque = rgbaPixels[i] == 255;
+
+      return isOpaque ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC3_SRGB_BLOCK;
+    }
+    }
+  }
+
+  bool convertTexture(const std::string& sourcePath, VkFormat requestedFormat)
+  {
+    cassidy::MappedFile sourceFile;
+    if (!sourceFile.open(sourcePath))
+    {
+      CS_LOG_ERROR("Failed to open {0}", sourcePath);
+      return false;
+    }
+
+    int width, height, numChannels;
+    const std::span<const uint8_t> sourceData = sourceFile.getData();
+    stbi_uc* pixels = stbi_load_from_memory(sourceData.data(), static_cast<int>(sourceData.size()), &width, &height,
+      &numChannels, STBI_rgb_alpha);
+    if (!pixels)
+    {
+      CS_LOG_ERROR("Failed to load {0} ({1})", sourcePath, stbi_failure_reason());
+      return false;
+    }
+
+    const std::vector<uint8_t> baseLevel(pixels, pixels + static_cast<size_t>(width) * height * 4);
+    stbi_image_free(pixels);
+
+    cassidy::helper::ContainerImage image;
+    image.format = chooseBCFormat(requestedFormat, baseLevel);
+    image.extent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+
+    // Offline, so use the sharper (slower) filter for the mip chain:
+    const bool isSrgb = requestedFormat == VK_FORMAT_R8G8B8A8_SRGB || requestedFormat == VK_FORMAT_R8_SRGB;
+    std::vector<uint8_t> mipChain;
+    std::vector<VkDeviceSize> mipOffsets;
+    cassidy::helper::generateMipChain(baseLevel.data(), image.extent.width, image.extent.height, 4, isSrgb,
+      cassidy::helper::MipFilter::KAISER, mipChain, mipOffsets);
+
+    // Compress every level of the full mip chain, down to 1x1:
+    std::vector<uint8_t> blocks;
+    for (uint32_t level = 0; level < mipOffsets.size(); ++level)
+    {
+      const uint32_t levelWidth = std::max(image.extent.width >> level, 1U);
+      const uint32_t levelHeight = std::max(image.extent.height >> level, 1U);
+      if (!cassidy::helper::compressBC(image.format, mipChain.data() + mipOffsets[level], levelWidth, levelHeight, blocks))
+        return false;
+
+      image.levelOffsets.push_back(image.data.size());
+      image.data.insert(image.data.end(), blocks.begin(), blocks.end());
+    }
+
+    const std::string outputPath = cassidy::Texture::getCompressedPath(sourcePath);
+    if (!cassidy::helper::writeDDS(outputPath, image))
+      return false;
+
+    CS_LOG_INFO("Wrote {0} ({1}x{2}, {3} levels, {4} KB)", outputPath, width, height, image.levelOffsets.size(),
+      image.data.size() / 1024);
+    return true;
+  }
+
+  bool isUpToDate(const std::string& sourcePath)
+  {
+    std::error_code errorCode;
+    const auto outputTime = std::filesystem::last_write_time(cassidy::Texture::getCompressedPath(sourcePath), errorCode);
+    if (errorCode) return false;
+
+    const auto sourceTime = std::filesystem::last_write_time(sourcePath, errorCode);
+    return !errorCode && outputTime >= sourceTime;
+  }
+}
+
+// Converts every texture referenced by the given models into a BC-compressed DDS (with its full mip chain) next to
+// the source image, which Texture::decode then loads in its place.
+// Usage: CassidyTexConv [--force] <model path>...
+int main(int argc, char* argv[])
+{
+  bool shouldForce = false;
+  std::vector<std::string> modelPaths;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "--force") == 0)
+      shouldForce = true;
+    else
+      modelPaths.push_back(argv[i]);
+  }
+
+  if (modelPaths.empty())
+  {
+    CS_LOG_ERROR("Usage: CassidyTexConv [--force] <model path>...");
+    return 1;
+  }
+
+  uint32_t numConverted = 0, numSkipped = 0, numFailed = 0;
+  std::set<std::string> convertedPaths;
+
+  for (const std::string& modelPath : modelPaths)
+  {
+    // Only materials are needed, so skip every post-process step:
+    Assimp::Importer importer;
+    const aiScene* scene = importer.ReadFile(modelPath, 0);
+    if (!scene)
+    {
+      CS_LOG_ERROR("Assimp failed to load {0} ({1})", modelPath, importer.GetErrorString());
+      ++numFailed;
+      continue;
+    }
+
+    const std::string directory = modelPath.substr(0, modelPath.find_last_of('/') + 1);
+
+    for (uint32_t i = 0; i < scene->mNumMaterials; ++i)
+    {
+      std::vector<cassidy::MeshCache::TextureRef> textureRefs;
+      cassidy::Model::gatherTextureRefs(scene->mMaterials[i], textureRefs);
+
+      for (const cassidy::MeshCache::TextureRef& texRef : textureRefs)
+      {
+        // Embedded textures ("*0", "*1", ...) are decoded straight from the model file, so can't be converted:
+        if (texRef.filename.empty() || texRef.filename[0] == '*') continue;
+
+        const std::string sourcePath = directory + texRef.filename;
+        if (cassidy::helper::isTextureContainerPath(sourcePath) || !convertedPaths.insert(sourcePath).second) continue;
+
+        if (!shouldForce && isUpToDate(sourcePath))
+        {
+          ++numSkipped;
+          continue;
+        }
+
+        if (convertTexture(sourcePath, texRef.format))
+          ++numConverted;
+        else
+          ++numFailed;
+      }
+    }
+  }
+
+  CS_LOG_INFO("Converted {0} textures ({1} already up to date, {2} failed)", numConverted, numSkipped, numFailed);
+  return numFailed == 0 ? 0 : 1;
+}
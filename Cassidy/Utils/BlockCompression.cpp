@@ -0,0 +1,237 @@
+#include "BlockCompression.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+  // Fit a line through the block's colours along their principal axis and snap every pixel to the nearest of the
+  // four colours interpolated between its 5:6:5 end points:
+  void compressColourBlock(const uint8_t block[16][4], uint8_t* outBlock)
+  {
+    float mean[3] = { 0.0f, 0.0f, 0.0f };
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+      for (uint32_t c = 0; c < 3; ++c)
+        mean[c] += block[i][c] / 16.0f;
+    }
+
+    float covariance[6] = {};   // (xx, xy, xz, yy, yz, zz)
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+      const float r = block[i][0] - mean[0];
+      const float g = block[i][1] - mean[1];
+      const float b = block[i][2] - mean[2];
+      covariance[0] += r * r; covariance[1] += r * g; covariance[2] += r * b;
+      covariance[3] += g * g; covariance[4] += g * b; covariance[5] += b * b;
+    }
+
+    // Power iteration converges on the principal axis quickly enough for a 3x3 matrix:
+    float axis[3] = { 1.0f, 1.0f, 1.0f };
+    for (uint32_t iteration = 0; iteration < 8; ++iteration)
+    {
+      const float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+      const float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+      const float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+      const float length = std::max({ std::fabs(x), std::fabs(y), std::fabs(z) });
+      if (length < 1e-6f) break;
+
+      axis[0] = x / length; axis[1] = y / length; axis[2] = z / length;
+    }
+
+    float minProjection = 1e30f;
+    float maxProjection = -1e30f;
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+      const float projection = (block[i][0] - mean[0]) * axis[0] + (block[i][1] - mean[1]) * axis[1] + (block[i][2] - mean[2]) * axis[2];
+      minProjection = std::min(minProjection, projection);
+      maxProjection = std::max(maxProjection, projection);
+    }
+
+    const float axisLengthSq = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+    const float scale = axisLengthSq > 0.0f ? 1.0f / axisLengthSq : 0.0f;
+
+    auto packEndPoint = [&](float projection) -> uint16_t {
+      const auto quantise = [](float value, uint32_t maxValue) {
+        return static_cast<uint32_t>(std::clamp(value, 0.0f, 255.0f) * maxValue / 255.0f + 0.5f);
+      };
+      const float r = mean[0] + axis[0] * projection * scale;
+      const float g = mean[1] + axis[1] * projection * scale;
+      const float b = mean[2] + axis[2] * projection * scale;
+      return static_cast<uint16_t>((quantise(r, 31) << 11) | (quantise(g, 63) << 5) | quantise(b, 31));
+    };
+
+    uint16_t colour0 = packEndPoint(maxProjection);
+    uint16_t colour1 = packEndPoint(minProjection);
+
+    // colour0 > colour1 selects four-colour mode (BC1's three-colour mode would make index 3 transparent black):
+    if (colour0 < colour1)
+      std::swap(colour0, colour1);
+
+    int32_t palette[4][3];
+    for (uint32_t p = 0; p < 2; ++p)
+    {
+      const uint16_t colour = p == 0 ? colour0 : colour1;
+      const uint32_t r5 = (colour >> 11) & 31;
+      const uint32_t g6 = (colour >> 5) & 63;
+      const uint32_t b5 = colour & 31;
+      palette[p][0] = static_cast<int32_t>((r5 << 3) | (r5 >> 2));
+      palette[p][1] = static_cast<int32_t>((g6 << 2) | (g6 >> 4));
+      palette[p][2] = static_cast<int32_t>((b5 << 3) | (b5 >> 2));
+    }
+    for (uint32_t c = 0; c < 3; ++c)
+    {
+      palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+      palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+
+    uint32_t indices = 0;
+    if (colour0 != colour1)
+    {
+      for (uint32_t i = 0; i < 16; ++i)
+      {
+        uint32_t bestIndex = 0;
+        int32_t bestError = INT32_MAX;
+        for (uint32_t p = 0; p < 4; ++p)
+        {
+          const int32_t dr = block[i][0] - palette[p][0];
+          const int32_t dg = block[i][1] - palette[p][1];
+          const int32_t db = block[i][2] - palette[p][2];
+          const int32_t error = dr * dr + dg * dg + db * db;
+          if (error < bestError)
+          {
+            bestError = error;
+            bestIndex = p;
+          }
+        }
+        indices |= bestIndex << (i * 2);
+      }
+    }
+
+    outBlock[0] = static_cast<uint8_t>(colour0);
+    outBlock[1] = static_cast<uint8_t>(colour0 >> 8);
+    outBlock[2] = static_cast<uint8_t>(colour1);
+    outBlock[3] = static_cast<uint8_t>(colour1 >> 8);
+    for (uint32_t i = 0; i < 4; ++i)
+      outBlock[4 + i] = static_cast<uint8_t>(indices >> (i * 8));
+  }
+
+  // Single-channel block (BC4, or BC3's alpha), using the eight-value mode between the block's min and max:
+  void compressChannelBlock(const uint8_t block[16][4], uint32_t channel, uint8_t* outBlock)
+  {
+    uint8_t maxValue = 0;
+    uint8_t minValue = 255;
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+      maxValue = std::max(maxValue, block[i][channel]);
+      minValue = std::min(minValue, block[i][channel]);
+    }
+
+    int32_t palette[8];
+    palette[0] = maxValue;
+    palette[1] = minValue;
+    for (int32_t p = 2; p < 8; ++p)
+      palette[p] = ((8 - p) * maxValue + (p - 1) * minValue) / 7;
+
+    uint64_t indices = 0;
+    if (maxValue != minValue)
+    {
+      for (uint32_t i = 0; i < 16; ++i)
+      {
+        uint64_t bestIndex = 0;
+        int32_t bestError = INT32_MAX;
+        for (uint32_t p = 0; p < 8; ++p)
+        {
+          const int32_t error = std::abs(block[i][channel] - palette[p]);
+          if (error < bestError)
+          {
+            bestError = error;
+            bestIndex = p;
+          }
+        }
+        indices |= bestIndex << (i * 3);
+      }
+    }
+
+    outBlock[0] = maxValue;
+    outBlock[1] = minValue;
+    for (uint32_t i = 0; i < 6; ++i)
+      outBlock[2 + i] = static_cast<uint8_t>(indices >> (i * 8));
+  }
+}
+
+uint32_t cassidy::helper::getBCBlockSize(VkFormat format)
+{
+  switch (format)
+  {
+  case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+  case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+  case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+  case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+  case VK_FORMAT_BC4_UNORM_BLOCK:
+  case VK_FORMAT_BC4_SNORM_BLOCK:
+    return 8;
+
+  case VK_FORMAT_BC3_UNORM_BLOCK:
+  case VK_FORMAT_BC3_SRGB_BLOCK:
+  case VK_FORMAT_BC5_UNORM_BLOCK:
+  case VK_FORMAT_BC5_SNORM_BLOCK:
+  case VK_FORMAT_BC7_UNORM_BLOCK:
+  case VK_FORMAT_BC7_SRGB_BLOCK:
+    return 16;
+
+  default:
+    return 0;
+  }
+}
+
+bool cassidy::helper::compressBC(VkFormat format, const uint8_t* rgbaPixels, uint32_t width, uint32_t height, std::vector<uint8_t>& outBlocks)
+{
+  const bool isColour = format == VK_FORMAT_BC1_RGB_UNORM_BLOCK || format == VK_FORMAT_BC1_RGB_SRGB_BLOCK ||
+    format == VK_FORMAT_BC3_UNORM_BLOCK || format == VK_FORMAT_BC3_SRGB_BLOCK;
+  const bool hasAlpha = format == VK_FORMAT_BC3_UNORM_BLOCK || format == VK_FORMAT_BC3_SRGB_BLOCK;
+  const bool isRed = format == VK_FORMAT_BC4_UNORM_BLOCK;
+  const bool isRedGreen = format == VK_FORMAT_BC5_UNORM_BLOCK;
+
+  if (!isColour && !isRed && !isRedGreen) return false;
+
+  const uint32_t blockSize = getBCBlockSize(format);
+  const uint32_t blocksWide = (width + 3) / 4;
+  const uint32_t blocksHigh = (height + 3) / 4;
+  outBlocks.resize(static_cast<size_t>(blocksWide) * blocksHigh * blockSize);
+
+  uint8_t block[16][4];
+  uint8_t* outBlock = outBlocks.data();
+
+  for (uint32_t by = 0; by < blocksHigh; ++by)
+  {
+    for (uint32_t bx = 0; bx < blocksWide; ++bx)
+    {
+      for (uint32_t i = 0; i < 16; ++i)
+      {
+        const uint32_t x = std::min(bx * 4 + (i % 4), width - 1);
+        const uint32_t y = std::min(by * 4 + (i / 4), height - 1);
+        const uint8_t* pixel = rgbaPixels + (static_cast<size_t>(y) * width + x) * 4;
+        std::copy(pixel, pixel + 4, block[i]);
+      }
+
+      if (hasAlpha)
+      {
+        compressChannelBlock(block, 3, outBlock);
+        compressColourBlock(block, outBlock + 8);
+      }
+      else if (isColour)
+      {
+        compressColourBlock(block, outBlock);
+      }
+      else
+      {
+        compressChannelBlock(block, 0, outBlock);
+        if (isRedGreen)
+          compressChannelBlock(block, 1, outBlock + 8);
+      }
+      outBlock += blockSize;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace cassidy::helper
+{
+  // Bytes per 4x4 block of a BC format, or 0 if the format isn't block-compressed:
+  uint32_t getBCBlockSize(VkFormat format);
+  inline bool isBlockCompressed(VkFormat format) { return getBCBlockSize(format) != 0; }
+
+  // Compress one level of tightly-packed RGBA8 pixels into BC1 (opaque colour), BC3 (colour and alpha), BC4 (red)
+  // or BC5 (red and green). Edge blocks of images that aren't a multiple of 4 wide/high repeat their last row/column.
+  // BC7 textures can be loaded, but have no encoder here, so compressing to BC7 returns false:
+  bool compressBC(VkFormat format, const uint8_t* rgbaPixels, uint32_t width, uint32_t height, std::vector<uint8_t>& outBlocks);
+}
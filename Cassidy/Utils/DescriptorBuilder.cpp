@@ -4,6 +4,7 @@
 #include <Utils/Initialisers.h>
 
 #include <algorithm>
+#include <numeric>
 
 cassidy::DescriptorBuilder cassidy::DescriptorBuilder::begin(DescriptorAllocator* allocator, DescriptorLayoutCache* layoutCache)
 {
@@ -29,9 +30,9 @@ cassidy::DescriptorBuilder& cassidy::DescriptorBuilder::bindBuffer(uint32_t bind
 }
 
 cassidy::DescriptorBuilder& cassidy::DescriptorBuilder::bindImage(uint32_t bindingIndex, 
-  VkDescriptorImageInfo* imageInfo, VkDescriptorType type, VkShaderStageFlags stageFlags)
+  VkDescriptorImageInfo* imageInfo, VkDescriptorType type, VkShaderStageFlags stageFlags, const VkSampler* immutableSampler)
 {
-  VkDescriptorSetLayoutBinding newBinding = cassidy::init::descriptorSetLayoutBinding(bindingIndex, type, 1, stageFlags, nullptr);
+  VkDescriptorSetLayoutBinding newBinding = cassidy::init::descriptorSetLayoutBinding(bindingIndex, type, 1, stageFlags, immutableSampler);
   m_bindings.push_back(newBinding);
 
   // (dstSet is left undefined, as it is set during the building of the final descriptor set object)
@@ -48,6 +49,17 @@ bool cassidy::DescriptorBuilder::build(VkDescriptorSet& set, VkDescriptorSetLayo
 
   layout = m_cache->createDescLayout(&info);
 
+  return buildWithLayout(set, layout);
+}
+
+bool cassidy::DescriptorBuilder::build(VkDescriptorSet& set)
+{
+  VkDescriptorSetLayout layout;
+  return build(set, layout);
+}
+
+bool cassidy::DescriptorBuilder::buildWithLayout(VkDescriptorSet& set, VkDescriptorSetLayout layout)
+{
   if (m_allocator->allocate(&set, layout) != VK_TRUE)
     return false;
 
@@ -60,12 +72,6 @@ bool cassidy::DescriptorBuilder::build(VkDescriptorSet& set, VkDescriptorSetLayo
   return true;
 }
 
-bool cassidy::DescriptorBuilder::build(VkDescriptorSet& set)
-{
-  VkDescriptorSetLayout layout;
-  return build(set, layout);
-}
-
 void cassidy::DescriptorAllocator::resetAllPools()
 {
   for (const auto& pool : m_usedDescriptorPools)
@@ -165,29 +171,44 @@ void cassidy::DescriptorLayoutCache::release()
 VkDescriptorSetLayout cassidy::DescriptorLayoutCache::createDescLayout(VkDescriptorSetLayoutCreateInfo* layoutCreateInfo)
 {
   DescriptorLayoutInfo layoutInfo;
+  layoutInfo.flags = layoutCreateInfo->flags;
   layoutInfo.bindings.reserve(layoutCreateInfo->bindingCount);
+  layoutInfo.bindingFlags.reserve(layoutCreateInfo->bindingCount);
+  layoutInfo.immutableSamplers.reserve(layoutCreateInfo->bindingCount);
 
-  bool isSorted = true;
-  int lastBinding = -1;
-
-  // Copy create info struct into bindings vector:
-  for (uint32_t i = 0; i < layoutCreateInfo->bindingCount; ++i)
+  // Per-binding flags are chained on, in the same order as the bindings they apply to:
+  const VkDescriptorBindingFlags* bindingFlags = nullptr;
+  for (const VkBaseInStructure* next = static_cast<const VkBaseInStructure*>(layoutCreateInfo->pNext); next; next = next->pNext)
   {
-    layoutInfo.bindings.push_back(layoutCreateInfo->pBindings[i]);
+    if (next->sType != VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO) continue;
 
-    // Keep track of whether bindings are in ascending order or not:
-    if (static_cast<int>(layoutCreateInfo->pBindings[i].binding) > lastBinding)
-      lastBinding = layoutCreateInfo->pBindings[i].binding;
-    else
-      isSorted = false;
+    const auto* flagsInfo = reinterpret_cast<const VkDescriptorSetLayoutBindingFlagsCreateInfo*>(next);
+    if (flagsInfo->bindingCount != 0)
+      bindingFlags = flagsInfo->pBindingFlags;
   }
 
-  // Sort bindings if they aren't already in order:
-  if (!isSorted)
-    std::sort(layoutInfo.bindings.begin(), layoutInfo.bindings.end(),
-      [](VkDescriptorSetLayoutBinding& a, VkDescriptorSetLayoutBinding& b) {
-        return a.binding < b.binding;
-      });
+  // Sort bindings into ascending order (if they aren't already), so the same bindings given in any order share a layout:
+  std::vector<uint32_t> order(layoutCreateInfo->bindingCount);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [layoutCreateInfo](uint32_t a, uint32_t b) {
+    return layoutCreateInfo->pBindings[a].binding < layoutCreateInfo->pBindings[b].binding;
+    });
+
+  // Copy create info struct into bindings vector. Immutable samplers are copied by handle, since the layout is
+  // defined by which samplers they are, and the array they were passed in may not outlive the cache:
+  for (const uint32_t i : order)
+  {
+    VkDescriptorSetLayoutBinding binding = layoutCreateInfo->pBindings[i];
+
+    std::vector<VkSampler> samplers;
+    if (binding.pImmutableSamplers)
+      samplers.assign(binding.pImmutableSamplers, binding.pImmutableSamplers + binding.descriptorCount);
+    binding.pImmutableSamplers = nullptr;
+
+    layoutInfo.bindings.push_back(binding);
+    layoutInfo.bindingFlags.push_back(bindingFlags ? bindingFlags[i] : 0);
+    layoutInfo.immutableSamplers.push_back(std::move(samplers));
+  }
 
   // Retrieve already-existing layout from cache, if it exists, otherwise create a new layout:
   if (m_layoutCache.find(layoutInfo) != m_layoutCache.end())
@@ -201,3 +222,13 @@ VkDescriptorSetLayout cassidy::DescriptorLayoutCache::createDescLayout(VkDescrip
   m_layoutCache[layoutInfo] = newLayout;
   return newLayout;
 }
+
+const cassidy::DescriptorLayoutCache::DescriptorLayoutInfo* cassidy::DescriptorLayoutCache::getLayoutInfo(VkDescriptorSetLayout layout) const
+{
+  for (const auto& [layoutInfo, cachedLayout] : m_layoutCache)
+  {
+    if (cachedLayout == layout)
+      return &layoutInfo;
+  }
+  return nullptr;
+}
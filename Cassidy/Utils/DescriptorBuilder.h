@@ -18,11 +18,15 @@ namespace cassidy
     static DescriptorBuilder begin(DescriptorAllocator* allocator, DescriptorLayoutCache* layoutCache);
 
     DescriptorBuilder& bindBuffer(uint32_t bindingIndex, VkDescriptorBufferInfo* bufferInfo, VkDescriptorType type, VkShaderStageFlags stageFlags);
-    DescriptorBuilder& bindImage(uint32_t bindingIndex, VkDescriptorImageInfo* imageInfo, VkDescriptorType type, VkShaderStageFlags stageFlags);
+    DescriptorBuilder& bindImage(uint32_t bindingIndex, VkDescriptorImageInfo* imageInfo, VkDescriptorType type, VkShaderStageFlags stageFlags,
+      const VkSampler* immutableSampler = nullptr);
 
     bool build(VkDescriptorSet& set, VkDescriptorSetLayout& layout);
     bool build(VkDescriptorSet& set);
 
+    // Allocate from an existing layout (e.g. one reflected from shaders) rather than one made from the bindings:
+    bool buildWithLayout(VkDescriptorSet& set, VkDescriptorSetLayout layout);
+
   private:
     std::vector<VkWriteDescriptorSet>         m_writes;
     std::vector<VkDescriptorSetLayoutBinding> m_bindings;
@@ -42,10 +46,14 @@ namespace cassidy
 
     struct DescriptorLayoutInfo
     {
-      std::vector<VkDescriptorSetLayoutBinding> bindings;
+      std::vector<VkDescriptorSetLayoutBinding> bindings;             // (pImmutableSamplers isn't kept, see below)
+      std::vector<VkDescriptorBindingFlags>     bindingFlags;         // (one per binding, 0 if none were chained on)
+      std::vector<std::vector<VkSampler>>       immutableSamplers;    // (one list per binding, empty if it has none)
+      VkDescriptorSetLayoutCreateFlags          flags = 0;
 
       bool operator==(const DescriptorLayoutInfo& other) const
       {
+        if (other.flags != flags) return false;
         if (other.bindings.size() != bindings.size()) return false;
         
         for (uint16_t i = 0; i < bindings.size(); ++i)
@@ -54,20 +62,28 @@ namespace cassidy
           if (other.bindings[i].descriptorType  != bindings[i].descriptorType)  return false;
           if (other.bindings[i].descriptorCount != bindings[i].descriptorCount) return false;
           if (other.bindings[i].stageFlags      != bindings[i].stageFlags)      return false;
+          if (other.bindingFlags[i]             != bindingFlags[i])             return false;
+          if (other.immutableSamplers[i]        != immutableSamplers[i])        return false;
         }
         return true;
       }
 
       size_t hash() const
       {
-        size_t result = std::hash<size_t>()(bindings.size());
+        size_t result = std::hash<size_t>()(bindings.size()) ^ std::hash<size_t>()(flags);
 
-        for (const VkDescriptorSetLayoutBinding& b : bindings)
+        for (size_t i = 0; i < bindings.size(); ++i)
         {
+          const VkDescriptorSetLayoutBinding& b = bindings[i];
+
           // Pack binding data into I64:
           size_t bindingHash = b.binding | b.descriptorType << 8 | b.descriptorCount << 16 | b.stageFlags << 24;
+          bindingHash |= static_cast<size_t>(bindingFlags[i]) << 32;
 
           result ^= std::hash<size_t>()(bindingHash);
+
+          for (const VkSampler sampler : immutableSamplers[i])
+            result ^= std::hash<VkSampler>()(sampler) + i;
         }
 
         return result;
@@ -82,6 +98,9 @@ namespace cassidy
       }
     };
 
+    // What a layout made by this cache was created from, or nullptr if the cache didn't make it:
+    const DescriptorLayoutInfo* getLayoutInfo(VkDescriptorSetLayout layout) const;
+
     std::unordered_map<DescriptorLayoutInfo, VkDescriptorSetLayout, DescriptorLayoutHash> m_layoutCache;
     VkDevice m_deviceRef;
   };
@@ -0,0 +1,118 @@
+#include "FileMapping.h"
+
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+cassidy::MappedFile::MappedFile(MappedFile&& other) noexcept :
+  m_data(std::exchange(other.m_data, nullptr)),
+  m_size(std::exchange(other.m_size, 0)),
+  m_fileHandle(std::exchange(other.m_fileHandle, nullptr)),
+  m_mappingHandle(std::exchange(other.m_mappingHandle, nullptr))
+{
+}
+
+cassidy::MappedFile& cassidy::MappedFile::operator=(MappedFile&& other) noexcept
+{
+  if (this != &other)
+  {
+    close();
+    m_data = std::exchange(other.m_data, nullptr);
+    m_size = std::exchange(other.m_size, 0);
+    m_fileHandle = std::exchange(other.m_fileHandle, nullptr);
+    m_mappingHandle = std::exchange(other.m_mappingHandle, nullptr);
+  }
+  return *this;
+}
+
+bool cassidy::MappedFile::open(const std::string& filepath)
+{
+  close();
+
+#ifdef _WIN32
+  // (assets are parsed front to back, so hint the cache manager to read ahead)
+  HANDLE file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+    FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+  {
+    CloseHandle(file);
+    return false;
+  }
+
+  HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (!mapping)
+  {
+    CloseHandle(file);
+    return false;
+  }
+
+  void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (!view)
+  {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return false;
+  }
+
+  m_fileHandle = file;
+  m_mappingHandle = mapping;
+  m_data = static_cast<const uint8_t*>(view);
+  m_size = static_cast<size_t>(fileSize.QuadPart);
+#else
+  const int fd = ::open(filepath.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+
+  struct stat fileStats;
+  if (fstat(fd, &fileStats) != 0 || fileStats.st_size == 0)
+  {
+    ::close(fd);
+    return false;
+  }
+
+  // (the mapping keeps its own reference to the file, so the descriptor isn't needed past here)
+  void* view = mmap(nullptr, static_cast<size_t>(fileStats.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (view == MAP_FAILED)
+    return false;
+
+  madvise(view, static_cast<size_t>(fileStats.st_size), MADV_SEQUENTIAL);
+
+  m_mappingHandle = view;
+  m_data = static_cast<const uint8_t*>(view);
+  m_size = static_cast<size_t>(fileStats.st_size);
+#endif
+
+  return true;
+}
+
+void cassidy::MappedFile::close()
+{
+  if (!m_data) return;
+
+#ifdef _WIN32
+  UnmapViewOfFile(m_data);
+  CloseHandle(static_cast<HANDLE>(m_mappingHandle));
+  CloseHandle(static_cast<HANDLE>(m_fileHandle));
+#else
+  munmap(m_mappingHandle, m_size);
+#endif
+
+  m_data = nullptr;
+  m_size = 0;
+  m_fileHandle = nullptr;
+  m_mappingHandle = nullptr;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <span>
+#include <string>
+
+namespace cassidy
+{
+  // Read-only memory mapping of a whole file, so loaders can parse assets in place instead of reading them into
+  // buffers of their own first. The view is valid until the file is closed (or the mapping is moved from), and
+  // starts on a page boundary, so is suitably aligned for any of the records stored in it.
+  //
+  // Files that are replaced while mapped should be replaced by renaming a new file over them, not rewritten in
+  // place, as truncating a mapped file invalidates the mapping.
+  class MappedFile
+  {
+  public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    // Fails if the file is missing, empty or can't be mapped:
+    bool open(const std::string& filepath);
+    void close();
+
+    // Getters/setters: ------------------------------------------------------------------------------------------
+    inline bool                       isOpen()    const { return m_data != nullptr; }
+    inline std::span<const uint8_t>   getData()   const { return { m_data, m_size }; }
+    inline size_t                     getSize()   const { return m_size; }
+
+  private:
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+
+    // Platform file/mapping handles:
+    void* m_fileHandle = nullptr;
+    void* m_mappingHandle = nullptr;
+  };
+}
@@ -0,0 +1,155 @@
+#include "Hash.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+  constexpr uint64_t PRIME_1 = 0x9E3779B185EBCA87ULL;
+  constexpr uint64_t PRIME_2 = 0xC2B2AE3D27D4EB4FULL;
+  constexpr uint64_t PRIME_3 = 0x165667B19E3779F9ULL;
+  constexpr uint64_t PRIME_4 = 0x85EBCA77C2B2AE63ULL;
+  constexpr uint64_t PRIME_5 = 0x27D4EB2F165667C5ULL;
+
+  inline uint64_t rotl(uint64_t value, uint32_t bits)
+  {
+    return (value << bits) | (value >> (64 - bits));
+  }
+
+  // (memcpy keeps unaligned reads well-defined, and compiles down to a plain load)
+  inline uint64_t read64(const uint8_t* bytes)
+  {
+    uint64_t value;
+    memcpy(&value, bytes, sizeof(value));
+    return value;
+  }
+
+  inline uint32_t read32(const uint8_t* bytes)
+  {
+    uint32_t value;
+    memcpy(&value, bytes, sizeof(value));
+    return value;
+  }
+
+  inline uint64_t round(uint64_t accumulator, uint64_t input)
+  {
+    accumulator += input * PRIME_2;
+    accumulator = rotl(accumulator, 31);
+    return accumulator * PRIME_1;
+  }
+
+  inline uint64_t mergeRound(uint64_t hash, uint64_t accumulator)
+  {
+    hash ^= round(0, accumulator);
+    return hash * PRIME_1 + PRIME_4;
+  }
+
+  // Consume every whole 32-byte stripe, returning the number of bytes consumed:
+  inline size_t processStripes(uint64_t (&accumulators)[4], const uint8_t* bytes, size_t size)
+  {
+    const uint8_t* const start = bytes;
+    const uint8_t* const limit = bytes + (size & ~size_t(31));
+    while (bytes < limit)
+    {
+      accumulators[0] = round(accumulators[0], read64(bytes));
+      accumulators[1] = round(accumulators[1], read64(bytes + 8));
+      accumulators[2] = round(accumulators[2], read64(bytes + 16));
+      accumulators[3] = round(accumulators[3], read64(bytes + 24));
+      bytes += 32;
+    }
+    return static_cast<size_t>(bytes - start);
+  }
+
+  inline uint64_t finalise(uint64_t hash, const uint8_t* bytes, size_t size)
+  {
+    while (size >= 8)
+    {
+      hash ^= round(0, read64(bytes));
+      hash = rotl(hash, 27) * PRIME_1 + PRIME_4;
+      bytes += 8;
+      size -= 8;
+    }
+    if (size >= 4)
+    {
+      hash ^= static_cast<uint64_t>(read32(bytes)) * PRIME_1;
+      hash = rotl(hash, 23) * PRIME_2 + PRIME_3;
+      bytes += 4;
+      size -= 4;
+    }
+    while (size > 0)
+    {
+      hash ^= (*bytes) * PRIME_5;
+      hash = rotl(hash, 11) * PRIME_1;
+      ++bytes;
+      --size;
+    }
+
+    hash ^= hash >> 33;
+    hash *= PRIME_2;
+    hash ^= hash >> 29;
+    hash *= PRIME_3;
+    hash ^= hash >> 32;
+    return hash;
+  }
+
+  inline uint64_t mergeAccumulators(const uint64_t (&accumulators)[4])
+  {
+    uint64_t hash = rotl(accumulators[0], 1) + rotl(accumulators[1], 7) + rotl(accumulators[2], 12) + rotl(accumulators[3], 18);
+    for (const uint64_t accumulator : accumulators)
+    {
+      hash = mergeRound(hash, accumulator);
+    }
+    return hash;
+  }
+}
+
+uint64_t cassidy::hash::xxHash64(const void* data, size_t size, uint64_t seed)
+{
+  XXHash64 hasher(seed);
+  hasher.update(data, size);
+  return hasher.digest();
+}
+
+cassidy::hash::XXHash64::XXHash64(uint64_t seed)
+  : m_seed(seed)
+{
+  m_accumulators[0] = seed + PRIME_1 + PRIME_2;
+  m_accumulators[1] = seed + PRIME_2;
+  m_accumulators[2] = seed;
+  m_accumulators[3] = seed - PRIME_1;
+}
+
+void cassidy::hash::XXHash64::update(const void* data, size_t size)
+{
+  if (size == 0) return;
+
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  m_totalSize += size;
+
+  // Top up a partial stripe left over from the previous update first:
+  if (m_bufferSize > 0)
+  {
+    const size_t numToCopy = std::min<size_t>(size, sizeof(m_buffer) - m_bufferSize);
+    memcpy(m_buffer + m_bufferSize, bytes, numToCopy);
+    m_bufferSize += static_cast<uint32_t>(numToCopy);
+    bytes += numToCopy;
+    size -= numToCopy;
+
+    if (m_bufferSize < sizeof(m_buffer)) return;
+
+    processStripes(m_accumulators, m_buffer, sizeof(m_buffer));
+    m_bufferSize = 0;
+  }
+
+  const size_t numConsumed = processStripes(m_accumulators, bytes, size);
+  memcpy(m_buffer, bytes + numConsumed, size - numConsumed);
+  m_bufferSize = static_cast<uint32_t>(size - numConsumed);
+}
+
+uint64_t cassidy::hash::XXHash64::digest() const
+{
+  // Inputs shorter than one stripe never touch the accumulators:
+  uint64_t hash = m_totalSize >= 32 ? mergeAccumulators(m_accumulators) : m_seed + PRIME_5;
+  hash += m_totalSize;
+
+  return finalise(hash, m_buffer, m_bufferSize);
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+namespace cassidy::hash
+{
+  // 64-bit xxHash (XXH64) of a block of memory, fast enough to key caches on the contents of whole images or files:
+  uint64_t xxHash64(const void* data, size_t size, uint64_t seed = 0);
+
+  // Mix a value into an existing hash, for keys made up of several fields:
+  inline uint64_t combine(uint64_t hash, uint64_t value)
+  {
+    return hash ^ (value + 0x9E3779B97F4A7C15ULL + (hash << 6) + (hash >> 2));
+  }
+
+  // XXH64 over data fed in several pieces (e.g. a file read in chunks), giving the same result as hashing it in one go:
+  class XXHash64
+  {
+  public:
+    explicit XXHash64(uint64_t seed = 0);
+
+    void update(const void* data, size_t size);
+    uint64_t digest() const;
+
+  private:
+    uint64_t m_accumulators[4];
+    uint64_t m_seed;
+    uint64_t m_totalSize = 0;
+    uint8_t m_buffer[32];   // (input not yet making up a whole 32-byte stripe)
+    uint32_t m_bufferSize = 0;
+  };
+}
@@ -8,6 +8,7 @@
 #include <map>
 #include <vector>
 #include <algorithm>
+#include <cstring>
 
 // Assign a score to a physical device given its capabilities:
 int32_t cassidy::helper::ratePhysicalDevice(VkPhysicalDevice device)
@@ -90,8 +91,12 @@ QueueFamilyIndices cassidy::helper::findQueueFamilies(VkPhysicalDevice device, V
     if (qf.queueFlags & VK_QUEUE_GRAPHICS_BIT)
       indices.graphicsFamily = i;
 
+    // Without a surface (headless) nothing is presented, so the graphics family stands in for the present family:
     VkBool32 presentSupport = false;
-    vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+    if (surface != VK_NULL_HANDLE)
+      vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+    else
+      presentSupport = (qf.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
 
     if (presentSupport)
       indices.presentFamily = i;
@@ -147,6 +152,26 @@ SwapchainSupportDetails cassidy::helper::querySwapchainSupport(VkPhysicalDevice
   return details;
 }
 
+bool cassidy::helper::areInstanceLayersAvailable(const std::vector<const char*>& layerNames)
+{
+  uint32_t numAvailableLayers = 0;
+  vkEnumerateInstanceLayerProperties(&numAvailableLayers, nullptr);
+
+  std::vector<VkLayerProperties> availableLayers(numAvailableLayers);
+  vkEnumerateInstanceLayerProperties(&numAvailableLayers, availableLayers.data());
+
+  for (const char* layerName : layerNames)
+  {
+    const bool isAvailable = std::any_of(availableLayers.begin(), availableLayers.end(), [=](const VkLayerProperties& layer) {
+      return strcmp(layer.layerName, layerName) == 0;
+      });
+
+    if (!isAvailable)
+      return false;
+  }
+  return true;
+}
+
 void cassidy::helper::queryAvailableExtensions(VkPhysicalDevice physicalDevice, const char* layerName, std::vector<VkExtensionProperties>& availableExtensions)
 {
   uint32_t numAvailableExtensions;
@@ -269,6 +294,8 @@ VkSampler cassidy::helper::createTextureSampler(const VkDevice& device, const Vk
 
 void cassidy::helper::immediateSubmit(VkDevice device, UploadContext& uploadContext, std::function<void(VkCommandBuffer cmd)>&& function)
 {
+  std::lock_guard<std::mutex> submitLock(uploadContext.submitMutex);
+
   VkCommandBufferBeginInfo beginInfo = cassidy::init::commandBufferBeginInfo(VK_COMMAND_BUFFER_LEVEL_PRIMARY, nullptr);
 
   vkBeginCommandBuffer(uploadContext.uploadCommandBuffer, &beginInfo);
@@ -318,96 +345,25 @@ void cassidy::helper::transitionImageLayout(VkCommandBuffer cmd, VkImage image,
     1, &barrier);
 }
 
-void cassidy::helper::generateMipmaps(VkImage image, VkCommandBuffer cmd, VkFormat format, uint32_t width, uint32_t height, uint8_t mipLevels)
+std::string cassidy::helper::escapeJSON(const std::string& str)
 {
-  VkImageSubresourceRange range = {
-  .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-  .levelCount = 1,
-  .baseArrayLayer = 0,
-  .layerCount = 1,
-  };
-
-  VkImageMemoryBarrier barrier = {
-    .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-    .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-    .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-    .image = image,
-    .subresourceRange = range,
-  };
-
-  int32_t mipWidth = width;
-  int32_t mipHeight = height;
-
-  // Blit lower mip level into level above it at progressively halving resolutions:
-  for (uint8_t i = 1; i < mipLevels; ++i)
+  std::string escaped;
+  escaped.reserve(str.size());
+  for (const char c : str)
   {
-    // Transition layout of current mip level to TRANSFER_SRC for blit:
-    barrier.subresourceRange.baseMipLevel = i - 1;
-    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-
-    vkCmdPipelineBarrier(cmd,
-      VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
-      0,
-      0, nullptr,
-      0, nullptr,
-      1, &barrier);
-
-    const VkImageSubresourceLayers srcLayers = {
-      .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-      .mipLevel = static_cast<uint32_t>(i - 1),
-      .baseArrayLayer = 0,
-      .layerCount = 1,
-    };
-    const VkImageSubresourceLayers dstLayers = {
-      .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-      .mipLevel = i,
-      .baseArrayLayer = 0,
-      .layerCount = 1,
-    };
-
-    VkImageBlit blit = {
-      .srcSubresource = srcLayers,
-      .srcOffsets = { { 0, 0, 0, }, { mipWidth, mipHeight, 1} },
-      .dstSubresource = dstLayers,
-      .dstOffsets = { { 0, 0, 0 }, { mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1 } },
-    };
-
-    vkCmdBlitImage(cmd,
-      image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-      image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-      1, &blit, VK_FILTER_LINEAR);
-
-    // Transition layout of current mip level to SHADER_READ_ONLY_OPTIMAL:
-    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-    vkCmdPipelineBarrier(cmd,
-      VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-      0,
-      0, nullptr,
-      0, nullptr,
-      1, &barrier);
-
-    if (mipWidth > 1) mipWidth /= 2;
-    if (mipHeight > 1) mipHeight /= 2;
-  }
-
-  // Transition final mip level:
-  barrier.subresourceRange.baseMipLevel = mipLevels - 1;
-  barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-  barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    // Control characters aren't allowed unescaped in JSON strings, so write them as \u00XX:
+    if (static_cast<unsigned char>(c) < 0x20)
+    {
+      constexpr char hexDigits[] = "0123456789abcdef";
+      escaped += "\\u00";
+      escaped.push_back(hexDigits[(c >> 4) & 0xF]);
+      escaped.push_back(hexDigits[c & 0xF]);
+      continue;
+    }
 
-  vkCmdPipelineBarrier(cmd,
-    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-    0,
-    0, nullptr,
-    0, nullptr,
-    1, &barrier);
+    if (c == '"' || c == '\\')
+      escaped.push_back('\\');
+    escaped.push_back(c);
+  }
+  return escaped;
 }
@@ -2,6 +2,7 @@
 
 #include "Utils/Types.h"
 #include <functional>
+#include <string>
 #include <iostream>
 
 #define VK_CHECK(x)													                    \
@@ -28,6 +29,8 @@ namespace cassidy::helper
 
   SwapchainSupportDetails querySwapchainSupport(VkPhysicalDevice device, VkSurfaceKHR surface);
 
+  bool areInstanceLayersAvailable(const std::vector<const char*>& layerNames);
+
   void queryAvailableExtensions(VkPhysicalDevice physicalDevice, const char* layerName, std::vector<VkExtensionProperties>& availableExtensions);
 
   bool isSwapchainPresentModeSupported(uint32_t numAvailableModes, VkPresentModeKHR* availableModes, VkPresentModeKHR desiredMode);
@@ -47,5 +50,6 @@ namespace cassidy::helper
     VkPipelineStageFlags srcStageFlags, VkPipelineStageFlags dstStageFlags,
     uint8_t mipLevels);
 
-  void generateMipmaps(VkImage image, VkCommandBuffer cmd, VkFormat format, uint32_t width, uint32_t height, uint8_t mipLevels);
+  // Escape a string for writing between quotes in a JSON file (quotes, backslashes and control characters):
+  std::string escapeJSON(const std::string& str);
 }
\ No newline at end of file
@@ -0,0 +1,131 @@
+#include "ImageWriter.h"
+#include <Core/Logger.h>
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+  constexpr uint8_t PNG_SIGNATURE[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+  constexpr uint32_t MAX_STORED_BLOCK_SIZE = 65535;   // (deflate's limit for uncompressed blocks)
+
+  std::array<uint32_t, 256> buildCrcTable()
+  {
+    std::array<uint32_t, 256> table;
+    for (uint32_t i = 0; i < 256; ++i)
+    {
+      uint32_t c = i;
+      for (uint32_t k = 0; k < 8; ++k)
+        c = (c & 1) ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+      table[i] = c;
+    }
+    return table;
+  }
+
+  uint32_t updateCrc(uint32_t crc, const uint8_t* data, size_t size)
+  {
+    static const std::array<uint32_t, 256> crcTable = buildCrcTable();
+
+    for (size_t i = 0; i < size; ++i)
+      crc = crcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return crc;
+  }
+
+  void appendU32BigEndian(std::vector<uint8_t>& out, uint32_t value)
+  {
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+  }
+
+  void appendChunk(std::vector<uint8_t>& out, const char type[4], const std::vector<uint8_t>& data)
+  {
+    appendU32BigEndian(out, static_cast<uint32_t>(data.size()));
+
+    const size_t typeOffset = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+
+    // CRC covers the chunk type and data, but not the length:
+    const uint32_t crc = updateCrc(0xFFFFFFFFU, out.data() + typeOffset, out.size() - typeOffset) ^ 0xFFFFFFFFU;
+    appendU32BigEndian(out, crc);
+  }
+}
+
+bool cassidy::helper::writePNG(const std::string& filepath, uint32_t width, uint32_t height, const uint8_t* rgbaPixels)
+{
+  if (width == 0 || height == 0 || !rgbaPixels)
+  {
+    CS_LOG_ERROR("Can't write empty image to {0}!", filepath);
+    return false;
+  }
+
+  // Scanlines each start with a filter type byte (0 = no filtering):
+  const size_t rowSize = static_cast<size_t>(width) * 4;
+  std::vector<uint8_t> scanlines;
+  scanlines.reserve((rowSize + 1) * height);
+  for (uint32_t y = 0; y < height; ++y)
+  {
+    scanlines.push_back(0);
+    scanlines.insert(scanlines.end(), rgbaPixels + y * rowSize, rgbaPixels + (y + 1) * rowSize);
+  }
+
+  // Wrap scanlines in a zlib stream made of uncompressed deflate blocks:
+  std::vector<uint8_t> zlibData;
+  zlibData.reserve(scanlines.size() + scanlines.size() / MAX_STORED_BLOCK_SIZE * 5 + 16);
+  zlibData.push_back(0x78);   // (deflate, 32K window)
+  zlibData.push_back(0x01);   // (no preset dictionary, fastest compression level, header checksum)
+
+  uint32_t adlerA = 1;
+  uint32_t adlerB = 0;
+  size_t offset = 0;
+  do
+  {
+    const uint32_t blockSize = static_cast<uint32_t>(std::min<size_t>(scanlines.size() - offset, MAX_STORED_BLOCK_SIZE));
+    const bool isFinalBlock = offset + blockSize == scanlines.size();
+
+    zlibData.push_back(isFinalBlock ? 1 : 0);
+    zlibData.push_back(static_cast<uint8_t>(blockSize));
+    zlibData.push_back(static_cast<uint8_t>(blockSize >> 8));
+    zlibData.push_back(static_cast<uint8_t>(~blockSize));
+    zlibData.push_back(static_cast<uint8_t>(~blockSize >> 8));
+    zlibData.insert(zlibData.end(), scanlines.begin() + offset, scanlines.begin() + offset + blockSize);
+
+    for (size_t i = offset; i < offset + blockSize; ++i)
+    {
+      adlerA = (adlerA + scanlines[i]) % 65521;
+      adlerB = (adlerB + adlerA) % 65521;
+    }
+    offset += blockSize;
+  } while (offset < scanlines.size());
+
+  appendU32BigEndian(zlibData, (adlerB << 16) | adlerA);
+
+  std::vector<uint8_t> header;
+  appendU32BigEndian(header, width);
+  appendU32BigEndian(header, height);
+  header.push_back(8);  // Bit depth
+  header.push_back(6);  // Colour type (RGBA)
+  header.push_back(0);  // Compression method
+  header.push_back(0);  // Filter method
+  header.push_back(0);  // Interlace method
+
+  std::vector<uint8_t> fileData(std::begin(PNG_SIGNATURE), std::end(PNG_SIGNATURE));
+  appendChunk(fileData, "IHDR", header);
+  appendChunk(fileData, "IDAT", zlibData);
+  appendChunk(fileData, "IEND", {});
+
+  std::ofstream file(filepath, std::ios::binary);
+  if (!file.is_open())
+  {
+    CS_LOG_ERROR("Failed to open {0} for writing!", filepath);
+    return false;
+  }
+  file.write(reinterpret_cast<const char*>(fileData.data()), fileData.size());
+
+  CS_LOG_INFO("Wrote {0}x{1} image to {2}", width, height, filepath);
+  return file.good();
+}
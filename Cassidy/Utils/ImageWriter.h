@@ -0,0 +1,10 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+namespace cassidy::helper
+{
+  // Write tightly-packed 8-bit RGBA pixels to an uncompressed PNG file. The output is bigger than an encoder would
+  // produce but needs no compression library, and is deterministic for the same pixels (for image-diff tests):
+  bool writePNG(const std::string& filepath, uint32_t width, uint32_t height, const uint8_t* rgbaPixels);
+}
@@ -170,7 +170,7 @@ VkImageViewCreateInfo cassidy::init::imageViewCreateInfo(VkImage image, VkFormat
 }
 
 VmaAllocationCreateInfo cassidy::init::vmaAllocationCreateInfo(VmaMemoryUsage usageFlags, 
-  VmaAllocationCreateFlagBits allocFlags)
+  VmaAllocationCreateFlags allocFlags)
 {
   VmaAllocationCreateInfo info = {};
   info.usage = usageFlags;
@@ -656,7 +656,7 @@ VkDescriptorSetAllocateInfo cassidy::init::descriptorSetAllocateInfo(VkDescripto
   return info;
 }
 
-VkDescriptorBufferInfo cassidy::init::descriptorBufferInfo(VkBuffer bufferHandle, uint32_t offset, uint32_t range)
+VkDescriptorBufferInfo cassidy::init::descriptorBufferInfo(VkBuffer bufferHandle, VkDeviceSize offset, VkDeviceSize range)
 {
   VkDescriptorBufferInfo info = {};
   info.buffer = bufferHandle;
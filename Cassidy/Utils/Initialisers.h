@@ -79,7 +79,7 @@ namespace cassidy::init
   // VMA memory allocation create info:
   VmaAllocationCreateInfo vmaAllocationCreateInfo(
     VmaMemoryUsage usageFlags,
-    VmaAllocationCreateFlagBits allocFlags
+    VmaAllocationCreateFlags allocFlags
   );
 
   // Shader module create info:
@@ -309,8 +309,8 @@ namespace cassidy::init
   );
   VkDescriptorBufferInfo descriptorBufferInfo(
     VkBuffer bufferHandle,
-    uint32_t offset,
-    uint32_t range
+    VkDeviceSize offset,
+    VkDeviceSize range
   );
   VkDescriptorImageInfo descriptorImageInfo(
     VkImageLayout imageLayout,
@@ -0,0 +1,88 @@
+#include "LinearUniformAllocator.h"
+#include <Core/Logger.h>
+#include <Utils/Helpers.h>
+#include <Utils/Initialisers.h>
+
+#include <algorithm>
+
+void cassidy::LinearUniformAllocator::init(VmaAllocator allocator, const VkPhysicalDeviceProperties& gpuProperties,
+  uint32_t bytesPerFrame, uint32_t numFrames, VkBufferUsageFlags usage)
+{
+  m_allocator = allocator;
+  m_alignment = cassidy::helper::padUniformBufferSize(1, gpuProperties);
+  m_bytesPerFrame = bytesPerFrame;
+  m_numFrames = numFrames;
+  m_usage = usage;
+
+  // Offsets have to satisfy both limits if the buffer is also bound as a dynamic storage buffer:
+  if (usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)
+    m_alignment = std::max(m_alignment, static_cast<uint32_t>(gpuProperties.limits.minStorageBufferOffsetAlignment));
+
+  createBuffer();
+}
+
+void cassidy::LinearUniformAllocator::release()
+{
+  vmaDestroyBuffer(m_allocator, m_buffer, m_allocation);
+  m_buffer = VK_NULL_HANDLE;
+  m_allocation = VK_NULL_HANDLE;
+  m_mappedData = nullptr;
+}
+
+void cassidy::LinearUniformAllocator::resize(uint32_t bytesPerFrame)
+{
+  vmaDestroyBuffer(m_allocator, m_buffer, m_allocation);
+  m_bytesPerFrame = bytesPerFrame;
+
+  createBuffer();
+}
+
+void cassidy::LinearUniformAllocator::beginFrame(uint32_t frameIndex)
+{
+  m_frameBaseOffset = frameIndex * m_bytesPerFrame;
+  m_cursor.store(0, std::memory_order_relaxed);
+}
+
+cassidy::LinearUniformAllocator::Allocation cassidy::LinearUniformAllocator::allocate(uint32_t size)
+{
+  const uint32_t alignedSize = (size + m_alignment - 1) & ~(m_alignment - 1);
+  const uint32_t offset = m_cursor.fetch_add(alignedSize, std::memory_order_relaxed);
+
+  if (offset + alignedSize > m_bytesPerFrame)
+  {
+    CS_LOG_ERROR("Linear uniform allocator is out of space for this frame! ({0} bytes requested)", size);
+    return {};
+  }
+
+  Allocation newAllocation;
+  newAllocation.dynamicOffset = m_frameBaseOffset + offset;
+  newAllocation.mappedData = m_mappedData + newAllocation.dynamicOffset;
+  return newAllocation;
+}
+
+void cassidy::LinearUniformAllocator::flush()
+{
+  const uint32_t numBytesAllocated = std::min(m_cursor.load(std::memory_order_relaxed), m_bytesPerFrame);
+  if (numBytesAllocated == 0) return;
+
+  vmaFlushAllocation(m_allocator, m_allocation, m_frameBaseOffset, numBytesAllocated);
+}
+
+void cassidy::LinearUniformAllocator::createBuffer()
+{
+  // Keep every frame's base offset aligned, so allocation offsets only depend on the cursor:
+  m_bytesPerFrame = (m_bytesPerFrame + m_alignment - 1) & ~(m_alignment - 1);
+
+  VkBufferCreateInfo bufferInfo = cassidy::init::bufferCreateInfo(m_bytesPerFrame * m_numFrames, m_usage);
+  VmaAllocationCreateInfo allocInfo = cassidy::init::vmaAllocationCreateInfo(VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
+    VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT);
+
+  VmaAllocationInfo allocationInfo;
+  VK_CHECK(vmaCreateBuffer(m_allocator, &bufferInfo, &allocInfo, &m_buffer, &m_allocation, &allocationInfo));
+
+  m_mappedData = static_cast<uint8_t*>(allocationInfo.pMappedData);
+  m_frameBaseOffset = 0;
+  m_cursor = 0;
+
+  CS_LOG_INFO("Created linear uniform allocator ({0} KB per frame)!", m_bytesPerFrame / 1024);
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include "Vendor/vma/vk_mem_alloc.h"
+
+#include <atomic>
+#include <cstring>
+
+namespace cassidy
+{
+  // Persistently-mapped uniform (and optionally storage) buffer split into one region per frame in flight. Per-draw data is bump-allocated
+  // from the current frame's region and bound through a dynamic descriptor with the returned offset. The region
+  // is reused once that frame's fence has been waited on, so nothing is ever freed individually.
+  class LinearUniformAllocator
+  {
+  public:
+    struct Allocation
+    {
+      void* mappedData        = nullptr;
+      uint32_t dynamicOffset  = 0;
+    };
+
+    void init(VmaAllocator allocator, const VkPhysicalDeviceProperties& gpuProperties, uint32_t bytesPerFrame,
+      uint32_t numFrames, VkBufferUsageFlags usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+    void release();
+
+    // Recreate the buffer with a different per-frame size. Every frame using the old buffer must have finished
+    // executing, and descriptors referencing it have to be rewritten with getBuffer():
+    void resize(uint32_t bytesPerFrame);
+
+    // Start allocating from the given frame's region, discarding everything allocated there previously:
+    void beginFrame(uint32_t frameIndex);
+
+    // Thread-safe, so command buffers recorded in parallel can allocate from the same frame:
+    Allocation allocate(uint32_t size);
+
+    template<typename T>
+    inline Allocation push(const T& data)
+    {
+      Allocation allocation = allocate(sizeof(T));
+      if (allocation.mappedData)
+        memcpy(allocation.mappedData, &data, sizeof(T));
+      return allocation;
+    }
+
+    // Make this frame's writes visible to the device (no-op on host-coherent memory):
+    void flush();
+
+    // Getters/setters: ------------------------------------------------------------------------------------------
+    inline VkBuffer getBuffer()               const { return m_buffer; }
+    inline uint32_t getBytesPerFrame()        const { return m_bytesPerFrame; }
+    inline uint32_t getNumBytesAllocated()    const { return m_cursor.load(std::memory_order_relaxed); }
+
+  private:
+    void createBuffer();
+
+    VmaAllocator m_allocator = VK_NULL_HANDLE;
+
+    VkBuffer m_buffer = VK_NULL_HANDLE;
+    VmaAllocation m_allocation = VK_NULL_HANDLE;
+    uint8_t* m_mappedData = nullptr;
+
+    uint32_t m_alignment = 256;
+    uint32_t m_bytesPerFrame = 0;
+    uint32_t m_numFrames = 0;
+    VkBufferUsageFlags m_usage = 0;
+    uint32_t m_frameBaseOffset = 0;
+    std::atomic<uint32_t> m_cursor = 0;   // (relative to current frame's base offset)
+  };
+}
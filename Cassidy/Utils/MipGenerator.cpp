@@ -0,0 +1,308 @@
+#include "MipGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CS_MIPGEN_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+  // Every pixel is filtered as four floats regardless of its channel count, so one pixel is one SSE register:
+  struct alignas(16) Pixel
+  {
+    float c[4];
+  };
+
+  // Weights of the source pixels contributing to one destination pixel, along one axis:
+  struct FilterTaps
+  {
+    uint32_t firstWeight;
+    uint32_t numWeights;
+    int32_t firstSource;
+  };
+
+  struct FilterKernel
+  {
+    std::vector<FilterTaps> taps;       // (one per destination pixel)
+    std::vector<float> weights;
+    std::vector<uint32_t> sourceIndices; // (clamped to the image, parallel to weights)
+  };
+
+  constexpr float KAISER_RADIUS = 3.0f;   // (in destination pixels)
+  constexpr float KAISER_ALPHA = 4.0f;
+
+  float besselI0(float x)
+  {
+    // Power series, converges quickly for the small arguments used here:
+    float sum = 1.0f, term = 1.0f;
+    const float halfXSq = x * x * 0.25f;
+    for (int k = 1; k < 32; ++k)
+    {
+      term *= halfXSq / static_cast<float>(k * k);
+      sum += term;
+      if (term < sum * 1e-7f) break;
+    }
+    return sum;
+  }
+
+  float sinc(float x)
+  {
+    if (std::abs(x) < 1e-5f) return 1.0f;
+    const float piX = 3.14159265f * x;
+    return std::sin(piX) / piX;
+  }
+
+  float kaiserWindowedSinc(float x)
+  {
+    const float t = x / KAISER_RADIUS;
+    if (std::abs(t) >= 1.0f) return 0.0f;
+    return sinc(x) * besselI0(KAISER_ALPHA * std::sqrt(1.0f - t * t)) / besselI0(KAISER_ALPHA);
+  }
+
+  FilterKernel buildKernel(uint32_t srcSize, uint32_t dstSize, cassidy::helper::MipFilter filter)
+  {
+    FilterKernel kernel;
+    kernel.taps.resize(dstSize);
+
+    const float scale = static_cast<float>(srcSize) / static_cast<float>(dstSize);
+
+    for (uint32_t dst = 0; dst < dstSize; ++dst)
+    {
+      FilterTaps& taps = kernel.taps[dst];
+      taps.firstWeight = static_cast<uint32_t>(kernel.weights.size());
+
+      float weightSum = 0.0f;
+      if (filter == cassidy::helper::MipFilter::BOX)
+      {
+        // Weight each source pixel by how much of it the destination pixel covers:
+        const float begin = dst * scale;
+        const float end = begin + scale;
+        for (uint32_t src = static_cast<uint32_t>(begin); static_cast<float>(src) < end && src < srcSize; ++src)
+        {
+          const float coverage = std::min(end, src + 1.0f) - std::max(begin, static_cast<float>(src));
+          if (coverage <= 0.0f) continue;
+
+          kernel.weights.push_back(coverage);
+          kernel.sourceIndices.push_back(src);
+          weightSum += coverage;
+        }
+      }
+      else
+      {
+        const float centre = (dst + 0.5f) * scale;
+        const float support = KAISER_RADIUS * scale;
+        const int32_t first = static_cast<int32_t>(std::floor(centre - support));
+        const int32_t last = static_cast<int32_t>(std::ceil(centre + support));
+        for (int32_t src = first; src <= last; ++src)
+        {
+          const float weight = kaiserWindowedSinc((src + 0.5f - centre) / scale);
+          if (weight == 0.0f) continue;
+
+          kernel.weights.push_back(weight);
+          kernel.sourceIndices.push_back(static_cast<uint32_t>(std::clamp(src, 0, static_cast<int32_t>(srcSize) - 1)));
+          weightSum += weight;
+        }
+      }
+
+      taps.numWeights = static_cast<uint32_t>(kernel.weights.size()) - taps.firstWeight;
+      for (uint32_t i = 0; i < taps.numWeights; ++i)
+        kernel.weights[taps.firstWeight + i] /= weightSum;
+    }
+    return kernel;
+  }
+
+  // sRGB <-> linear conversions. Decoding only ever sees 256 values, so is a table lookup:
+  struct SrgbTable
+  {
+    float toLinear[256];
+
+    SrgbTable()
+    {
+      for (int i = 0; i < 256; ++i)
+      {
+        const float c = i / 255.0f;
+        toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+      }
+    }
+  };
+
+  const SrgbTable& getSrgbTable()
+  {
+    static const SrgbTable table;
+    return table;
+  }
+
+  float linearToSrgb(float c)
+  {
+    return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+  }
+
+  void unpackRow(const uint8_t* row, uint32_t width, uint32_t numChannels, bool isSrgb, Pixel* outRow)
+  {
+    const float* toLinear = getSrgbTable().toLinear;
+    const uint32_t numColourChannels = numChannels == 4 ? 3 : numChannels;   // (the 4th channel is always alpha)
+
+    for (uint32_t x = 0; x < width; ++x)
+    {
+      Pixel& pixel = outRow[x];
+      for (uint32_t c = 0; c < 4; ++c)
+      {
+        if (c >= numChannels)
+          pixel.c[c] = 0.0f;
+        else if (isSrgb && c < numColourChannels)
+          pixel.c[c] = toLinear[row[x * numChannels + c]];
+        else
+          pixel.c[c] = row[x * numChannels + c] * (1.0f / 255.0f);
+      }
+    }
+  }
+
+  void packRow(const Pixel* row, uint32_t width, uint32_t numChannels, bool isSrgb, uint8_t* outRow)
+  {
+    const uint32_t numColourChannels = numChannels == 4 ? 3 : numChannels;
+
+    for (uint32_t x = 0; x < width; ++x)
+    {
+      for (uint32_t c = 0; c < numChannels; ++c)
+      {
+        float value = std::clamp(row[x].c[c], 0.0f, 1.0f);
+        if (isSrgb && c < numColourChannels)
+          value = linearToSrgb(value);
+        outRow[x * numChannels + c] = static_cast<uint8_t>(value * 255.0f + 0.5f);
+      }
+    }
+  }
+
+  // outRow[x] += row[x] * weight, for a whole row at once:
+  void accumulateRow(const Pixel* row, float weight, uint32_t width, Pixel* outRow)
+  {
+#if CS_MIPGEN_SSE2
+    const __m128 weights = _mm_set1_ps(weight);
+    for (uint32_t x = 0; x < width; ++x)
+    {
+      const __m128 sum = _mm_add_ps(_mm_load_ps(outRow[x].c), _mm_mul_ps(_mm_load_ps(row[x].c), weights));
+      _mm_store_ps(outRow[x].c, sum);
+    }
+#else
+    for (uint32_t x = 0; x < width; ++x)
+    {
+      for (uint32_t c = 0; c < 4; ++c)
+        outRow[x].c[c] += row[x].c[c] * weight;
+    }
+#endif
+  }
+
+  void filterRowHorizontal(const Pixel* row, const FilterKernel& kernel, uint32_t dstWidth, Pixel* outRow)
+  {
+    for (uint32_t x = 0; x < dstWidth; ++x)
+    {
+      const FilterTaps& taps = kernel.taps[x];
+      const float* weights = kernel.weights.data() + taps.firstWeight;
+      const uint32_t* sourceIndices = kernel.sourceIndices.data() + taps.firstWeight;
+
+#if CS_MIPGEN_SSE2
+      __m128 sum = _mm_setzero_ps();
+      for (uint32_t i = 0; i < taps.numWeights; ++i)
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load_ps(row[sourceIndices[i]].c), _mm_set1_ps(weights[i])));
+      _mm_store_ps(outRow[x].c, sum);
+#else
+      Pixel sum = {};
+      for (uint32_t i = 0; i < taps.numWeights; ++i)
+      {
+        for (uint32_t c = 0; c < 4; ++c)
+          sum.c[c] += row[sourceIndices[i]].c[c] * weights[i];
+      }
+      outRow[x] = sum;
+#endif
+    }
+  }
+
+  // Downsample one level into the next. Each destination row filters the source rows it needs vertically, then
+  // horizontally, so only a couple of rows are ever held besides the two levels:
+  template<typename GetSourceRow>
+  void downsampleLevel(GetSourceRow&& getSourceRow, uint32_t srcWidth, uint32_t srcHeight,
+    uint32_t dstWidth, uint32_t dstHeight, cassidy::helper::MipFilter filter, std::vector<Pixel>& outLevel)
+  {
+    const FilterKernel horizontalKernel = buildKernel(srcWidth, dstWidth, filter);
+    const FilterKernel verticalKernel = buildKernel(srcHeight, dstHeight, filter);
+
+    std::vector<Pixel> verticalSum(srcWidth);
+    outLevel.resize(static_cast<size_t>(dstWidth) * dstHeight);
+
+    for (uint32_t y = 0; y < dstHeight; ++y)
+    {
+      const FilterTaps& taps = verticalKernel.taps[y];
+      std::fill(verticalSum.begin(), verticalSum.end(), Pixel{});
+
+      for (uint32_t i = 0; i < taps.numWeights; ++i)
+      {
+        const uint32_t sourceY = verticalKernel.sourceIndices[taps.firstWeight + i];
+        accumulateRow(getSourceRow(sourceY), verticalKernel.weights[taps.firstWeight + i], srcWidth, verticalSum.data());
+      }
+
+      filterRowHorizontal(verticalSum.data(), horizontalKernel, dstWidth, outLevel.data() + static_cast<size_t>(y) * dstWidth);
+    }
+  }
+}
+
+void cassidy::helper::generateMipChain(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t numChannels, bool isSrgb,
+  MipFilter filter, std::vector<uint8_t>& outData, std::vector<VkDeviceSize>& outLevelOffsets)
+{
+  const uint32_t numLevels = getNumMipLevels(width, height);
+
+  // Reserve the whole chain up front (a little over 4/3 of the base level):
+  outData.clear();
+  outLevelOffsets.clear();
+  outData.reserve(static_cast<size_t>(width) * height * numChannels * 4 / 3 + numLevels * numChannels);
+
+  outLevelOffsets.push_back(0);
+  outData.insert(outData.end(), pixels, pixels + static_cast<size_t>(width) * height * numChannels);
+
+  if (numLevels == 1) return;
+
+  // The base level is unpacked a row at a time as it's read, rather than held as floats all at once. Every level
+  // after it is filtered from the previous one at full precision:
+  std::vector<Pixel> unpackedRow(width);
+  uint32_t lastUnpackedY = UINT32_MAX;
+  auto getBaseRow = [&](uint32_t y) -> const Pixel* {
+    if (y != lastUnpackedY)
+    {
+      unpackRow(pixels + static_cast<size_t>(y) * width * numChannels, width, numChannels, isSrgb, unpackedRow.data());
+      lastUnpackedY = y;
+    }
+    return unpackedRow.data();
+  };
+
+  std::vector<Pixel> previousLevel, currentLevel;
+  uint32_t srcWidth = width, srcHeight = height;
+
+  for (uint32_t level = 1; level < numLevels; ++level)
+  {
+    const uint32_t dstWidth = std::max(srcWidth >> 1, 1U);
+    const uint32_t dstHeight = std::max(srcHeight >> 1, 1U);
+
+    if (level == 1)
+      downsampleLevel(getBaseRow, srcWidth, srcHeight, dstWidth, dstHeight, filter, currentLevel);
+    else
+      downsampleLevel([&](uint32_t y) { return previousLevel.data() + static_cast<size_t>(y) * srcWidth; },
+        srcWidth, srcHeight, dstWidth, dstHeight, filter, currentLevel);
+
+    outLevelOffsets.push_back(outData.size());
+    outData.resize(outData.size() + static_cast<size_t>(dstWidth) * dstHeight * numChannels);
+
+    uint8_t* levelData = outData.data() + outLevelOffsets.back();
+    for (uint32_t y = 0; y < dstHeight; ++y)
+    {
+      packRow(currentLevel.data() + static_cast<size_t>(y) * dstWidth, dstWidth, numChannels, isSrgb,
+        levelData + static_cast<size_t>(y) * dstWidth * numChannels);
+    }
+
+    previousLevel.swap(currentLevel);
+    srcWidth = dstWidth;
+    srcHeight = dstHeight;
+  }
+}
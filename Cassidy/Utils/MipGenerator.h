@@ -0,0 +1,32 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace cassidy::helper
+{
+  enum class MipFilter : uint8_t
+  {
+    BOX = 0,      // (area average, cheap and fine for most textures)
+    KAISER = 1,   // (Kaiser-windowed sinc, sharper minification at ~6x the cost)
+  };
+
+  // Generate the full mip chain (down to 1x1) of an 8-bit image with 1-4 channels per pixel, on the CPU. Levels are
+  // tightly packed, largest (the source image itself) first, with one offset per level. Colour channels of sRGB
+  // images are filtered in linear space, alpha and every channel of UNORM images are filtered as stored:
+  void generateMipChain(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t numChannels, bool isSrgb,
+    MipFilter filter, std::vector<uint8_t>& outData, std::vector<VkDeviceSize>& outLevelOffsets);
+
+  inline uint32_t getNumMipLevels(uint32_t width, uint32_t height)
+  {
+    uint32_t numLevels = 1;
+    while ((width | height) > 1)
+    {
+      width >>= 1;
+      height >>= 1;
+      ++numLevels;
+    }
+    return numLevels;
+  }
+}
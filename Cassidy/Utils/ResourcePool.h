@@ -0,0 +1,160 @@
+#pragma once
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+namespace cassidy
+{
+  // Generational index into a resource pool. A handle goes stale once its resource is removed, so a slot reused by
+  // a newer resource can't be reached through a handle to the old one. Tag only exists to keep handles to different
+  // resource types from being mixed up:
+  template<typename Tag>
+  struct ResourceHandle
+  {
+    static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+    uint32_t index      = INVALID_INDEX;
+    uint32_t generation = 0;
+
+    inline bool isValid() const { return index != INVALID_INDEX; }
+    inline bool operator==(const ResourceHandle& other) const { return index == other.index && generation == other.generation; }
+    inline bool operator!=(const ResourceHandle& other) const { return !(*this == other); }
+  };
+
+  struct ResourceHandleHash
+  {
+    template<typename Tag>
+    size_t operator()(const ResourceHandle<Tag>& handle) const
+    {
+      return std::hash<uint64_t>()((static_cast<uint64_t>(handle.generation) << 32) | handle.index);
+    }
+  };
+
+  typedef ResourceHandle<struct TextureHandleTag>   TextureHandle;
+  typedef ResourceHandle<struct MaterialHandleTag>  MaterialHandle;
+  typedef ResourceHandle<struct ModelHandleTag>     ModelHandle;
+
+  // Slot array of reference-counted resources. Slots live in a deque so resources never move once added, meaning
+  // raw pointers returned by get() stay valid for as long as a reference is held. Thread-safe.
+  //
+  // The pool only does the bookkeeping: once removeRef() returns 0 the owner is expected to destroy the resource
+  // (typically a few frames later, once the GPU is done with it) and then remove() its slot.
+  template<typename T, typename Handle>
+  class ResourcePool
+  {
+  public:
+    // Add a resource with one reference, owned by the caller:
+    Handle add(const T& resource)
+    {
+      std::lock_guard<std::mutex> poolLock(m_mutex);
+
+      uint32_t index;
+      if (!m_freeIndices.empty())
+      {
+        index = m_freeIndices.back();
+        m_freeIndices.pop_back();
+      }
+      else
+      {
+        index = static_cast<uint32_t>(m_slots.size());
+        m_slots.emplace_back();
+      }
+
+      Slot& slot = m_slots[index];
+      slot.resource = resource;
+      slot.refCount = 1;
+      slot.isOccupied = true;
+      ++m_numOccupied;
+
+      return { index, slot.generation };
+    }
+
+    // Null if the handle is stale, or invalid:
+    T* get(Handle handle)
+    {
+      std::lock_guard<std::mutex> poolLock(m_mutex);
+      Slot* slot = getSlot(handle);
+      return slot ? &slot->resource : nullptr;
+    }
+
+    bool addRef(Handle handle)
+    {
+      std::lock_guard<std::mutex> poolLock(m_mutex);
+      Slot* slot = getSlot(handle);
+      if (!slot || slot->refCount == 0) return false;
+
+      ++slot->refCount;
+      return true;
+    }
+
+    // Returns the number of references left (the slot stays occupied at 0 until it's removed):
+    uint32_t removeRef(Handle handle)
+    {
+      std::lock_guard<std::mutex> poolLock(m_mutex);
+      Slot* slot = getSlot(handle);
+      if (!slot || slot->refCount == 0) return UINT32_MAX;
+
+      return --slot->refCount;
+    }
+
+    void remove(Handle handle)
+    {
+      std::lock_guard<std::mutex> poolLock(m_mutex);
+      Slot* slot = getSlot(handle);
+      if (!slot) return;
+
+      slot->resource = T();
+      slot->isOccupied = false;
+      ++slot->generation;
+      m_freeIndices.push_back(handle.index);
+      --m_numOccupied;
+    }
+
+    // Visit every occupied slot (including ones waiting to be removed). The pool is locked throughout, so the
+    // callback mustn't use the pool:
+    void forEach(const std::function<void(Handle, T&)>& callback)
+    {
+      std::lock_guard<std::mutex> poolLock(m_mutex);
+      for (uint32_t i = 0; i < m_slots.size(); ++i)
+      {
+        if (m_slots[i].isOccupied)
+          callback({ i, m_slots[i].generation }, m_slots[i].resource);
+      }
+    }
+
+    void clear()
+    {
+      std::lock_guard<std::mutex> poolLock(m_mutex);
+      m_slots.clear();
+      m_freeIndices.clear();
+      m_numOccupied = 0;
+    }
+
+    // Getters/setters: ------------------------------------------------------------------------------------------
+    inline uint32_t getNumResources() const { std::lock_guard<std::mutex> poolLock(m_mutex); return m_numOccupied; }
+
+  private:
+    struct Slot
+    {
+      T resource = T();
+      uint32_t generation = 0;
+      uint32_t refCount = 0;
+      bool isOccupied = false;
+    };
+
+    inline Slot* getSlot(Handle handle)
+    {
+      if (handle.index >= m_slots.size()) return nullptr;
+
+      Slot& slot = m_slots[handle.index];
+      return slot.isOccupied && slot.generation == handle.generation ? &slot : nullptr;
+    }
+
+    std::deque<Slot> m_slots;
+    std::vector<uint32_t> m_freeIndices;
+    uint32_t m_numOccupied = 0;
+    mutable std::mutex m_mutex;
+  };
+}
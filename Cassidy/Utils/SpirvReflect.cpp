@@ -0,0 +1,490 @@
+#include "SpirvReflect.h"
+
+#include <Core/Logger.h>
+#include <Utils/DescriptorBuilder.h>
+#include <Utils/Initialisers.h>
+
+#include <algorithm>
+
+// Only the handful of opcodes, decorations and storage classes that resource declarations use:
+// https://registry.khronos.org/SPIR-V/specs/unified1/SPIRV.html
+namespace
+{
+  constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+  constexpr uint32_t SPIRV_HEADER_WORDS = 5;
+  constexpr uint32_t UNASSIGNED = UINT32_MAX;
+
+  enum SpirvOp : uint16_t
+  {
+    OP_TYPE_BOOL            = 20,
+    OP_TYPE_INT             = 21,
+    OP_TYPE_FLOAT           = 22,
+    OP_TYPE_VECTOR          = 23,
+    OP_TYPE_MATRIX          = 24,
+    OP_TYPE_IMAGE           = 25,
+    OP_TYPE_SAMPLER         = 26,
+    OP_TYPE_SAMPLED_IMAGE   = 27,
+    OP_TYPE_ARRAY           = 28,
+    OP_TYPE_RUNTIME_ARRAY   = 29,
+    OP_TYPE_STRUCT          = 30,
+    OP_TYPE_POINTER         = 32,
+    OP_CONSTANT             = 43,
+    OP_VARIABLE             = 59,
+    OP_DECORATE             = 71,
+    OP_MEMBER_DECORATE      = 72,
+  };
+
+  enum SpirvDecoration : uint32_t
+  {
+    DECORATION_BUFFER_BLOCK   = 3,
+    DECORATION_ARRAY_STRIDE   = 6,
+    DECORATION_MATRIX_STRIDE  = 7,
+    DECORATION_BINDING        = 33,
+    DECORATION_DESCRIPTOR_SET = 34,
+    DECORATION_OFFSET         = 35,
+  };
+
+  enum SpirvStorageClass : uint32_t
+  {
+    STORAGE_CLASS_UNIFORM_CONSTANT  = 0,
+    STORAGE_CLASS_UNIFORM           = 2,
+    STORAGE_CLASS_PUSH_CONSTANT     = 9,
+    STORAGE_CLASS_STORAGE_BUFFER    = 12,
+  };
+
+  enum SpirvImageDim : uint32_t
+  {
+    DIM_BUFFER        = 5,
+    DIM_SUBPASS_DATA  = 6,
+  };
+
+  // Everything the reflection needs to know about one result ID, whether it's a type, constant or variable:
+  struct SpirvId
+  {
+    uint16_t opcode = 0;
+    uint32_t typeId = 0;          // (pointee, element, component or column type, or a variable's pointer type)
+    uint32_t count = 0;           // (vector/matrix size, array length ID, or a constant's value)
+    uint32_t width = 0;           // (scalar width in bits)
+    uint32_t storageClass = 0;
+    uint32_t imageDim = 0;
+    uint32_t imageSampled = 0;    // (1 if sampled, 2 if used as a storage image)
+
+    std::vector<uint32_t> memberTypes;
+    std::vector<uint32_t> memberOffsets;
+    std::vector<uint32_t> memberMatrixStrides;
+
+    uint32_t set = UNASSIGNED;
+    uint32_t binding = UNASSIGNED;
+    uint32_t arrayStride = 0;
+    bool isBufferBlock = false;
+  };
+
+  void setMemberDecoration(std::vector<uint32_t>& memberValues, uint32_t member, uint32_t value)
+  {
+    if (memberValues.size() <= member)
+      memberValues.resize(member + 1, 0);
+    memberValues[member] = value;
+  }
+
+  // Size in bytes of a type laid out in a block, following its explicit offset and stride decorations:
+  uint32_t getTypeSize(const std::vector<SpirvId>& ids, uint32_t typeId)
+  {
+    if (typeId >= ids.size()) return 0;
+
+    const SpirvId& type = ids[typeId];
+    switch (type.opcode)
+    {
+    case OP_TYPE_BOOL:
+      return 4;
+    case OP_TYPE_INT:
+    case OP_TYPE_FLOAT:
+      return type.width / 8;
+    case OP_TYPE_VECTOR:
+    case OP_TYPE_MATRIX:
+      return type.count * getTypeSize(ids, type.typeId);
+    case OP_TYPE_ARRAY:
+    {
+      const uint32_t stride = type.arrayStride > 0 ? type.arrayStride : getTypeSize(ids, type.typeId);
+      return type.count < ids.size() ? ids[type.count].count * stride : 0;
+    }
+    case OP_TYPE_STRUCT:
+    {
+      uint32_t size = 0;
+      for (uint32_t i = 0; i < type.memberTypes.size(); ++i)
+      {
+        const uint32_t memberTypeId = type.memberTypes[i];
+        if (memberTypeId >= ids.size()) continue;
+
+        const uint32_t offset = i < type.memberOffsets.size() ? type.memberOffsets[i] : size;
+        const uint32_t matrixStride = i < type.memberMatrixStrides.size() ? type.memberMatrixStrides[i] : 0;
+
+        // (matrix columns are padded out to their stride, e.g. a mat3's columns are 16 bytes apart under std140)
+        const uint32_t memberSize = (ids[memberTypeId].opcode == OP_TYPE_MATRIX && matrixStride > 0) ?
+          ids[memberTypeId].count * matrixStride : getTypeSize(ids, memberTypeId);
+        size = std::max(size, offset + memberSize);
+      }
+      return size;
+    }
+    default:
+      return 0;
+    }
+  }
+
+  // Returns false if the type isn't one a descriptor can be bound to:
+  bool getDescriptorType(const std::vector<SpirvId>& ids, uint32_t storageClass, uint32_t typeId, VkDescriptorType& outType)
+  {
+    const SpirvId& type = ids[typeId];
+
+    if (storageClass == STORAGE_CLASS_STORAGE_BUFFER)
+    {
+      outType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+      return true;
+    }
+
+    if (storageClass == STORAGE_CLASS_UNIFORM)
+    {
+      // (storage buffers are declared as BufferBlock uniforms before SPIR-V 1.3)
+      outType = type.isBufferBlock ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+      return true;
+    }
+
+    if (storageClass != STORAGE_CLASS_UNIFORM_CONSTANT) return false;
+
+    switch (type.opcode)
+    {
+    case OP_TYPE_SAMPLER:
+      outType = VK_DESCRIPTOR_TYPE_SAMPLER;
+      return true;
+    case OP_TYPE_SAMPLED_IMAGE:
+      outType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+      return true;
+    case OP_TYPE_IMAGE:
+      if (type.imageDim == DIM_SUBPASS_DATA)
+        outType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+      else if (type.imageDim == DIM_BUFFER)
+        outType = type.imageSampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+      else
+        outType = type.imageSampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  // The type a shader declares a descriptor as, ignoring whether it's bound with a dynamic offset:
+  VkDescriptorType getBaseDescriptorType(VkDescriptorType type)
+  {
+    switch (type)
+    {
+    case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+      return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+      return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    default:
+      return type;
+    }
+  }
+}
+
+bool cassidy::SpirvReflection::addStage(VkShaderStageFlagBits stage, const SpirvShaderCode& code)
+{
+  const uint32_t* words = code.codeBuffer;
+  const size_t numWords = code.codeSize / sizeof(uint32_t);
+
+  if (!words || numWords < SPIRV_HEADER_WORDS || words[0] != SPIRV_MAGIC)
+  {
+    CS_LOG_ERROR("Can't reflect shader stage, code isn't a SPIR-V module!");
+    return false;
+  }
+
+  // Every ID in the module is below the header's bound, so IDs can index straight into a flat array:
+  const uint32_t idBound = words[3];
+  std::vector<SpirvId> ids(idBound);
+  std::vector<uint32_t> variableIds;
+
+  size_t wordIndex = SPIRV_HEADER_WORDS;
+  while (wordIndex < numWords)
+  {
+    const uint16_t opcode = static_cast<uint16_t>(words[wordIndex] & 0xFFFF);
+    const uint16_t wordCount = static_cast<uint16_t>(words[wordIndex] >> 16);
+    const uint32_t* operands = words + wordIndex + 1;
+
+    if (wordCount == 0 || wordIndex + wordCount > numWords)
+    {
+      CS_LOG_ERROR("Can't reflect shader stage, SPIR-V module is malformed!");
+      return false;
+    }
+
+    // (result IDs are checked against the bound, so a corrupt module can't index out of range)
+    auto resultId = [&](uint32_t operand) -> SpirvId* {
+      return (operand + 1 < wordCount && operands[operand] < idBound) ? &ids[operands[operand]] : nullptr;
+    };
+
+    switch (opcode)
+    {
+    case OP_DECORATE:
+      if (SpirvId* target = resultId(0); target && wordCount > 2)
+      {
+        const uint32_t decoration = operands[1];
+        const uint32_t literal = wordCount > 3 ? operands[2] : 0;
+        if (decoration == DECORATION_DESCRIPTOR_SET)  target->set = literal;
+        if (decoration == DECORATION_BINDING)         target->binding = literal;
+        if (decoration == DECORATION_ARRAY_STRIDE)    target->arrayStride = literal;
+        if (decoration == DECORATION_BUFFER_BLOCK)    target->isBufferBlock = true;
+      }
+      break;
+    case OP_MEMBER_DECORATE:
+      if (SpirvId* target = resultId(0); target && wordCount > 4)
+      {
+        const uint32_t member = operands[1];
+        const uint32_t decoration = operands[2];
+        if (decoration == DECORATION_OFFSET)          setMemberDecoration(target->memberOffsets, member, operands[3]);
+        if (decoration == DECORATION_MATRIX_STRIDE)   setMemberDecoration(target->memberMatrixStrides, member, operands[3]);
+      }
+      break;
+    case OP_TYPE_BOOL:
+    case OP_TYPE_SAMPLER:
+      if (SpirvId* type = resultId(0))
+        type->opcode = opcode;
+      break;
+    case OP_TYPE_INT:
+    case OP_TYPE_FLOAT:
+      if (SpirvId* type = resultId(0); type && wordCount > 2)
+      {
+        type->opcode = opcode;
+        type->width = operands[1];
+      }
+      break;
+    case OP_TYPE_VECTOR:
+    case OP_TYPE_MATRIX:
+    case OP_TYPE_ARRAY:
+      if (SpirvId* type = resultId(0); type && wordCount > 3)
+      {
+        type->opcode = opcode;
+        type->typeId = operands[1];
+        type->count = operands[2];
+      }
+      break;
+    case OP_TYPE_SAMPLED_IMAGE:
+    case OP_TYPE_RUNTIME_ARRAY:
+      if (SpirvId* type = resultId(0); type && wordCount > 2)
+      {
+        type->opcode = opcode;
+        type->typeId = operands[1];
+      }
+      break;
+    case OP_TYPE_IMAGE:
+      if (SpirvId* type = resultId(0); type && wordCount > 7)
+      {
+        type->opcode = opcode;
+        type->imageDim = operands[2];
+        type->imageSampled = operands[6];
+      }
+      break;
+    case OP_TYPE_STRUCT:
+      if (SpirvId* type = resultId(0))
+      {
+        type->opcode = opcode;
+        type->memberTypes.assign(operands + 1, operands + wordCount - 1);
+      }
+      break;
+    case OP_TYPE_POINTER:
+      if (SpirvId* type = resultId(0); type && wordCount > 3)
+      {
+        type->opcode = opcode;
+        type->storageClass = operands[1];
+        type->typeId = operands[2];
+      }
+      break;
+    case OP_CONSTANT:
+      if (SpirvId* constant = resultId(1); constant && wordCount > 3)
+      {
+        constant->opcode = opcode;
+        constant->count = operands[2];  // (only 32-bit integer constants are used as array lengths)
+      }
+      break;
+    case OP_VARIABLE:
+      if (SpirvId* variable = resultId(1); variable && wordCount > 3)
+      {
+        variable->opcode = opcode;
+        variable->typeId = operands[0];
+        variable->storageClass = operands[2];
+        variableIds.push_back(operands[1]);
+      }
+      break;
+    }
+
+    wordIndex += wordCount;
+  }
+
+  for (const uint32_t variableId : variableIds)
+  {
+    const SpirvId& variable = ids[variableId];
+    if (variable.typeId >= idBound || ids[variable.typeId].opcode != OP_TYPE_POINTER) continue;
+    uint32_t typeId = ids[variable.typeId].typeId;
+    if (typeId >= idBound) continue;
+
+    if (variable.storageClass == STORAGE_CLASS_PUSH_CONSTANT)
+    {
+      // Range starts at the first member's offset, so blocks placed after another stage's (with layout(offset = N))
+      // don't overlap it:
+      const SpirvId& block = ids[typeId];
+      const uint32_t offset = block.memberOffsets.empty() ? 0 :
+        *std::min_element(block.memberOffsets.begin(), block.memberOffsets.end());
+      const uint32_t size = getTypeSize(ids, typeId) - offset;
+
+      auto rangeIt = std::find_if(m_pushConstantRanges.begin(), m_pushConstantRanges.end(), [&](const VkPushConstantRange& range) {
+        return range.offset == offset && range.size == size;
+        });
+      if (rangeIt != m_pushConstantRanges.end())
+        rangeIt->stageFlags |= stage;
+      else
+        m_pushConstantRanges.push_back({ static_cast<VkShaderStageFlags>(stage), offset, size });
+      continue;
+    }
+
+    if (variable.set == UNASSIGNED || variable.binding == UNASSIGNED) continue;
+
+    // Arrays of resources are bound as one binding with a descriptor per element (unbounded arrays have a count of
+    // 0, since their size is only decided by the layout they're given):
+    uint32_t descriptorCount = 1;
+    while (ids[typeId].opcode == OP_TYPE_ARRAY || ids[typeId].opcode == OP_TYPE_RUNTIME_ARRAY)
+    {
+      const uint32_t lengthId = ids[typeId].count;
+      descriptorCount *= (ids[typeId].opcode == OP_TYPE_ARRAY && lengthId < idBound) ? ids[lengthId].count : 0;
+      typeId = ids[typeId].typeId;
+      if (typeId >= idBound) break;
+    }
+    if (typeId >= idBound) continue;
+
+    VkDescriptorType descriptorType;
+    if (!getDescriptorType(ids, variable.storageClass, typeId, descriptorType)) continue;
+
+    if (VkDescriptorSetLayoutBinding* existing = findBinding(variable.set, variable.binding))
+    {
+      if (existing->descriptorType != descriptorType)
+      {
+        CS_LOG_ERROR("Shader stages disagree on the type of descriptor (set = {0}, binding = {1})!",
+          variable.set, variable.binding);
+      }
+      existing->stageFlags |= stage;
+      existing->descriptorCount = std::max(existing->descriptorCount, descriptorCount);
+      continue;
+    }
+
+    if (m_sets.size() <= variable.set)
+      m_sets.resize(variable.set + 1);
+
+    m_sets[variable.set].push_back(cassidy::init::descriptorSetLayoutBinding(variable.binding, descriptorType,
+      descriptorCount, stage, nullptr));
+  }
+
+  return true;
+}
+
+void cassidy::SpirvReflection::clear()
+{
+  m_sets.clear();
+  m_pushConstantRanges.clear();
+}
+
+bool cassidy::SpirvReflection::hasSameLayout(const SpirvReflection& other) const
+{
+  const auto isSameBinding = [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) {
+    return a.binding == b.binding && a.descriptorType == b.descriptorType && a.descriptorCount == b.descriptorCount &&
+      a.stageFlags == b.stageFlags && a.pImmutableSamplers == b.pImmutableSamplers;
+  };
+  const auto isSameRange = [](const VkPushConstantRange& a, const VkPushConstantRange& b) {
+    return a.stageFlags == b.stageFlags && a.offset == b.offset && a.size == b.size;
+  };
+
+  const std::vector<VkDescriptorSetLayoutBinding> noBindings;
+  const size_t numSets = std::max(m_sets.size(), other.m_sets.size());
+  for (size_t set = 0; set < numSets; ++set)
+  {
+    const std::vector<VkDescriptorSetLayoutBinding>& bindings = set < m_sets.size() ? m_sets[set] : noBindings;
+    const std::vector<VkDescriptorSetLayoutBinding>& otherBindings = set < other.m_sets.size() ? other.m_sets[set] : noBindings;
+    if (bindings.size() != otherBindings.size()) return false;
+
+    for (const VkDescriptorSetLayoutBinding& binding : bindings)
+    {
+      if (std::none_of(otherBindings.begin(), otherBindings.end(),
+        [&](const VkDescriptorSetLayoutBinding& otherBinding) { return isSameBinding(binding, otherBinding); }))
+        return false;
+    }
+  }
+
+  if (m_pushConstantRanges.size() != other.m_pushConstantRanges.size()) return false;
+  for (const VkPushConstantRange& range : m_pushConstantRanges)
+  {
+    if (std::none_of(other.m_pushConstantRanges.begin(), other.m_pushConstantRanges.end(),
+      [&](const VkPushConstantRange& otherRange) { return isSameRange(range, otherRange); }))
+      return false;
+  }
+  return true;
+}
+
+void cassidy::SpirvReflection::setDescriptorType(uint32_t set, uint32_t binding, VkDescriptorType type)
+{
+  VkDescriptorSetLayoutBinding* existing = findBinding(set, binding);
+  if (!existing)
+  {
+    CS_LOG_WARN("Can't override type of descriptor no shader stage uses (set = {0}, binding = {1})", set, binding);
+    return;
+  }
+
+  // Anything more than adding a dynamic offset means the shaders and the code binding the descriptor disagree, which
+  // overriding would only hide:
+  if (getBaseDescriptorType(type) != getBaseDescriptorType(existing->descriptorType))
+  {
+    CS_LOG_ERROR("Can't override descriptor (set = {0}, binding = {1}) from type {2} to {3}, only dynamic offsets can "
+      "be added to what the shaders declare!", set, binding, static_cast<uint32_t>(existing->descriptorType), static_cast<uint32_t>(type));
+    return;
+  }
+
+  existing->descriptorType = type;
+}
+
+void cassidy::SpirvReflection::setImmutableSamplers(uint32_t set, uint32_t binding, const VkSampler* immutableSamplers)
+{
+  if (VkDescriptorSetLayoutBinding* existing = findBinding(set, binding))
+    existing->pImmutableSamplers = immutableSamplers;
+  else
+    CS_LOG_WARN("Can't set immutable samplers of descriptor no shader stage uses (set = {0}, binding = {1})", set, binding);
+}
+
+VkDescriptorSetLayout cassidy::SpirvReflection::createSetLayout(uint32_t set, cassidy::DescriptorLayoutCache& layoutCache) const
+{
+  std::vector<VkDescriptorSetLayoutBinding> bindings;
+  if (set < m_sets.size())
+    bindings = m_sets[set];
+
+  for (const VkDescriptorSetLayoutBinding& binding : bindings)
+  {
+    if (binding.descriptorCount == 0)
+    {
+      CS_LOG_WARN("Descriptor (set = {0}, binding = {1}) is an unbounded array, its set's layout should be "
+        "supplied explicitly instead of reflected!", set, binding.binding);
+    }
+  }
+
+  VkDescriptorSetLayoutCreateInfo layoutInfo = cassidy::init::descriptorSetLayoutCreateInfo(
+    static_cast<uint32_t>(bindings.size()), bindings.data());
+  return layoutCache.createDescLayout(&layoutInfo);
+}
+
+std::vector<VkDescriptorSetLayoutBinding>* cassidy::SpirvReflection::findSet(uint32_t set)
+{
+  return set < m_sets.size() ? &m_sets[set] : nullptr;
+}
+
+VkDescriptorSetLayoutBinding* cassidy::SpirvReflection::findBinding(uint32_t set, uint32_t binding)
+{
+  std::vector<VkDescriptorSetLayoutBinding>* bindings = findSet(set);
+  if (!bindings) return nullptr;
+
+  auto bindingIt = std::find_if(bindings->begin(), bindings->end(), [binding](const VkDescriptorSetLayoutBinding& b) {
+    return b.binding == binding;
+    });
+  return bindingIt != bindings->end() ? &(*bindingIt) : nullptr;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <Utils/Types.h>
+
+#include <vector>
+
+namespace cassidy
+{
+  class DescriptorLayoutCache;
+
+  // Minimal SPIR-V reflection, reading the descriptor bindings and push constant block each shader stage declares
+  // straight from its module. Stages are merged as they're added (bindings used by several stages get all of their
+  // stage flags), so descriptor set layouts and push constant ranges can be derived from the shaders themselves
+  // rather than written out by hand to match them.
+  //
+  // Some properties of a binding can't be told from SPIR-V (whether a buffer is bound with a dynamic offset, or
+  // which immutable samplers it uses), so can be overridden before creating layouts. Overrides can't change the
+  // type a shader declares, e.g. a uniform buffer into a storage buffer.
+  class SpirvReflection
+  {
+  public:
+    // Parse a module and merge its resources into those of the stages already reflected:
+    bool addStage(VkShaderStageFlagBits stage, const SpirvShaderCode& code);
+    void clear();
+
+    // Whether both would create the same set layouts and push constant ranges (bindings may be declared in any order):
+    bool hasSameLayout(const SpirvReflection& other) const;
+
+    void setDescriptorType(uint32_t set, uint32_t binding, VkDescriptorType type);
+    void setImmutableSamplers(uint32_t set, uint32_t binding, const VkSampler* immutableSamplers);
+
+    // Layouts are created through the layout cache, so pipelines reflected from the same shaders share them. Sets
+    // no stage uses (e.g. a gap below a set that is used) get an empty layout:
+    VkDescriptorSetLayout createSetLayout(uint32_t set, cassidy::DescriptorLayoutCache& layoutCache) const;
+
+    // Getters/setters: ------------------------------------------------------------------------------------------
+    inline uint32_t                                 getNumSets()              const { return static_cast<uint32_t>(m_sets.size()); }
+    inline const std::vector<VkPushConstantRange>&  getPushConstantRanges()   const { return m_pushConstantRanges; }
+
+  private:
+    std::vector<VkDescriptorSetLayoutBinding>* findSet(uint32_t set);
+    VkDescriptorSetLayoutBinding* findBinding(uint32_t set, uint32_t binding);
+
+    std::vector<std::vector<VkDescriptorSetLayoutBinding>> m_sets;  // (indexed by set number)
+    std::vector<VkPushConstantRange> m_pushConstantRanges;           // (ranges used by identical stages are merged)
+  };
+}
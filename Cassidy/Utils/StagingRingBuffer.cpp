@@ -0,0 +1,232 @@
+#include "StagingRingBuffer.h"
+#include <Core/Logger.h>
+#include <Utils/Helpers.h>
+#include <Utils/Initialisers.h>
+
+namespace
+{
+  inline VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+  {
+    return (value + alignment - 1) / alignment * alignment;
+  }
+}
+
+void cassidy::StagingRingBuffer::init(VkDevice device, VmaAllocator allocator, VkDeviceSize capacity)
+{
+  m_device = device;
+  m_allocator = allocator;
+  m_capacity = capacity;
+
+  VkBufferCreateInfo bufferInfo = cassidy::init::bufferCreateInfo(static_cast<uint32_t>(capacity),
+    VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+
+  // Coherent memory so callers never need to flush after writing staging data:
+  VmaAllocationCreateInfo allocInfo = cassidy::init::vmaAllocationCreateInfo(VMA_MEMORY_USAGE_AUTO_PREFER_HOST,
+    VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT);
+  allocInfo.requiredFlags = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+  VmaAllocationInfo allocationInfo;
+  VK_CHECK(vmaCreateBuffer(m_allocator, &bufferInfo, &allocInfo, &m_buffer, &m_allocation, &allocationInfo));
+
+  m_mappedData = static_cast<uint8_t*>(allocationInfo.pMappedData);
+
+  CS_LOG_INFO("Created staging ring buffer ({0} MB)!", capacity / (1024 * 1024));
+}
+
+void cassidy::StagingRingBuffer::release()
+{
+  std::lock_guard<std::mutex> ringLock(m_mutex);
+
+  vmaDestroyBuffer(m_allocator, m_buffer, m_allocation);
+  m_buffer = VK_NULL_HANDLE;
+  m_allocation = VK_NULL_HANDLE;
+  m_mappedData = nullptr;
+  m_entries.clear();
+
+  for (const auto& dedicated : m_liveDedicated)
+  {
+    vmaDestroyBuffer(m_allocator, dedicated.buffer, dedicated.allocation);
+  }
+  m_liveDedicated.clear();
+
+  CS_LOG_INFO("Released staging ring buffer ({0} dedicated fallback allocations made)", m_numDedicatedAllocs);
+}
+
+cassidy::StagingRingBuffer::Allocation cassidy::StagingRingBuffer::allocate(VkDeviceSize size, VkDeviceSize alignment)
+{
+  std::lock_guard<std::mutex> ringLock(m_mutex);
+
+  // Very large uploads would monopolise the ring, so give them their own buffer:
+  if (size > m_capacity / 2)
+    return allocateDedicated(size);
+
+  reclaim();
+
+  Allocation newAllocation;
+  if (tryAllocateFromRing(size, alignment, newAllocation))
+    return newAllocation;
+
+  // Ring is full, wait for the oldest submitted uploads to finish before resorting to a dedicated buffer:
+  while (!m_entries.empty() && m_entries.front().state == EntryState::RETIRED)
+  {
+    vkWaitForFences(m_device, 1, &m_entries.front().fence, VK_TRUE, UINT64_MAX);
+    m_entries.front().state = EntryState::FREE;
+    reclaim();
+
+    if (tryAllocateFromRing(size, alignment, newAllocation))
+      return newAllocation;
+  }
+
+  CS_LOG_WARN("Staging ring buffer is full of unsubmitted uploads, falling back to dedicated staging buffer!");
+  return allocateDedicated(size);
+}
+
+void cassidy::StagingRingBuffer::retire(const Allocation& allocation, VkFence fence)
+{
+  std::lock_guard<std::mutex> ringLock(m_mutex);
+
+  if (allocation.isDedicated())
+  {
+    for (DedicatedEntry& entry : m_liveDedicated)
+    {
+      if (entry.id == allocation.id)
+        entry.fence = fence;
+    }
+    return;
+  }
+
+  const uint64_t index = allocation.id - m_frontEntryId;
+  if (allocation.id < m_frontEntryId || index >= m_entries.size()) return;
+
+  Entry& entry = m_entries[index];
+  if (entry.state == EntryState::IN_USE)
+  {
+    entry.state = EntryState::RETIRED;
+    entry.fence = fence;
+  }
+}
+
+void cassidy::StagingRingBuffer::free(const Allocation& allocation)
+{
+  std::lock_guard<std::mutex> ringLock(m_mutex);
+
+  if (allocation.isDedicated())
+  {
+    // (already destroyed if it was retired and reclaimed before being freed)
+    const size_t numErased = std::erase_if(m_liveDedicated, [&](const DedicatedEntry& entry) { return entry.id == allocation.id; });
+    if (numErased > 0)
+      vmaDestroyBuffer(m_allocator, allocation.buffer, allocation.dedicatedAllocation);
+    return;
+  }
+
+  const uint64_t index = allocation.id - m_frontEntryId;
+  if (allocation.id < m_frontEntryId || index >= m_entries.size()) return;
+
+  m_entries[index].state = EntryState::FREE;
+  reclaim();
+}
+
+cassidy::StagingRingBuffer::Allocation cassidy::StagingRingBuffer::allocateDedicated(VkDeviceSize size)
+{
+  VkBufferCreateInfo bufferInfo = cassidy::init::bufferCreateInfo(static_cast<uint32_t>(size),
+    VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+  VmaAllocationCreateInfo allocInfo = cassidy::init::vmaAllocationCreateInfo(VMA_MEMORY_USAGE_AUTO_PREFER_HOST,
+    VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT);
+  allocInfo.requiredFlags = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+  Allocation newAllocation;
+  VmaAllocationInfo allocationInfo;
+  VK_CHECK(vmaCreateBuffer(m_allocator, &bufferInfo, &allocInfo, &newAllocation.buffer, &newAllocation.dedicatedAllocation,
+    &allocationInfo));
+
+  newAllocation.offset = 0;
+  newAllocation.mappedData = allocationInfo.pMappedData;
+  newAllocation.id = m_nextDedicatedId++;
+  ++m_numDedicatedAllocs;
+
+  m_liveDedicated.push_back({ newAllocation.id, newAllocation.buffer, newAllocation.dedicatedAllocation, VK_NULL_HANDLE });
+
+  return newAllocation;
+}
+
+bool cassidy::StagingRingBuffer::tryAllocateFromRing(VkDeviceSize size, VkDeviceSize alignment, Allocation& outAllocation)
+{
+  if (m_entries.empty())
+  {
+    m_head = 0;
+    m_tail = 0;
+  }
+
+  VkDeviceSize offset = alignUp(m_tail, alignment);
+
+  // Live data is [head, tail) when tail >= head, otherwise it has wrapped around and free space is [tail, head):
+  if (m_tail >= m_head)
+  {
+    if (offset + size > m_capacity)
+    {
+      // Not enough room before the end of the buffer, wrap around (strictly less than head, so that a full
+      // ring can't be mistaken for an empty one):
+      if (size >= m_head) return false;
+      offset = 0;
+    }
+  }
+  else if (offset + size >= m_head)
+  {
+    return false;
+  }
+
+  const Entry newEntry = {
+    .begin = m_tail,
+    .end = offset + size,
+    .fence = VK_NULL_HANDLE,
+    .state = EntryState::IN_USE,
+  };
+
+  outAllocation.id = m_frontEntryId + m_entries.size();
+  m_entries.push_back(newEntry);
+  m_tail = newEntry.end;
+
+  outAllocation.buffer = m_buffer;
+  outAllocation.offset = offset;
+  outAllocation.mappedData = m_mappedData + offset;
+  outAllocation.dedicatedAllocation = VK_NULL_HANDLE;
+
+  return true;
+}
+
+void cassidy::StagingRingBuffer::reclaim()
+{
+  // Only the oldest allocations can be reclaimed, since the ring is consumed in order:
+  while (!m_entries.empty())
+  {
+    Entry& oldest = m_entries.front();
+    if (oldest.state == EntryState::RETIRED && vkGetFenceStatus(m_device, oldest.fence) == VK_SUCCESS)
+      oldest.state = EntryState::FREE;
+
+    if (oldest.state != EntryState::FREE) break;
+
+    m_entries.pop_front();
+    ++m_frontEntryId;
+  }
+
+  if (m_entries.empty())
+  {
+    m_head = 0;
+    m_tail = 0;
+  }
+  else
+  {
+    m_head = m_entries.front().begin;
+  }
+
+  for (auto it = m_liveDedicated.begin(); it != m_liveDedicated.end();)
+  {
+    if (it->fence == VK_NULL_HANDLE || vkGetFenceStatus(m_device, it->fence) != VK_SUCCESS)
+    {
+      ++it;
+      continue;
+    }
+    vmaDestroyBuffer(m_allocator, it->buffer, it->allocation);
+    it = m_liveDedicated.erase(it);
+  }
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include "Vendor/vma/vk_mem_alloc.h"
+
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace cassidy
+{
+  // Persistently-mapped, host-visible buffer that upload staging memory is sub-allocated from in FIFO order.
+  // Allocations are reclaimed once freed, or once the fence of the submission reading them has signalled.
+  // Uploads too large for the ring, or made while the ring is full of unsubmitted data, fall back to a
+  // one-off staging buffer.
+  class StagingRingBuffer
+  {
+  public:
+    struct Allocation
+    {
+      VkBuffer buffer       = VK_NULL_HANDLE;
+      VkDeviceSize offset   = 0;
+      void* mappedData      = nullptr;
+
+      // Internal bookkeeping:
+      uint64_t id = 0;
+      VmaAllocation dedicatedAllocation = VK_NULL_HANDLE;
+
+      inline bool isDedicated() const { return dedicatedAllocation != VK_NULL_HANDLE; }
+    };
+
+    void init(VkDevice device, VmaAllocator allocator, VkDeviceSize capacity);
+    void release();
+
+    Allocation allocate(VkDeviceSize size, VkDeviceSize alignment = 16);
+
+    // Tie an allocation to the fence of the submission that reads from it, so it can be reclaimed (or waited on
+    // when the ring is full) without an explicit free(). The fence must outlive the allocation.
+    void retire(const Allocation& allocation, VkFence fence);
+
+    // Safe to call on a retired allocation whether or not it has been reclaimed yet:
+    void free(const Allocation& allocation);
+
+    // Getters/setters: ------------------------------------------------------------------------------------------
+    inline VkDeviceSize getCapacity()           const { return m_capacity; }
+    inline uint64_t     getNumDedicatedAllocs() const { return m_numDedicatedAllocs; }
+
+  private:
+    enum class EntryState : uint8_t
+    {
+      IN_USE,
+      RETIRED,
+      FREE,
+    };
+
+    struct Entry
+    {
+      VkDeviceSize begin;   // (includes alignment padding and wrap-around waste)
+      VkDeviceSize end;
+      VkFence fence;
+      EntryState state;
+    };
+
+    struct DedicatedEntry
+    {
+      uint64_t id;
+      VkBuffer buffer;
+      VmaAllocation allocation;
+      VkFence fence;        // (null until retired)
+    };
+
+    Allocation allocateDedicated(VkDeviceSize size);
+    bool tryAllocateFromRing(VkDeviceSize size, VkDeviceSize alignment, Allocation& outAllocation);
+    void reclaim();
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    VmaAllocator m_allocator = VK_NULL_HANDLE;
+
+    VkBuffer m_buffer = VK_NULL_HANDLE;
+    VmaAllocation m_allocation = VK_NULL_HANDLE;
+    uint8_t* m_mappedData = nullptr;
+    VkDeviceSize m_capacity = 0;
+
+    VkDeviceSize m_head = 0;  // (start of oldest live allocation)
+    VkDeviceSize m_tail = 0;  // (end of newest live allocation)
+    std::deque<Entry> m_entries;
+    uint64_t m_frontEntryId = 1;
+    // Every dedicated allocation not yet destroyed, so one reclaimed after retiring isn't destroyed again when freed.
+    // Matched by id rather than handle, as a destroyed buffer's handle can be reused by a later allocation:
+    std::vector<DedicatedEntry> m_liveDedicated;
+    uint64_t m_nextDedicatedId = 1;
+
+    uint64_t m_numDedicatedAllocs = 0;
+    std::mutex m_mutex;
+  };
+}
@@ -0,0 +1,362 @@
+#include "TextureContainer.h"
+#include <Core/Logger.h>
+#include <Utils/BlockCompression.h>
+#include <Utils/FileMapping.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+  constexpr uint32_t DDS_MAGIC = 0x20534444;  // "DDS "
+  constexpr uint32_t DDS_FOURCC_DX10 = 0x30315844;  // "DX10"
+
+  constexpr uint32_t DDSD_CAPS = 0x1, DDSD_HEIGHT = 0x2, DDSD_WIDTH = 0x4, DDSD_PIXELFORMAT = 0x1000;
+  constexpr uint32_t DDSD_MIPMAPCOUNT = 0x20000, DDSD_LINEARSIZE = 0x80000;
+  constexpr uint32_t DDPF_FOURCC = 0x4;
+  constexpr uint32_t DDSCAPS_COMPLEX = 0x8, DDSCAPS_TEXTURE = 0x1000, DDSCAPS_MIPMAP = 0x400000;
+  constexpr uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+
+  struct DDSPixelFormat
+  {
+    uint32_t size;
+    uint32_t flags;
+    uint32_t fourCC;
+    uint32_t rgbBitCount;
+    uint32_t bitMasks[4];
+  };
+
+  struct DDSHeader
+  {
+    uint32_t size;
+    uint32_t flags;
+    uint32_t height;
+    uint32_t width;
+    uint32_t pitchOrLinearSize;
+    uint32_t depth;
+    uint32_t mipMapCount;
+    uint32_t reserved1[11];
+    DDSPixelFormat pixelFormat;
+    uint32_t caps[4];
+    uint32_t reserved2;
+  };
+  static_assert(sizeof(DDSHeader) == 124);
+
+  struct DDSHeaderDX10
+  {
+    uint32_t dxgiFormat;
+    uint32_t resourceDimension;
+    uint32_t miscFlag;
+    uint32_t arraySize;
+    uint32_t miscFlags2;
+  };
+
+  constexpr uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+  struct KTX2Header
+  {
+    uint8_t identifier[12];
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;
+    uint64_t sgdByteLength;
+  };
+  static_assert(sizeof(KTX2Header) == 80);
+
+  struct KTX2LevelIndex
+  {
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+  };
+
+  constexpr uint32_t makeFourCC(char a, char b, char c, char d)
+  {
+    return static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) | (static_cast<uint32_t>(c) << 16) | (static_cast<uint32_t>(d) << 24);
+  }
+
+  // DXGI_FORMAT values of the formats textures are loaded in:
+  struct DXGIFormatPair
+  {
+    uint32_t dxgiFormat;
+    VkFormat vkFormat;
+  };
+  constexpr DXGIFormatPair DXGI_FORMATS[] = {
+    { 28, VK_FORMAT_R8G8B8A8_UNORM },
+    { 29, VK_FORMAT_R8G8B8A8_SRGB },
+    { 49, VK_FORMAT_R8G8_UNORM },
+    { 61, VK_FORMAT_R8_UNORM },
+    { 71, VK_FORMAT_BC1_RGB_UNORM_BLOCK },
+    { 72, VK_FORMAT_BC1_RGB_SRGB_BLOCK },
+    { 77, VK_FORMAT_BC3_UNORM_BLOCK },
+    { 78, VK_FORMAT_BC3_SRGB_BLOCK },
+    { 80, VK_FORMAT_BC4_UNORM_BLOCK },
+    { 81, VK_FORMAT_BC4_SNORM_BLOCK },
+    { 83, VK_FORMAT_BC5_UNORM_BLOCK },
+    { 84, VK_FORMAT_BC5_SNORM_BLOCK },
+    { 98, VK_FORMAT_BC7_UNORM_BLOCK },
+    { 99, VK_FORMAT_BC7_SRGB_BLOCK },
+  };
+
+  VkFormat dxgiToVkFormat(uint32_t dxgiFormat)
+  {
+    for (const DXGIFormatPair& pair : DXGI_FORMATS)
+    {
+      if (pair.dxgiFormat == dxgiFormat) return pair.vkFormat;
+    }
+    return VK_FORMAT_UNDEFINED;
+  }
+
+  uint32_t vkToDxgiFormat(VkFormat format)
+  {
+    for (const DXGIFormatPair& pair : DXGI_FORMATS)
+    {
+      if (pair.vkFormat == format) return pair.dxgiFormat;
+    }
+    return 0;
+  }
+
+  // Fill in level offsets for a tightly-packed mip chain, clamping the level count to what the data actually holds:
+  bool computeLevelOffsets(cassidy::helper::ContainerImage& image, uint32_t numLevels)
+  {
+    image.levelOffsets.clear();
+
+    VkDeviceSize offset = 0;
+    for (uint32_t level = 0; level < std::max(numLevels, 1U); ++level)
+    {
+      const uint32_t width = std::max(image.extent.width >> level, 1U);
+      const uint32_t height = std::max(image.extent.height >> level, 1U);
+      const VkDeviceSize levelSize = cassidy::helper::getImageLevelSize(image.format, width, height);
+      if (offset + levelSize > image.data.size()) break;
+
+      image.levelOffsets.push_back(offset);
+      offset += levelSize;
+    }
+    return !image.levelOffsets.empty();
+  }
+}
+
+VkDeviceSize cassidy::helper::getImageLevelSize(VkFormat format, uint32_t width, uint32_t height)
+{
+  const uint32_t blockSize = getBCBlockSize(format);
+  if (blockSize != 0)
+    return static_cast<VkDeviceSize>((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+
+  switch (format)
+  {
+  case VK_FORMAT_R8_UNORM:
+  case VK_FORMAT_R8_SRGB:
+    return static_cast<VkDeviceSize>(width) * height;
+  case VK_FORMAT_R8G8_UNORM:
+    return static_cast<VkDeviceSize>(width) * height * 2;
+  case VK_FORMAT_R8G8B8A8_UNORM:
+  case VK_FORMAT_R8G8B8A8_SRGB:
+    return static_cast<VkDeviceSize>(width) * height * 4;
+  default:
+    return 0;
+  }
+}
+
+bool cassidy::helper::isTextureContainerPath(const std::string& filepath)
+{
+  const size_t extensionStart = filepath.find_last_of('.');
+  if (extensionStart == std::string::npos) return false;
+
+  std::string extension = filepath.substr(extensionStart + 1);
+  std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+  return extension == "dds" || extension == "ktx2";
+}
+
+bool cassidy::helper::readTextureContainer(const std::string& filepath, bool preferSrgb, ContainerImage& outImage)
+{
+  std::string extension = filepath.substr(filepath.find_last_of('.') + 1);
+  std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+
+  if (extension == "ktx2")
+    return readKTX2(filepath, outImage);
+  return readDDS(filepath, preferSrgb, outImage);
+}
+
+bool cassidy::helper::readDDS(const std::string& filepath, bool preferSrgb, ContainerImage& outImage)
+{
+  // (only the image data is copied out of the mapping, rather than the whole file being read in first)
+  cassidy::MappedFile file;
+  if (!file.open(filepath) || file.getSize() < sizeof(uint32_t) + sizeof(DDSHeader))
+    return false;
+  const std::span<const uint8_t> bytes = file.getData();
+
+  uint32_t magic;
+  DDSHeader header;
+  memcpy(&magic, bytes.data(), sizeof(magic));
+  memcpy(&header, bytes.data() + sizeof(magic), sizeof(header));
+
+  if (magic != DDS_MAGIC || header.size != sizeof(DDSHeader))
+  {
+    CS_LOG_ERROR("{0} isn't a valid DDS file!", filepath);
+    return false;
+  }
+
+  size_t dataOffset = sizeof(magic) + sizeof(header);
+  VkFormat format = VK_FORMAT_UNDEFINED;
+
+  if ((header.pixelFormat.flags & DDPF_FOURCC) && header.pixelFormat.fourCC == DDS_FOURCC_DX10)
+  {
+    DDSHeaderDX10 headerDX10;
+    if (bytes.size() < dataOffset + sizeof(headerDX10)) return false;
+
+    memcpy(&headerDX10, bytes.data() + dataOffset, sizeof(headerDX10));
+    dataOffset += sizeof(headerDX10);
+
+    if (headerDX10.resourceDimension != DDS_DIMENSION_TEXTURE2D || headerDX10.arraySize > 1)
+    {
+      CS_LOG_ERROR("{0} isn't a single 2D texture!", filepath);
+      return false;
+    }
+    format = dxgiToVkFormat(headerDX10.dxgiFormat);
+  }
+  else if (header.pixelFormat.flags & DDPF_FOURCC)
+  {
+    switch (header.pixelFormat.fourCC)
+    {
+    case makeFourCC('D', 'X', 'T', '1'):
+      format = preferSrgb ? VK_FORMAT_BC1_RGBA_SRGB_BLOCK : VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+      break;
+    case makeFourCC('D', 'X', 'T', '5'):
+      format = preferSrgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+      break;
+    case makeFourCC('A', 'T', 'I', '1'):
+    case makeFourCC('B', 'C', '4', 'U'):
+      format = VK_FORMAT_BC4_UNORM_BLOCK;
+      break;
+    case makeFourCC('A', 'T', 'I', '2'):
+    case makeFourCC('B', 'C', '5', 'U'):
+      format = VK_FORMAT_BC5_UNORM_BLOCK;
+      break;
+    }
+  }
+
+  if (format == VK_FORMAT_UNDEFINED)
+  {
+    CS_LOG_ERROR("{0} uses an unsupported DDS pixel format!", filepath);
+    return false;
+  }
+
+  outImage.format = format;
+  outImage.extent = { header.width, header.height };
+  outImage.data.assign(bytes.begin() + dataOffset, bytes.end());
+
+  const uint32_t numLevels = (header.flags & DDSD_MIPMAPCOUNT) ? header.mipMapCount : 1;
+  return computeLevelOffsets(outImage, numLevels);
+}
+
+bool cassidy::helper::readKTX2(const std::string& filepath, ContainerImage& outImage)
+{
+  cassidy::MappedFile file;
+  if (!file.open(filepath) || file.getSize() < sizeof(KTX2Header))
+    return false;
+  const std::span<const uint8_t> bytes = file.getData();
+
+  KTX2Header header;
+  memcpy(&header, bytes.data(), sizeof(header));
+
+  if (memcmp(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0)
+  {
+    CS_LOG_ERROR("{0} isn't a valid KTX2 file!", filepath);
+    return false;
+  }
+  if (header.supercompressionScheme != 0 || header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1)
+  {
+    CS_LOG_ERROR("{0} is supercompressed, or isn't a single 2D texture!", filepath);
+    return false;
+  }
+
+  outImage.format = static_cast<VkFormat>(header.vkFormat);
+  outImage.extent = { header.pixelWidth, header.pixelHeight };
+
+  // Levels can be stored in any order (typically smallest first), so repack them largest first:
+  const uint32_t numLevels = std::max(header.levelCount, 1U);
+  if (bytes.size() < sizeof(header) + numLevels * sizeof(KTX2LevelIndex))
+    return false;
+
+  outImage.data.clear();
+  outImage.levelOffsets.clear();
+  for (uint32_t level = 0; level < numLevels; ++level)
+  {
+    KTX2LevelIndex levelIndex;
+    memcpy(&levelIndex, bytes.data() + sizeof(header) + level * sizeof(KTX2LevelIndex), sizeof(levelIndex));
+
+    const uint32_t width = std::max(header.pixelWidth >> level, 1U);
+    const uint32_t height = std::max(header.pixelHeight >> level, 1U);
+    const VkDeviceSize levelSize = getImageLevelSize(outImage.format, width, height);
+
+    if (levelSize == 0 || levelIndex.byteLength < levelSize || levelIndex.byteOffset + levelSize > bytes.size())
+    {
+      if (level == 0)
+      {
+        CS_LOG_ERROR("{0} has an unsupported format ({1}) or truncated level data!", filepath, header.vkFormat);
+        return false;
+      }
+      break;
+    }
+
+    outImage.levelOffsets.push_back(outImage.data.size());
+    outImage.data.insert(outImage.data.end(), bytes.begin() + levelIndex.byteOffset, bytes.begin() + levelIndex.byteOffset + levelSize);
+  }
+  return true;
+}
+
+bool cassidy::helper::writeDDS(const std::string& filepath, const ContainerImage& image)
+{
+  const uint32_t dxgiFormat = vkToDxgiFormat(image.format);
+  if (dxgiFormat == 0)
+  {
+    CS_LOG_ERROR("Can't write format {0} to a DDS file!", static_cast<uint32_t>(image.format));
+    return false;
+  }
+
+  std::ofstream file(filepath, std::ios::binary);
+  if (!file.is_open())
+  {
+    CS_LOG_ERROR("Failed to open {0} for writing!", filepath);
+    return false;
+  }
+
+  const uint32_t numLevels = static_cast<uint32_t>(image.levelOffsets.size());
+
+  DDSHeader header = {};
+  header.size = sizeof(DDSHeader);
+  header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+  header.height = image.extent.height;
+  header.width = image.extent.width;
+  header.pitchOrLinearSize = static_cast<uint32_t>(getImageLevelSize(image.format, image.extent.width, image.extent.height));
+  header.depth = 1;
+  header.mipMapCount = numLevels;
+  header.pixelFormat.size = sizeof(DDSPixelFormat);
+  header.pixelFormat.flags = DDPF_FOURCC;
+  header.pixelFormat.fourCC = DDS_FOURCC_DX10;
+  header.caps[0] = DDSCAPS_TEXTURE | (numLevels > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0);
+
+  DDSHeaderDX10 headerDX10 = {};
+  headerDX10.dxgiFormat = dxgiFormat;
+  headerDX10.resourceDimension = DDS_DIMENSION_TEXTURE2D;
+  headerDX10.arraySize = 1;
+
+  file.write(reinterpret_cast<const char*>(&DDS_MAGIC), sizeof(DDS_MAGIC));
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(&headerDX10), sizeof(headerDX10));
+  file.write(reinterpret_cast<const char*>(image.data.data()), image.data.size());
+
+  return file.good();
+}
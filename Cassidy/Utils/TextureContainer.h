@@ -0,0 +1,33 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cassidy::helper
+{
+  // Texture data stored in a DDS or KTX2 container, with every mip level tightly packed one after another
+  // (largest first):
+  struct ContainerImage
+  {
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    VkExtent2D extent = {};
+    std::vector<uint8_t> data;
+    std::vector<VkDeviceSize> levelOffsets;   // (one per mip level, into data)
+  };
+
+  // Size in bytes of one mip level, for the uncompressed and BC formats containers are read in (0 if unsupported):
+  VkDeviceSize getImageLevelSize(VkFormat format, uint32_t width, uint32_t height);
+
+  // Only uncompressed 2D textures (no arrays, cubemaps or supercompression) are supported. DDS files without a DX10
+  // header don't say whether their colour is sRGB, so preferSrgb picks for them:
+  bool readTextureContainer(const std::string& filepath, bool preferSrgb, ContainerImage& outImage);
+  bool readDDS(const std::string& filepath, bool preferSrgb, ContainerImage& outImage);
+  bool readKTX2(const std::string& filepath, ContainerImage& outImage);
+
+  // Always writes a DX10 header, so the exact format (including sRGB-ness) survives a round trip:
+  bool writeDDS(const std::string& filepath, const ContainerImage& image);
+
+  bool isTextureContainerPath(const std::string& filepath);
+}
@@ -3,11 +3,14 @@
 #include <vulkan/vulkan.h>
 #include <deque>
 #include <array>
+#include <atomic>
 #include <functional>
+#include <mutex>
 #include <optional>
 #include <string>
 
 #include "Vendor/vma/vk_mem_alloc.h"
+#include <Utils/StagingRingBuffer.h>
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -56,7 +59,7 @@ struct SwapchainSupportDetails
 struct SpirvShaderCode
 {
   size_t codeSize;
-  uint32_t* codeBuffer;
+  const uint32_t* codeBuffer;
 };
 
 struct Vertex
@@ -110,6 +113,22 @@ enum class LoadResult : uint8_t
   UPLOADING     = 1 << 3,
 };
 
+// Load result that can be written by a job system worker while the render thread reads it. Copyable so
+// resources holding one can still be stored by value in containers.
+struct AtomicLoadResult
+{
+  AtomicLoadResult(LoadResult result = LoadResult::READY_TO_LOAD) : value(result) {}
+  AtomicLoadResult(const AtomicLoadResult& other) : value(other.load()) {}
+
+  inline AtomicLoadResult& operator=(const AtomicLoadResult& other) { value.store(other.load(), std::memory_order_release); return *this; }
+  inline AtomicLoadResult& operator=(LoadResult result)             { value.store(result, std::memory_order_release); return *this; }
+
+  inline operator LoadResult() const  { return load(); }
+  inline LoadResult load() const      { return value.load(std::memory_order_acquire); }
+
+  std::atomic<LoadResult> value;
+};
+
 // An image object allocated with Vulkan Memory Allocator
 struct AllocatedImage
 {
@@ -180,6 +199,8 @@ struct FrameData
 
   AllocatedBuffer perPassMatrixUniformBuffer;
   AllocatedBuffer perPassLightUniformBuffer;
+  void* perPassMatrixMappedData;  // (both per-pass buffers stay mapped for the renderer's lifetime)
+  void* perPassLightMappedData;
 
   VkDescriptorSet perPassSet;
 
@@ -194,6 +215,10 @@ struct UploadContext
   VkFence uploadFence;
   VkQueue uploadQueue;
   VkQueue graphicsQueueRef;
+  uint32_t uploadQueueFamily;
+  uint32_t graphicsQueueFamily;
+  cassidy::StagingRingBuffer stagingRing;
+  std::mutex submitMutex;   // (upload command buffer and fence are shared between job system workers)
 };
 
 struct DebugContext
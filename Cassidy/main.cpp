@@ -1,6 +1,39 @@
 #include "Core/Engine.h"
 #include <spdlog/spdlog.h>
 
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+// Usage: Cassidy [--headless] [--frames <count>] [--capture <output.png>]
+static cassidy::HeadlessSettings parseHeadlessSettings(int argc, char* argv[])
+{
+  cassidy::HeadlessSettings settings;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "--headless") == 0)
+      settings.enabled = true;
+    else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+    {
+      const char* frameCount = argv[++i];
+      try
+      {
+        settings.numFrames = static_cast<uint32_t>(std::stoul(frameCount));
+      }
+      catch (const std::logic_error&)   // (std::invalid_argument or std::out_of_range)
+      {
+        spdlog::warn("Invalid frame count: {0}, rendering {1} frames instead", frameCount, settings.numFrames);
+      }
+    }
+    else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc)
+      settings.capturePath = argv[++i];
+    else
+      spdlog::warn("Unrecognised argument: {0}", argv[i]);
+  }
+  return settings;
+}
+
 int main(int argc, char* argv[])
 {
   spdlog::info("Hello, world!");
@@ -9,6 +42,7 @@ int main(int argc, char* argv[])
   spdlog::warn("This is a warning message!");
 
   cassidy::Engine engine(glm::uvec2(1280, 720));
+  engine.setHeadless(parseHeadlessSettings(argc, argv));
 
   engine.init();
 
@@ -17,4 +51,4 @@ int main(int argc, char* argv[])
   engine.release();
 
   return 0;
-}
\ No newline at end of file
+}
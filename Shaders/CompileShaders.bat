@@ -2,6 +2,7 @@ C:/VulkanSDK/1.3.296.0/Bin/glslc.exe helloTriangle.vert -o helloTriangleVert.spv
 C:/VulkanSDK/1.3.296.0/Bin/glslc.exe helloTriangle.frag -o helloTriangleFrag.spv
 
 C:/VulkanSDK/1.3.296.0/Bin/glslc.exe phongLighting.frag -o phongLightingFrag.spv
+C:/VulkanSDK/1.3.296.0/Bin/glslc.exe phongLightingBindless.frag -o phongLightingBindlessFrag.spv
 C:/VulkanSDK/1.3.296.0/Bin/glslc.exe gammaCorrect.comp -o gammaCorrectComp.spv
 
 pause
\ No newline at end of file
@@ -16,15 +16,23 @@ layout (set = 0, binding = 0) uniform MatrixBuffer
     mat4 invViewProj;
 } u_matrixBuffer;
 
-layout (set = 1, binding = 0) uniform PerObjectBuffer
+struct PerObjectData
 {
     mat4 world;
+};
+
+// Bound at the dynamic offset of the current instance group, one element per instance:
+layout (std430, set = 1, binding = 0) readonly buffer PerObjectBuffer
+{
+    PerObjectData objects[];
 } u_perObjectBuffer;
 
 void main()
 {
-    positionWS = (u_perObjectBuffer.world * vec4(aPos, 1.0)).xyz;
+    const mat4 world = u_perObjectBuffer.objects[gl_InstanceIndex].world;
+
+    positionWS = (world * vec4(aPos, 1.0)).xyz;
     gl_Position = u_matrixBuffer.viewProj * vec4(positionWS, 1.0);
     uv = aUV;
-    normalWS = (u_perObjectBuffer.world * vec4(aNormal, 0.0)).xyz;
+    normalWS = (world * vec4(aNormal, 0.0)).xyz;
 }
\ No newline at end of file
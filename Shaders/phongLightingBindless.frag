@@ -0,0 +1,94 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout (location = 0) in vec2 uv;
+layout (location = 1) in vec3 normalWS;
+layout (location = 2) in vec3 positionWS;
+
+layout (location = 0) out vec4 outColour;
+
+layout (set = 0, binding = 0) uniform MatrixBuffer
+{
+    mat4 view;
+    mat4 proj;
+    mat4 viewProj;
+    mat4 invViewProj;
+} u_matrixBuffer;
+
+struct DirectionalLight
+{
+	vec4 directionWS;
+	vec3 colour;
+	float ambient;
+};
+
+#define NUM_LIGHTS 4
+
+layout (set = 0, binding = 1) uniform LightBuffer
+{
+	uvec4 numActiveLights;
+	DirectionalLight dirLights[NUM_LIGHTS];
+} u_lightBuffer;
+
+// Every loaded texture, indexed by the material buffer:
+layout (set = 2, binding = 0) uniform texture2D u_textures[];
+layout (set = 2, binding = 1) uniform sampler u_linearSampler;
+
+struct MaterialData
+{
+	uint albedoIndex;
+	uint specularIndex;
+	uint normalIndex;
+	uint padding;
+};
+
+layout (std430, set = 3, binding = 0) readonly buffer MaterialBuffer
+{
+	MaterialData materials[];
+} u_materialBuffer;
+
+layout (push_constant) uniform MaterialConstants
+{
+	uint materialIndex;
+} u_materialConstants;
+
+vec4 sampleTexture(uint textureIndex, vec2 texCoord)
+{
+	return texture(sampler2D(u_textures[nonuniformEXT(textureIndex)], u_linearSampler), texCoord);
+}
+
+void main()
+{
+	const MaterialData material = u_materialBuffer.materials[u_materialConstants.materialIndex];
+
+	vec3 albedoColour = sampleTexture(material.albedoIndex, uv).rgb;
+	float specularColour = sampleTexture(material.specularIndex, uv).r;
+	vec3 normalColour = sampleTexture(material.normalIndex, uv).rgb;
+
+	const vec3 normal = normalize(normalWS);
+	const vec3 camPos = u_matrixBuffer.view[3].xyz;
+	const vec3 viewDir = normalize(camPos - positionWS);
+
+	vec3 lighting = vec3(0.0);
+
+	for (uint i = 0; i < u_lightBuffer.numActiveLights.x; ++i)
+	{
+		const DirectionalLight dirLight = u_lightBuffer.dirLights[i];
+	
+		const vec3 lightDir = normalize(dirLight.directionWS.xyz);
+		const vec3 halfVec = normalize(lightDir + viewDir);
+
+		const float NdotL = max(dot(normal, lightDir), 0.0);
+		const float NdotH = max(dot(normal, halfVec), 0.0);
+
+		const float diff = NdotL;
+		const float spec = pow(NdotH, 64.0) * specularColour;
+
+		lighting += (diff + spec + dirLight.ambient) * dirLight.colour.rgb;
+	}
+
+	lighting *= albedoColour;
+	vec3 gammaCorrect = pow(lighting, vec3(1.0 / 2.2));	
+
+	outColour = vec4(lighting, 1.0);
+}
\ No newline at end of file